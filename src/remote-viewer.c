@@ -107,6 +107,31 @@ remote_viewer_deactivated(VirtViewerApp *app, gboolean connect_error)
 static gchar **opt_args = NULL;
 static char *opt_title = NULL;
 static gboolean opt_shared = FALSE;
+static gchar *opt_video_codecs = NULL;
+static gchar *opt_compression = NULL;
+static gchar *opt_vnc_depth = NULL;
+static gint opt_vnc_lossy = -1;
+static gchar *opt_vnc_encodings = NULL;
+static gboolean opt_calibrate = FALSE;
+static gint opt_benchmark = 0;
+
+static gboolean
+option_vnc_lossy(G_GNUC_UNUSED const gchar *option_name,
+                 const gchar *value,
+                 G_GNUC_UNUSED gpointer data, GError **error)
+{
+    if (value == NULL || g_str_equal(value, "on")) {
+        opt_vnc_lossy = TRUE;
+        return TRUE;
+    }
+    if (g_str_equal(value, "off")) {
+        opt_vnc_lossy = FALSE;
+        return TRUE;
+    }
+
+    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED, _("Invalid vnc-lossy-encoding argument: %s"), value);
+    return FALSE;
+}
 
 static void
 remote_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, GOptionGroup *group)
@@ -116,6 +141,20 @@ remote_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, G
           N_("Set window title"), NULL },
         { "shared", 's', 0, G_OPTION_ARG_NONE,  &opt_shared,
           N_("Share client session"), NULL },
+        { "preferred-video-codecs", '\0', 0, G_OPTION_ARG_STRING, &opt_video_codecs,
+          N_("Video codecs to stream the display with, most preferred first, separated by commas"), "CODECS" },
+        { "preferred-compression", '\0', 0, G_OPTION_ARG_STRING, &opt_compression,
+          N_("Image compression of the display"), "COMPRESSION" },
+        { "vnc-depth", '\0', 0, G_OPTION_ARG_STRING, &opt_vnc_depth,
+          N_("Color depth of the VNC display: 'default', 'full', 'medium', 'low' or 'ultra-low'"), "DEPTH" },
+        { "vnc-lossy-encoding", '\0', G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, option_vnc_lossy,
+          N_("Let the VNC server compress the display with JPEG"), N_("<on|off>") },
+        { "vnc-encodings", '\0', 0, G_OPTION_ARG_STRING, &opt_vnc_encodings,
+          N_("VNC encodings of the display, most preferred first, separated by commas"), "ENCODINGS" },
+        { "calibrate-video-codecs", '\0', 0, G_OPTION_ARG_NONE, &opt_calibrate,
+          N_("Try each video codec and remember the best one for the host"), NULL },
+        { "benchmark", '\0', 0, G_OPTION_ARG_INT, &opt_benchmark,
+          N_("Measure the session for SECONDS without showing it, print a JSON summary and quit"), "SECONDS" },
         { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_STRING_ARRAY, &opt_args,
           NULL, "URI|VV-FILE" },
         { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
@@ -143,6 +182,13 @@ remote_viewer_local_command_line (GApplication   *gapp,
     if (ret)
         goto end;
 
+    if (opt_benchmark < 0 || (opt_benchmark > 0 && !opt_args)) {
+        g_printerr(_("\nError: --benchmark needs a positive duration and a URI\n\n"));
+        ret = TRUE;
+        *status = 1;
+        goto end;
+    }
+
     if (!opt_args) {
         self->open_recent_dialog = TRUE;
     } else {
@@ -160,6 +206,13 @@ remote_viewer_local_command_line (GApplication   *gapp,
         g_object_set(app, "title", opt_title, NULL);
 
     virt_viewer_app_set_shared(app, opt_shared);
+    virt_viewer_app_set_preferred_video_codecs(app, opt_video_codecs);
+    virt_viewer_app_set_preferred_compression(app, opt_compression);
+    virt_viewer_app_set_vnc_depth(app, opt_vnc_depth);
+    virt_viewer_app_set_vnc_lossy_encoding(app, opt_vnc_lossy);
+    virt_viewer_app_set_vnc_encodings(app, opt_vnc_encodings);
+    virt_viewer_app_set_calibrate_video_codecs(app, opt_calibrate);
+    virt_viewer_app_set_benchmark(app, opt_benchmark);
 
  end:
     if (ret && *status)
@@ -35,7 +35,9 @@
 #include <gio/gio.h>
 #include <glib/gprintf.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <errno.h>
+#include <time.h>
 
 #ifndef G_OS_WIN32
 #include <glib-unix.h>
@@ -51,6 +53,12 @@
 #include "virt-viewer-window.h"
 #include "virt-viewer-session.h"
 #include "virt-viewer-util.h"
+#include "virt-viewer-timing.h"
+#include "virt-viewer-link-quality.h"
+#include "virt-viewer-screenshot.h"
+#include "virt-viewer-recorder.h"
+#include "virt-viewer-keymap.h"
+#include "virt-viewer-log-sink.h"
 #ifdef HAVE_GTK_VNC
 #include "virt-viewer-session-vnc.h"
 #endif
@@ -108,6 +116,12 @@ static VirtViewerWindow *virt_viewer_app_get_vte_window(VirtViewerApp *self, con
 static void virt_viewer_app_set_actions_sensitive(VirtViewerApp *self);
 static void virt_viewer_app_set_display_auto_resize(VirtViewerApp *self,
                                                     VirtViewerDisplay *display);
+static void virt_viewer_app_start_benchmark(VirtViewerApp *self);
+static void virt_viewer_app_benchmark_ready(VirtViewerApp *self);
+static void virt_viewer_app_finish_benchmark(VirtViewerApp *self, const gchar *result);
+static void virt_viewer_app_start_latency_test(VirtViewerApp *self);
+static void virt_viewer_app_save_input_latency(VirtViewerApp *self);
+static VirtViewerDisplayScaling virt_viewer_app_get_display_scaling(VirtViewerApp *self);
 
 /* Application actions */
 static void virt_viewer_app_action_monitor(GSimpleAction *act,
@@ -143,6 +157,9 @@ struct _VirtViewerAppPrivate {
     gboolean initialized;
 
     VirtViewerSession *session;
+    VirtViewerSession *reusable_session; /* closed, kept for the next connection */
+    gboolean warm_reconnect;
+    gboolean lazy_channels;
     gboolean active;
     gboolean connected;
     gboolean cancelled;
@@ -155,6 +172,10 @@ struct _VirtViewerAppPrivate {
     int port;/* ssh */
     char *user; /* ssh */
     char *transport;
+    gchar *ssh_control_dir; /* holds the socket of the ssh master connection */
+    gchar *ssh_control_host; /* user@host:port the master connection goes to */
+    GKeyFile *ssh_relays; /* cached relay program of each ssh host */
+    gboolean ssh_relay_probing;
     char *pretty_address;
     gchar *guest_name;
     gboolean grabbed;
@@ -171,7 +192,40 @@ struct _VirtViewerAppPrivate {
     gchar **usb_device_reset_accel;
     gboolean quit_on_disconnect;
     gboolean supports_share_clipboard;
-    VirtViewerKeyMapping *keyMappings;
+    gchar *keymap_string;
+    VirtViewerKeymap *keymap;
+
+    VirtViewerTiming *timing;
+    gchar *timing_file;
+    gchar **disabled_channels;
+    gchar *link_profile;
+    gchar *preferred_video_codecs;
+    gchar *preferred_compression;
+    gchar *vnc_depth;
+    gint vnc_lossy_encoding; /* -1 when not set */
+    gchar *vnc_encodings;
+    gboolean calibrate_video_codecs;
+    gchar *serial_log;
+    gint serial_log_max_size; /* MiB */
+    gboolean serial_log_compress;
+    gchar *screenshot_dir;
+    gchar *screenshot_format;
+    VirtViewerRecorder *recorder;
+    guint record_id;
+    gint benchmark_seconds;
+    VirtViewerBenchmark *benchmark;
+    gboolean benchmark_ready;
+    guint benchmark_id;
+    guint benchmark_tick_id;
+    gint64 benchmark_tick;
+    gint latency_test;
+    gint latency_test_sent;
+    guint latency_test_id;
+    gchar *scaling; /* nick of a VirtViewerDisplayScaling */
+    clock_t benchmark_cpu;
+    gint max_width;
+    gint max_height;
+    gint64 max_area;
 };
 
 
@@ -193,6 +247,8 @@ enum {
     PROP_VM_RUNNING,
     PROP_CONFIG_SHARE_CLIPBOARD,
     PROP_SUPPORTS_SHARE_CLIPBOARD,
+    PROP_TIMING_FILE,
+    PROP_SCALING,
 };
 
 void
@@ -586,94 +642,67 @@ void virt_viewer_app_set_uuid_string(VirtViewerApp *self, const gchar *uuid_stri
     priv->uuid = g_strdup(uuid_string);
 
     virt_viewer_app_apply_monitor_mapping(self);
+    virt_viewer_app_update_keymap(self);
 }
 
-static
-void virt_viewer_app_set_keymap(VirtViewerApp *self, const gchar *keymap_string)
+/* Compiles the keymap profile of the VM, from the "keymap" list of its
+ * section in the settings, and the --keymap on top of it */
+static void
+virt_viewer_app_update_keymap(VirtViewerApp *self)
 {
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    gchar **key, **keymaps = NULL, **valkey, **valuekeys = NULL;
-    VirtViewerKeyMapping *keyMappingArray, *keyMappingPtr;
-    guint *mappedArray, *ptrMove;
-
-    if (keymap_string == NULL) {
-        g_debug("keymap string is empty - nothing to do");
-        priv->keyMappings = NULL;
-        return;
-    }
-
-    g_debug("keymap string set to %s", keymap_string);
-
-    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    VirtViewerKeymap *keymap = virt_viewer_keymap_new();
+    GList *l;
 
-    g_debug("keymap command-line set to %s", keymap_string);
-    if (keymap_string) {
-        keymaps = g_strsplit(keymap_string, ",", -1);
-    }
+    if (priv->uuid) {
+        GError *error = NULL;
+        gchar **mappings = g_key_file_get_string_list(priv->config, priv->uuid,
+                                                      "keymap", NULL, &error);
 
-    if (!keymaps || g_strv_length(keymaps) == 0) {
-        g_strfreev(keymaps);
-        return;
+        if (error) {
+            if (error->code != G_KEY_FILE_ERROR_GROUP_NOT_FOUND
+                && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND)
+                g_warning("Error reading keymap for %s: %s", priv->uuid, error->message);
+            g_clear_error(&error);
+        } else {
+            g_debug("Using the keymap profile of %s", priv->uuid);
+            virt_viewer_keymap_add_list(keymap, (const gchar * const *)mappings);
+        }
+        g_strfreev(mappings);
     }
 
-    keyMappingPtr = keyMappingArray = g_new0(VirtViewerKeyMapping,  g_strv_length(keymaps));
-
-    g_debug("Allocated %d number of mappings",  g_strv_length(keymaps));
+    if (priv->keymap_string) {
+        gchar **mappings = g_strsplit(priv->keymap_string, ",", -1);
 
-    for (key = keymaps; *key != NULL; key++) {
-        gchar *srcKey = strstr(*key, "=");
-        const gchar *value = (srcKey == NULL) ? NULL : (*srcKey = '\0', srcKey + 1);
-        if (value == NULL) {
-                g_warning("Missing mapping value for key '%s'", srcKey);
-                continue;
-        }
-
-        // Key value must be resolved to GDK key code
-        // along with mapped key which can also be void (for no action)
-        guint kcode;
-        kcode = gdk_keyval_from_name(*key);
-        if (kcode == GDK_KEY_VoidSymbol) {
-                g_warning("Unable to lookup '%s' key", *key);
-                continue;
-        }
-        g_debug("Mapped source key '%s' to %x", *key, kcode);
+        virt_viewer_keymap_add_list(keymap, (const gchar * const *)mappings);
+        g_strfreev(mappings);
+    }
 
-        valuekeys = g_strsplit(value, "+", -1);
+    g_debug("%u keys mapped", virt_viewer_keymap_get_size(keymap));
+    if (virt_viewer_keymap_get_size(keymap) == 0)
+        g_clear_pointer(&keymap, virt_viewer_keymap_unref);
 
-        keyMappingPtr->sourceKey = kcode;
-        keyMappingPtr->numMappedKeys = g_strv_length(valuekeys);
-        keyMappingPtr->isLast = FALSE;
+    if (keymap == NULL && priv->keymap == NULL)
+        return;
 
-        if (!valuekeys || g_strv_length(valuekeys) == 0) {
-                g_debug("No value set for key '%s' it will be blocked", *key);
-                keyMappingPtr->mappedKeys = NULL;
-                keyMappingPtr++;
-                g_strfreev(valuekeys);
-                continue;
-        }
+    virt_viewer_keymap_unref(priv->keymap);
+    priv->keymap = keymap;
+    for (l = priv->windows; l; l = l->next)
+        g_object_set(l->data, "keymap", priv->keymap, NULL);
+}
 
-        ptrMove = mappedArray = g_new0(guint, g_strv_length(valuekeys));
+static
+void virt_viewer_app_set_keymap(VirtViewerApp *self, const gchar *keymap_string)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
 
-        guint mcode;
-        for (valkey = valuekeys; *valkey != NULL; valkey++) {
-                g_debug("Value key to map '%s'", *valkey);
-                mcode = gdk_keyval_from_name(*valkey);
-                if (mcode == GDK_KEY_VoidSymbol) {
-                        g_warning("Unable to lookup mapped key '%s' it will be ignored", *valkey);
-                }
-                g_debug("Mapped dest key '%s' to %x", *valkey, mcode);
-                *ptrMove++ = mcode;
-        }
-        keyMappingPtr->mappedKeys = mappedArray;
-        keyMappingPtr++;
-        g_strfreev(valuekeys);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
 
-    }
-    keyMappingPtr--;
-    keyMappingPtr->isLast=TRUE;
+    g_debug("keymap command-line set to %s", keymap_string);
+    g_free(priv->keymap_string);
+    priv->keymap_string = g_strdup(keymap_string);
 
-    priv->keyMappings = keyMappingArray;
-    g_strfreev(keymaps);
+    virt_viewer_app_update_keymap(self);
 }
 
 void
@@ -790,7 +819,7 @@ virt_viewer_app_about_delete(GtkWidget *dialog,
 #ifndef G_OS_WIN32
 
 static int
-virt_viewer_app_open_tunnel(const char **cmd)
+virt_viewer_app_open_tunnel(const char **cmd, pid_t *child)
 {
     int fd[2];
     pid_t pid;
@@ -818,24 +847,356 @@ virt_viewer_app_open_tunnel(const char **cmd)
         _exit(1);
     }
     close(fd[1]);
+    *child = pid;
     return fd[0];
 }
 
+/* Identifies the ssh connection, for sharing it and caching what the
+ * remote end provides */
+static gchar *
+virt_viewer_app_get_ssh_host(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    return g_strdup_printf("%s%s%s:%d",
+                           priv->user ? priv->user : "",
+                           priv->user ? "@" : "",
+                           priv->host, priv->port);
+}
+
+static gchar *
+virt_viewer_app_get_ssh_control_path(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    return g_build_filename(priv->ssh_control_dir, "master", NULL);
+}
+
+static void
+virt_viewer_app_close_ssh_master(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    const gchar *argv[] = { "ssh", "-o", NULL, "-O", "exit", NULL, NULL };
+    gchar *path, *control_path;
+    GError *error = NULL;
+
+    if (priv->ssh_control_host == NULL)
+        return;
+
+    path = virt_viewer_app_get_ssh_control_path(self);
+    control_path = g_strdup_printf("ControlPath=%s", path);
+    argv[2] = control_path;
+    argv[5] = priv->ssh_control_host;
+
+    g_debug("Closing ssh master connection to %s", priv->ssh_control_host);
+    if (!g_spawn_sync(NULL, (gchar **)argv, NULL,
+                      G_SPAWN_SEARCH_PATH |
+                      G_SPAWN_STDOUT_TO_DEV_NULL |
+                      G_SPAWN_STDERR_TO_DEV_NULL,
+                      NULL, NULL, NULL, NULL, NULL, &error)) {
+        g_debug("Failed to close ssh master connection: %s", error->message);
+        g_clear_error(&error);
+    }
+
+    g_free(control_path);
+    g_free(path);
+    g_clear_pointer(&priv->ssh_control_host, g_free);
+}
+
+/*
+ * All the tunnels to a host share a single ssh connection, started by the
+ * first of them, so that the channels of a session, and the reconnections
+ * happening shortly after a disconnection, don't each go through a key
+ * exchange and authentication. Returns NULL if this is not possible.
+ */
+static gchar *
+virt_viewer_app_get_ssh_master(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    gchar *host;
+
+    if (priv->ssh_control_dir == NULL) {
+        GError *error = NULL;
+
+        priv->ssh_control_dir = g_dir_make_tmp("virt-viewer-ssh-XXXXXX", &error);
+        if (priv->ssh_control_dir == NULL) {
+            g_debug("Not sharing ssh connections: %s", error->message);
+            g_clear_error(&error);
+            return NULL;
+        }
+    }
+
+    host = virt_viewer_app_get_ssh_host(self);
+    if (g_strcmp0(host, priv->ssh_control_host) != 0) {
+        virt_viewer_app_close_ssh_master(self);
+        priv->ssh_control_host = host;
+    } else {
+        g_free(host);
+    }
+
+    return virt_viewer_app_get_ssh_control_path(self);
+}
+
+/*
+ * The relay program found on each ssh host (socat or nc) is cached in
+ * ~/.cache/virt-viewer/ssh-relays, so that tunnels can run it directly
+ * instead of looking for it every time.
+ */
+#define SSH_RELAY_CACHE_TTL (7 * 24 * 60 * 60) /* seconds */
+
+static gchar *
+virt_viewer_app_get_ssh_relays_file(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), "virt-viewer", "ssh-relays", NULL);
+}
+
+static GKeyFile *
+virt_viewer_app_get_ssh_relays(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (priv->ssh_relays == NULL) {
+        gchar *file = virt_viewer_app_get_ssh_relays_file();
+        GError *error = NULL;
+
+        priv->ssh_relays = g_key_file_new();
+        if (!g_key_file_load_from_file(priv->ssh_relays, file, G_KEY_FILE_NONE, &error)) {
+            if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+                g_debug("Couldn't load ssh relays cache: %s", error->message);
+            g_clear_error(&error);
+        }
+        g_free(file);
+    }
+
+    return priv->ssh_relays;
+}
+
+static void
+virt_viewer_app_save_ssh_relays(VirtViewerApp *self)
+{
+    gchar *file = virt_viewer_app_get_ssh_relays_file();
+    gchar *dir = g_path_get_dirname(file);
+    GError *error = NULL;
+
+    if (g_mkdir_with_parents(dir, S_IRWXU) < 0 ||
+        !g_key_file_save_to_file(virt_viewer_app_get_ssh_relays(self), file, &error)) {
+        g_debug("Couldn't save ssh relays cache: %s",
+                error ? error->message : g_strerror(errno));
+        g_clear_error(&error);
+    }
+
+    g_free(dir);
+    g_free(file);
+}
+
+static gchar *
+virt_viewer_app_lookup_ssh_relay(VirtViewerApp *self, const gchar *host)
+{
+    GKeyFile *relays = virt_viewer_app_get_ssh_relays(self);
+    gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+    gint64 checked = g_key_file_get_int64(relays, host, "checked", NULL);
+
+    if (checked > now || now - checked > SSH_RELAY_CACHE_TTL)
+        return NULL;
+
+    return g_key_file_get_string(relays, host, "relay", NULL);
+}
+
+static void
+virt_viewer_app_forget_ssh_relay(VirtViewerApp *self, const gchar *host)
+{
+    if (g_key_file_remove_group(virt_viewer_app_get_ssh_relays(self), host, NULL)) {
+        g_debug("Forgetting the ssh relay of %s", host);
+        virt_viewer_app_save_ssh_relays(self);
+    }
+}
+
+typedef struct {
+    VirtViewerApp *app;
+    gchar *host;
+    gboolean cached; /* the tunnel runs the cached relay */
+} VirtViewerSshTunnel;
+
+static void
+virt_viewer_ssh_tunnel_free(gpointer data)
+{
+    VirtViewerSshTunnel *tunnel = data;
+
+    g_object_unref(tunnel->app);
+    g_free(tunnel->host);
+    g_free(tunnel);
+}
+
+static void
+virt_viewer_app_ssh_relay_probed(GObject *source,
+                                 GAsyncResult *result,
+                                 gpointer user_data)
+{
+    VirtViewerSshTunnel *probe = user_data;
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(probe->app);
+    GKeyFile *relays = virt_viewer_app_get_ssh_relays(probe->app);
+    gchar *relay = NULL;
+    GError *error = NULL;
+
+    priv->ssh_relay_probing = FALSE;
+
+    if (!g_subprocess_communicate_utf8_finish(G_SUBPROCESS(source), result,
+                                              &relay, NULL, &error)) {
+        g_debug("Failed to look for the ssh relay of %s: %s", probe->host, error->message);
+        g_clear_error(&error);
+        goto end;
+    }
+
+    if (relay)
+        g_strstrip(relay);
+    /* anything but a plain path, such as an alias, is left to the shell */
+    if (!g_subprocess_get_successful(G_SUBPROCESS(source)) ||
+        relay == NULL || !g_path_is_absolute(relay) || strchr(relay, '\n') != NULL) {
+        g_debug("No usable ssh relay found on %s", probe->host);
+        goto end;
+    }
+
+    g_debug("Using %s as ssh relay on %s", relay, probe->host);
+    g_key_file_set_string(relays, probe->host, "relay", relay);
+    g_key_file_set_int64(relays, probe->host, "checked", g_get_real_time() / G_USEC_PER_SEC);
+    virt_viewer_app_save_ssh_relays(probe->app);
+
+end:
+    g_free(relay);
+    virt_viewer_ssh_tunnel_free(probe);
+}
+
+/* Looks for the relay without delaying the tunnel being opened, which
+ * keeps using the shell to find it this time */
+static void
+virt_viewer_app_probe_ssh_relay(VirtViewerApp *self, const char *control_path)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GPtrArray *argv = g_ptr_array_new_with_free_func(g_free);
+    VirtViewerSshTunnel *probe;
+    GSubprocess *subprocess;
+    GError *error = NULL;
+
+    if (priv->ssh_relay_probing)
+        return;
+
+    g_ptr_array_add(argv, g_strdup("ssh"));
+    if (control_path) {
+        /* use the master connection if it is up, but don't race with the
+         * tunnel for starting it */
+        g_ptr_array_add(argv, g_strdup("-o"));
+        g_ptr_array_add(argv, g_strdup("ControlMaster=no"));
+        g_ptr_array_add(argv, g_strdup("-o"));
+        g_ptr_array_add(argv, g_strdup_printf("ControlPath=%s", control_path));
+    }
+    if (priv->port) {
+        g_ptr_array_add(argv, g_strdup("-p"));
+        g_ptr_array_add(argv, g_strdup_printf("%d", priv->port));
+    }
+    if (priv->user) {
+        g_ptr_array_add(argv, g_strdup("-l"));
+        g_ptr_array_add(argv, g_strdup(priv->user));
+    }
+    g_ptr_array_add(argv, g_strdup(priv->host));
+    g_ptr_array_add(argv, g_strdup("command -v socat || command -v nc"));
+    g_ptr_array_add(argv, NULL);
+
+    subprocess = g_subprocess_newv((const gchar * const *)argv->pdata,
+                                   G_SUBPROCESS_FLAGS_STDOUT_PIPE |
+                                   G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+                                   &error);
+    g_ptr_array_unref(argv);
+    if (subprocess == NULL) {
+        g_debug("Failed to look for the ssh relay: %s", error->message);
+        g_clear_error(&error);
+        return;
+    }
+
+    probe = g_new0(VirtViewerSshTunnel, 1);
+    probe->app = g_object_ref(self);
+    probe->host = virt_viewer_app_get_ssh_host(self);
+    priv->ssh_relay_probing = TRUE;
+    g_subprocess_communicate_utf8_async(subprocess, NULL, NULL,
+                                        virt_viewer_app_ssh_relay_probed, probe);
+    g_object_unref(subprocess);
+}
+
+static void
+virt_viewer_app_ssh_tunnel_exited(GPid pid, gint status, gpointer user_data)
+{
+    VirtViewerSshTunnel *tunnel = user_data;
+    GError *error = NULL;
+
+    g_debug("ssh tunnel %d exited with status %d", pid, status);
+    /* the shell couldn't find or run the relay: it was removed, or the
+     * cache is wrong. A refused connection or a network drop keeps it. */
+    if (tunnel->cached && !g_spawn_check_exit_status(status, &error) &&
+        error->domain == G_SPAWN_EXIT_ERROR &&
+        (error->code == 126 || error->code == 127))
+        virt_viewer_app_forget_ssh_relay(tunnel->app, tunnel->host);
+    g_clear_error(&error);
+
+    g_spawn_close_pid(pid);
+}
+
+/* Appends the arguments making socat, or nc, relay stdio to the display */
+static void
+virt_viewer_app_append_relay_args(GString *cat,
+                                  gboolean socat,
+                                  const char *host,
+                                  const char *port,
+                                  const char *unixsock)
+{
+    if (socat) {
+        g_string_append(cat, " - ");
+        if (port) {
+            // Wrap raw IPv6 address in []
+            const char *connect_str;
+            if (strstr(host, ":") != NULL) {
+                connect_str = "TCP:[%s]:%s";
+            } else {
+                connect_str = "TCP:%s:%s";
+            }
+            g_string_append_printf(cat, connect_str, host, port);
+        } else
+            g_string_append_printf(cat, "UNIX-CONNECT:%s", unixsock);
+    } else {
+        if (port)
+            g_string_append_printf(cat, " %s %s", host, port);
+        else
+            g_string_append_printf(cat, " -U %s", unixsock);
+    }
+}
 
 static int
 virt_viewer_app_open_tunnel_ssh(const char *sshhost,
                                 int sshport,
                                 const char *sshuser,
+                                const char *control_path,
+                                const char *relay,
                                 const char *host,
                                 const char *port,
-                                const char *unixsock)
+                                const char *unixsock,
+                                pid_t *pid)
 {
-    const char *cmd[8];
+    const char *cmd[14];
     char portstr[12] = { 0 };
+    gchar *control_path_opt = NULL;
     int n = 0;
     GString *cat;
 
     cmd[n++] = "ssh";
+    if (control_path) {
+        control_path_opt = g_strdup_printf("ControlPath=%s", control_path);
+        cmd[n++] = "-o";
+        cmd[n++] = "ControlMaster=auto";
+        cmd[n++] = "-o";
+        cmd[n++] = control_path_opt;
+        /* keep the connection for reconnections, but not forever in case
+         * we don't get to close it */
+        cmd[n++] = "-o";
+        cmd[n++] = "ControlPersist=60";
+    }
     if (sshport) {
         cmd[n++] = "-p";
         sprintf(portstr, "%d", sshport);
@@ -847,38 +1208,71 @@ virt_viewer_app_open_tunnel_ssh(const char *sshhost,
     }
     cmd[n++] = sshhost;
 
-    cat = g_string_new("if (command -v socat) >/dev/null 2>&1");
-
-    g_string_append(cat, "; then socat - ");
-    if (port) {
-        // Wrap raw IPv6 address in []
-        const char *connect_str;
-        if (strstr(host, ":") != NULL) {
-            connect_str = "TCP:[%s]:%s";
-        } else {
-            connect_str = "TCP:%s:%s";
-        }
-        g_string_append_printf(cat, connect_str, host, port);
-    } else
-        g_string_append_printf(cat, "UNIX-CONNECT:%s", unixsock);
+    if (relay) {
+        gchar *quoted = g_shell_quote(relay);
 
-    g_string_append(cat, "; else nc ");
-    if (port)
-        g_string_append_printf(cat, "%s %s", host, port);
-    else
-        g_string_append_printf(cat, "-U %s", unixsock);
+        cat = g_string_new("exec ");
+        g_string_append(cat, quoted);
+        virt_viewer_app_append_relay_args(cat, g_str_has_suffix(relay, "socat"),
+                                          host, port, unixsock);
+        g_free(quoted);
+    } else {
+        cat = g_string_new("if (command -v socat) >/dev/null 2>&1");
 
-    g_string_append(cat, "; fi");
+        g_string_append(cat, "; then socat");
+        virt_viewer_app_append_relay_args(cat, TRUE, host, port, unixsock);
+        g_string_append(cat, "; else nc");
+        virt_viewer_app_append_relay_args(cat, FALSE, host, port, unixsock);
+        g_string_append(cat, "; fi");
+    }
 
     cmd[n++] = cat->str;
     cmd[n++] = NULL;
 
-    n = virt_viewer_app_open_tunnel(cmd);
+    n = virt_viewer_app_open_tunnel(cmd, pid);
     g_string_free(cat, TRUE);
+    g_free(control_path_opt);
 
     return n;
 }
 
+static int
+virt_viewer_app_connect_ssh_tunnel(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    gchar *control_path = virt_viewer_app_get_ssh_master(self);
+    VirtViewerSshTunnel *tunnel = g_new0(VirtViewerSshTunnel, 1);
+    gchar *relay;
+    pid_t pid;
+    int fd;
+
+    virt_viewer_app_timing_mark(self, "ssh-tunnel");
+
+    tunnel->app = g_object_ref(self);
+    tunnel->host = virt_viewer_app_get_ssh_host(self);
+    relay = virt_viewer_app_lookup_ssh_relay(self, tunnel->host);
+    tunnel->cached = relay != NULL;
+
+    fd = virt_viewer_app_open_tunnel_ssh(priv->host, priv->port, priv->user,
+                                         control_path, relay, priv->ghost,
+                                         priv->gport, priv->unixsock, &pid);
+    if (fd < 0) {
+        virt_viewer_ssh_tunnel_free(tunnel);
+        goto end;
+    }
+
+    g_child_watch_add_full(G_PRIORITY_DEFAULT, pid,
+                           virt_viewer_app_ssh_tunnel_exited,
+                           tunnel, virt_viewer_ssh_tunnel_free);
+    if (relay == NULL)
+        virt_viewer_app_probe_ssh_relay(self, control_path);
+
+end:
+    g_free(relay);
+    g_free(control_path);
+    return fd;
+}
+
 static int
 virt_viewer_app_open_unix_sock(const char *unixsock, GError **error)
 {
@@ -1186,8 +1580,8 @@ virt_viewer_app_window_new(VirtViewerApp *self, gint nth)
     g_signal_connect(w, "hide", G_CALLBACK(viewer_window_visible_cb), self);
     g_signal_connect(w, "show", G_CALLBACK(viewer_window_visible_cb), self);
 
-    if (priv->keyMappings) {
-       g_object_set(window, "keymap", priv->keyMappings, NULL);
+    if (priv->keymap) {
+       g_object_set(window, "keymap", priv->keymap, NULL);
     }
 
     return window;
@@ -1286,6 +1680,9 @@ display_show_hint(VirtViewerDisplay *display,
         if (hint & VIRT_VIEWER_DISPLAY_SHOW_HINT_READY) {
             win = display_show_notebook_get_window(self, display);
             virt_viewer_window_show(win);
+            virt_viewer_app_timing_finish(self, "ready");
+            virt_viewer_app_benchmark_ready(self);
+            virt_viewer_app_start_latency_test(self);
         } else {
             if (!priv->kiosk && win) {
                 nb = virt_viewer_window_get_notebook(win);
@@ -1316,6 +1713,8 @@ virt_viewer_app_display_added(VirtViewerSession *session G_GNUC_UNUSED,
 
     g_hash_table_insert(priv->displays, GINT_TO_POINTER(nth), g_object_ref(display));
     virt_viewer_app_set_display_auto_resize(self, display);
+    virt_viewer_display_set_scaling(display, virt_viewer_app_get_display_scaling(self));
+    virt_viewer_display_set_count_frames(display, priv->benchmark_seconds > 0);
 
     g_signal_connect(display, "notify::show-hint",
                      G_CALLBACK(display_show_hint), NULL);
@@ -1385,6 +1784,16 @@ static void notify_software_reader_cb(GObject    *gobject G_GNUC_UNUSED,
     virt_viewer_update_smartcard_accels(VIRT_VIEWER_APP(user_data));
 }
 
+static void
+virt_viewer_app_drop_session(VirtViewerSession *session)
+{
+    if (session == NULL)
+        return;
+
+    virt_viewer_session_clear_displays(session);
+    g_object_unref(session);
+}
+
 gboolean
 virt_viewer_app_create_session(VirtViewerApp *self, const gchar *type, GError **error)
 {
@@ -1392,6 +1801,7 @@ virt_viewer_app_create_session(VirtViewerApp *self, const gchar *type, GError **
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
     g_return_val_if_fail(priv->session == NULL, FALSE);
     g_return_val_if_fail(type != NULL, FALSE);
+    VirtViewerSession *reusable = g_steal_pointer(&priv->reusable_session);
 
 #ifdef HAVE_GTK_VNC
     if (g_ascii_strcasecmp(type, "vnc") == 0) {
@@ -1406,6 +1816,14 @@ virt_viewer_app_create_session(VirtViewerApp *self, const gchar *type, GError **
         GtkWindow *window = virt_viewer_window_get_window(priv->main_window);
         virt_viewer_app_trace(self, "Guest %s has a %s display",
                               priv->guest_name, type);
+        if (virt_viewer_app_get_display_scaling(self) == VIRT_VIEWER_DISPLAY_SCALING_NEAREST)
+            g_warning("SPICE displays always interpolate, the 'nearest' scaling is smooth");
+        if (VIRT_VIEWER_IS_SESSION_SPICE(reusable)) {
+            /* its signals are still connected */
+            virt_viewer_app_trace(self, "Reusing the previous %s session", type);
+            priv->session = g_steal_pointer(&reusable);
+            return TRUE;
+        }
         priv->session = virt_viewer_session_spice_new(self, window);
     } else
 #endif
@@ -1416,9 +1834,12 @@ virt_viewer_app_create_session(VirtViewerApp *self, const gchar *type, GError **
 
         virt_viewer_app_trace(self, "Guest %s has unsupported %s display type",
                               priv->guest_name, type);
+        virt_viewer_app_drop_session(reusable);
         return FALSE;
     }
 
+    virt_viewer_app_drop_session(reusable);
+
     g_signal_connect(priv->session, "session-initialized",
                      G_CALLBACK(virt_viewer_app_initialized), self);
     g_signal_connect(priv->session, "session-connected",
@@ -1494,8 +1915,7 @@ virt_viewer_app_channel_open(VirtViewerSession *session,
     priv = virt_viewer_app_get_instance_private(self);
     if (priv->transport && g_ascii_strcasecmp(priv->transport, "ssh") == 0 &&
         !priv->direct && fd == -1) {
-        if ((fd = virt_viewer_app_open_tunnel_ssh(priv->host, priv->port, priv->user,
-                                                  priv->ghost, priv->gport, priv->unixsock)) < 0) {
+        if ((fd = virt_viewer_app_connect_ssh_tunnel(self)) < 0) {
             error_message = g_strdup(_("Connect to SSH failed."));
             g_debug("channel open ssh tunnel: %s", error_message);
         }
@@ -1568,9 +1988,7 @@ virt_viewer_app_default_activate(VirtViewerApp *self, GError **error)
                               priv->host, p ? p : "");
         g_free(p);
 
-        if ((fd = virt_viewer_app_open_tunnel_ssh(priv->host, priv->port,
-                                                  priv->user, priv->ghost,
-                                                  priv->gport, priv->unixsock)) < 0)
+        if ((fd = virt_viewer_app_connect_ssh_tunnel(self)) < 0)
             return FALSE;
     } else if (priv->unixsock && fd == -1) {
         virt_viewer_app_trace(self, "Opening direct UNIX connection to display at %s",
@@ -1601,6 +2019,74 @@ virt_viewer_app_default_activate(VirtViewerApp *self, GError **error)
     return FALSE;
 }
 
+static VirtViewerTiming *
+virt_viewer_app_get_timing(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (priv->timing == NULL)
+        priv->timing = virt_viewer_timing_new(g_get_prgname());
+
+    return priv->timing;
+}
+
+/* Begins timing a connection attempt, unless one is already going on */
+void
+virt_viewer_app_timing_start(VirtViewerApp *self, const gchar *phase)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    virt_viewer_timing_start(virt_viewer_app_get_timing(self), phase);
+}
+
+void
+virt_viewer_app_timing_mark(VirtViewerApp *self, const gchar *fmt, ...)
+{
+    VirtViewerAppPrivate *priv;
+    gchar *phase;
+    va_list args;
+
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    priv = virt_viewer_app_get_instance_private(self);
+    if (priv->timing == NULL || !virt_viewer_timing_is_started(priv->timing))
+        return;
+
+    va_start(args, fmt);
+    phase = g_strdup_vprintf(fmt, args);
+    va_end(args);
+
+    virt_viewer_timing_mark(priv->timing, phase);
+    g_free(phase);
+}
+
+/* Ends the current connection attempt, and appends it to the timing file */
+void
+virt_viewer_app_timing_finish(VirtViewerApp *self, const gchar *result)
+{
+    VirtViewerAppPrivate *priv;
+    GError *error = NULL;
+    gchar *record;
+
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    priv = virt_viewer_app_get_instance_private(self);
+    if (priv->timing == NULL)
+        return;
+
+    record = virt_viewer_timing_finish(priv->timing, result, g_get_monotonic_time());
+    if (record == NULL)
+        return;
+
+    g_debug("Connection timing: %s", record);
+    if (priv->timing_file &&
+        !virt_viewer_timing_append_to_file(priv->timing_file, record, &error)) {
+        g_warning("%s", error->message);
+        g_clear_error(&error);
+    }
+    g_free(record);
+}
+
 gboolean
 virt_viewer_app_activate(VirtViewerApp *self, GError **error)
 {
@@ -1613,12 +2099,14 @@ virt_viewer_app_activate(VirtViewerApp *self, GError **error)
     if (priv->active)
         return FALSE;
 
+    virt_viewer_app_timing_mark(self, "activate");
     ret = VIRT_VIEWER_APP_GET_CLASS(self)->activate(self, error);
 
     if (ret == FALSE) {
         if(error != NULL && *error != NULL)
             virt_viewer_app_show_status(self, "%s", (*error)->message);
         priv->connected = FALSE;
+        virt_viewer_app_timing_finish(self, "failed");
     } else {
         virt_viewer_app_show_status(self, _("Connecting to graphic server"));
         priv->cancelled = FALSE;
@@ -1700,7 +2188,14 @@ virt_viewer_app_initial_connect(VirtViewerApp *self, GError **error)
     g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
     klass = VIRT_VIEWER_APP_GET_CLASS(self);
 
-    return klass->initial_connect(self, error);
+    virt_viewer_app_timing_start(self, "initial-connect");
+
+    if (!klass->initial_connect(self, error)) {
+        virt_viewer_app_timing_finish(self, "failed");
+        return FALSE;
+    }
+
+    return TRUE;
 }
 
 static gboolean
@@ -1745,6 +2240,10 @@ virt_viewer_app_deactivate(VirtViewerApp *self, gboolean connect_error)
     if (!priv->active)
         return;
 
+    virt_viewer_app_timing_finish(self, connect_error ? "failed" : "disconnected");
+    virt_viewer_app_finish_benchmark(self, connect_error ? "failed" : "disconnected");
+    virt_viewer_app_save_input_latency(self);
+
     if (priv->session) {
         virt_viewer_session_close(VIRT_VIEWER_SESSION(priv->session));
     }
@@ -1765,6 +2264,11 @@ virt_viewer_app_deactivate(VirtViewerApp *self, gboolean connect_error)
         priv->authretry = FALSE;
         g_idle_add(virt_viewer_app_retryauth, self);
     } else {
+        if (priv->warm_reconnect &&
+            virt_viewer_session_can_reconnect(priv->session)) {
+            virt_viewer_app_drop_session(priv->reusable_session);
+            priv->reusable_session = g_steal_pointer(&priv->session);
+        }
         g_clear_object(&priv->session);
         virt_viewer_app_deactivated(self, connect_error);
     }
@@ -1778,6 +2282,7 @@ virt_viewer_app_connected(VirtViewerSession *session G_GNUC_UNUSED,
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
 
     priv->connected = TRUE;
+    virt_viewer_app_timing_mark(self, "session-connected");
 
     if (priv->kiosk)
         virt_viewer_app_show_status(self, "%s", "");
@@ -1793,6 +2298,7 @@ virt_viewer_app_initialized(VirtViewerSession *session G_GNUC_UNUSED,
 {
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
     priv->initialized = TRUE;
+    virt_viewer_app_timing_mark(self, "session-initialized");
     virt_viewer_app_update_title(self);
 }
 
@@ -1969,6 +2475,14 @@ virt_viewer_app_get_property (GObject *object, guint property_id,
         g_value_set_boolean(value, virt_viewer_app_get_supports_share_clipboard(self));
         break;
 
+    case PROP_TIMING_FILE:
+        g_value_set_string(value, priv->timing_file);
+        break;
+
+    case PROP_SCALING:
+        g_value_set_string(value, priv->scaling ? priv->scaling : "smooth");
+        break;
+
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -2046,7 +2560,16 @@ virt_viewer_app_set_property (GObject *object, guint property_id,
         virt_viewer_app_set_supports_share_clipboard(self, g_value_get_boolean(value));
         break;
 
-    default:
+    case PROP_TIMING_FILE:
+        g_free(priv->timing_file);
+        priv->timing_file = g_value_dup_string(value);
+        break;
+
+    case PROP_SCALING:
+        virt_viewer_app_set_scaling(self, g_value_get_string(value));
+        break;
+
+    default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
 }
@@ -2061,6 +2584,9 @@ virt_viewer_app_dispose (GObject *object)
         gtk_widget_destroy(priv->preferences);
     priv->preferences = NULL;
 
+    /* its displays are removed while the windows are still there */
+    virt_viewer_app_drop_session(g_steal_pointer(&priv->reusable_session));
+
     if (priv->windows) {
         GList *tmp = priv->windows;
         /* null-ify before unrefing, because we need
@@ -2082,6 +2608,8 @@ virt_viewer_app_dispose (GObject *object)
 
     priv->resource = NULL;
     g_clear_object(&priv->session);
+    /* the serial logs of the closed consoles are written before quitting */
+    virt_viewer_log_sink_wait_all();
     g_free(priv->title);
     priv->title = NULL;
     g_free(priv->guest_name);
@@ -2109,6 +2637,48 @@ virt_viewer_app_dispose (GObject *object)
 
     virt_viewer_app_free_connect_info(self);
 
+#ifndef G_OS_WIN32
+    virt_viewer_app_close_ssh_master(self);
+#endif
+    if (priv->ssh_control_dir) {
+        g_rmdir(priv->ssh_control_dir);
+        g_clear_pointer(&priv->ssh_control_dir, g_free);
+    }
+    g_clear_pointer(&priv->ssh_relays, g_key_file_free);
+
+    if (priv->timing) {
+        virt_viewer_app_timing_finish(self, "aborted");
+        g_clear_pointer(&priv->timing, virt_viewer_timing_free);
+    }
+    g_free(priv->timing_file);
+    priv->timing_file = NULL;
+    g_clear_pointer(&priv->disabled_channels, g_strfreev);
+    g_clear_pointer(&priv->link_profile, g_free);
+    g_clear_pointer(&priv->preferred_video_codecs, g_free);
+    g_clear_pointer(&priv->preferred_compression, g_free);
+    g_clear_pointer(&priv->vnc_depth, g_free);
+    g_clear_pointer(&priv->vnc_encodings, g_free);
+    g_clear_pointer(&priv->serial_log, g_free);
+    g_clear_pointer(&priv->screenshot_dir, g_free);
+    g_clear_pointer(&priv->screenshot_format, g_free);
+    g_clear_pointer(&priv->keymap_string, g_free);
+    g_clear_pointer(&priv->keymap, virt_viewer_keymap_unref);
+    g_clear_pointer(&priv->scaling, g_free);
+    virt_viewer_app_stop_recording(self);
+    if (priv->benchmark_id > 0) {
+        g_source_remove(priv->benchmark_id);
+        priv->benchmark_id = 0;
+    }
+    if (priv->benchmark_tick_id > 0) {
+        g_source_remove(priv->benchmark_tick_id);
+        priv->benchmark_tick_id = 0;
+    }
+    g_clear_pointer(&priv->benchmark, virt_viewer_benchmark_free);
+    if (priv->latency_test_id > 0) {
+        g_source_remove(priv->latency_test_id);
+        priv->latency_test_id = 0;
+    }
+
     G_OBJECT_CLASS (virt_viewer_app_parent_class)->dispose (object);
 }
 
@@ -2145,6 +2715,21 @@ static gboolean opt_kiosk = FALSE;
 static gboolean opt_kiosk_quit = FALSE;
 static gchar *opt_cursor = NULL;
 static gchar *opt_resize = NULL;
+static gchar *opt_timing = NULL;
+static gchar *opt_disable_channels = NULL;
+static gboolean opt_lazy_channels = FALSE;
+static gchar *opt_link_profile = NULL;
+static gchar *opt_serial_log = NULL;
+static gint opt_serial_log_max_size = 0;
+static gboolean opt_serial_log_compress = FALSE;
+static gchar *opt_screenshot_dir = NULL;
+static gchar *opt_screenshot_format = NULL;
+static gchar *opt_record = NULL;
+static gint opt_record_fps = 5;
+static gint opt_latency_test = 0;
+static gchar *opt_scaling = NULL;
+static gchar *opt_max_resolution = NULL;
+static gint64 opt_max_area = 0;
 
 #ifndef G_OS_WIN32
 static gboolean
@@ -2161,6 +2746,18 @@ sigint_cb(gpointer data)
 
     return priv->quitting ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
 }
+
+static gboolean
+sigusr1_cb(gpointer data)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(data);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    g_debug("got SIGUSR1, saving screenshots");
+    virt_viewer_app_save_screenshots(self, priv->screenshot_dir);
+
+    return G_SOURCE_CONTINUE;
+}
 #endif
 
 static void
@@ -2496,6 +3093,24 @@ virt_viewer_app_on_application_startup(GApplication *app)
     virt_viewer_app_set_keymap(self, opt_keymap);
 
     priv->verbose = opt_verbose;
+    priv->timing_file = g_strdup(opt_timing);
+    virt_viewer_app_set_disabled_channels(self, opt_disable_channels);
+    priv->lazy_channels = opt_lazy_channels;
+    priv->link_profile = g_strdup(opt_link_profile);
+    virt_viewer_app_set_serial_log(self, opt_serial_log);
+    virt_viewer_app_set_serial_log_max_size(self, opt_serial_log_max_size);
+    virt_viewer_app_set_serial_log_compress(self, opt_serial_log_compress);
+    priv->screenshot_dir = g_strdup(opt_screenshot_dir);
+    priv->screenshot_format = g_strdup(opt_screenshot_format ? opt_screenshot_format : "png");
+#ifndef G_OS_WIN32
+    if (priv->screenshot_dir)
+        g_unix_signal_add(SIGUSR1, sigusr1_cb, self);
+#endif
+    if (opt_record)
+        virt_viewer_app_start_recording(self, opt_record, opt_record_fps);
+    priv->latency_test = opt_latency_test;
+    if (priv->benchmark_seconds > 0)
+        virt_viewer_app_start_benchmark(self);
     priv->quit_on_disconnect = opt_kiosk ? opt_kiosk_quit : TRUE;
 
     priv->main_window = virt_viewer_app_window_new(self,
@@ -2607,6 +3222,75 @@ virt_viewer_app_local_command_line (GApplication   *gapp,
         virt_viewer_app_set_cursor(self, cursor);
     }
 
+    if (opt_scaling) {
+        if (virt_viewer_enum_from_string(VIRT_VIEWER_TYPE_DISPLAY_SCALING, opt_scaling) < 0) {
+            g_printerr("unknown value '%s' for --scaling\n", opt_scaling);
+            *status = 1;
+            ret = TRUE;
+            goto end;
+        }
+        virt_viewer_app_set_scaling(self, opt_scaling);
+    }
+
+    if (opt_max_resolution) {
+        gint width, height;
+
+        if (!virt_viewer_parse_resolution(opt_max_resolution, &width, &height)) {
+            g_printerr("--max-resolution expects WIDTHxHEIGHT, not '%s'\n", opt_max_resolution);
+            *status = 1;
+            ret = TRUE;
+            goto end;
+        }
+        virt_viewer_app_set_max_resolution(self, width, height);
+    }
+
+    if (opt_max_area < 0) {
+        g_printerr("--max-area expects a number of pixels\n");
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+    if (opt_max_area > 0)
+        virt_viewer_app_set_max_area(self, opt_max_area);
+
+    if (opt_link_profile &&
+        !g_str_equal(opt_link_profile, "auto") &&
+        !virt_viewer_link_profile_from_string(opt_link_profile, NULL)) {
+        g_printerr("unknown value '%s' for --link-profile\n", opt_link_profile);
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+
+    if (opt_serial_log_max_size < 0) {
+        g_printerr("invalid value '%d' for --serial-log-max-size\n", opt_serial_log_max_size);
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+
+    if (opt_record_fps < 1 || opt_record_fps > 60) {
+        g_printerr("invalid value '%d' for --record-fps\n", opt_record_fps);
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+
+    if (opt_latency_test < 0) {
+        g_printerr("invalid value '%d' for --latency-test\n", opt_latency_test);
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+
+    if (opt_screenshot_format &&
+        !virt_viewer_screenshot_format_supported(opt_screenshot_format)) {
+        g_printerr("unsupported image format '%s' for --screenshot-format\n", opt_screenshot_format);
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+
     if (opt_resize) {
         GAction *resize = g_action_map_lookup_action(G_ACTION_MAP(self),
                                                     "auto-resize");
@@ -2781,6 +3465,24 @@ virt_viewer_app_class_init (VirtViewerAppClass *klass)
                                                          FALSE,
                                                          G_PARAM_READWRITE |
                                                          G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(object_class,
+                                    PROP_TIMING_FILE,
+                                    g_param_spec_string("timing-file",
+                                                        "Timing file",
+                                                        "File the timing of the connection attempts is appended to",
+                                                        NULL,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(object_class,
+                                    PROP_SCALING,
+                                    g_param_spec_string("scaling",
+                                                        "Scaling",
+                                                        "How the displays are scaled: off, integer, nearest or smooth",
+                                                        "smooth",
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -2810,6 +3512,8 @@ virt_viewer_app_init(VirtViewerApp *self)
 
     g_clear_error(&error);
 
+    priv->vnc_lossy_encoding = -1;
+
     g_signal_connect(self, "notify::guest-name", G_CALLBACK(title_maybe_changed), NULL);
     g_signal_connect(self, "notify::title", G_CALLBACK(title_maybe_changed), NULL);
     g_signal_connect(self, "notify::guri", G_CALLBACK(title_maybe_changed), NULL);
@@ -2837,236 +3541,1084 @@ gboolean virt_viewer_app_get_direct(VirtViewerApp *self)
     return priv->direct;
 }
 
-gchar*
-virt_viewer_app_get_release_cursor_display_hotkey(VirtViewerApp *self)
+/* When enabled, a session which can reconnect is kept once closed, with
+ * its displays and windows, and reused by the next connection to the
+ * same type of display */
+void
+virt_viewer_app_set_warm_reconnect(VirtViewerApp *self, gboolean warm_reconnect)
 {
-    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    return priv->release_cursor_display_hotkey;
+    priv->warm_reconnect = warm_reconnect;
 }
 
-void
-virt_viewer_app_set_release_cursor_display_hotkey(VirtViewerApp *self, const gchar *hotkey)
+gboolean virt_viewer_app_get_warm_reconnect(VirtViewerApp *self)
 {
-    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    g_free(priv->release_cursor_display_hotkey);
-    priv->release_cursor_display_hotkey = g_strdup(hotkey);
-    g_object_notify(G_OBJECT(self), "release-cursor-display-hotkey");
+    return priv->warm_reconnect;
 }
 
-gchar**
-virt_viewer_app_get_hotkey_names(void)
+/* @channels is a comma separated list of channel names, the session
+ * decides which of them it can do without */
+void
+virt_viewer_app_set_disabled_channels(VirtViewerApp *self, const gchar *channels)
 {
-    return hotkey_names;
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    g_clear_pointer(&priv->disabled_channels, g_strfreev);
+    if (channels == NULL)
+        return;
+
+    priv->disabled_channels = g_strsplit(channels, ",", -1);
 }
 
-void
-virt_viewer_app_clear_hotkeys(VirtViewerApp *self)
+gchar** virt_viewer_app_get_disabled_channels(VirtViewerApp *self)
 {
-    gint i;
-    const gchar *no_accels[] = { NULL };
-    for (i = 0 ; i < G_N_ELEMENTS(hotkey_defaults); i++) {
-        gtk_application_set_accels_for_action(GTK_APPLICATION(self),
-                                              hotkey_defaults[i].action,
-                                              no_accels);
-    }
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
 
-    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
-    virt_viewer_app_set_release_cursor_display_hotkey(self, "Control_L+Alt_L");
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    g_strfreev(priv->insert_smartcard_accel);
-    priv->insert_smartcard_accel = NULL;
-    g_strfreev(priv->remove_smartcard_accel);
-    priv->remove_smartcard_accel = NULL;
-    g_strfreev(priv->usb_device_reset_accel);
-    priv->usb_device_reset_accel = NULL;
+    return priv->disabled_channels;
 }
 
+/* When enabled, the session only connects the channels needed to show and
+ * control the guest display at first, the other ones wait until they are
+ * used */
 void
-virt_viewer_app_set_hotkey(VirtViewerApp *self, const gchar *hotkey_name,
-                           const gchar *hotkey)
+virt_viewer_app_set_lazy_channels(VirtViewerApp *self, gboolean lazy_channels)
 {
     g_return_if_fail(VIRT_VIEWER_IS_APP(self));
-    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-
-    const gchar *action = NULL;
-    int i;
-    for (i = 0; i < G_N_ELEMENTS(hotkey_defaults); i++) {
-        if (g_str_equal(hotkey_name, hotkey_defaults[i].name)) {
-            action = hotkey_defaults[i].action;
-            break;
-        }
-    }
-    if (action == NULL) {
-        g_warning("Unknown hotkey name %s", hotkey_name);
-        return;
-    }
 
-    gchar *accel = spice_hotkey_to_gtk_accelerator(hotkey);
-    const gchar *accels[] = { accel, NULL };
-    guint accel_key;
-    GdkModifierType accel_mods;
-    /*
-     * First try the spice translated accel.
-     * Works for basic modifiers and single letters/numbers
-     * where forced uppercasing matches GTK key names
-     */
-    gtk_accelerator_parse(accels[0], &accel_key, &accel_mods);
-    if (accel_key == 0 && accel_mods == 0) {
-        /* Fallback to native GTK accels to cope with
-         * case sensitive accels
-         */
-        accels[0] = hotkey;
-        gtk_accelerator_parse(accels[0], &accel_key, &accel_mods);
-    }
-    if (g_str_equal(hotkey_name, "release-cursor")) {
-        if (accel_key == 0) {
-            /* GTK does not support using modifiers as hotkeys without any non-modifiers
-             * (eg. CTRL+ALT), however the displays do support this for the grab sequence.
-             */
-            virt_viewer_app_set_release_cursor_display_hotkey(self, hotkey);
-            g_free(accel);
-            return;
-        }
-        virt_viewer_app_set_release_cursor_display_hotkey(self, NULL);
-    }
-    if (accel_key == 0) {
-        g_warning("Invalid hotkey '%s' for '%s'", hotkey, hotkey_name);
-        g_free(accel);
-        return;
-    }
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->lazy_channels = lazy_channels;
+}
 
-    if (g_str_equal(hotkey_name, "smartcard-insert")) {
-        g_strfreev(priv->insert_smartcard_accel);
-        priv->insert_smartcard_accel = g_strdupvc(accels);
-        g_free(accel);
-        virt_viewer_update_smartcard_accels(self);
-        return;
-    }
-    if (g_str_equal(hotkey_name, "smartcard-remove")) {
-        g_strfreev(priv->remove_smartcard_accel);
-        priv->remove_smartcard_accel = g_strdupvc(accels);
-        g_free(accel);
-        virt_viewer_update_smartcard_accels(self);
-        return;
-    }
-    if (g_str_equal(hotkey_name, "usb-device-reset")) {
-        g_strfreev(priv->usb_device_reset_accel);
-        priv->usb_device_reset_accel = g_strdupvc(accels);
-        g_free(accel);
-        virt_viewer_update_usbredir_accels(self);
-        return;
-    }
+gboolean virt_viewer_app_get_lazy_channels(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
 
-    gtk_application_set_accels_for_action(GTK_APPLICATION(self), action, accels);
-    g_free(accel);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->lazy_channels;
 }
 
+/* @codecs is a comma separated list of video codec names, most preferred
+ * first */
 void
-virt_viewer_app_set_hotkeys(VirtViewerApp *self, const gchar *hotkeys_str)
+virt_viewer_app_set_preferred_video_codecs(VirtViewerApp *self, const gchar *codecs)
 {
-    gchar **hotkey, **hotkeys = NULL;
-
     g_return_if_fail(VIRT_VIEWER_IS_APP(self));
 
-    if (hotkeys_str)
-        hotkeys = g_strsplit(hotkeys_str, ",", -1);
-
-    if (!hotkeys || g_strv_length(hotkeys) == 0) {
-        g_strfreev(hotkeys);
-        return;
-    }
-
-    virt_viewer_app_clear_hotkeys(self);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    g_free(priv->preferred_video_codecs);
+    priv->preferred_video_codecs = g_strdup(codecs);
+}
 
-    for (hotkey = hotkeys; *hotkey != NULL; hotkey++) {
-        gchar *eq = strstr(*hotkey, "=");
-        const gchar *value = (eq == NULL) ? NULL : (*eq = '\0', eq + 1);
-        if (value == NULL || *value == '\0') {
-            g_warning("Missing value for hotkey '%s'", *hotkey);
-            continue;
-        }
+const gchar *virt_viewer_app_get_preferred_video_codecs(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
 
-        virt_viewer_app_set_hotkey(self, *hotkey, value);
-    }
-    g_strfreev(hotkeys);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->preferred_video_codecs;
 }
 
 void
-virt_viewer_app_set_attach(VirtViewerApp *self, gboolean attach)
+virt_viewer_app_set_preferred_compression(VirtViewerApp *self, const gchar *compression)
 {
     g_return_if_fail(VIRT_VIEWER_IS_APP(self));
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    priv->attach = attach;
+    g_free(priv->preferred_compression);
+    priv->preferred_compression = g_strdup(compression);
 }
 
-gboolean
-virt_viewer_app_get_attach(VirtViewerApp *self)
+const gchar *virt_viewer_app_get_preferred_compression(VirtViewerApp *self)
 {
-    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    return priv->attach;
+    return priv->preferred_compression;
 }
 
 void
-virt_viewer_app_set_shared(VirtViewerApp *self, gboolean shared)
+virt_viewer_app_set_vnc_depth(VirtViewerApp *self, const gchar *depth)
 {
     g_return_if_fail(VIRT_VIEWER_IS_APP(self));
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    priv->shared = shared;
+    g_free(priv->vnc_depth);
+    priv->vnc_depth = g_strdup(depth);
 }
 
-gboolean
-virt_viewer_app_get_shared(VirtViewerApp *self)
+const gchar *virt_viewer_app_get_vnc_depth(VirtViewerApp *self)
 {
-    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    return priv->shared;
+    return priv->vnc_depth;
 }
 
-void virt_viewer_app_set_cursor(VirtViewerApp *self, VirtViewerCursor cursor)
+/* @lossy is -1 to leave it to the connection file and the link profile */
+void
+virt_viewer_app_set_vnc_lossy_encoding(VirtViewerApp *self, gint lossy)
 {
     g_return_if_fail(VIRT_VIEWER_IS_APP(self));
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    priv->cursor = cursor;
+    priv->vnc_lossy_encoding = lossy;
 }
 
-VirtViewerCursor virt_viewer_app_get_cursor(VirtViewerApp *self)
+gint virt_viewer_app_get_vnc_lossy_encoding(VirtViewerApp *self)
 {
-    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), -1);
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    return priv->cursor;
+    return priv->vnc_lossy_encoding;
 }
 
-gboolean
-virt_viewer_app_is_active(VirtViewerApp *self)
+/* @encodings is a comma separated list of VNC encoding names, most
+ * preferred first */
+void
+virt_viewer_app_set_vnc_encodings(VirtViewerApp *self, const gchar *encodings)
 {
-    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    return priv->active;
+    g_free(priv->vnc_encodings);
+    priv->vnc_encodings = g_strdup(encodings);
 }
 
-gboolean
-virt_viewer_app_has_session(VirtViewerApp *self)
+const gchar *virt_viewer_app_get_vnc_encodings(VirtViewerApp *self)
 {
-    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
 
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
-    return priv->session != NULL;
+    return priv->vnc_encodings;
 }
 
-static void
-virt_viewer_app_update_pretty_address(VirtViewerApp *self)
+void
+virt_viewer_app_set_calibrate_video_codecs(VirtViewerApp *self, gboolean calibrate)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->calibrate_video_codecs = calibrate;
+}
+
+gboolean virt_viewer_app_get_calibrate_video_codecs(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->calibrate_video_codecs;
+}
+
+/* The file the serial console is logged to, or NULL */
+void
+virt_viewer_app_set_serial_log(VirtViewerApp *self, const gchar *path)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    g_free(priv->serial_log);
+    priv->serial_log = g_strdup(path);
+}
+
+const gchar *virt_viewer_app_get_serial_log(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->serial_log;
+}
+
+/* In MiB, 0 to never rotate the serial console log */
+void
+virt_viewer_app_set_serial_log_max_size(VirtViewerApp *self, gint max_size)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(max_size >= 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->serial_log_max_size = max_size;
+}
+
+gint virt_viewer_app_get_serial_log_max_size(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->serial_log_max_size;
+}
+
+void
+virt_viewer_app_set_serial_log_compress(VirtViewerApp *self, gboolean compress)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->serial_log_compress = compress;
+}
+
+gboolean virt_viewer_app_get_serial_log_compress(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->serial_log_compress;
+}
+
+/* The directory to save the screenshots to without asking, or NULL */
+const gchar *virt_viewer_app_get_screenshot_dir(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->screenshot_dir;
+}
+
+static gboolean
+virt_viewer_app_display_can_grab(VirtViewerDisplay *display)
+{
+    return VIRT_VIEWER_DISPLAY_CAN_SCREENSHOT(display) &&
+        (virt_viewer_display_get_show_hint(display) & VIRT_VIEWER_DISPLAY_SHOW_HINT_READY);
+}
+
+typedef struct {
+    VirtViewerApp *app;
+    gchar *filename;
+    GdkPixbuf *pixbuf;
+} VirtViewerAppScreenshot;
+
+static void
+screenshot_saved(GObject *source G_GNUC_UNUSED,
+                 GAsyncResult *result,
+                 gpointer opaque)
+{
+    VirtViewerAppScreenshot *screenshot = opaque;
+    GError *error = NULL;
+
+    if (virt_viewer_screenshot_save_finish(result, &error)) {
+        virt_viewer_app_trace(screenshot->app, "Saved screenshot %s", screenshot->filename);
+    } else {
+        g_warning("Failed to save screenshot %s: %s", screenshot->filename, error->message);
+        g_error_free(error);
+    }
+
+    g_object_unref(screenshot->app);
+    g_object_unref(screenshot->pixbuf);
+    g_free(screenshot->filename);
+    g_free(screenshot);
+}
+
+/*
+ * Saves the screenshots of all the ready displays to @dir. The frames are
+ * all taken before any encoding starts, so they show the same moment.
+ */
+void
+virt_viewer_app_save_screenshots(VirtViewerApp *self, const gchar *dir)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(dir != NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GHashTableIter iter;
+    gpointer key, value;
+    GList *frames = NULL, *l;
+    GDateTime *now = g_date_time_new_now_local();
+    gchar *seconds = g_date_time_format(now, "%Y%m%d-%H%M%S");
+    /* with the milliseconds, so that quick screenshots don't overwrite each other */
+    gchar *stamp = g_strdup_printf("%s-%03d", seconds, g_date_time_get_microsecond(now) / 1000);
+    gchar *name = g_strdup(priv->guest_name ? priv->guest_name : "screenshot");
+
+    g_strdelimit(name, "/\\", '_');
+
+    g_hash_table_iter_init(&iter, priv->displays);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        VirtViewerDisplay *display = VIRT_VIEWER_DISPLAY(value);
+        VirtViewerAppScreenshot *screenshot;
+        GdkPixbuf *pixbuf;
+        gchar *basename;
+
+        if (!virt_viewer_app_display_can_grab(display))
+            continue;
+
+        /* the display may have no frame yet */
+        pixbuf = virt_viewer_display_get_pixbuf(display);
+        if (pixbuf == NULL)
+            continue;
+
+        basename = g_strdup_printf("%s-%s-display%d.%s", name, stamp,
+                                   virt_viewer_display_get_nth(display) + 1,
+                                   priv->screenshot_format);
+        screenshot = g_new0(VirtViewerAppScreenshot, 1);
+        screenshot->app = g_object_ref(self);
+        screenshot->filename = g_build_filename(dir, basename, NULL);
+        screenshot->pixbuf = pixbuf;
+        frames = g_list_prepend(frames, screenshot);
+        g_free(basename);
+    }
+
+    for (l = frames; l != NULL; l = l->next) {
+        VirtViewerAppScreenshot *screenshot = l->data;
+
+        virt_viewer_screenshot_save_async(screenshot->pixbuf, screenshot->filename, NULL,
+                                          screenshot_saved, screenshot);
+    }
+
+    if (frames == NULL)
+        g_warning("No display to take a screenshot of");
+
+    g_list_free(frames);
+    g_free(name);
+    g_free(stamp);
+    g_free(seconds);
+    g_date_time_unref(now);
+}
+
+static gboolean
+virt_viewer_app_record_frames(gpointer opaque)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(opaque);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init(&iter, priv->displays);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        VirtViewerDisplay *display = VIRT_VIEWER_DISPLAY(value);
+        gint64 start = g_get_monotonic_time();
+        GdkPixbuf *pixbuf;
+
+        if (!virt_viewer_app_display_can_grab(display))
+            continue;
+
+        /* the display may have no frame yet */
+        pixbuf = virt_viewer_display_get_pixbuf(display);
+        if (pixbuf == NULL)
+            continue;
+
+        virt_viewer_recorder_push(priv->recorder, virt_viewer_display_get_nth(display),
+                                  pixbuf, g_get_monotonic_time() - start);
+        g_object_unref(pixbuf);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+/* Grabs the frames of the displays @fps times per second */
+void
+virt_viewer_app_start_recording(VirtViewerApp *self, const gchar *dir, gint fps)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(fps > 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GError *error = NULL;
+
+    virt_viewer_app_stop_recording(self);
+
+    /* a few frames wait for the encoder, more only delay the drops */
+    priv->recorder = virt_viewer_recorder_new(dir, 4, &error);
+    if (priv->recorder == NULL) {
+        g_warning("Failed to start recording: %s", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    priv->record_id = g_timeout_add(1000 / fps, virt_viewer_app_record_frames, self);
+    virt_viewer_app_trace(self, "Recording to %s at %d frames per second", dir, fps);
+}
+
+void
+virt_viewer_app_stop_recording(VirtViewerApp *self)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    VirtViewerRecorderStats stats;
+
+    if (priv->record_id > 0) {
+        g_source_remove(priv->record_id);
+        priv->record_id = 0;
+    }
+
+    if (priv->recorder == NULL)
+        return;
+
+    virt_viewer_recorder_stop(priv->recorder);
+    virt_viewer_recorder_get_stats(priv->recorder, &stats);
+    g_clear_pointer(&priv->recorder, virt_viewer_recorder_free);
+
+    virt_viewer_app_trace(self, "Recorded %u frames: %u written (%" G_GUINT64_FORMAT " bytes), "
+                          "%u unchanged, %u dropped",
+                          stats.frames, stats.written, stats.bytes,
+                          stats.unchanged, stats.dropped);
+    virt_viewer_app_trace(self, "Recording overhead: %.2f%% of the main loop, "
+                          "%.1f ms per frame in the encoder",
+                          stats.elapsed > 0 ? 100.0 * stats.grab_time / stats.elapsed : 0.0,
+                          stats.frames > stats.dropped ?
+                          stats.encode_time / 1000.0 / (stats.frames - stats.dropped) : 0.0);
+}
+
+/* Runs a benchmark of @seconds once the displays are ready, 0 for none */
+void
+virt_viewer_app_set_benchmark(VirtViewerApp *self, gint seconds)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(seconds >= 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->benchmark_seconds = seconds;
+}
+
+gint virt_viewer_app_get_benchmark(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->benchmark_seconds;
+}
+
+#define BENCHMARK_TICK 10 /* ms */
+
+/* how late the main loop runs a timer is its latency */
+static gboolean
+virt_viewer_app_benchmark_tick(gpointer opaque)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(opaque);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    gint64 now = g_get_monotonic_time();
+
+    virt_viewer_benchmark_add_latency(priv->benchmark,
+                                      now - priv->benchmark_tick - BENCHMARK_TICK * 1000);
+    priv->benchmark_tick = now;
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+virt_viewer_app_benchmark_timeout(gpointer opaque)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(opaque);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    priv->benchmark_id = 0;
+    virt_viewer_app_finish_benchmark(self, priv->benchmark_ready ? "completed" : "timeout");
+
+    if (priv->kiosk)
+        g_application_quit(G_APPLICATION(self));
+    else
+        virt_viewer_app_quit(self);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* The session gets benchmark_seconds to get ready, then is measured for as
+ * long. The app quits once done or disconnected. */
+static void
+virt_viewer_app_start_benchmark(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    priv->benchmark = virt_viewer_benchmark_new(g_get_prgname(), g_get_monotonic_time());
+    priv->benchmark_cpu = clock();
+    priv->benchmark_tick = g_get_monotonic_time();
+    priv->benchmark_tick_id = g_timeout_add(BENCHMARK_TICK, virt_viewer_app_benchmark_tick, self);
+    priv->benchmark_id = g_timeout_add_seconds(priv->benchmark_seconds,
+                                               virt_viewer_app_benchmark_timeout, self);
+    priv->quit_on_disconnect = TRUE;
+}
+
+static void
+virt_viewer_app_benchmark_ready(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (priv->benchmark == NULL || priv->benchmark_ready)
+        return;
+
+    priv->benchmark_ready = TRUE;
+    virt_viewer_benchmark_set_connected(priv->benchmark, g_get_monotonic_time());
+    priv->benchmark_cpu = clock();
+    if (priv->benchmark_id > 0)
+        g_source_remove(priv->benchmark_id);
+    priv->benchmark_id = g_timeout_add_seconds(priv->benchmark_seconds,
+                                               virt_viewer_app_benchmark_timeout, self);
+}
+
+/* Prints the summary of the benchmark on stdout */
+static void
+virt_viewer_app_finish_benchmark(VirtViewerApp *self, const gchar *result)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GHashTableIter iter;
+    gpointer key, value;
+    gchar *summary;
+
+    if (priv->benchmark == NULL)
+        return;
+
+    if (priv->benchmark_id > 0) {
+        g_source_remove(priv->benchmark_id);
+        priv->benchmark_id = 0;
+    }
+    if (priv->benchmark_tick_id > 0) {
+        g_source_remove(priv->benchmark_tick_id);
+        priv->benchmark_tick_id = 0;
+    }
+
+    g_hash_table_iter_init(&iter, priv->displays);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        VirtViewerDisplay *display = VIRT_VIEWER_DISPLAY(value);
+        VirtViewerLatency *latency;
+        guint64 updates, frames;
+
+        if (VIRT_VIEWER_IS_DISPLAY_VTE(display))
+            continue;
+
+        virt_viewer_display_get_update_counts(display, &updates, &frames);
+        virt_viewer_benchmark_set_display(priv->benchmark,
+                                          virt_viewer_display_get_nth(display),
+                                          updates, frames);
+        latency = virt_viewer_display_get_input_latency(display);
+        if (virt_viewer_latency_get_count(latency) > 0)
+            virt_viewer_benchmark_set_display_latency(priv->benchmark,
+                                                      virt_viewer_display_get_nth(display),
+                                                      latency);
+    }
+
+    if (priv->session) {
+#ifdef HAVE_SPICE_GTK
+        if (VIRT_VIEWER_IS_SESSION_SPICE(priv->session))
+            virt_viewer_benchmark_set_string(priv->benchmark, "session", "spice");
+#endif
+#ifdef HAVE_GTK_VNC
+        if (VIRT_VIEWER_IS_SESSION_VNC(priv->session))
+            virt_viewer_benchmark_set_string(priv->benchmark, "session", "vnc");
+#endif
+        virt_viewer_session_add_benchmark_stats(priv->session, priv->benchmark);
+    }
+    virt_viewer_benchmark_set_string(priv->benchmark, "scaling",
+                                     priv->scaling ? priv->scaling : "smooth");
+    virt_viewer_benchmark_set_cpu_time(priv->benchmark,
+                                       (gint64)(clock() - priv->benchmark_cpu) * G_USEC_PER_SEC / CLOCKS_PER_SEC);
+
+    summary = virt_viewer_benchmark_finish(priv->benchmark, result, g_get_monotonic_time());
+    g_print("%s\n", summary);
+    g_free(summary);
+    g_clear_pointer(&priv->benchmark, virt_viewer_benchmark_free);
+}
+
+static gint
+compare_display_nth(gconstpointer a, gconstpointer b)
+{
+    VirtViewerDisplay *da = *(VirtViewerDisplay **)a;
+    VirtViewerDisplay *db = *(VirtViewerDisplay **)b;
+
+    return virt_viewer_display_get_nth(da) - virt_viewer_display_get_nth(db);
+}
+
+/* {"program":"remote-viewer","input_latency":[{"display":1,"samples":20,
+ * "p50":12.000,"p95":30.000,"p99":31.000}]}, or NULL if nothing was measured */
+static gchar *
+virt_viewer_app_get_input_latency_json(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GPtrArray *displays = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer key, value;
+    GString *json;
+    guint i;
+
+    g_hash_table_iter_init(&iter, priv->displays);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        VirtViewerDisplay *display = VIRT_VIEWER_DISPLAY(value);
+
+        if (!VIRT_VIEWER_IS_DISPLAY_VTE(display) &&
+            virt_viewer_latency_get_count(virt_viewer_display_get_input_latency(display)) > 0)
+            g_ptr_array_add(displays, display);
+    }
+    if (displays->len == 0) {
+        g_ptr_array_unref(displays);
+        return NULL;
+    }
+    g_ptr_array_sort(displays, compare_display_nth);
+
+    json = g_string_new("{\"program\":");
+    virt_viewer_timing_append_json_string(json, g_get_prgname());
+    g_string_append(json, ",\"input_latency\":[");
+    for (i = 0; i < displays->len; i++) {
+        VirtViewerDisplay *display = g_ptr_array_index(displays, i);
+
+        g_string_append_printf(json, "%s{\"display\":%d,", i > 0 ? "," : "",
+                               virt_viewer_display_get_nth(display) + 1);
+        virt_viewer_latency_append_json_members(virt_viewer_display_get_input_latency(display), json);
+        g_string_append_c(json, '}');
+    }
+    g_string_append(json, "]}");
+    g_ptr_array_unref(displays);
+
+    return g_string_free(json, FALSE);
+}
+
+/* Appends the input latency of the displays to the timing file */
+static void
+virt_viewer_app_save_input_latency(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GError *error = NULL;
+    gchar *record;
+
+    if (priv->timing_file == NULL)
+        return;
+
+    record = virt_viewer_app_get_input_latency_json(self);
+    if (record == NULL)
+        return;
+
+    if (!virt_viewer_timing_append_to_file(priv->timing_file, record, &error)) {
+        g_warning("%s", error->message);
+        g_clear_error(&error);
+    }
+    g_free(record);
+}
+
+#define LATENCY_TEST_INTERVAL 500 /* ms */
+
+static gboolean
+virt_viewer_app_latency_test_done(gpointer opaque)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(opaque);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    gchar *json;
+
+    priv->latency_test_id = 0;
+    json = virt_viewer_app_get_input_latency_json(self);
+    g_print("%s\n", json ? json : "{\"input_latency\":[]}");
+    g_free(json);
+
+    /* a benchmark quits on its own */
+    if (priv->benchmark == NULL) {
+        if (priv->kiosk)
+            g_application_quit(G_APPLICATION(self));
+        else
+            virt_viewer_app_quit(self);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Types a key in the first display, the next update of the display
+ * completes the measure */
+static gboolean
+virt_viewer_app_latency_test_tick(gpointer opaque)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(opaque);
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    VirtViewerDisplay *target = NULL;
+    GHashTableIter iter;
+    gpointer key, value;
+    guint keyval;
+
+    if (priv->latency_test_sent >= priv->latency_test) {
+        /* leave some time for the last update */
+        priv->latency_test_id = g_timeout_add_seconds(1, virt_viewer_app_latency_test_done, self);
+        return G_SOURCE_REMOVE;
+    }
+
+    g_hash_table_iter_init(&iter, priv->displays);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        VirtViewerDisplay *display = VIRT_VIEWER_DISPLAY(value);
+
+        if (VIRT_VIEWER_IS_DISPLAY_VTE(display) ||
+            !(virt_viewer_display_get_show_hint(display) & VIRT_VIEWER_DISPLAY_SHOW_HINT_READY))
+            continue;
+        if (target == NULL ||
+            virt_viewer_display_get_nth(display) < virt_viewer_display_get_nth(target))
+            target = display;
+    }
+    if (target == NULL)
+        return G_SOURCE_CONTINUE;
+
+    /* type and erase, so the guest screen does not fill up */
+    keyval = priv->latency_test_sent % 2 ? GDK_KEY_BackSpace : GDK_KEY_a;
+    virt_viewer_display_notify_input(target);
+    virt_viewer_display_send_keys(target, &keyval, 1);
+    priv->latency_test_sent++;
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+virt_viewer_app_start_latency_test(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (priv->latency_test == 0 || priv->latency_test_id > 0 || priv->latency_test_sent > 0)
+        return;
+
+    virt_viewer_app_trace(self, "Typing %d keys to measure the input latency", priv->latency_test);
+    priv->latency_test_id = g_timeout_add(LATENCY_TEST_INTERVAL,
+                                          virt_viewer_app_latency_test_tick, self);
+}
+
+/* The --scaling or the scaling of the connection file, NULL by default */
+const gchar *virt_viewer_app_get_scaling(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->scaling;
+}
+
+static VirtViewerDisplayScaling
+virt_viewer_app_get_display_scaling(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    gint scaling = -1;
+
+    if (priv->scaling)
+        scaling = virt_viewer_enum_from_string(VIRT_VIEWER_TYPE_DISPLAY_SCALING, priv->scaling);
+
+    return scaling < 0 ? VIRT_VIEWER_DISPLAY_SCALING_SMOOTH : scaling;
+}
+
+void
+virt_viewer_app_set_scaling(VirtViewerApp *self, const gchar *scaling)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    if (scaling &&
+        virt_viewer_enum_from_string(VIRT_VIEWER_TYPE_DISPLAY_SCALING, (gchar *)scaling) < 0) {
+        g_warning("Unknown scaling '%s'", scaling);
+        return;
+    }
+    if (g_strcmp0(priv->scaling, scaling) == 0)
+        return;
+
+    g_free(priv->scaling);
+    priv->scaling = g_strdup(scaling);
+
+    g_hash_table_iter_init(&iter, priv->displays);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        virt_viewer_display_set_scaling(VIRT_VIEWER_DISPLAY(value),
+                                        virt_viewer_app_get_display_scaling(self));
+
+    g_object_notify(G_OBJECT(self), "scaling");
+}
+
+static void
+virt_viewer_app_update_displays_geometry(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (priv->session != NULL && priv->connected)
+        virt_viewer_session_update_displays_geometry(priv->session);
+}
+
+/* The largest resolution requested for a guest display with auto-resize,
+ * 0 for no limit. The display scales the smaller guest display up. */
+void
+virt_viewer_app_get_max_resolution(VirtViewerApp *self, gint *width, gint *height)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (width)
+        *width = priv->max_width;
+    if (height)
+        *height = priv->max_height;
+}
+
+void
+virt_viewer_app_set_max_resolution(VirtViewerApp *self, gint width, gint height)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(width >= 0 && height >= 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (priv->max_width == width && priv->max_height == height)
+        return;
+
+    priv->max_width = width;
+    priv->max_height = height;
+    virt_viewer_app_update_displays_geometry(self);
+}
+
+/* The largest total area of the guest displays with auto-resize, in pixels,
+ * 0 for no limit */
+gint64
+virt_viewer_app_get_max_area(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->max_area;
+}
+
+void
+virt_viewer_app_set_max_area(VirtViewerApp *self, gint64 area)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(area >= 0);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    if (priv->max_area == area)
+        return;
+
+    priv->max_area = area;
+    virt_viewer_app_update_displays_geometry(self);
+}
+
+/* The name of a VirtViewerLinkProfile, "auto" or NULL */
+const gchar *virt_viewer_app_get_link_profile(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->link_profile;
+}
+
+gchar*
+virt_viewer_app_get_release_cursor_display_hotkey(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->release_cursor_display_hotkey;
+}
+
+void
+virt_viewer_app_set_release_cursor_display_hotkey(VirtViewerApp *self, const gchar *hotkey)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    g_free(priv->release_cursor_display_hotkey);
+    priv->release_cursor_display_hotkey = g_strdup(hotkey);
+    g_object_notify(G_OBJECT(self), "release-cursor-display-hotkey");
+}
+
+gchar**
+virt_viewer_app_get_hotkey_names(void)
+{
+    return hotkey_names;
+}
+
+void
+virt_viewer_app_clear_hotkeys(VirtViewerApp *self)
+{
+    gint i;
+    const gchar *no_accels[] = { NULL };
+    for (i = 0 ; i < G_N_ELEMENTS(hotkey_defaults); i++) {
+        gtk_application_set_accels_for_action(GTK_APPLICATION(self),
+                                              hotkey_defaults[i].action,
+                                              no_accels);
+    }
+
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    virt_viewer_app_set_release_cursor_display_hotkey(self, "Control_L+Alt_L");
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    g_strfreev(priv->insert_smartcard_accel);
+    priv->insert_smartcard_accel = NULL;
+    g_strfreev(priv->remove_smartcard_accel);
+    priv->remove_smartcard_accel = NULL;
+    g_strfreev(priv->usb_device_reset_accel);
+    priv->usb_device_reset_accel = NULL;
+}
+
+void
+virt_viewer_app_set_hotkey(VirtViewerApp *self, const gchar *hotkey_name,
+                           const gchar *hotkey)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    const gchar *action = NULL;
+    int i;
+    for (i = 0; i < G_N_ELEMENTS(hotkey_defaults); i++) {
+        if (g_str_equal(hotkey_name, hotkey_defaults[i].name)) {
+            action = hotkey_defaults[i].action;
+            break;
+        }
+    }
+    if (action == NULL) {
+        g_warning("Unknown hotkey name %s", hotkey_name);
+        return;
+    }
+
+    gchar *accel = spice_hotkey_to_gtk_accelerator(hotkey);
+    const gchar *accels[] = { accel, NULL };
+    guint accel_key;
+    GdkModifierType accel_mods;
+    /*
+     * First try the spice translated accel.
+     * Works for basic modifiers and single letters/numbers
+     * where forced uppercasing matches GTK key names
+     */
+    gtk_accelerator_parse(accels[0], &accel_key, &accel_mods);
+    if (accel_key == 0 && accel_mods == 0) {
+        /* Fallback to native GTK accels to cope with
+         * case sensitive accels
+         */
+        accels[0] = hotkey;
+        gtk_accelerator_parse(accels[0], &accel_key, &accel_mods);
+    }
+    if (g_str_equal(hotkey_name, "release-cursor")) {
+        if (accel_key == 0) {
+            /* GTK does not support using modifiers as hotkeys without any non-modifiers
+             * (eg. CTRL+ALT), however the displays do support this for the grab sequence.
+             */
+            virt_viewer_app_set_release_cursor_display_hotkey(self, hotkey);
+            g_free(accel);
+            return;
+        }
+        virt_viewer_app_set_release_cursor_display_hotkey(self, NULL);
+    }
+    if (accel_key == 0) {
+        g_warning("Invalid hotkey '%s' for '%s'", hotkey, hotkey_name);
+        g_free(accel);
+        return;
+    }
+
+    if (g_str_equal(hotkey_name, "smartcard-insert")) {
+        g_strfreev(priv->insert_smartcard_accel);
+        priv->insert_smartcard_accel = g_strdupvc(accels);
+        g_free(accel);
+        virt_viewer_update_smartcard_accels(self);
+        return;
+    }
+    if (g_str_equal(hotkey_name, "smartcard-remove")) {
+        g_strfreev(priv->remove_smartcard_accel);
+        priv->remove_smartcard_accel = g_strdupvc(accels);
+        g_free(accel);
+        virt_viewer_update_smartcard_accels(self);
+        return;
+    }
+    if (g_str_equal(hotkey_name, "usb-device-reset")) {
+        g_strfreev(priv->usb_device_reset_accel);
+        priv->usb_device_reset_accel = g_strdupvc(accels);
+        g_free(accel);
+        virt_viewer_update_usbredir_accels(self);
+        return;
+    }
+
+    gtk_application_set_accels_for_action(GTK_APPLICATION(self), action, accels);
+    g_free(accel);
+}
+
+void
+virt_viewer_app_set_hotkeys(VirtViewerApp *self, const gchar *hotkeys_str)
+{
+    gchar **hotkey, **hotkeys = NULL;
+
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    if (hotkeys_str)
+        hotkeys = g_strsplit(hotkeys_str, ",", -1);
+
+    if (!hotkeys || g_strv_length(hotkeys) == 0) {
+        g_strfreev(hotkeys);
+        return;
+    }
+
+    virt_viewer_app_clear_hotkeys(self);
+
+    for (hotkey = hotkeys; *hotkey != NULL; hotkey++) {
+        gchar *eq = strstr(*hotkey, "=");
+        const gchar *value = (eq == NULL) ? NULL : (*eq = '\0', eq + 1);
+        if (value == NULL || *value == '\0') {
+            g_warning("Missing value for hotkey '%s'", *hotkey);
+            continue;
+        }
+
+        virt_viewer_app_set_hotkey(self, *hotkey, value);
+    }
+    g_strfreev(hotkeys);
+}
+
+void
+virt_viewer_app_set_attach(VirtViewerApp *self, gboolean attach)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->attach = attach;
+}
+
+gboolean
+virt_viewer_app_get_attach(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->attach;
+}
+
+void
+virt_viewer_app_set_shared(VirtViewerApp *self, gboolean shared)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->shared = shared;
+}
+
+gboolean
+virt_viewer_app_get_shared(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->shared;
+}
+
+void virt_viewer_app_set_cursor(VirtViewerApp *self, VirtViewerCursor cursor)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    priv->cursor = cursor;
+}
+
+VirtViewerCursor virt_viewer_app_get_cursor(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->cursor;
+}
+
+gboolean
+virt_viewer_app_is_active(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->active;
+}
+
+gboolean
+virt_viewer_app_has_session(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+    return priv->session != NULL;
+}
+
+static void
+virt_viewer_app_update_pretty_address(VirtViewerApp *self)
 {
     VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
     g_free(priv->pretty_address);
@@ -3455,6 +5007,30 @@ share_folder_changed(VirtViewerApp *self)
     g_free(folder);
 }
 
+#ifdef HAVE_SPICE_GTK
+static void
+virt_viewer_app_remove_combo_item(GtkComboBox *combo, const gchar *id)
+{
+    GtkTreeModel *model = gtk_combo_box_get_model(combo);
+    GtkTreeIter iter;
+    gboolean valid;
+
+    for (valid = gtk_tree_model_get_iter_first(model, &iter); valid;
+         valid = gtk_tree_model_iter_next(model, &iter)) {
+        gchar *item = NULL;
+        gboolean found;
+
+        gtk_tree_model_get(model, &iter, gtk_combo_box_get_id_column(combo), &item, -1);
+        found = g_strcmp0(item, id) == 0;
+        g_free(item);
+        if (found) {
+            gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
+            return;
+        }
+    }
+}
+#endif
+
 static GtkWidget *
 virt_viewer_app_get_preferences(VirtViewerApp *self)
 {
@@ -3479,6 +5055,19 @@ virt_viewer_app_get_preferences(VirtViewerApp *self)
                            "active",
                            G_BINDING_BIDIRECTIONAL|G_BINDING_SYNC_CREATE);
 
+#ifdef HAVE_SPICE_GTK
+    /* spice-gtk always interpolates */
+    if (VIRT_VIEWER_IS_SESSION_SPICE(session))
+        virt_viewer_app_remove_combo_item(GTK_COMBO_BOX(gtk_builder_get_object(builder, "cbscaling")),
+                                          "nearest");
+#endif
+
+    g_object_bind_property(self,
+                           "scaling",
+                           gtk_builder_get_object(builder, "cbscaling"),
+                           "active-id",
+                           G_BINDING_BIDIRECTIONAL|G_BINDING_SYNC_CREATE);
+
     g_object_set (gtk_builder_get_object(builder, "cbshareclipboard"),
                   "sensitive", virt_viewer_app_get_supports_share_clipboard(self), NULL);
     g_object_set (gtk_builder_get_object(builder, "cbsharefolder"),
@@ -3580,6 +5169,36 @@ virt_viewer_app_add_option_entries(G_GNUC_UNUSED VirtViewerApp *self,
           N_("Display verbose information"), NULL },
         { "debug", '\0', 0, G_OPTION_ARG_NONE, &opt_debug,
           N_("Display debugging information"), NULL },
+        { "timing", '\0', 0, G_OPTION_ARG_FILENAME, &opt_timing,
+          N_("Append the timing of each connection attempt to FILE"), "FILE" },
+        { "disable-channels", '\0', 0, G_OPTION_ARG_STRING, &opt_disable_channels,
+          N_("Do not connect the given channels, separated by commas"), "CHANNELS" },
+        { "lazy-channels", '\0', 0, G_OPTION_ARG_NONE, &opt_lazy_channels,
+          N_("Connect the secondary channels once the display is up or when first used"), NULL },
+        { "link-profile", '\0', 0, G_OPTION_ARG_STRING, &opt_link_profile,
+          N_("Adapt the display settings to the link: 'lan', 'wan', 'cellular' or 'auto'"), "PROFILE" },
+        { "serial-log", '\0', 0, G_OPTION_ARG_FILENAME, &opt_serial_log,
+          N_("Log the guest serial console to FILE"), "FILE" },
+        { "serial-log-max-size", '\0', 0, G_OPTION_ARG_INT, &opt_serial_log_max_size,
+          N_("Rotate the serial console log over SIZE MiB"), "SIZE" },
+        { "serial-log-compress", '\0', 0, G_OPTION_ARG_NONE, &opt_serial_log_compress,
+          N_("Compress the rotated serial console logs"), NULL },
+        { "screenshot-dir", '\0', 0, G_OPTION_ARG_FILENAME, &opt_screenshot_dir,
+          N_("Save the screenshots of all displays to DIR, without asking (on SIGUSR1)"), "DIR" },
+        { "screenshot-format", '\0', 0, G_OPTION_ARG_STRING, &opt_screenshot_format,
+          N_("Save the screenshots as FORMAT: 'png', 'ppm', 'qoi'..."), "FORMAT" },
+        { "record", '\0', 0, G_OPTION_ARG_FILENAME, &opt_record,
+          N_("Record the frames of the displays to DIR"), "DIR" },
+        { "record-fps", '\0', 0, G_OPTION_ARG_INT, &opt_record_fps,
+          N_("Grab FPS frames per second when recording (default 5)"), "FPS" },
+        { "latency-test", '\0', 0, G_OPTION_ARG_INT, &opt_latency_test,
+          N_("Type COUNT keys in the guest, print the input latency and quit"), "COUNT" },
+        { "scaling", '\0', 0, G_OPTION_ARG_STRING, &opt_scaling,
+          N_("Scale the displays to their window: 'off', 'integer', 'nearest' or 'smooth'"), "MODE" },
+        { "max-resolution", '\0', 0, G_OPTION_ARG_STRING, &opt_max_resolution,
+          N_("Don't resize a guest display beyond WIDTHxHEIGHT"), "WIDTHxHEIGHT" },
+        { "max-area", '\0', 0, G_OPTION_ARG_INT64, &opt_max_area,
+          N_("Don't resize the guest displays beyond PIXELS in total"), "PIXELS" },
         { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
     };
 
@@ -3619,6 +5238,29 @@ void virt_viewer_app_set_config_share_clipboard(VirtViewerApp *self, gboolean en
     g_object_notify(G_OBJECT(self), "config-share-clipboard");
 }
 
+/* The video codec found to be the best with @host by the calibration */
+gchar *virt_viewer_app_get_config_video_codec(VirtViewerApp *self, const gchar *host)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+    g_return_val_if_fail(host != NULL, NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    return g_key_file_get_string(priv->config, "video-codecs", host, NULL);
+}
+
+void virt_viewer_app_set_config_video_codec(VirtViewerApp *self, const gchar *host, const gchar *codec)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(host != NULL);
+    g_return_if_fail(codec != NULL);
+
+    VirtViewerAppPrivate *priv = virt_viewer_app_get_instance_private(self);
+
+    g_key_file_set_string(priv->config, "video-codecs", host, codec);
+    virt_viewer_app_save_config(self);
+}
+
 gboolean virt_viewer_app_get_supports_share_clipboard(VirtViewerApp *self)
 {
     g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
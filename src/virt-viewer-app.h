@@ -33,13 +33,6 @@ G_DECLARE_DERIVABLE_TYPE(VirtViewerApp,
                          APP,
                          GtkApplication)
 
-typedef struct {
-    guint sourceKey;
-    guint numMappedKeys;
-    guint *mappedKeys;
-    gboolean isLast;
-} VirtViewerKeyMapping;
-
 typedef enum {
     VIRT_VIEWER_CURSOR_AUTO,
     VIRT_VIEWER_CURSOR_LOCAL,
@@ -64,6 +57,9 @@ gboolean virt_viewer_app_start(VirtViewerApp *app, GError **error);
 void virt_viewer_app_maybe_quit(VirtViewerApp *self, VirtViewerWindow *window);
 VirtViewerWindow* virt_viewer_app_get_main_window(VirtViewerApp *self);
 void virt_viewer_app_trace(VirtViewerApp *self, const char *fmt, ...) G_GNUC_PRINTF(2, 3);
+void virt_viewer_app_timing_start(VirtViewerApp *self, const gchar *phase);
+void virt_viewer_app_timing_mark(VirtViewerApp *self, const gchar *fmt, ...) G_GNUC_PRINTF(2, 3);
+void virt_viewer_app_timing_finish(VirtViewerApp *self, const gchar *result);
 void virt_viewer_app_simple_message_dialog(VirtViewerApp *self, const char *fmt, ...) G_GNUC_PRINTF(2, 3);
 gboolean virt_viewer_app_is_active(VirtViewerApp *app);
 void virt_viewer_app_free_connect_info(VirtViewerApp *self);
@@ -72,6 +68,43 @@ gboolean virt_viewer_app_activate(VirtViewerApp *self, GError **error);
 gboolean virt_viewer_app_initial_connect(VirtViewerApp *self, GError **error);
 gboolean virt_viewer_app_get_direct(VirtViewerApp *self);
 void virt_viewer_app_set_direct(VirtViewerApp *self, gboolean direct);
+gboolean virt_viewer_app_get_warm_reconnect(VirtViewerApp *self);
+void virt_viewer_app_set_warm_reconnect(VirtViewerApp *self, gboolean warm_reconnect);
+gchar** virt_viewer_app_get_disabled_channels(VirtViewerApp *self);
+void virt_viewer_app_set_disabled_channels(VirtViewerApp *self, const gchar *channels);
+gboolean virt_viewer_app_get_lazy_channels(VirtViewerApp *self);
+void virt_viewer_app_set_lazy_channels(VirtViewerApp *self, gboolean lazy_channels);
+const gchar *virt_viewer_app_get_link_profile(VirtViewerApp *self);
+const gchar *virt_viewer_app_get_preferred_video_codecs(VirtViewerApp *self);
+void virt_viewer_app_set_preferred_video_codecs(VirtViewerApp *self, const gchar *codecs);
+const gchar *virt_viewer_app_get_preferred_compression(VirtViewerApp *self);
+void virt_viewer_app_set_preferred_compression(VirtViewerApp *self, const gchar *compression);
+const gchar *virt_viewer_app_get_vnc_depth(VirtViewerApp *self);
+void virt_viewer_app_set_vnc_depth(VirtViewerApp *self, const gchar *depth);
+gint virt_viewer_app_get_vnc_lossy_encoding(VirtViewerApp *self);
+void virt_viewer_app_set_vnc_lossy_encoding(VirtViewerApp *self, gint lossy);
+const gchar *virt_viewer_app_get_vnc_encodings(VirtViewerApp *self);
+void virt_viewer_app_set_vnc_encodings(VirtViewerApp *self, const gchar *encodings);
+gboolean virt_viewer_app_get_calibrate_video_codecs(VirtViewerApp *self);
+void virt_viewer_app_set_calibrate_video_codecs(VirtViewerApp *self, gboolean calibrate);
+const gchar *virt_viewer_app_get_serial_log(VirtViewerApp *self);
+void virt_viewer_app_set_serial_log(VirtViewerApp *self, const gchar *path);
+gint virt_viewer_app_get_serial_log_max_size(VirtViewerApp *self);
+void virt_viewer_app_set_serial_log_max_size(VirtViewerApp *self, gint max_size);
+gboolean virt_viewer_app_get_serial_log_compress(VirtViewerApp *self);
+void virt_viewer_app_set_serial_log_compress(VirtViewerApp *self, gboolean compress);
+const gchar *virt_viewer_app_get_screenshot_dir(VirtViewerApp *self);
+void virt_viewer_app_save_screenshots(VirtViewerApp *self, const gchar *dir);
+void virt_viewer_app_start_recording(VirtViewerApp *self, const gchar *dir, gint fps);
+void virt_viewer_app_stop_recording(VirtViewerApp *self);
+void virt_viewer_app_set_benchmark(VirtViewerApp *self, gint seconds);
+gint virt_viewer_app_get_benchmark(VirtViewerApp *self);
+const gchar *virt_viewer_app_get_scaling(VirtViewerApp *self);
+void virt_viewer_app_set_scaling(VirtViewerApp *self, const gchar *scaling);
+void virt_viewer_app_get_max_resolution(VirtViewerApp *self, gint *width, gint *height);
+void virt_viewer_app_set_max_resolution(VirtViewerApp *self, gint width, gint height);
+gint64 virt_viewer_app_get_max_area(VirtViewerApp *self);
+void virt_viewer_app_set_max_area(VirtViewerApp *self, gint64 area);
 char** virt_viewer_app_get_hotkey_names(void);
 gchar* virt_viewer_app_get_release_cursor_display_hotkey(VirtViewerApp *self);
 void virt_viewer_app_set_release_cursor_display_hotkey(VirtViewerApp *self, const gchar *hotkey);
@@ -108,6 +141,8 @@ gboolean virt_viewer_app_get_session_cancelled(VirtViewerApp *self);
 
 gboolean virt_viewer_app_get_config_share_clipboard(VirtViewerApp *self);
 void virt_viewer_app_set_config_share_clipboard(VirtViewerApp *self, gboolean enable);
+gchar *virt_viewer_app_get_config_video_codec(VirtViewerApp *self, const gchar *host);
+void virt_viewer_app_set_config_video_codec(VirtViewerApp *self, const gchar *host, const gchar *codec);
 
 gboolean virt_viewer_app_get_supports_share_clipboard(VirtViewerApp *self);
 void virt_viewer_app_set_supports_share_clipboard(VirtViewerApp *self, gboolean enable);
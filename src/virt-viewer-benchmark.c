@@ -0,0 +1,362 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "virt-viewer-benchmark.h"
+#include "virt-viewer-timing.h"
+
+/*
+ * Gathers what a benchmark run measured and sums it up as a JSON object,
+ * such as:
+ *
+ * {"program":"remote-viewer","result":"completed","duration":10012.345,
+ *  "connect":153.120,"cpu_time":4521.000,"cpu_usage":45.15,"session":"spice",
+ *  "displays":[{"display":1,"updates":5120,"frames":598,
+ *               "updates_per_second":518.41,"frames_per_second":60.55,
+ *               "input_latency":{"samples":20,"p50":12.000,"p95":30.000,
+ *                                "p99":31.000}}],
+ *  "channels":[{"channel":"display","bytes":73400320,
+ *               "bytes_per_second":7432163.00}],
+ *  "main_loop_latency":{"samples":985,"mean":0.412,"p50":0.101,
+ *                       "p95":1.820,"p99":4.002,"max":12.731}}
+ *
+ * The times are in milliseconds. "connect" is null if the session never got
+ * ready, the rates are computed from when it did, or from the start if not.
+ * The members set with virt_viewer_benchmark_set_string() come after
+ * "connect".
+ */
+
+typedef struct {
+    gint display;
+    guint64 updates;
+    guint64 frames;
+    gchar *input_latency; /* JSON, or NULL */
+} VirtViewerBenchmarkDisplay;
+
+typedef struct {
+    gchar *name;
+    guint64 bytes;
+} VirtViewerBenchmarkChannel;
+
+struct _VirtViewerBenchmark {
+    gchar *program;
+    gint64 start;     /* monotonic */
+    gint64 connected; /* monotonic, 0 until then */
+    gint64 cpu_time;  /* -1 if unknown */
+    GPtrArray *strings; /* key, value, key, value... */
+    GArray *displays;
+    GArray *channels;
+    GArray *latencies; /* gint64, us */
+};
+
+static void
+virt_viewer_benchmark_display_clear(gpointer data)
+{
+    VirtViewerBenchmarkDisplay *display = data;
+
+    g_free(display->input_latency);
+}
+
+static void
+virt_viewer_benchmark_channel_clear(gpointer data)
+{
+    VirtViewerBenchmarkChannel *channel = data;
+
+    g_free(channel->name);
+}
+
+/* @start is the g_get_monotonic_time() the run started at */
+VirtViewerBenchmark *
+virt_viewer_benchmark_new(const gchar *program, gint64 start)
+{
+    VirtViewerBenchmark *self = g_new0(VirtViewerBenchmark, 1);
+
+    self->program = g_strdup(program);
+    self->start = start;
+    self->cpu_time = -1;
+    self->strings = g_ptr_array_new_with_free_func(g_free);
+    self->displays = g_array_new(FALSE, FALSE, sizeof(VirtViewerBenchmarkDisplay));
+    g_array_set_clear_func(self->displays, virt_viewer_benchmark_display_clear);
+    self->channels = g_array_new(FALSE, FALSE, sizeof(VirtViewerBenchmarkChannel));
+    g_array_set_clear_func(self->channels, virt_viewer_benchmark_channel_clear);
+    self->latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+
+    return self;
+}
+
+void
+virt_viewer_benchmark_free(VirtViewerBenchmark *self)
+{
+    if (self == NULL)
+        return;
+
+    g_array_unref(self->latencies);
+    g_array_unref(self->channels);
+    g_array_unref(self->displays);
+    g_ptr_array_unref(self->strings);
+    g_free(self->program);
+    g_free(self);
+}
+
+/* Only the first call counts, a reconnection is not a connect time */
+void
+virt_viewer_benchmark_set_connected(VirtViewerBenchmark *self, gint64 time)
+{
+    g_return_if_fail(self != NULL);
+
+    if (self->connected == 0)
+        self->connected = time;
+}
+
+void
+virt_viewer_benchmark_set_string(VirtViewerBenchmark *self,
+                                 const gchar *key,
+                                 const gchar *value)
+{
+    guint i;
+
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(key != NULL);
+    g_return_if_fail(value != NULL);
+
+    for (i = 0; i < self->strings->len; i += 2) {
+        if (g_str_equal(g_ptr_array_index(self->strings, i), key)) {
+            g_free(g_ptr_array_index(self->strings, i + 1));
+            g_ptr_array_index(self->strings, i + 1) = g_strdup(value);
+            return;
+        }
+    }
+    g_ptr_array_add(self->strings, g_strdup(key));
+    g_ptr_array_add(self->strings, g_strdup(value));
+}
+
+static VirtViewerBenchmarkDisplay *
+virt_viewer_benchmark_get_display(VirtViewerBenchmark *self, gint display)
+{
+    VirtViewerBenchmarkDisplay d = { display, 0, 0, NULL };
+    guint i;
+
+    for (i = 0; i < self->displays->len; i++) {
+        VirtViewerBenchmarkDisplay *old = &g_array_index(self->displays, VirtViewerBenchmarkDisplay, i);
+
+        if (old->display == display)
+            return old;
+        if (old->display > display)
+            break;
+    }
+    g_array_insert_val(self->displays, i, d);
+
+    return &g_array_index(self->displays, VirtViewerBenchmarkDisplay, i);
+}
+
+/* The processor time used over the measure, since the connection */
+void
+virt_viewer_benchmark_set_cpu_time(VirtViewerBenchmark *self, gint64 cpu_time)
+{
+    g_return_if_fail(self != NULL);
+
+    self->cpu_time = cpu_time;
+}
+
+/* @display is 0-based, @updates and @frames are totals */
+void
+virt_viewer_benchmark_set_display(VirtViewerBenchmark *self,
+                                  gint display,
+                                  guint64 updates,
+                                  guint64 frames)
+{
+    VirtViewerBenchmarkDisplay *d;
+
+    g_return_if_fail(self != NULL);
+
+    d = virt_viewer_benchmark_get_display(self, display);
+    d->updates = updates;
+    d->frames = frames;
+}
+
+/* The input latency of the display, as measured so far */
+void
+virt_viewer_benchmark_set_display_latency(VirtViewerBenchmark *self,
+                                          gint display,
+                                          VirtViewerLatency *latency)
+{
+    VirtViewerBenchmarkDisplay *d;
+    GString *json;
+
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(latency != NULL);
+
+    d = virt_viewer_benchmark_get_display(self, display);
+    json = g_string_new(NULL);
+    virt_viewer_latency_append_json(latency, json);
+    g_free(d->input_latency);
+    d->input_latency = g_string_free(json, FALSE);
+}
+
+void
+virt_viewer_benchmark_add_channel_bytes(VirtViewerBenchmark *self,
+                                        const gchar *channel,
+                                        guint64 bytes)
+{
+    VirtViewerBenchmarkChannel c;
+    guint i;
+
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(channel != NULL);
+
+    for (i = 0; i < self->channels->len; i++) {
+        VirtViewerBenchmarkChannel *old = &g_array_index(self->channels, VirtViewerBenchmarkChannel, i);
+
+        if (g_str_equal(old->name, channel)) {
+            old->bytes += bytes;
+            return;
+        }
+    }
+    c.name = g_strdup(channel);
+    c.bytes = bytes;
+    g_array_append_val(self->channels, c);
+}
+
+/* How late the main loop ran a timer, in us */
+void
+virt_viewer_benchmark_add_latency(VirtViewerBenchmark *self, gint64 latency)
+{
+    g_return_if_fail(self != NULL);
+
+    latency = MAX(latency, 0);
+    g_array_append_val(self->latencies, latency);
+}
+
+/* of the sorted latencies */
+static gint64
+percentile(GArray *latencies, guint p)
+{
+    return virt_viewer_latency_percentile((const gint64 *)latencies->data, latencies->len, p);
+}
+
+static void
+append_json_double(GString *json, gdouble value)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append(json, g_ascii_formatd(buf, sizeof(buf), "%.2f", value));
+}
+
+/*
+ * Ends the run, @time being the monotonic time it ended at, and returns
+ * its JSON summary.
+ */
+gchar *
+virt_viewer_benchmark_finish(VirtViewerBenchmark *self,
+                             const gchar *result,
+                             gint64 time)
+{
+    gint64 from;
+    gdouble seconds;
+    GString *json;
+    guint i;
+
+    g_return_val_if_fail(self != NULL, NULL);
+    g_return_val_if_fail(result != NULL, NULL);
+
+    from = self->connected ? self->connected : self->start;
+    seconds = MAX(time - from, 1) / (gdouble)G_USEC_PER_SEC;
+
+    json = g_string_new("{\"program\":");
+    virt_viewer_timing_append_json_string(json, self->program ? self->program : "");
+    g_string_append(json, ",\"result\":");
+    virt_viewer_timing_append_json_string(json, result);
+    g_string_append(json, ",\"duration\":");
+    virt_viewer_timing_append_json_ms(json, time - self->start);
+    g_string_append(json, ",\"connect\":");
+    if (self->connected)
+        virt_viewer_timing_append_json_ms(json, self->connected - self->start);
+    else
+        g_string_append(json, "null");
+    if (self->cpu_time >= 0) {
+        g_string_append(json, ",\"cpu_time\":");
+        virt_viewer_timing_append_json_ms(json, self->cpu_time);
+        g_string_append(json, ",\"cpu_usage\":");
+        append_json_double(json, self->cpu_time * 100.0 / G_USEC_PER_SEC / seconds);
+    }
+
+    for (i = 0; i < self->strings->len; i += 2) {
+        g_string_append_c(json, ',');
+        virt_viewer_timing_append_json_string(json, g_ptr_array_index(self->strings, i));
+        g_string_append_c(json, ':');
+        virt_viewer_timing_append_json_string(json, g_ptr_array_index(self->strings, i + 1));
+    }
+
+    g_string_append(json, ",\"displays\":[");
+    for (i = 0; i < self->displays->len; i++) {
+        VirtViewerBenchmarkDisplay *d = &g_array_index(self->displays, VirtViewerBenchmarkDisplay, i);
+
+        g_string_append_printf(json, "%s{\"display\":%d,\"updates\":%" G_GUINT64_FORMAT
+                               ",\"frames\":%" G_GUINT64_FORMAT ",\"updates_per_second\":",
+                               i > 0 ? "," : "", d->display + 1, d->updates, d->frames);
+        append_json_double(json, d->updates / seconds);
+        g_string_append(json, ",\"frames_per_second\":");
+        append_json_double(json, d->frames / seconds);
+        if (d->input_latency) {
+            g_string_append(json, ",\"input_latency\":");
+            g_string_append(json, d->input_latency);
+        }
+        g_string_append_c(json, '}');
+    }
+
+    g_string_append(json, "],\"channels\":[");
+    for (i = 0; i < self->channels->len; i++) {
+        VirtViewerBenchmarkChannel *c = &g_array_index(self->channels, VirtViewerBenchmarkChannel, i);
+
+        g_string_append_printf(json, "%s{\"channel\":", i > 0 ? "," : "");
+        virt_viewer_timing_append_json_string(json, c->name);
+        g_string_append_printf(json, ",\"bytes\":%" G_GUINT64_FORMAT ",\"bytes_per_second\":",
+                               c->bytes);
+        append_json_double(json, c->bytes / seconds);
+        g_string_append_c(json, '}');
+    }
+
+    g_string_append_printf(json, "],\"main_loop_latency\":{\"samples\":%u", self->latencies->len);
+    if (self->latencies->len > 0) {
+        gint64 sum = 0;
+
+        virt_viewer_latency_sort((gint64 *)self->latencies->data, self->latencies->len);
+        for (i = 0; i < self->latencies->len; i++)
+            sum += g_array_index(self->latencies, gint64, i);
+
+        g_string_append(json, ",\"mean\":");
+        virt_viewer_timing_append_json_ms(json, sum / self->latencies->len);
+        g_string_append(json, ",\"p50\":");
+        virt_viewer_timing_append_json_ms(json, percentile(self->latencies, 50));
+        g_string_append(json, ",\"p95\":");
+        virt_viewer_timing_append_json_ms(json, percentile(self->latencies, 95));
+        g_string_append(json, ",\"p99\":");
+        virt_viewer_timing_append_json_ms(json, percentile(self->latencies, 99));
+        g_string_append(json, ",\"max\":");
+        virt_viewer_timing_append_json_ms(json, g_array_index(self->latencies, gint64,
+                                                              self->latencies->len - 1));
+    }
+    g_string_append(json, "}}");
+
+    return g_string_free(json, FALSE);
+}
@@ -0,0 +1,51 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "virt-viewer-latency.h"
+
+typedef struct _VirtViewerBenchmark VirtViewerBenchmark;
+
+VirtViewerBenchmark *virt_viewer_benchmark_new(const gchar *program, gint64 start);
+void virt_viewer_benchmark_free(VirtViewerBenchmark *self);
+
+void virt_viewer_benchmark_set_connected(VirtViewerBenchmark *self, gint64 time);
+void virt_viewer_benchmark_set_string(VirtViewerBenchmark *self,
+                                      const gchar *key,
+                                      const gchar *value);
+void virt_viewer_benchmark_set_cpu_time(VirtViewerBenchmark *self, gint64 cpu_time);
+void virt_viewer_benchmark_set_display(VirtViewerBenchmark *self,
+                                       gint display,
+                                       guint64 updates,
+                                       guint64 frames);
+void virt_viewer_benchmark_set_display_latency(VirtViewerBenchmark *self,
+                                               gint display,
+                                               VirtViewerLatency *latency);
+void virt_viewer_benchmark_add_channel_bytes(VirtViewerBenchmark *self,
+                                             const gchar *channel,
+                                             guint64 bytes);
+void virt_viewer_benchmark_add_latency(VirtViewerBenchmark *self, gint64 latency);
+
+gchar *virt_viewer_benchmark_finish(VirtViewerBenchmark *self,
+                                    const gchar *result,
+                                    gint64 time);
@@ -0,0 +1,133 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include "virt-viewer-calibration.h"
+
+/*
+ * Picks the best of the video codecs tried one after the other for the
+ * same time, given the bytes received and the client CPU time (in
+ * microseconds) spent while each one was used.
+ *
+ * The winner is the codec using the least bandwidth among the ones which
+ * did not cost much more CPU than the cheapest one. Codecs which got too
+ * little data to tell are ignored, the guest display was probably idle.
+ */
+
+/* below this, there was not enough video for the codec to be judged */
+#define CALIBRATION_MIN_BYTES (256 * 1024)
+/* CPU time a codec can use over the cheapest one and still win */
+#define CALIBRATION_CPU_RATIO 1.5
+#define CALIBRATION_CPU_SLACK (50 * 1000)
+
+typedef struct {
+    gchar *name;
+    guint64 bytes;
+    gint64 cpu_time;
+} VirtViewerCalibrationResult;
+
+struct _VirtViewerCalibration {
+    GArray *results;
+};
+
+static void
+virt_viewer_calibration_result_clear(gpointer data)
+{
+    VirtViewerCalibrationResult *result = data;
+
+    g_free(result->name);
+}
+
+VirtViewerCalibration *
+virt_viewer_calibration_new(void)
+{
+    VirtViewerCalibration *calibration = g_new0(VirtViewerCalibration, 1);
+
+    calibration->results = g_array_new(FALSE, FALSE, sizeof(VirtViewerCalibrationResult));
+    g_array_set_clear_func(calibration->results, virt_viewer_calibration_result_clear);
+
+    return calibration;
+}
+
+void
+virt_viewer_calibration_free(VirtViewerCalibration *calibration)
+{
+    if (calibration == NULL)
+        return;
+
+    g_array_unref(calibration->results);
+    g_free(calibration);
+}
+
+void
+virt_viewer_calibration_add_result(VirtViewerCalibration *calibration,
+                                   const gchar *name,
+                                   guint64 bytes,
+                                   gint64 cpu_time)
+{
+    VirtViewerCalibrationResult result;
+
+    g_return_if_fail(calibration != NULL);
+    g_return_if_fail(name != NULL);
+
+    if (bytes < CALIBRATION_MIN_BYTES) {
+        g_debug("Ignoring codec %s, only %" G_GUINT64_FORMAT " bytes received", name, bytes);
+        return;
+    }
+
+    result.name = g_strdup(name);
+    result.bytes = bytes;
+    result.cpu_time = MAX(cpu_time, 0);
+    g_array_append_val(calibration->results, result);
+}
+
+/* Returns NULL when no codec got enough data */
+const gchar *
+virt_viewer_calibration_get_winner(VirtViewerCalibration *calibration)
+{
+    VirtViewerCalibrationResult *winner = NULL;
+    gint64 min_cpu_time = G_MAXINT64;
+    gdouble max_cpu_time;
+    guint i;
+
+    g_return_val_if_fail(calibration != NULL, NULL);
+
+    for (i = 0; i < calibration->results->len; i++) {
+        VirtViewerCalibrationResult *result =
+            &g_array_index(calibration->results, VirtViewerCalibrationResult, i);
+        min_cpu_time = MIN(min_cpu_time, result->cpu_time);
+    }
+
+    max_cpu_time = min_cpu_time * CALIBRATION_CPU_RATIO + CALIBRATION_CPU_SLACK;
+    for (i = 0; i < calibration->results->len; i++) {
+        VirtViewerCalibrationResult *result =
+            &g_array_index(calibration->results, VirtViewerCalibrationResult, i);
+
+        if (result->cpu_time > max_cpu_time)
+            continue;
+
+        if (winner == NULL || result->bytes < winner->bytes ||
+            (result->bytes == winner->bytes && result->cpu_time < winner->cpu_time))
+            winner = result;
+    }
+
+    return winner ? winner->name : NULL;
+}
@@ -0,0 +1,34 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _VirtViewerCalibration VirtViewerCalibration;
+
+VirtViewerCalibration *virt_viewer_calibration_new(void);
+void virt_viewer_calibration_free(VirtViewerCalibration *calibration);
+
+void virt_viewer_calibration_add_result(VirtViewerCalibration *calibration,
+                                        const gchar *name,
+                                        guint64 bytes,
+                                        gint64 cpu_time);
+const gchar *virt_viewer_calibration_get_winner(VirtViewerCalibration *calibration);
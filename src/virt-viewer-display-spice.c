@@ -58,6 +58,9 @@ static void virt_viewer_display_spice_release_cursor(VirtViewerDisplay *display)
 static gboolean virt_viewer_display_spice_selectable(VirtViewerDisplay *display);
 static void virt_viewer_display_spice_enable(VirtViewerDisplay *display);
 static void virt_viewer_display_spice_disable(VirtViewerDisplay *display);
+static void virt_viewer_display_spice_apply_scaling(VirtViewerDisplay *display,
+                                                    gboolean enabled,
+                                                    gboolean smooth);
 
 static void
 virt_viewer_display_spice_class_init(VirtViewerDisplaySpiceClass *klass)
@@ -70,6 +73,7 @@ virt_viewer_display_spice_class_init(VirtViewerDisplaySpiceClass *klass)
     dclass->selectable = virt_viewer_display_spice_selectable;
     dclass->enable = virt_viewer_display_spice_enable;
     dclass->disable = virt_viewer_display_spice_disable;
+    dclass->apply_scaling = virt_viewer_display_spice_apply_scaling;
 }
 
 static SpiceMainChannel*
@@ -141,6 +145,18 @@ virt_viewer_display_spice_send_keys(VirtViewerDisplay *display,
     spice_display_send_keys(self->display, keyvals, nkeyvals, SPICE_DISPLAY_KEY_EVENT_CLICK);
 }
 
+/* spice-gtk does not let us pick the filter, the widget is allocated with
+ * the size to scale to */
+static void
+virt_viewer_display_spice_apply_scaling(VirtViewerDisplay *display,
+                                        gboolean enabled,
+                                        gboolean smooth G_GNUC_UNUSED)
+{
+    VirtViewerDisplaySpice *self = VIRT_VIEWER_DISPLAY_SPICE(display);
+
+    g_object_set(self->display, "scaling", enabled, NULL);
+}
+
 static GdkPixbuf *
 virt_viewer_display_spice_get_pixbuf(VirtViewerDisplay *display)
 {
@@ -159,10 +175,35 @@ update_display_ready(VirtViewerDisplaySpice *self)
 
     g_object_get(self->display, "ready", &ready, NULL);
 
+    /* keep showing the display while its hidden window has its channel
+     * paused */
+    if (!ready && self->channel != NULL &&
+        g_object_get_data(G_OBJECT(self->channel), "virt-viewer-paused") != NULL)
+        return;
+
+    if (ready) {
+        VirtViewerSession *session = virt_viewer_display_get_session(VIRT_VIEWER_DISPLAY(self));
+
+        virt_viewer_app_timing_mark(virt_viewer_session_get_app(session), "display-ready %d",
+                                    virt_viewer_display_get_nth(VIRT_VIEWER_DISPLAY(self)));
+    }
+
     virt_viewer_display_set_show_hint(VIRT_VIEWER_DISPLAY(self),
                                       VIRT_VIEWER_DISPLAY_SHOW_HINT_READY, ready);
 }
 
+/* a channel with several monitors updates all of their displays */
+static void
+virt_viewer_display_spice_invalidate(SpiceChannel *channel G_GNUC_UNUSED,
+                                     gint x G_GNUC_UNUSED,
+                                     gint y G_GNUC_UNUSED,
+                                     gint width G_GNUC_UNUSED,
+                                     gint height G_GNUC_UNUSED,
+                                     VirtViewerDisplaySpice *self)
+{
+    virt_viewer_display_notify_update(VIRT_VIEWER_DISPLAY(self));
+}
+
 static void
 virt_viewer_display_spice_keyboard_grab(SpiceDisplay *display G_GNUC_UNUSED,
                                         int grabbed,
@@ -329,6 +370,11 @@ virt_viewer_display_spice_new(VirtViewerSessionSpice *session,
                                       G_CALLBACK(virt_viewer_display_spice_mouse_grab), self, 0);
     virt_viewer_signal_connect_object(self, "size-allocate",
                                       G_CALLBACK(virt_viewer_display_spice_size_allocate), self, 0);
+    virt_viewer_signal_connect_object(channel, "display-invalidate",
+                                      G_CALLBACK(virt_viewer_display_spice_invalidate), self, 0);
+    virt_viewer_signal_connect_object(channel, "gl-draw",
+                                      G_CALLBACK(virt_viewer_display_spice_invalidate), self, 0);
+    virt_viewer_display_watch_input(VIRT_VIEWER_DISPLAY(self), GTK_WIDGET(self->display));
 
 
     app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(session));
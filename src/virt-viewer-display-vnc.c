@@ -49,6 +49,9 @@ G_DEFINE_TYPE(VirtViewerDisplayVnc, virt_viewer_display_vnc, VIRT_VIEWER_TYPE_DI
 static void virt_viewer_display_vnc_send_keys(VirtViewerDisplay* display, const guint *keyvals, int nkeyvals);
 static GdkPixbuf *virt_viewer_display_vnc_get_pixbuf(VirtViewerDisplay* display);
 static void virt_viewer_display_vnc_close(VirtViewerDisplay *display);
+static void virt_viewer_display_vnc_apply_scaling(VirtViewerDisplay *display,
+                                                  gboolean enabled,
+                                                  gboolean smooth);
 
 static void
 virt_viewer_display_vnc_finalize(GObject *obj)
@@ -81,6 +84,7 @@ virt_viewer_display_vnc_class_init(VirtViewerDisplayVncClass *klass)
     dclass->get_pixbuf = virt_viewer_display_vnc_get_pixbuf;
     dclass->close = virt_viewer_display_vnc_close;
     dclass->release_cursor = virt_viewer_display_vnc_release_cursor;
+    dclass->apply_scaling = virt_viewer_display_vnc_apply_scaling;
 }
 
 static void
@@ -118,6 +122,17 @@ virt_viewer_display_vnc_key_ungrab(VncDisplay *vnc G_GNUC_UNUSED,
     g_signal_emit_by_name(display, "display-keyboard-ungrab");
 }
 
+static void
+virt_viewer_display_vnc_framebuffer_update(VncDisplay *vnc G_GNUC_UNUSED,
+                                           gint x G_GNUC_UNUSED,
+                                           gint y G_GNUC_UNUSED,
+                                           gint width G_GNUC_UNUSED,
+                                           gint height G_GNUC_UNUSED,
+                                           VirtViewerDisplay *display)
+{
+    virt_viewer_display_notify_update(display);
+}
+
 static void
 virt_viewer_display_vnc_initialized(VncDisplay *vnc G_GNUC_UNUSED,
                                     VirtViewerDisplay *display)
@@ -162,6 +177,21 @@ virt_viewer_display_vnc_send_keys(VirtViewerDisplay* display,
 }
 
 
+/* "smoothing" is only in recent gtk-vnc versions, without it the scaling
+ * is always smooth */
+static void
+virt_viewer_display_vnc_apply_scaling(VirtViewerDisplay *display,
+                                      gboolean enabled,
+                                      gboolean smooth)
+{
+    VirtViewerDisplayVnc *self = VIRT_VIEWER_DISPLAY_VNC(display);
+
+    vnc_display_set_scaling(self->vnc, enabled);
+    if (g_object_class_find_property(G_OBJECT_GET_CLASS(self->vnc), "smoothing"))
+        g_object_set(self->vnc, "smoothing", smooth, NULL);
+}
+
+
 static GdkPixbuf *
 virt_viewer_display_vnc_get_pixbuf(VirtViewerDisplay* display)
 {
@@ -286,6 +316,9 @@ virt_viewer_display_vnc_new(VirtViewerSessionVnc *session,
                      G_CALLBACK(virt_viewer_display_vnc_key_ungrab), self);
     g_signal_connect(self->vnc, "vnc-initialized",
                      G_CALLBACK(virt_viewer_display_vnc_initialized), self);
+    g_signal_connect(self->vnc, "vnc-framebuffer-update",
+                     G_CALLBACK(virt_viewer_display_vnc_framebuffer_update), self);
+    virt_viewer_display_watch_input(VIRT_VIEWER_DISPLAY(self), GTK_WIDGET(self->vnc));
 
     app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(session));
     virt_viewer_signal_connect_object(app, "notify::release-cursor-display-hotkey",
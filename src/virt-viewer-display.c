@@ -36,6 +36,11 @@ struct _VirtViewerDisplayPrivate
 {
     guint desktopWidth;
     guint desktopHeight;
+    /* the size last asked from the guest, and as capped for it */
+    gint requested_width;
+    gint requested_height;
+    gint capped_width;
+    gint capped_height;
     guint zoom_level;
     gint nth_display; /* Monitor number inside the guest */
     gint monitor;     /* Monitor number on the client */
@@ -44,8 +49,23 @@ struct _VirtViewerDisplayPrivate
     gboolean fullscreen;
     gboolean auto_resize;
     gboolean force_aspect;
+    gboolean hidden;
+    gboolean count_frames;
+    guint64 updates;
+    guint64 frames;
+    guint frame_id;
+    gint64 input_time; /* of the input waiting for an update, or 0 */
+    VirtViewerLatency *input_latency;
+    VirtViewerDisplayScaling scaling;
+    /* as applied to the widget of the display */
+    gboolean scaling_enabled;
+    gboolean scaling_smooth;
 };
 
+#define INPUT_LATENCY_WINDOW 256
+/* an input without update for so long had no visible effect */
+#define INPUT_LATENCY_MAX (G_USEC_PER_SEC)
+
 static void virt_viewer_display_get_preferred_width(GtkWidget *widget,
                                                     int *minwidth,
                                                     int *defwidth);
@@ -63,6 +83,7 @@ static void virt_viewer_display_get_property(GObject *object,
                                              GValue *value,
                                              GParamSpec *pspec);
 static void virt_viewer_display_grab_focus(GtkWidget *widget);
+static void virt_viewer_display_dispose(GObject *object);
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE(VirtViewerDisplay, virt_viewer_display, GTK_TYPE_BIN)
 
@@ -80,6 +101,8 @@ enum {
     PROP_MONITOR,
     PROP_AUTO_RESIZE,
     PROP_FORCE_ASPECT,
+    PROP_HIDDEN,
+    PROP_SCALING,
 };
 
 static void
@@ -90,6 +113,7 @@ virt_viewer_display_class_init(VirtViewerDisplayClass *class)
 
     object_class->set_property = virt_viewer_display_set_property;
     object_class->get_property = virt_viewer_display_get_property;
+    object_class->dispose = virt_viewer_display_dispose;
 
     widget_class->get_preferred_width = virt_viewer_display_get_preferred_width;
     widget_class->get_preferred_height = virt_viewer_display_get_preferred_height;
@@ -200,6 +224,24 @@ virt_viewer_display_class_init(VirtViewerDisplayClass *class)
                                                          G_PARAM_READABLE |
                                                          G_PARAM_WRITABLE));
 
+    g_object_class_install_property(object_class,
+                                    PROP_HIDDEN,
+                                    g_param_spec_boolean("hidden",
+                                                         "Hidden",
+                                                         "Whether the display can not be seen",
+                                                         FALSE,
+                                                         G_PARAM_READABLE));
+
+    g_object_class_install_property(object_class,
+                                    PROP_SCALING,
+                                    g_param_spec_enum("scaling",
+                                                      "Scaling",
+                                                      "How the desktop is scaled to the widget",
+                                                      VIRT_VIEWER_TYPE_DISPLAY_SCALING,
+                                                      VIRT_VIEWER_DISPLAY_SCALING_SMOOTH,
+                                                      G_PARAM_READABLE |
+                                                      G_PARAM_WRITABLE));
+
     g_signal_new("display-pointer-grab",
                  G_OBJECT_CLASS_TYPE(object_class),
                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_HOOKS,
@@ -272,6 +314,26 @@ virt_viewer_display_init(VirtViewerDisplay *display)
     priv->desktopHeight = MIN_DISPLAY_HEIGHT;
     priv->zoom_level = NORMAL_ZOOM_LEVEL;
     priv->force_aspect = TRUE;
+    /* the defaults of the widgets */
+    priv->scaling = VIRT_VIEWER_DISPLAY_SCALING_SMOOTH;
+    priv->scaling_enabled = TRUE;
+    priv->scaling_smooth = TRUE;
+    priv->input_latency = virt_viewer_latency_new(INPUT_LATENCY_WINDOW);
+}
+
+static void
+virt_viewer_display_dispose(GObject *object)
+{
+    VirtViewerDisplay *self = VIRT_VIEWER_DISPLAY(object);
+    VirtViewerDisplayPrivate *priv = virt_viewer_display_get_instance_private(self);
+
+    if (priv->frame_id > 0) {
+        g_source_remove(priv->frame_id);
+        priv->frame_id = 0;
+    }
+    g_clear_pointer(&priv->input_latency, virt_viewer_latency_free);
+
+    G_OBJECT_CLASS(virt_viewer_display_parent_class)->dispose(object);
 }
 
 GtkWidget*
@@ -312,6 +374,9 @@ virt_viewer_display_set_property(GObject *object,
     case PROP_FORCE_ASPECT:
         priv->force_aspect = g_value_get_boolean(value);
         break;
+    case PROP_SCALING:
+        virt_viewer_display_set_scaling(display, g_value_get_enum(value));
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -359,6 +424,12 @@ virt_viewer_display_get_property(GObject *object,
     case PROP_FORCE_ASPECT:
         g_value_set_boolean(value, priv->force_aspect);
         break;
+    case PROP_HIDDEN:
+        g_value_set_boolean(value, priv->hidden);
+        break;
+    case PROP_SCALING:
+        g_value_set_enum(value, priv->scaling);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -426,6 +497,33 @@ static void virt_viewer_display_get_preferred_height(GtkWidget *widget,
 }
 
 
+/* Smoothing is only worth its cost if the desktop is not zoomed in or out
+ * by an integer factor, where the nearest pixel is close enough */
+static void
+virt_viewer_display_apply_scaling(VirtViewerDisplay *self,
+                                  const GtkAllocation *allocation)
+{
+    VirtViewerDisplayPrivate *priv = virt_viewer_display_get_instance_private(self);
+    VirtViewerDisplayClass *klass = VIRT_VIEWER_DISPLAY_GET_CLASS(self);
+    gboolean enabled = priv->scaling != VIRT_VIEWER_DISPLAY_SCALING_OFF;
+    gboolean smooth = priv->scaling == VIRT_VIEWER_DISPLAY_SCALING_SMOOTH;
+
+    if (smooth &&
+        virt_viewer_is_integer_scale(priv->desktopWidth, priv->desktopHeight,
+                                     allocation->width, allocation->height))
+        smooth = FALSE;
+
+    if (klass->apply_scaling == NULL ||
+        (enabled == priv->scaling_enabled && smooth == priv->scaling_smooth))
+        return;
+
+    g_debug("Scaling %s, %s", enabled ? "enabled" : "disabled",
+            smooth ? "smooth" : "nearest");
+    priv->scaling_enabled = enabled;
+    priv->scaling_smooth = smooth;
+    klass->apply_scaling(self, enabled, smooth);
+}
+
 static void
 virt_viewer_display_size_allocate(GtkWidget *widget,
                                   GtkAllocation *allocation)
@@ -450,7 +548,15 @@ virt_viewer_display_size_allocate(GtkWidget *widget,
     width  = MAX(MIN_DISPLAY_WIDTH, allocation->width - 2 * border_width);
     height = MAX(MIN_DISPLAY_HEIGHT, allocation->height - 2 * border_width);
 
-    if (priv->force_aspect) {
+    if (priv->scaling == VIRT_VIEWER_DISPLAY_SCALING_OFF) {
+        virt_viewer_scale_desktop_off(priv->desktopWidth, priv->desktopHeight,
+                                      width, height,
+                                      &child_allocation.width, &child_allocation.height);
+    } else if (priv->scaling == VIRT_VIEWER_DISPLAY_SCALING_INTEGER) {
+        virt_viewer_scale_desktop_integer(priv->desktopWidth, priv->desktopHeight,
+                                          width, height,
+                                          &child_allocation.width, &child_allocation.height);
+    } else if (priv->force_aspect) {
         double desktopAspect = (double) priv->desktopWidth / (double) priv->desktopHeight;
         double actualAspect = (double) width / (double) height;
 
@@ -470,6 +576,7 @@ virt_viewer_display_size_allocate(GtkWidget *widget,
     child_allocation.y = 0.5 * (height - child_allocation.height) + allocation->y + border_width;
 
     g_debug("Child allocate %dx%d", child_allocation.width, child_allocation.height);
+    virt_viewer_display_apply_scaling(display, &child_allocation);
     gtk_widget_size_allocate(child, &child_allocation);
 }
 
@@ -808,3 +915,196 @@ gboolean virt_viewer_display_get_auto_resize(VirtViewerDisplay *self)
     priv = virt_viewer_display_get_instance_private(self);
     return priv->auto_resize;
 }
+
+/* this function informs the display that its window is minimized or
+ * covered, so that the backend may stop updating it */
+void virt_viewer_display_set_hidden(VirtViewerDisplay *self, gboolean hidden)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+
+    priv = virt_viewer_display_get_instance_private(self);
+    if (priv->hidden == hidden)
+        return;
+
+    priv->hidden = hidden;
+    g_object_notify(G_OBJECT(self), "hidden");
+}
+
+gboolean virt_viewer_display_get_hidden(VirtViewerDisplay *self)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_val_if_fail(VIRT_VIEWER_IS_DISPLAY(self), FALSE);
+
+    priv = virt_viewer_display_get_instance_private(self);
+    return priv->hidden;
+}
+
+static gboolean
+virt_viewer_display_frame_done(gpointer opaque)
+{
+    VirtViewerDisplay *self = VIRT_VIEWER_DISPLAY(opaque);
+    VirtViewerDisplayPrivate *priv = virt_viewer_display_get_instance_private(self);
+
+    priv->frame_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/* The subclasses call this for each update of the display from the guest.
+ * The updates of a main loop iteration count as one frame, they are only
+ * counted when asked to. */
+void virt_viewer_display_notify_update(VirtViewerDisplay *self)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+
+    priv = virt_viewer_display_get_instance_private(self);
+    if (priv->input_time != 0) {
+        gint64 latency = g_get_monotonic_time() - priv->input_time;
+
+        if (latency <= INPUT_LATENCY_MAX && priv->input_latency)
+            virt_viewer_latency_add(priv->input_latency, latency);
+        priv->input_time = 0;
+    }
+
+    if (!priv->count_frames)
+        return;
+
+    priv->updates++;
+    if (priv->frame_id == 0) {
+        priv->frames++;
+        priv->frame_id = g_idle_add(virt_viewer_display_frame_done, self);
+    }
+}
+
+/* Counting the updates and frames costs an idle source per frame, only the
+ * benchmark does it */
+/* The size asked from the guest for the preferred @requested_width x
+ * @requested_height of the display, after the caps */
+void virt_viewer_display_set_capped_size(VirtViewerDisplay *self,
+                                         gint requested_width,
+                                         gint requested_height,
+                                         gint capped_width,
+                                         gint capped_height)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+
+    priv = virt_viewer_display_get_instance_private(self);
+    priv->requested_width = requested_width;
+    priv->requested_height = requested_height;
+    priv->capped_width = capped_width;
+    priv->capped_height = capped_height;
+}
+
+/* Whether the desktop has the capped size asked for the display */
+gboolean virt_viewer_display_get_desktop_capped(VirtViewerDisplay *self)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_val_if_fail(VIRT_VIEWER_IS_DISPLAY(self), FALSE);
+
+    priv = virt_viewer_display_get_instance_private(self);
+    return virt_viewer_desktop_is_capped(priv->requested_width, priv->requested_height,
+                                         priv->capped_width, priv->capped_height,
+                                         priv->desktopWidth, priv->desktopHeight);
+}
+
+void virt_viewer_display_set_count_frames(VirtViewerDisplay *self, gboolean count)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+
+    priv = virt_viewer_display_get_instance_private(self);
+    priv->count_frames = count;
+}
+
+void virt_viewer_display_get_update_counts(VirtViewerDisplay *self,
+                                           guint64 *updates,
+                                           guint64 *frames)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+
+    priv = virt_viewer_display_get_instance_private(self);
+    if (updates)
+        *updates = priv->updates;
+    if (frames)
+        *frames = priv->frames;
+}
+
+/*
+ * Marks a key or pointer input sent to the guest, to measure how long it
+ * takes for the next update of the display. An input that comes before the
+ * update of the previous one is not measured.
+ */
+void virt_viewer_display_notify_input(VirtViewerDisplay *self)
+{
+    VirtViewerDisplayPrivate *priv;
+    gint64 now = g_get_monotonic_time();
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+
+    priv = virt_viewer_display_get_instance_private(self);
+    if (priv->input_time == 0 || now - priv->input_time > INPUT_LATENCY_MAX)
+        priv->input_time = now;
+}
+
+static gboolean
+virt_viewer_display_input_event(GtkWidget *widget G_GNUC_UNUSED,
+                                GdkEvent *event G_GNUC_UNUSED,
+                                VirtViewerDisplay *self)
+{
+    virt_viewer_display_notify_input(self);
+    return FALSE;
+}
+
+/* The subclasses call this with the widget getting the input events */
+void virt_viewer_display_watch_input(VirtViewerDisplay *self, GtkWidget *widget)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+    g_return_if_fail(GTK_IS_WIDGET(widget));
+
+    virt_viewer_signal_connect_object(widget, "key-press-event",
+                                      G_CALLBACK(virt_viewer_display_input_event), self, 0);
+    virt_viewer_signal_connect_object(widget, "button-press-event",
+                                      G_CALLBACK(virt_viewer_display_input_event), self, 0);
+    virt_viewer_signal_connect_object(widget, "scroll-event",
+                                      G_CALLBACK(virt_viewer_display_input_event), self, 0);
+}
+
+/* The latencies from an input to the next update, owned by the display */
+VirtViewerLatency *virt_viewer_display_get_input_latency(VirtViewerDisplay *self)
+{
+    VirtViewerDisplayPrivate *priv;
+    g_return_val_if_fail(VIRT_VIEWER_IS_DISPLAY(self), NULL);
+
+    priv = virt_viewer_display_get_instance_private(self);
+    return priv->input_latency;
+}
+
+void
+virt_viewer_display_set_scaling(VirtViewerDisplay *self,
+                                VirtViewerDisplayScaling scaling)
+{
+    VirtViewerDisplayPrivate *priv;
+
+    g_return_if_fail(VIRT_VIEWER_IS_DISPLAY(self));
+
+    priv = virt_viewer_display_get_instance_private(self);
+    if (priv->scaling == scaling)
+        return;
+
+    priv->scaling = scaling;
+    gtk_widget_queue_resize(GTK_WIDGET(self));
+    g_object_notify(G_OBJECT(self), "scaling");
+}
+
+VirtViewerDisplayScaling
+virt_viewer_display_get_scaling(VirtViewerDisplay *self)
+{
+    VirtViewerDisplayPrivate *priv;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_DISPLAY(self), VIRT_VIEWER_DISPLAY_SCALING_SMOOTH);
+
+    priv = virt_viewer_display_get_instance_private(self);
+    return priv->scaling;
+}
@@ -26,6 +26,7 @@
 
 #include <gtk/gtk.h>
 #include "virt-viewer-enums.h"
+#include "virt-viewer-latency.h"
 
 #define MIN_DISPLAY_WIDTH 320
 #define MIN_DISPLAY_HEIGHT 200
@@ -48,6 +49,13 @@ typedef enum {
     VIRT_VIEWER_DISPLAY_SHOW_HINT_SET              = 1 << 2,
 } VirtViewerDisplayShowHintFlags;
 
+typedef enum {
+    VIRT_VIEWER_DISPLAY_SCALING_OFF,
+    VIRT_VIEWER_DISPLAY_SCALING_INTEGER,
+    VIRT_VIEWER_DISPLAY_SCALING_NEAREST,
+    VIRT_VIEWER_DISPLAY_SCALING_SMOOTH,
+} VirtViewerDisplayScaling;
+
 struct _VirtViewerDisplayClass {
     GtkBinClass parent_class;
 
@@ -61,6 +69,7 @@ struct _VirtViewerDisplayClass {
     gboolean (*selectable)(VirtViewerDisplay *display);
     void (*enable)(VirtViewerDisplay *display);
     void (*disable)(VirtViewerDisplay *display);
+    void (*apply_scaling)(VirtViewerDisplay *display, gboolean enabled, gboolean smooth);
 };
 
 #define VIRT_VIEWER_DISPLAY_CAN_SCREENSHOT(display) \
@@ -111,3 +120,21 @@ void virt_viewer_display_get_preferred_monitor_geometry(VirtViewerDisplay *self,
 gint virt_viewer_display_get_nth(VirtViewerDisplay *self);
 void virt_viewer_display_set_auto_resize(VirtViewerDisplay *self, gboolean enabled);
 gboolean virt_viewer_display_get_auto_resize(VirtViewerDisplay *self);
+void virt_viewer_display_set_hidden(VirtViewerDisplay *self, gboolean hidden);
+gboolean virt_viewer_display_get_hidden(VirtViewerDisplay *self);
+void virt_viewer_display_notify_update(VirtViewerDisplay *self);
+void virt_viewer_display_set_count_frames(VirtViewerDisplay *self, gboolean count);
+void virt_viewer_display_set_capped_size(VirtViewerDisplay *self,
+                                         gint requested_width,
+                                         gint requested_height,
+                                         gint capped_width,
+                                         gint capped_height);
+gboolean virt_viewer_display_get_desktop_capped(VirtViewerDisplay *self);
+void virt_viewer_display_get_update_counts(VirtViewerDisplay *self,
+                                           guint64 *updates,
+                                           guint64 *frames);
+void virt_viewer_display_notify_input(VirtViewerDisplay *self);
+void virt_viewer_display_watch_input(VirtViewerDisplay *self, GtkWidget *widget);
+VirtViewerLatency *virt_viewer_display_get_input_latency(VirtViewerDisplay *self);
+void virt_viewer_display_set_scaling(VirtViewerDisplay *self, VirtViewerDisplayScaling scaling);
+VirtViewerDisplayScaling virt_viewer_display_get_scaling(VirtViewerDisplay *self);
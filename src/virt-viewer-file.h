@@ -103,6 +103,30 @@ gchar** virt_viewer_file_get_secure_channels(VirtViewerFile* self, gsize* length
 void virt_viewer_file_set_secure_channels(VirtViewerFile* self, const gchar* const* value, gsize length);
 gint virt_viewer_file_get_delete_this_file(VirtViewerFile* self);
 void virt_viewer_file_set_delete_this_file(VirtViewerFile* self, gint value);
+gint virt_viewer_file_get_timing(VirtViewerFile* self);
+void virt_viewer_file_set_timing(VirtViewerFile* self, gint value);
+gchar* virt_viewer_file_get_scaling(VirtViewerFile* self);
+void virt_viewer_file_set_scaling(VirtViewerFile* self, const gchar* value);
+gchar* virt_viewer_file_get_max_resolution(VirtViewerFile* self);
+void virt_viewer_file_set_max_resolution(VirtViewerFile* self, const gchar* value);
+gint virt_viewer_file_get_max_area(VirtViewerFile* self);
+void virt_viewer_file_set_max_area(VirtViewerFile* self, gint value);
+gchar** virt_viewer_file_get_preferred_video_codecs(VirtViewerFile* self, gsize* length);
+void virt_viewer_file_set_preferred_video_codecs(VirtViewerFile* self, const gchar* const* value, gsize length);
+gchar* virt_viewer_file_get_preferred_compression(VirtViewerFile* self);
+void virt_viewer_file_set_preferred_compression(VirtViewerFile* self, const gchar* value);
+gchar* virt_viewer_file_get_vnc_depth(VirtViewerFile* self);
+void virt_viewer_file_set_vnc_depth(VirtViewerFile* self, const gchar* value);
+gint virt_viewer_file_get_vnc_lossy_encoding(VirtViewerFile* self);
+void virt_viewer_file_set_vnc_lossy_encoding(VirtViewerFile* self, gint value);
+gchar** virt_viewer_file_get_vnc_encodings(VirtViewerFile* self, gsize* length);
+void virt_viewer_file_set_vnc_encodings(VirtViewerFile* self, const gchar* const* value, gsize length);
+gchar* virt_viewer_file_get_serial_log(VirtViewerFile* self);
+void virt_viewer_file_set_serial_log(VirtViewerFile* self, const gchar* value);
+gint virt_viewer_file_get_serial_log_max_size(VirtViewerFile* self);
+void virt_viewer_file_set_serial_log_max_size(VirtViewerFile* self, gint value);
+gint virt_viewer_file_get_serial_log_compress(VirtViewerFile* self);
+void virt_viewer_file_set_serial_log_compress(VirtViewerFile* self, gint value);
 gchar* virt_viewer_file_get_secure_attention(VirtViewerFile* self);
 void virt_viewer_file_set_secure_attention(VirtViewerFile* self, const gchar* value);
 gchar* virt_viewer_file_get_usb_device_reset(VirtViewerFile* self);
@@ -0,0 +1,424 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "virt-viewer-keymap.h"
+#include "virt-viewer-util.h"
+
+/*
+ * The --keymap and the per-VM keymap profiles are compiled into a hash
+ * table keyed by the keyval and the modifiers of the source key, so that
+ * dispatching a key press costs one or two lookups, whatever the number of
+ * mappings.
+ *
+ * A mapping is "SOURCE=KEY+KEY...", where SOURCE is a key name, optionally
+ * prefixed by modifiers as in "<Ctrl><Alt>F1". An empty list of keys
+ * blocks the source key. A source key without modifiers matches whatever
+ * modifiers are pressed, unless a mapping with these exact modifiers
+ * exists.
+ *
+ * Super, Hyper and Meta are virtual modifiers, aliases of a real one: Meta
+ * often sits on Mod1 with Alt. The mappings and the key presses are both
+ * normalized with the aliases of the keyboard, so that "<Alt>F1" and
+ * "<Meta>F1" match the same presses there, whether the state of the press
+ * has the real modifiers only or the virtual ones too. The aliases are
+ * only looked up when the keyboard changes.
+ */
+
+typedef struct {
+    guint keyval;
+    GdkModifierType modifiers;
+    guint nkeyvals;
+    guint *keyvals; /* NULL to block the key */
+} VirtViewerKeymapEntry;
+
+/* The virtual modifiers */
+static const GdkModifierType virtual_masks[] = {
+    GDK_SUPER_MASK,
+    GDK_HYPER_MASK,
+    GDK_META_MASK,
+};
+
+#define REAL_MODIFIERS (GDK_MOD1_MASK | GDK_MOD2_MASK | GDK_MOD3_MASK | \
+                        GDK_MOD4_MASK | GDK_MOD5_MASK)
+
+struct _VirtViewerKeymap {
+    gint ref_count;
+    GHashTable *entries; /* packed key -> VirtViewerKeymapEntry */
+    GdkModifierType aliases[G_N_ELEMENTS(virtual_masks)]; /* real modifiers of each virtual one */
+};
+
+static const struct {
+    const gchar *name;
+    GdkModifierType mask;
+} modifier_names[] = {
+    { "shift", GDK_SHIFT_MASK },
+    { "ctrl", GDK_CONTROL_MASK },
+    { "control", GDK_CONTROL_MASK },
+    { "primary", GDK_CONTROL_MASK },
+    { "alt", GDK_MOD1_MASK },
+    { "mod1", GDK_MOD1_MASK },
+    { "super", GDK_SUPER_MASK },
+    { "hyper", GDK_HYPER_MASK },
+    { "meta", GDK_META_MASK },
+};
+
+/* The modifiers a mapping can use, in the order of their packed bits */
+static const GdkModifierType modifier_masks[] = {
+    GDK_SHIFT_MASK,
+    GDK_CONTROL_MASK,
+    GDK_MOD1_MASK,
+    GDK_SUPER_MASK,
+    GDK_HYPER_MASK,
+    GDK_META_MASK,
+};
+
+#define KEYMAP_MODIFIERS (GDK_SHIFT_MASK | GDK_CONTROL_MASK | GDK_MOD1_MASK | \
+                          GDK_SUPER_MASK | GDK_HYPER_MASK | GDK_META_MASK)
+
+/* The keyvals fit in 25 bits, which leaves 6 bits for the modifiers. With
+ * Shift, the keyval is lowered so that "<Shift>a" matches the "A" that
+ * GDK reports. */
+static gpointer
+keymap_pack(guint keyval, GdkModifierType modifiers)
+{
+    guint bits = 0;
+    guint i;
+
+    if (modifiers & GDK_SHIFT_MASK)
+        keyval = gdk_keyval_to_lower(keyval);
+
+    for (i = 0; i < G_N_ELEMENTS(modifier_masks); i++) {
+        if (modifiers & modifier_masks[i])
+            bits |= 1 << i;
+    }
+
+    return GUINT_TO_POINTER(((keyval & 0x1ffffff) << 6) | bits);
+}
+
+/* Replaces each virtual modifier, or the real one it is on, by Alt when it
+ * is on Mod1, or by the first virtual modifier on the same real one */
+static GdkModifierType
+keymap_normalize(VirtViewerKeymap *self, GdkModifierType modifiers)
+{
+    GdkModifierType normalized = modifiers & ~(GDK_SUPER_MASK | GDK_HYPER_MASK | GDK_META_MASK);
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS(virtual_masks); i++) {
+        GdkModifierType real = self->aliases[i];
+
+        if (!(modifiers & virtual_masks[i]) && !(modifiers & real))
+            continue;
+
+        if (real == 0) {
+            normalized |= virtual_masks[i];
+        } else if (real & GDK_MOD1_MASK) {
+            normalized |= GDK_MOD1_MASK;
+        } else {
+            for (j = 0; j <= i; j++) {
+                if (self->aliases[j] & real) {
+                    normalized |= virtual_masks[j];
+                    break;
+                }
+            }
+        }
+    }
+
+    return normalized;
+}
+
+static void
+virt_viewer_keymap_entry_free(gpointer data)
+{
+    VirtViewerKeymapEntry *entry = data;
+
+    g_free(entry->keyvals);
+    g_free(entry);
+}
+
+VirtViewerKeymap *
+virt_viewer_keymap_new(void)
+{
+    VirtViewerKeymap *self = g_new0(VirtViewerKeymap, 1);
+
+    self->ref_count = 1;
+    self->entries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                          NULL, virt_viewer_keymap_entry_free);
+
+    return self;
+}
+
+VirtViewerKeymap *
+virt_viewer_keymap_ref(VirtViewerKeymap *self)
+{
+    g_return_val_if_fail(self != NULL, NULL);
+
+    g_atomic_int_inc(&self->ref_count);
+
+    return self;
+}
+
+void
+virt_viewer_keymap_unref(VirtViewerKeymap *self)
+{
+    if (self == NULL)
+        return;
+
+    if (!g_atomic_int_dec_and_test(&self->ref_count))
+        return;
+
+    g_hash_table_unref(self->entries);
+    g_free(self);
+}
+
+/* Parses "<Ctrl><Alt>F1" */
+static gboolean
+parse_source_key(const gchar *source,
+                 guint *keyval,
+                 GdkModifierType *modifiers,
+                 GError **error)
+{
+    const gchar *name = source;
+
+    *modifiers = 0;
+    while (*name == '<') {
+        const gchar *end = strchr(name, '>');
+        gboolean found = FALSE;
+        guint i;
+
+        if (end == NULL) {
+            g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                        "Missing '>' in key '%s'", source);
+            return FALSE;
+        }
+        for (i = 0; i < G_N_ELEMENTS(modifier_names); i++) {
+            if (strlen(modifier_names[i].name) == (gsize)(end - name - 1) &&
+                g_ascii_strncasecmp(name + 1, modifier_names[i].name, end - name - 1) == 0) {
+                *modifiers |= modifier_names[i].mask;
+                found = TRUE;
+                break;
+            }
+        }
+        if (!found) {
+            g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                        "Unknown modifier '%.*s' in key '%s'",
+                        (int)(end - name + 1), name, source);
+            return FALSE;
+        }
+        name = end + 1;
+    }
+
+    *keyval = gdk_keyval_from_name(name);
+    if (*keyval == GDK_KEY_VoidSymbol) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    "Unable to lookup '%s' key", name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Adds "SOURCE=KEY+KEY...", replacing an earlier mapping of SOURCE. Nothing
+ * is added if any of the keys is invalid. */
+gboolean
+virt_viewer_keymap_add(VirtViewerKeymap *self,
+                       const gchar *mapping,
+                       GError **error)
+{
+    VirtViewerKeymapEntry *entry;
+    const gchar *value;
+    gchar *source = NULL;
+    gchar **names = NULL;
+    guint keyval, n, i;
+    GdkModifierType modifiers;
+    gboolean ret = FALSE;
+
+    g_return_val_if_fail(self != NULL, FALSE);
+    g_return_val_if_fail(mapping != NULL, FALSE);
+
+    value = strchr(mapping, '=');
+    if (value == NULL) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    "Missing mapping value for key '%s'", mapping);
+        return FALSE;
+    }
+
+    source = g_strstrip(g_strndup(mapping, value - mapping));
+    if (!parse_source_key(source, &keyval, &modifiers, error))
+        goto end;
+
+    entry = g_new0(VirtViewerKeymapEntry, 1);
+    entry->keyval = keyval;
+    entry->modifiers = modifiers;
+
+    names = g_strsplit(value + 1, "+", -1);
+    n = g_strv_length(names);
+    if (n == 0) {
+        g_debug("No value set for key '%s' it will be blocked", source);
+    } else {
+        entry->nkeyvals = n;
+        entry->keyvals = g_new(guint, n);
+        for (i = 0; i < n; i++) {
+            entry->keyvals[i] = gdk_keyval_from_name(g_strstrip(names[i]));
+            if (entry->keyvals[i] == GDK_KEY_VoidSymbol) {
+                g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            "Unable to lookup mapped key '%s' of key '%s'",
+                            names[i], source);
+                virt_viewer_keymap_entry_free(entry);
+                goto end;
+            }
+        }
+    }
+
+    g_debug("Mapped source key '%s' to %x with modifiers %x", source, keyval, modifiers);
+    g_hash_table_replace(self->entries,
+                         keymap_pack(keyval, keymap_normalize(self, modifiers)), entry);
+    ret = TRUE;
+
+end:
+    g_strfreev(names);
+    g_free(source);
+    return ret;
+}
+
+/* Adds each of @mappings, warning about the invalid ones. Returns the
+ * number of mappings added. */
+guint
+virt_viewer_keymap_add_list(VirtViewerKeymap *self,
+                            const gchar * const *mappings)
+{
+    guint added = 0;
+
+    g_return_val_if_fail(self != NULL, 0);
+
+    for (; mappings && *mappings; mappings++) {
+        GError *error = NULL;
+
+        if (**mappings == '\0')
+            continue;
+
+        if (virt_viewer_keymap_add(self, *mappings, &error)) {
+            added++;
+        } else {
+            g_warning("%s", error->message);
+            g_clear_error(&error);
+        }
+    }
+
+    return added;
+}
+
+guint
+virt_viewer_keymap_get_size(VirtViewerKeymap *self)
+{
+    g_return_val_if_fail(self != NULL, 0);
+
+    return g_hash_table_size(self->entries);
+}
+
+/* Sets the real modifiers @virtual_mask is mapped to, 0 if none. The
+ * mappings are indexed again when it changed. */
+void
+virt_viewer_keymap_set_virtual_modifier(VirtViewerKeymap *self,
+                                        GdkModifierType virtual_mask,
+                                        GdkModifierType real)
+{
+    GHashTable *entries;
+    GHashTableIter iter;
+    gpointer value;
+    guint i;
+
+    g_return_if_fail(self != NULL);
+
+    for (i = 0; i < G_N_ELEMENTS(virtual_masks); i++) {
+        if (virtual_masks[i] == virtual_mask)
+            break;
+    }
+    g_return_if_fail(i < G_N_ELEMENTS(virtual_masks));
+
+    real &= REAL_MODIFIERS;
+    if (self->aliases[i] == real)
+        return;
+    self->aliases[i] = real;
+
+    entries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                    NULL, virt_viewer_keymap_entry_free);
+    g_hash_table_iter_init(&iter, self->entries);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        VirtViewerKeymapEntry *entry = value;
+
+        g_hash_table_iter_steal(&iter);
+        /* "<Alt>F1" and "<Meta>F1" may become the same, one of them wins */
+        g_hash_table_replace(entries,
+                             keymap_pack(entry->keyval, keymap_normalize(self, entry->modifiers)),
+                             entry);
+    }
+    g_hash_table_unref(self->entries);
+    self->entries = entries;
+}
+
+/* Takes the aliases of the virtual modifiers from @keymap */
+void
+virt_viewer_keymap_update_modifiers(VirtViewerKeymap *self, GdkKeymap *keymap)
+{
+    guint i;
+
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(GDK_IS_KEYMAP(keymap));
+
+    for (i = 0; i < G_N_ELEMENTS(virtual_masks); i++) {
+        GdkModifierType state = virtual_masks[i];
+
+        gdk_keymap_map_virtual_modifiers(keymap, &state);
+        virt_viewer_keymap_set_virtual_modifier(self, virtual_masks[i], state);
+    }
+}
+
+/* Finds the mapping of a key press. TRUE if the key is mapped, with
+ * *@keyvals set to the keys to send instead, or NULL if it is blocked. */
+gboolean
+virt_viewer_keymap_lookup(VirtViewerKeymap *self,
+                          guint keyval,
+                          GdkModifierType state,
+                          const guint **keyvals,
+                          guint *nkeyvals)
+{
+    VirtViewerKeymapEntry *entry = NULL;
+
+    g_return_val_if_fail(self != NULL, FALSE);
+
+    state = keymap_normalize(self, state) & KEYMAP_MODIFIERS;
+    if (state != 0)
+        entry = g_hash_table_lookup(self->entries, keymap_pack(keyval, state));
+    if (entry == NULL)
+        entry = g_hash_table_lookup(self->entries, keymap_pack(keyval, 0));
+    if (entry == NULL)
+        return FALSE;
+
+    if (keyvals)
+        *keyvals = entry->keyvals;
+    if (nkeyvals)
+        *nkeyvals = entry->nkeyvals;
+
+    return TRUE;
+}
@@ -0,0 +1,48 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <gdk/gdk.h>
+
+typedef struct _VirtViewerKeymap VirtViewerKeymap;
+
+VirtViewerKeymap *virt_viewer_keymap_new(void);
+VirtViewerKeymap *virt_viewer_keymap_ref(VirtViewerKeymap *self);
+void virt_viewer_keymap_unref(VirtViewerKeymap *self);
+
+gboolean virt_viewer_keymap_add(VirtViewerKeymap *self,
+                                const gchar *mapping,
+                                GError **error);
+guint virt_viewer_keymap_add_list(VirtViewerKeymap *self,
+                                  const gchar * const *mappings);
+guint virt_viewer_keymap_get_size(VirtViewerKeymap *self);
+
+void virt_viewer_keymap_set_virtual_modifier(VirtViewerKeymap *self,
+                                             GdkModifierType virtual_mask,
+                                             GdkModifierType real);
+void virt_viewer_keymap_update_modifiers(VirtViewerKeymap *self, GdkKeymap *keymap);
+
+gboolean virt_viewer_keymap_lookup(VirtViewerKeymap *self,
+                                   guint keyval,
+                                   GdkModifierType state,
+                                   const guint **keyvals,
+                                   guint *nkeyvals);
@@ -0,0 +1,171 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "virt-viewer-latency.h"
+#include "virt-viewer-timing.h"
+
+/*
+ * Keeps the last latencies measured, in microseconds, and gives their
+ * percentiles. The window is small, so that they follow the recent
+ * behaviour of the link, and sorting a copy of it is cheap enough to do on
+ * demand.
+ */
+
+struct _VirtViewerLatency {
+    gint64 *samples;
+    guint window;
+    guint count; /* up to window */
+    guint next;
+};
+
+/* @window is the number of latencies kept */
+VirtViewerLatency *
+virt_viewer_latency_new(guint window)
+{
+    VirtViewerLatency *self;
+
+    g_return_val_if_fail(window > 0, NULL);
+
+    self = g_new0(VirtViewerLatency, 1);
+    self->samples = g_new0(gint64, window);
+    self->window = window;
+
+    return self;
+}
+
+void
+virt_viewer_latency_free(VirtViewerLatency *self)
+{
+    if (self == NULL)
+        return;
+
+    g_free(self->samples);
+    g_free(self);
+}
+
+void
+virt_viewer_latency_add(VirtViewerLatency *self, gint64 latency)
+{
+    g_return_if_fail(self != NULL);
+
+    self->samples[self->next] = MAX(latency, 0);
+    self->next = (self->next + 1) % self->window;
+    self->count = MIN(self->count + 1, self->window);
+}
+
+guint
+virt_viewer_latency_get_count(VirtViewerLatency *self)
+{
+    g_return_val_if_fail(self != NULL, 0);
+
+    return self->count;
+}
+
+static gint
+compare_latency(gconstpointer a, gconstpointer b)
+{
+    gint64 la = *(const gint64 *)a;
+    gint64 lb = *(const gint64 *)b;
+
+    return la < lb ? -1 : la > lb;
+}
+
+/* Sorts @count latencies in place, for virt_viewer_latency_percentile() */
+void
+virt_viewer_latency_sort(gint64 *samples, guint count)
+{
+    qsort(samples, count, sizeof(gint64), compare_latency);
+}
+
+/* The @p percentile of @count sorted latencies, by nearest rank */
+gint64
+virt_viewer_latency_percentile(const gint64 *sorted, guint count, guint p)
+{
+    guint rank;
+
+    g_return_val_if_fail(count > 0, 0);
+
+    rank = (count * p + 99) / 100;
+    return sorted[MAX(rank, 1) - 1];
+}
+
+/* Returns FALSE if there is no latency yet */
+gboolean
+virt_viewer_latency_get_percentiles(VirtViewerLatency *self,
+                                    gint64 *p50,
+                                    gint64 *p95,
+                                    gint64 *p99)
+{
+    gint64 *sorted;
+
+    g_return_val_if_fail(self != NULL, FALSE);
+
+    if (self->count == 0)
+        return FALSE;
+
+    sorted = g_new(gint64, self->count);
+    memcpy(sorted, self->samples, self->count * sizeof(gint64));
+    virt_viewer_latency_sort(sorted, self->count);
+    if (p50)
+        *p50 = virt_viewer_latency_percentile(sorted, self->count, 50);
+    if (p95)
+        *p95 = virt_viewer_latency_percentile(sorted, self->count, 95);
+    if (p99)
+        *p99 = virt_viewer_latency_percentile(sorted, self->count, 99);
+    g_free(sorted);
+
+    return TRUE;
+}
+
+/* Appends the "samples":N,"p50":ms,"p95":ms,"p99":ms members of a JSON
+ * object, without the percentiles if there is no latency yet */
+void
+virt_viewer_latency_append_json_members(VirtViewerLatency *self, GString *json)
+{
+    gint64 p50, p95, p99;
+
+    g_return_if_fail(self != NULL);
+
+    g_string_append_printf(json, "\"samples\":%u", self->count);
+    if (virt_viewer_latency_get_percentiles(self, &p50, &p95, &p99)) {
+        g_string_append(json, ",\"p50\":");
+        virt_viewer_timing_append_json_ms(json, p50);
+        g_string_append(json, ",\"p95\":");
+        virt_viewer_timing_append_json_ms(json, p95);
+        g_string_append(json, ",\"p99\":");
+        virt_viewer_timing_append_json_ms(json, p99);
+    }
+}
+
+/* Appends {"samples":N,"p50":ms,"p95":ms,"p99":ms} */
+void
+virt_viewer_latency_append_json(VirtViewerLatency *self, GString *json)
+{
+    g_return_if_fail(self != NULL);
+
+    g_string_append_c(json, '{');
+    virt_viewer_latency_append_json_members(self, json);
+    g_string_append_c(json, '}');
+}
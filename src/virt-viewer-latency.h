@@ -0,0 +1,40 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _VirtViewerLatency VirtViewerLatency;
+
+VirtViewerLatency *virt_viewer_latency_new(guint window);
+void virt_viewer_latency_free(VirtViewerLatency *self);
+
+void virt_viewer_latency_add(VirtViewerLatency *self, gint64 latency);
+guint virt_viewer_latency_get_count(VirtViewerLatency *self);
+gboolean virt_viewer_latency_get_percentiles(VirtViewerLatency *self,
+                                             gint64 *p50,
+                                             gint64 *p95,
+                                             gint64 *p99);
+void virt_viewer_latency_append_json_members(VirtViewerLatency *self, GString *json);
+void virt_viewer_latency_append_json(VirtViewerLatency *self, GString *json);
+
+void virt_viewer_latency_sort(gint64 *samples, guint count);
+gint64 virt_viewer_latency_percentile(const gint64 *sorted, guint count, guint p);
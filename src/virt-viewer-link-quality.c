@@ -0,0 +1,294 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include "virt-viewer-link-quality.h"
+
+/*
+ * Picks the profile of the link to the guest from the latency and
+ * throughput measured on it. Latencies are in microseconds and the
+ * throughput in bytes per second.
+ *
+ * The latency decides the profile. The throughput can only be measured
+ * while the guest is sending something, a low value alone tells nothing
+ * about the link. It keeps a high latency link which carried a lot of data
+ * out of the cellular profile. When the latency grows well over the lowest
+ * one seen while data is flowing, the packets are queued on a saturated
+ * link: the throughput is then its capacity, and a low capacity moves the
+ * profile down.
+ *
+ * A profile is only changed once virt_viewer_link_quality_update() found
+ * the same new one a few times in a row, and the latency has to go well
+ * below a threshold to get back to a better profile than to leave it.
+ */
+
+#define LATENCY_WAN (10 * 1000)
+#define LATENCY_CELLULAR (100 * 1000)
+#define LATENCY_HYSTERESIS 0.7
+#define THROUGHPUT_WAN (10.0 * 1000 * 1000 / 8)
+#define THROUGHPUT_CELLULAR (2.0 * 1000 * 1000 / 8)
+#define THROUGHPUT_DECAY 0.9
+/* the link is saturated when the latency is that many times the lowest
+ * one, and at least CONGESTION_LATENCY over it */
+#define CONGESTION_RATIO 2
+#define CONGESTION_LATENCY (5 * 1000)
+/* less data than this in a transfer leaves the link idle */
+#define ACTIVE_BYTES (16 * 1024)
+#define UPDATES_BEFORE_CHANGE 3
+
+struct _VirtViewerLinkQuality {
+    VirtViewerLinkProfile profile;
+    VirtViewerLinkProfile next_profile;
+    guint next_profile_count;
+    gint64 latency; /* moving average, -1 until measured */
+    gint64 min_latency; /* -1 until measured */
+    gdouble throughput; /* decaying peak */
+    gdouble capacity; /* moving average while saturated, -1 if unknown */
+};
+
+static const gchar * const profile_names[] = {
+    [VIRT_VIEWER_LINK_PROFILE_LAN] = "lan",
+    [VIRT_VIEWER_LINK_PROFILE_WAN] = "wan",
+    [VIRT_VIEWER_LINK_PROFILE_CELLULAR] = "cellular",
+};
+
+const gchar *
+virt_viewer_link_profile_to_string(VirtViewerLinkProfile profile)
+{
+    g_return_val_if_fail(profile < G_N_ELEMENTS(profile_names), NULL);
+
+    return profile_names[profile];
+}
+
+gboolean
+virt_viewer_link_profile_from_string(const gchar *str, VirtViewerLinkProfile *profile)
+{
+    guint i;
+
+    g_return_val_if_fail(str != NULL, FALSE);
+
+    for (i = 0; i < G_N_ELEMENTS(profile_names); i++) {
+        if (g_ascii_strcasecmp(str, profile_names[i]) == 0) {
+            if (profile)
+                *profile = i;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* The profile for a single latency measure, when the link can't be sampled
+ * over time */
+VirtViewerLinkProfile
+virt_viewer_link_profile_from_latency(gint64 latency)
+{
+    if (latency >= LATENCY_CELLULAR)
+        return VIRT_VIEWER_LINK_PROFILE_CELLULAR;
+    if (latency >= LATENCY_WAN)
+        return VIRT_VIEWER_LINK_PROFILE_WAN;
+    return VIRT_VIEWER_LINK_PROFILE_LAN;
+}
+
+/* The total area of the displays requested from the guest on a link of
+ * @profile, 0 for no limit. A smaller resolution keeps a slow link usable. */
+gint64
+virt_viewer_link_profile_get_max_area(VirtViewerLinkProfile profile)
+{
+    static const gint64 max_areas[] = {
+        [VIRT_VIEWER_LINK_PROFILE_LAN] = 0,
+        [VIRT_VIEWER_LINK_PROFILE_WAN] = 2560 * 1440,
+        [VIRT_VIEWER_LINK_PROFILE_CELLULAR] = 1920 * 1080,
+    };
+
+    g_return_val_if_fail(profile < G_N_ELEMENTS(max_areas), 0);
+
+    return max_areas[profile];
+}
+
+VirtViewerLinkQuality *
+virt_viewer_link_quality_new(VirtViewerLinkProfile profile)
+{
+    VirtViewerLinkQuality *quality = g_new0(VirtViewerLinkQuality, 1);
+
+    quality->profile = profile;
+    quality->next_profile = profile;
+    quality->latency = -1;
+    quality->min_latency = -1;
+    quality->capacity = -1;
+
+    return quality;
+}
+
+void
+virt_viewer_link_quality_free(VirtViewerLinkQuality *quality)
+{
+    g_free(quality);
+}
+
+void
+virt_viewer_link_quality_add_latency(VirtViewerLinkQuality *quality, gint64 latency)
+{
+    g_return_if_fail(quality != NULL);
+
+    if (latency < 0)
+        return;
+
+    if (quality->latency < 0)
+        quality->latency = latency;
+    else
+        quality->latency = (3 * quality->latency + latency) / 4;
+
+    if (quality->min_latency < 0 || latency < quality->min_latency)
+        quality->min_latency = latency;
+}
+
+static gboolean
+virt_viewer_link_quality_is_saturated(VirtViewerLinkQuality *quality)
+{
+    if (quality->latency < 0 || quality->min_latency < 0)
+        return FALSE;
+
+    return quality->latency >= CONGESTION_RATIO * quality->min_latency &&
+        quality->latency - quality->min_latency >= CONGESTION_LATENCY;
+}
+
+void
+virt_viewer_link_quality_add_transfer(VirtViewerLinkQuality *quality,
+                                      guint64 bytes, gint64 duration)
+{
+    gdouble throughput;
+
+    g_return_if_fail(quality != NULL);
+
+    if (duration <= 0)
+        return;
+
+    throughput = (gdouble)bytes * G_USEC_PER_SEC / duration;
+    quality->throughput = MAX(throughput, quality->throughput * THROUGHPUT_DECAY);
+
+    if (bytes < ACTIVE_BYTES)
+        return;
+
+    if (virt_viewer_link_quality_is_saturated(quality)) {
+        if (quality->capacity < 0)
+            quality->capacity = throughput;
+        else
+            quality->capacity = (3 * quality->capacity + throughput) / 4;
+    } else if (throughput > quality->capacity) {
+        /* the link carried more than it was thought to */
+        quality->capacity = -1;
+    }
+}
+
+static VirtViewerLinkProfile
+virt_viewer_link_quality_classify(VirtViewerLinkQuality *quality)
+{
+    gdouble wan = LATENCY_WAN;
+    gdouble cellular = LATENCY_CELLULAR;
+    VirtViewerLinkProfile profile;
+
+    if (quality->latency < 0)
+        return quality->profile;
+
+    if (quality->profile >= VIRT_VIEWER_LINK_PROFILE_WAN)
+        wan *= LATENCY_HYSTERESIS;
+    if (quality->profile >= VIRT_VIEWER_LINK_PROFILE_CELLULAR)
+        cellular *= LATENCY_HYSTERESIS;
+
+    if (quality->latency >= cellular)
+        profile = VIRT_VIEWER_LINK_PROFILE_CELLULAR;
+    else if (quality->latency >= wan)
+        profile = VIRT_VIEWER_LINK_PROFILE_WAN;
+    else
+        profile = VIRT_VIEWER_LINK_PROFILE_LAN;
+
+    if (profile == VIRT_VIEWER_LINK_PROFILE_CELLULAR &&
+        quality->throughput >= THROUGHPUT_WAN)
+        profile = VIRT_VIEWER_LINK_PROFILE_WAN;
+
+    if (quality->capacity >= 0 && quality->capacity < THROUGHPUT_CELLULAR)
+        profile = VIRT_VIEWER_LINK_PROFILE_CELLULAR;
+    else if (quality->capacity >= 0 && quality->capacity < THROUGHPUT_WAN)
+        profile = MAX(profile, VIRT_VIEWER_LINK_PROFILE_WAN);
+
+    return profile;
+}
+
+/* Returns TRUE when the profile changed */
+gboolean
+virt_viewer_link_quality_update(VirtViewerLinkQuality *quality)
+{
+    VirtViewerLinkProfile profile;
+
+    g_return_val_if_fail(quality != NULL, FALSE);
+
+    profile = virt_viewer_link_quality_classify(quality);
+    if (profile == quality->profile) {
+        quality->next_profile_count = 0;
+        return FALSE;
+    }
+
+    if (profile != quality->next_profile) {
+        quality->next_profile = profile;
+        quality->next_profile_count = 0;
+    }
+
+    if (++quality->next_profile_count < UPDATES_BEFORE_CHANGE)
+        return FALSE;
+
+    quality->profile = profile;
+    quality->next_profile_count = 0;
+    return TRUE;
+}
+
+VirtViewerLinkProfile
+virt_viewer_link_quality_get_profile(VirtViewerLinkQuality *quality)
+{
+    g_return_val_if_fail(quality != NULL, VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    return quality->profile;
+}
+
+gint64
+virt_viewer_link_quality_get_latency(VirtViewerLinkQuality *quality)
+{
+    g_return_val_if_fail(quality != NULL, -1);
+
+    return quality->latency;
+}
+
+gdouble
+virt_viewer_link_quality_get_throughput(VirtViewerLinkQuality *quality)
+{
+    g_return_val_if_fail(quality != NULL, 0);
+
+    return quality->throughput;
+}
+
+/* The throughput of the link while it was saturated, -1 if unknown */
+gdouble
+virt_viewer_link_quality_get_capacity(VirtViewerLinkQuality *quality)
+{
+    g_return_val_if_fail(quality != NULL, -1);
+
+    return quality->capacity;
+}
@@ -0,0 +1,48 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef enum {
+    VIRT_VIEWER_LINK_PROFILE_LAN,
+    VIRT_VIEWER_LINK_PROFILE_WAN,
+    VIRT_VIEWER_LINK_PROFILE_CELLULAR,
+} VirtViewerLinkProfile;
+
+typedef struct _VirtViewerLinkQuality VirtViewerLinkQuality;
+
+const gchar *virt_viewer_link_profile_to_string(VirtViewerLinkProfile profile);
+gboolean virt_viewer_link_profile_from_string(const gchar *str, VirtViewerLinkProfile *profile);
+VirtViewerLinkProfile virt_viewer_link_profile_from_latency(gint64 latency);
+gint64 virt_viewer_link_profile_get_max_area(VirtViewerLinkProfile profile);
+
+VirtViewerLinkQuality *virt_viewer_link_quality_new(VirtViewerLinkProfile profile);
+void virt_viewer_link_quality_free(VirtViewerLinkQuality *quality);
+
+void virt_viewer_link_quality_add_latency(VirtViewerLinkQuality *quality, gint64 latency);
+void virt_viewer_link_quality_add_transfer(VirtViewerLinkQuality *quality, guint64 bytes, gint64 duration);
+gboolean virt_viewer_link_quality_update(VirtViewerLinkQuality *quality);
+
+VirtViewerLinkProfile virt_viewer_link_quality_get_profile(VirtViewerLinkQuality *quality);
+gint64 virt_viewer_link_quality_get_latency(VirtViewerLinkQuality *quality);
+gdouble virt_viewer_link_quality_get_throughput(VirtViewerLinkQuality *quality);
+gdouble virt_viewer_link_quality_get_capacity(VirtViewerLinkQuality *quality);
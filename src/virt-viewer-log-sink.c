@@ -0,0 +1,395 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "virt-viewer-log-sink.h"
+
+/*
+ * Appends the data of a console to a file from a thread of its own, so that
+ * the caller never waits for the disk. What the thread could not write yet
+ * is queued up to LOG_QUEUE_MAX bytes, beyond that the data is dropped and
+ * a note of it is written in the file.
+ *
+ * Freeing the sink never waits either: the thread writes what is still
+ * queued on its own, and the thread of a new sink of the same file waits
+ * for it before writing. virt_viewer_log_sink_wait_all() waits for them
+ * all when quitting, so that nothing is lost.
+ *
+ * Once the file would grow over max_size, it is renamed to "path.1", the
+ * previous ones to "path.2" and so on, up to LOG_ROTATE_KEEP files. With
+ * compress, the renamed files are gzipped to "path.N.gz".
+ */
+
+#define LOG_QUEUE_MAX (4 * 1024 * 1024)
+#define LOG_ROTATE_KEEP 5
+
+struct _VirtViewerLogSink {
+    gint ref_count;
+    gchar *path;
+    gsize max_size;
+    gboolean compress;
+    GThread *thread;
+
+    GMutex lock;
+    GCond cond;
+    GQueue queue; /* of GBytes */
+    gsize queued;
+    guint64 dropped;
+    gboolean writing;
+    gboolean stopping;
+
+    /* only used by the thread */
+    FILE *file;
+    gsize size;
+    gboolean failed;
+};
+
+/* A freed sink whose thread may still be writing */
+typedef struct {
+    GThread *thread;
+    gchar *path;
+} VirtViewerLogSinkStopping;
+
+static GMutex stopping_lock;
+static GSList *stopping_sinks; /* of VirtViewerLogSinkStopping */
+
+static void
+virt_viewer_log_sink_unref(VirtViewerLogSink *sink)
+{
+    if (!g_atomic_int_dec_and_test(&sink->ref_count))
+        return;
+
+    /* the thread left the queue empty */
+    g_queue_clear(&sink->queue);
+    g_mutex_clear(&sink->lock);
+    g_cond_clear(&sink->cond);
+    g_free(sink->path);
+    g_free(sink);
+}
+
+/* Takes the stopping sinks of @path, or all of them if NULL */
+static GSList *
+virt_viewer_log_sink_steal_stopping(const gchar *path)
+{
+    GSList *stolen = NULL;
+    GSList *l, *next;
+
+    g_mutex_lock(&stopping_lock);
+    for (l = stopping_sinks; l != NULL; l = next) {
+        VirtViewerLogSinkStopping *stopping = l->data;
+
+        next = l->next;
+        if (path != NULL && g_strcmp0(stopping->path, path) != 0)
+            continue;
+        stopping_sinks = g_slist_remove_link(stopping_sinks, l);
+        stolen = g_slist_concat(l, stolen);
+    }
+    g_mutex_unlock(&stopping_lock);
+
+    return stolen;
+}
+
+static void
+virt_viewer_log_sink_join_stopping(GSList *stopping_list)
+{
+    GSList *l;
+
+    for (l = stopping_list; l != NULL; l = l->next) {
+        VirtViewerLogSinkStopping *stopping = l->data;
+
+        g_thread_join(stopping->thread);
+        g_free(stopping->path);
+        g_free(stopping);
+    }
+    g_slist_free(stopping_list);
+}
+
+static gchar *
+virt_viewer_log_sink_rotated_path(VirtViewerLogSink *sink, guint n)
+{
+    return g_strdup_printf("%s.%u%s", sink->path, n, sink->compress ? ".gz" : "");
+}
+
+static gboolean
+virt_viewer_log_sink_compress(const gchar *src, const gchar *dst, GError **error)
+{
+    GFile *in = g_file_new_for_path(src);
+    GFile *out = g_file_new_for_path(dst);
+    GFileInputStream *istream = NULL;
+    GFileOutputStream *ostream = NULL;
+    GConverter *compressor = NULL;
+    GOutputStream *cstream = NULL;
+    gboolean ret = FALSE;
+
+    istream = g_file_read(in, NULL, error);
+    if (istream == NULL)
+        goto end;
+
+    ostream = g_file_replace(out, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+    if (ostream == NULL)
+        goto end;
+
+    compressor = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1));
+    cstream = g_converter_output_stream_new(G_OUTPUT_STREAM(ostream), compressor);
+    ret = g_output_stream_splice(cstream, G_INPUT_STREAM(istream),
+                                 G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                                 G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                                 NULL, error) >= 0;
+
+end:
+    g_clear_object(&cstream);
+    g_clear_object(&compressor);
+    g_clear_object(&ostream);
+    g_clear_object(&istream);
+    g_object_unref(out);
+    g_object_unref(in);
+    return ret;
+}
+
+static void
+virt_viewer_log_sink_rotate(VirtViewerLogSink *sink)
+{
+    gchar *path;
+    guint i;
+
+    fclose(sink->file);
+    sink->file = NULL;
+
+    path = virt_viewer_log_sink_rotated_path(sink, LOG_ROTATE_KEEP);
+    g_unlink(path);
+    g_free(path);
+    for (i = LOG_ROTATE_KEEP - 1; i > 0; i--) {
+        gchar *from = virt_viewer_log_sink_rotated_path(sink, i);
+        gchar *to = virt_viewer_log_sink_rotated_path(sink, i + 1);
+
+        g_rename(from, to);
+        g_free(from);
+        g_free(to);
+    }
+
+    path = virt_viewer_log_sink_rotated_path(sink, 1);
+    if (sink->compress) {
+        GError *error = NULL;
+
+        if (virt_viewer_log_sink_compress(sink->path, path, &error)) {
+            g_unlink(sink->path);
+        } else {
+            g_warning("Failed to compress %s: %s", sink->path, error->message);
+            g_clear_error(&error);
+        }
+    } else {
+        g_rename(sink->path, path);
+    }
+    g_free(path);
+}
+
+static gboolean
+virt_viewer_log_sink_append(VirtViewerLogSink *sink, gconstpointer data, gsize size)
+{
+    if (sink->file != NULL && sink->max_size > 0 &&
+        sink->size > 0 && sink->size + size > sink->max_size)
+        virt_viewer_log_sink_rotate(sink);
+
+    if (sink->file == NULL) {
+        sink->file = g_fopen(sink->path, "ab");
+        if (sink->file == NULL) {
+            g_warning("Failed to open %s: %s", sink->path, g_strerror(errno));
+            return FALSE;
+        }
+        fseek(sink->file, 0, SEEK_END);
+        sink->size = ftell(sink->file);
+    }
+
+    if (fwrite(data, 1, size, sink->file) != size ||
+        fflush(sink->file) != 0) {
+        g_warning("Failed to write %s: %s", sink->path, g_strerror(errno));
+        return FALSE;
+    }
+    sink->size += size;
+
+    return TRUE;
+}
+
+static gpointer
+virt_viewer_log_sink_thread(gpointer data)
+{
+    VirtViewerLogSink *sink = data;
+    GSList *l;
+
+    /* a freed sink of the same file may still be writing */
+    virt_viewer_log_sink_join_stopping(virt_viewer_log_sink_steal_stopping(sink->path));
+
+    g_mutex_lock(&sink->lock);
+    for (;;) {
+        GBytes *bytes;
+        gsize size;
+
+        while (g_queue_is_empty(&sink->queue) && !sink->stopping)
+            g_cond_wait(&sink->cond, &sink->lock);
+
+        bytes = g_queue_pop_head(&sink->queue);
+        if (bytes == NULL)
+            break;
+
+        sink->writing = TRUE;
+        g_mutex_unlock(&sink->lock);
+
+        size = g_bytes_get_size(bytes);
+        /* the data is dropped once the file can't be written */
+        if (!sink->failed)
+            sink->failed = !virt_viewer_log_sink_append(sink, g_bytes_get_data(bytes, NULL), size);
+        g_bytes_unref(bytes);
+
+        g_mutex_lock(&sink->lock);
+        sink->queued -= size;
+        sink->writing = FALSE;
+        g_cond_broadcast(&sink->cond);
+    }
+    g_mutex_unlock(&sink->lock);
+
+    if (sink->file != NULL)
+        fclose(sink->file);
+
+    /* nobody has to join this thread any more, unless they already took it */
+    g_mutex_lock(&stopping_lock);
+    for (l = stopping_sinks; l != NULL; l = l->next) {
+        VirtViewerLogSinkStopping *stopping = l->data;
+
+        if (stopping->thread == g_thread_self()) {
+            stopping_sinks = g_slist_delete_link(stopping_sinks, l);
+            g_thread_unref(stopping->thread);
+            g_free(stopping->path);
+            g_free(stopping);
+            break;
+        }
+    }
+    g_mutex_unlock(&stopping_lock);
+
+    virt_viewer_log_sink_unref(sink);
+
+    return NULL;
+}
+
+/* @max_size is the size of the file rotation, 0 for none */
+VirtViewerLogSink *
+virt_viewer_log_sink_new(const gchar *path, gsize max_size, gboolean compress)
+{
+    VirtViewerLogSink *sink;
+
+    g_return_val_if_fail(path != NULL, NULL);
+
+    sink = g_new0(VirtViewerLogSink, 1);
+    sink->ref_count = 2; /* for the thread */
+    sink->path = g_strdup(path);
+    sink->max_size = max_size;
+    sink->compress = compress;
+    g_mutex_init(&sink->lock);
+    g_cond_init(&sink->cond);
+    g_queue_init(&sink->queue);
+    sink->thread = g_thread_new("virt-viewer-log", virt_viewer_log_sink_thread, sink);
+
+    return sink;
+}
+
+/* The data still queued is written in the background */
+void
+virt_viewer_log_sink_free(VirtViewerLogSink *sink)
+{
+    VirtViewerLogSinkStopping *stopping;
+
+    if (sink == NULL)
+        return;
+
+    /* before the thread may stop */
+    stopping = g_new0(VirtViewerLogSinkStopping, 1);
+    stopping->thread = sink->thread;
+    stopping->path = g_strdup(sink->path);
+    g_mutex_lock(&stopping_lock);
+    stopping_sinks = g_slist_prepend(stopping_sinks, stopping);
+    g_mutex_unlock(&stopping_lock);
+
+    g_mutex_lock(&sink->lock);
+    sink->stopping = TRUE;
+    g_cond_broadcast(&sink->cond);
+    g_mutex_unlock(&sink->lock);
+
+    virt_viewer_log_sink_unref(sink);
+}
+
+/* Waits until the freed sinks wrote what they had queued, when quitting */
+void
+virt_viewer_log_sink_wait_all(void)
+{
+    virt_viewer_log_sink_join_stopping(virt_viewer_log_sink_steal_stopping(NULL));
+}
+
+static void
+virt_viewer_log_sink_push(VirtViewerLogSink *sink, GBytes *bytes)
+{
+    g_queue_push_tail(&sink->queue, bytes);
+    sink->queued += g_bytes_get_size(bytes);
+}
+
+/* Never waits for the writes */
+void
+virt_viewer_log_sink_write(VirtViewerLogSink *sink, gconstpointer data, gsize size)
+{
+    g_return_if_fail(sink != NULL);
+
+    if (size == 0)
+        return;
+
+    g_mutex_lock(&sink->lock);
+    if (sink->queued + size > LOG_QUEUE_MAX) {
+        sink->dropped += size;
+        g_mutex_unlock(&sink->lock);
+        return;
+    }
+
+    if (sink->dropped > 0) {
+        gchar *note = g_strdup_printf("\n[virt-viewer: %" G_GUINT64_FORMAT " bytes dropped]\n",
+                                      sink->dropped);
+
+        virt_viewer_log_sink_push(sink, g_bytes_new_take(note, strlen(note)));
+        sink->dropped = 0;
+    }
+    virt_viewer_log_sink_push(sink, g_bytes_new(data, size));
+    g_cond_broadcast(&sink->cond);
+    g_mutex_unlock(&sink->lock);
+}
+
+/* Waits until the data queued so far is written */
+void
+virt_viewer_log_sink_flush(VirtViewerLogSink *sink)
+{
+    g_return_if_fail(sink != NULL);
+
+    g_mutex_lock(&sink->lock);
+    while (!g_queue_is_empty(&sink->queue) || sink->writing)
+        g_cond_wait(&sink->cond, &sink->lock);
+    g_mutex_unlock(&sink->lock);
+}
@@ -0,0 +1,36 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _VirtViewerLogSink VirtViewerLogSink;
+
+VirtViewerLogSink *virt_viewer_log_sink_new(const gchar *path,
+                                            gsize max_size,
+                                            gboolean compress);
+void virt_viewer_log_sink_free(VirtViewerLogSink *sink);
+void virt_viewer_log_sink_wait_all(void);
+
+void virt_viewer_log_sink_write(VirtViewerLogSink *sink,
+                                gconstpointer data,
+                                gsize size);
+void virt_viewer_log_sink_flush(VirtViewerLogSink *sink);
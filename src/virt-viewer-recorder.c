@@ -0,0 +1,340 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "virt-viewer-recorder.h"
+#include "virt-viewer-screenshot.h"
+
+/*
+ * Records the frames of the displays to a directory, as QOI images and a
+ * "manifest.csv" listing them with their time since the start, from which
+ * a video can be made offline.
+ *
+ * The caller only grabs the frames: hashing, encoding and writing happen in
+ * a thread. At most max_pending frames wait for it, the frames pushed beyond
+ * are dropped rather than letting the caller wait. A frame with the same
+ * content as the previous one of its display is not written. What all this
+ * costs is summed up in "summary.txt" once the recording stops.
+ */
+
+typedef struct {
+    gint display;
+    GdkPixbuf *pixbuf;
+    gint64 time;
+} VirtViewerRecorderFrame;
+
+struct _VirtViewerRecorder {
+    gchar *dir;
+    guint max_pending;
+    gint64 start;
+    GThread *thread;
+
+    GMutex lock;
+    GCond cond;
+    GQueue queue; /* of VirtViewerRecorderFrame */
+    gboolean stopping;
+    VirtViewerRecorderStats stats;
+
+    /* only used by the thread */
+    FILE *manifest;
+    GHashTable *hashes; /* display -> guint64 * */
+    guint sequence;
+};
+
+static guint64
+virt_viewer_recorder_hash(GdkPixbuf *pixbuf)
+{
+    const guint8 *pixels = gdk_pixbuf_read_pixels(pixbuf);
+    int stride = gdk_pixbuf_get_rowstride(pixbuf);
+    int height = gdk_pixbuf_get_height(pixbuf);
+    gsize length = (gsize)gdk_pixbuf_get_width(pixbuf) * gdk_pixbuf_get_n_channels(pixbuf);
+    guint64 hash = 0xcbf29ce484222325ULL ^ length ^ ((guint64)height << 32);
+    int y;
+
+    /* FNV-1a, a word rather than a byte at a time */
+    for (y = 0; y < height; y++) {
+        const guint8 *row = pixels + (gsize)y * stride;
+        gsize i;
+
+        for (i = 0; i + 8 <= length; i += 8) {
+            guint64 word;
+
+            memcpy(&word, row + i, 8);
+            hash = (hash ^ word) * 0x100000001b3ULL;
+        }
+        for (; i < length; i++)
+            hash = (hash ^ row[i]) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/* Returns the bytes written, 0 if the frame was unchanged, -1 on error */
+static gssize
+virt_viewer_recorder_write(VirtViewerRecorder *self, VirtViewerRecorderFrame *frame)
+{
+    guint64 hash = virt_viewer_recorder_hash(frame->pixbuf);
+    guint64 *last = g_hash_table_lookup(self->hashes, GINT_TO_POINTER(frame->display));
+    GError *error = NULL;
+    GBytes *bytes;
+    gchar *name, *path;
+    gssize written = -1;
+
+    if (last != NULL && *last == hash)
+        return 0;
+
+    bytes = virt_viewer_screenshot_encode_qoi(frame->pixbuf);
+    name = g_strdup_printf("display%d-%06u.qoi", frame->display + 1, self->sequence++);
+    path = g_build_filename(self->dir, name, NULL);
+    if (!g_file_set_contents(path, g_bytes_get_data(bytes, NULL),
+                             g_bytes_get_size(bytes), &error)) {
+        g_warning("Failed to write %s: %s", path, error->message);
+        g_clear_error(&error);
+        goto end;
+    }
+
+    if (fprintf(self->manifest, "%d,%" G_GINT64_FORMAT ",%s\n",
+                frame->display + 1, frame->time, name) < 0 ||
+        fflush(self->manifest) != 0) {
+        g_warning("Failed to write the recording manifest: %s", g_strerror(errno));
+        goto end;
+    }
+
+    if (last == NULL) {
+        last = g_new(guint64, 1);
+        g_hash_table_insert(self->hashes, GINT_TO_POINTER(frame->display), last);
+    }
+    *last = hash;
+    written = g_bytes_get_size(bytes);
+
+end:
+    g_free(path);
+    g_free(name);
+    g_bytes_unref(bytes);
+    return written;
+}
+
+static gpointer
+virt_viewer_recorder_thread(gpointer data)
+{
+    VirtViewerRecorder *self = data;
+
+    g_mutex_lock(&self->lock);
+    for (;;) {
+        VirtViewerRecorderFrame *frame;
+        gint64 start;
+        gssize written;
+
+        while (g_queue_is_empty(&self->queue) && !self->stopping)
+            g_cond_wait(&self->cond, &self->lock);
+
+        frame = g_queue_peek_head(&self->queue);
+        if (frame == NULL)
+            break;
+        g_mutex_unlock(&self->lock);
+
+        start = g_get_monotonic_time();
+        written = virt_viewer_recorder_write(self, frame);
+
+        g_mutex_lock(&self->lock);
+        /* only leaves the queue now, so that it counts as pending */
+        g_queue_pop_head(&self->queue);
+        self->stats.encode_time += g_get_monotonic_time() - start;
+        if (written > 0) {
+            self->stats.written++;
+            self->stats.bytes += written;
+        } else if (written == 0) {
+            self->stats.unchanged++;
+        }
+        g_object_unref(frame->pixbuf);
+        g_free(frame);
+    }
+    g_mutex_unlock(&self->lock);
+
+    return NULL;
+}
+
+VirtViewerRecorder *
+virt_viewer_recorder_new(const gchar *dir, guint max_pending, GError **error)
+{
+    VirtViewerRecorder *self;
+    gchar *path;
+    FILE *manifest;
+
+    g_return_val_if_fail(dir != NULL, NULL);
+    g_return_val_if_fail(max_pending > 0, NULL);
+
+    if (g_mkdir_with_parents(dir, 0755) < 0) {
+        int err = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err),
+                    "Unable to create %s: %s", dir, g_strerror(err));
+        return NULL;
+    }
+
+    path = g_build_filename(dir, "manifest.csv", NULL);
+    manifest = g_fopen(path, "w");
+    if (manifest == NULL) {
+        int err = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err),
+                    "Unable to create %s: %s", path, g_strerror(err));
+        g_free(path);
+        return NULL;
+    }
+    g_free(path);
+    fputs("display,time_us,file\n", manifest);
+
+    self = g_new0(VirtViewerRecorder, 1);
+    self->dir = g_strdup(dir);
+    self->max_pending = max_pending;
+    self->start = g_get_monotonic_time();
+    self->manifest = manifest;
+    self->hashes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    g_mutex_init(&self->lock);
+    g_cond_init(&self->cond);
+    g_queue_init(&self->queue);
+    self->thread = g_thread_new("virt-viewer-record", virt_viewer_recorder_thread, self);
+
+    return self;
+}
+
+static void
+virt_viewer_recorder_write_summary(VirtViewerRecorder *self)
+{
+    VirtViewerRecorderStats *stats = &self->stats;
+    gchar *path = g_build_filename(self->dir, "summary.txt", NULL);
+    gchar *summary;
+    GError *error = NULL;
+
+    summary = g_strdup_printf("duration_us=%" G_GINT64_FORMAT "\n"
+                              "frames=%u\n"
+                              "written=%u\n"
+                              "unchanged=%u\n"
+                              "dropped=%u\n"
+                              "bytes=%" G_GUINT64_FORMAT "\n"
+                              "grab_time_us=%" G_GINT64_FORMAT "\n"
+                              "encode_time_us=%" G_GINT64_FORMAT "\n"
+                              "main_loop_overhead=%.2f%%\n",
+                              stats->elapsed, stats->frames, stats->written,
+                              stats->unchanged, stats->dropped, stats->bytes,
+                              stats->grab_time, stats->encode_time,
+                              stats->elapsed > 0 ? 100.0 * stats->grab_time / stats->elapsed : 0.0);
+    if (!g_file_set_contents(path, summary, -1, &error)) {
+        g_warning("Failed to write %s: %s", path, error->message);
+        g_clear_error(&error);
+    }
+
+    g_free(summary);
+    g_free(path);
+}
+
+/* Waits for the pending frames to be written and sums the recording up */
+void
+virt_viewer_recorder_stop(VirtViewerRecorder *self)
+{
+    g_return_if_fail(self != NULL);
+
+    if (self->thread == NULL)
+        return;
+
+    g_mutex_lock(&self->lock);
+    self->stopping = TRUE;
+    g_cond_broadcast(&self->cond);
+    g_mutex_unlock(&self->lock);
+    g_thread_join(self->thread);
+    self->thread = NULL;
+
+    self->stats.elapsed = g_get_monotonic_time() - self->start;
+    virt_viewer_recorder_write_summary(self);
+}
+
+void
+virt_viewer_recorder_free(VirtViewerRecorder *self)
+{
+    if (self == NULL)
+        return;
+
+    virt_viewer_recorder_stop(self);
+
+    fclose(self->manifest);
+    g_hash_table_unref(self->hashes);
+    g_mutex_clear(&self->lock);
+    g_cond_clear(&self->cond);
+    g_free(self->dir);
+    g_free(self);
+}
+
+/*
+ * @grab_time is how long getting @pixbuf took, in us. The pixbuf must not
+ * be modified afterwards. Returns FALSE if the frame was dropped.
+ */
+gboolean
+virt_viewer_recorder_push(VirtViewerRecorder *self,
+                          gint display,
+                          GdkPixbuf *pixbuf,
+                          gint64 grab_time)
+{
+    VirtViewerRecorderFrame *frame;
+    gboolean queued = FALSE;
+
+    g_return_val_if_fail(self != NULL, FALSE);
+    g_return_val_if_fail(GDK_IS_PIXBUF(pixbuf), FALSE);
+
+    g_mutex_lock(&self->lock);
+    if (self->stopping) {
+        g_mutex_unlock(&self->lock);
+        return FALSE;
+    }
+    self->stats.frames++;
+    self->stats.grab_time += grab_time;
+    if (g_queue_get_length(&self->queue) >= self->max_pending) {
+        self->stats.dropped++;
+    } else {
+        frame = g_new0(VirtViewerRecorderFrame, 1);
+        frame->display = display;
+        frame->pixbuf = g_object_ref(pixbuf);
+        frame->time = g_get_monotonic_time() - self->start;
+        g_queue_push_tail(&self->queue, frame);
+        g_cond_broadcast(&self->cond);
+        queued = TRUE;
+    }
+    g_mutex_unlock(&self->lock);
+
+    return queued;
+}
+
+void
+virt_viewer_recorder_get_stats(VirtViewerRecorder *self,
+                               VirtViewerRecorderStats *stats)
+{
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(stats != NULL);
+
+    g_mutex_lock(&self->lock);
+    *stats = self->stats;
+    if (!self->stopping)
+        stats->elapsed = g_get_monotonic_time() - self->start;
+    g_mutex_unlock(&self->lock);
+}
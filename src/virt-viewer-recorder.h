@@ -0,0 +1,49 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+typedef struct _VirtViewerRecorder VirtViewerRecorder;
+
+typedef struct {
+    guint frames;       /* pushed */
+    guint written;
+    guint unchanged;    /* same content as the previous frame of the display */
+    guint dropped;      /* the pipeline was full */
+    guint64 bytes;      /* written */
+    gint64 elapsed;     /* us, since the recording started */
+    gint64 grab_time;   /* us, spent by the caller to grab the frames */
+    gint64 encode_time; /* us, spent by the thread to hash, encode and write */
+} VirtViewerRecorderStats;
+
+VirtViewerRecorder *virt_viewer_recorder_new(const gchar *dir,
+                                             guint max_pending,
+                                             GError **error);
+void virt_viewer_recorder_stop(VirtViewerRecorder *self);
+void virt_viewer_recorder_free(VirtViewerRecorder *self);
+
+gboolean virt_viewer_recorder_push(VirtViewerRecorder *self,
+                                   gint display,
+                                   GdkPixbuf *pixbuf,
+                                   gint64 grab_time);
+void virt_viewer_recorder_get_stats(VirtViewerRecorder *self,
+                                    VirtViewerRecorderStats *stats);
@@ -0,0 +1,158 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "virt-viewer-ring-buffer.h"
+
+/*
+ * A byte queue merging many small writes so that they can be handed over
+ * in large chunks. It grows as needed, by doubling its size, so that
+ * writes never fail; the readers keep it small by draining it.
+ */
+
+struct _VirtViewerRingBuffer {
+    guint8 *data;
+    gsize size;
+    gsize start; /* offset of the first byte queued */
+    gsize length;
+};
+
+VirtViewerRingBuffer *
+virt_viewer_ring_buffer_new(gsize size)
+{
+    VirtViewerRingBuffer *buffer;
+
+    g_return_val_if_fail(size > 0, NULL);
+
+    buffer = g_new0(VirtViewerRingBuffer, 1);
+    buffer->size = size;
+    buffer->data = g_malloc(size);
+
+    return buffer;
+}
+
+void
+virt_viewer_ring_buffer_free(VirtViewerRingBuffer *buffer)
+{
+    if (buffer == NULL)
+        return;
+
+    g_free(buffer->data);
+    g_free(buffer);
+}
+
+/* Copies the first @size queued bytes to @data */
+static void
+virt_viewer_ring_buffer_copy(VirtViewerRingBuffer *buffer,
+                             gpointer data,
+                             gsize size)
+{
+    gsize first = MIN(size, buffer->size - buffer->start);
+
+    memcpy(data, buffer->data + buffer->start, first);
+    memcpy((guint8 *)data + first, buffer->data, size - first);
+}
+
+static void
+virt_viewer_ring_buffer_grow(VirtViewerRingBuffer *buffer, gsize length)
+{
+    gsize size = buffer->size;
+    guint8 *data;
+
+    while (size < length)
+        size *= 2;
+
+    data = g_malloc(size);
+    virt_viewer_ring_buffer_copy(buffer, data, buffer->length);
+    g_free(buffer->data);
+
+    buffer->data = data;
+    buffer->size = size;
+    buffer->start = 0;
+}
+
+void
+virt_viewer_ring_buffer_write(VirtViewerRingBuffer *buffer,
+                              gconstpointer data,
+                              gsize size)
+{
+    gsize end, first;
+
+    g_return_if_fail(buffer != NULL);
+
+    if (buffer->length + size > buffer->size)
+        virt_viewer_ring_buffer_grow(buffer, buffer->length + size);
+
+    end = (buffer->start + buffer->length) % buffer->size;
+    first = MIN(size, buffer->size - end);
+    memcpy(buffer->data + end, data, first);
+    memcpy(buffer->data, (const guint8 *)data + first, size - first);
+    buffer->length += size;
+}
+
+/* Returns the number of bytes copied to @data, at most @size */
+gsize
+virt_viewer_ring_buffer_read(VirtViewerRingBuffer *buffer,
+                             gpointer data,
+                             gsize size)
+{
+    g_return_val_if_fail(buffer != NULL, 0);
+
+    size = MIN(size, buffer->length);
+    virt_viewer_ring_buffer_copy(buffer, data, size);
+    virt_viewer_ring_buffer_consume(buffer, size);
+
+    return size;
+}
+
+/* Points @data to the first bytes queued, returns how many of them are
+ * contiguous. They stay valid until the buffer is written to. */
+gsize
+virt_viewer_ring_buffer_peek(VirtViewerRingBuffer *buffer,
+                             gconstpointer *data)
+{
+    g_return_val_if_fail(buffer != NULL, 0);
+
+    *data = buffer->data + buffer->start;
+
+    return MIN(buffer->length, buffer->size - buffer->start);
+}
+
+void
+virt_viewer_ring_buffer_consume(VirtViewerRingBuffer *buffer,
+                                gsize size)
+{
+    g_return_if_fail(buffer != NULL);
+    g_return_if_fail(size <= buffer->length);
+
+    buffer->length -= size;
+    buffer->start = buffer->length == 0 ? 0 : (buffer->start + size) % buffer->size;
+}
+
+gsize
+virt_viewer_ring_buffer_get_length(VirtViewerRingBuffer *buffer)
+{
+    g_return_val_if_fail(buffer != NULL, 0);
+
+    return buffer->length;
+}
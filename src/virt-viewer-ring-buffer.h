@@ -0,0 +1,40 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _VirtViewerRingBuffer VirtViewerRingBuffer;
+
+VirtViewerRingBuffer *virt_viewer_ring_buffer_new(gsize size);
+void virt_viewer_ring_buffer_free(VirtViewerRingBuffer *buffer);
+
+void virt_viewer_ring_buffer_write(VirtViewerRingBuffer *buffer,
+                                   gconstpointer data,
+                                   gsize size);
+gsize virt_viewer_ring_buffer_read(VirtViewerRingBuffer *buffer,
+                                   gpointer data,
+                                   gsize size);
+gsize virt_viewer_ring_buffer_peek(VirtViewerRingBuffer *buffer,
+                                   gconstpointer *data);
+void virt_viewer_ring_buffer_consume(VirtViewerRingBuffer *buffer,
+                                     gsize size);
+gsize virt_viewer_ring_buffer_get_length(VirtViewerRingBuffer *buffer);
@@ -0,0 +1,290 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <glib/gi18n.h>
+
+#include "virt-viewer-screenshot.h"
+
+/*
+ * Saves the screenshots of the displays. Besides the formats gdk-pixbuf
+ * can write, the uncompressed PPM and the lossless QOI formats are
+ * supported: they are many times faster to encode than PNG, which matters
+ * for large displays and recordings. The encoding can be done in a thread
+ * so that the displays keep being updated meanwhile.
+ */
+
+static void add_if_writable (GdkPixbufFormat *data, GHashTable *formats)
+{
+    if (gdk_pixbuf_format_is_writable(data)) {
+        gchar **extensions;
+        gchar **it;
+        extensions = gdk_pixbuf_format_get_extensions(data);
+        for (it = extensions; *it != NULL; it++) {
+            g_hash_table_insert(formats, g_strdup(*it), data);
+        }
+        g_strfreev(extensions);
+    }
+}
+
+static GHashTable *init_image_formats(G_GNUC_UNUSED gpointer user_data)
+{
+    GHashTable *format_map;
+    GSList *formats = gdk_pixbuf_get_formats();
+
+    format_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    g_slist_foreach(formats, (GFunc)add_if_writable, format_map);
+    g_slist_free (formats);
+
+    return format_map;
+}
+
+/* @format is a file name extension */
+static GdkPixbufFormat *get_image_format(const char *format)
+{
+    static GOnce image_formats_once = G_ONCE_INIT;
+
+    g_once(&image_formats_once, (GThreadFunc)init_image_formats, NULL);
+
+    return g_hash_table_lookup(image_formats_once.retval, format);
+}
+
+gboolean
+virt_viewer_screenshot_format_supported(const gchar *format)
+{
+    return g_str_equal(format, "ppm") || g_str_equal(format, "qoi") ||
+        get_image_format(format) != NULL;
+}
+
+GBytes *
+virt_viewer_screenshot_encode_ppm(GdkPixbuf *pixbuf)
+{
+    int width = gdk_pixbuf_get_width(pixbuf);
+    int height = gdk_pixbuf_get_height(pixbuf);
+    int stride = gdk_pixbuf_get_rowstride(pixbuf);
+    int channels = gdk_pixbuf_get_n_channels(pixbuf);
+    const guint8 *pixels = gdk_pixbuf_read_pixels(pixbuf);
+    GByteArray *data;
+    gchar *header;
+    int x, y;
+
+    header = g_strdup_printf("P6\n%d %d\n255\n", width, height);
+    data = g_byte_array_sized_new(strlen(header) + width * height * 3);
+    g_byte_array_append(data, (const guint8 *)header, strlen(header));
+    g_free(header);
+
+    for (y = 0; y < height; y++) {
+        const guint8 *row = pixels + y * stride;
+
+        if (channels == 3) {
+            g_byte_array_append(data, row, width * 3);
+            continue;
+        }
+        for (x = 0; x < width; x++)
+            g_byte_array_append(data, row + x * channels, 3);
+    }
+
+    return g_byte_array_free_to_bytes(data);
+}
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+
+#define QOI_HASH(px) (((px)[0] * 3 + (px)[1] * 5 + (px)[2] * 7 + (px)[3] * 11) % 64)
+
+static void
+qoi_write_32(guint8 **p, guint32 value)
+{
+    value = GUINT32_TO_BE(value);
+    memcpy(*p, &value, 4);
+    *p += 4;
+}
+
+/* See https://qoiformat.org/qoi-specification.pdf */
+GBytes *
+virt_viewer_screenshot_encode_qoi(GdkPixbuf *pixbuf)
+{
+    static const guint8 padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    int width = gdk_pixbuf_get_width(pixbuf);
+    int height = gdk_pixbuf_get_height(pixbuf);
+    int stride = gdk_pixbuf_get_rowstride(pixbuf);
+    int channels = gdk_pixbuf_get_n_channels(pixbuf);
+    const guint8 *pixels = gdk_pixbuf_read_pixels(pixbuf);
+    guint8 seen[64][4] = { { 0 } };
+    guint8 prev[4] = { 0, 0, 0, 255 };
+    gsize max_size = 14 + (gsize)width * height * (channels + 1) + sizeof(padding);
+    guint8 *data = g_malloc(max_size);
+    guint8 *p = data;
+    int x, y, run = 0;
+
+    memcpy(p, "qoif", 4);
+    p += 4;
+    qoi_write_32(&p, width);
+    qoi_write_32(&p, height);
+    *p++ = channels;
+    *p++ = 0; /* sRGB with linear alpha */
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            const guint8 *src = pixels + y * stride + x * channels;
+            gboolean last = y == height - 1 && x == width - 1;
+            guint8 px[4] = { src[0], src[1], src[2], channels == 4 ? src[3] : 255 };
+            int hash;
+
+            if (memcmp(px, prev, 4) == 0) {
+                run++;
+                if (run == 62 || last) {
+                    *p++ = QOI_OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                *p++ = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            hash = QOI_HASH(px);
+            if (memcmp(seen[hash], px, 4) == 0) {
+                *p++ = QOI_OP_INDEX | hash;
+            } else if (px[3] == prev[3]) {
+                gint8 vr = px[0] - prev[0];
+                gint8 vg = px[1] - prev[1];
+                gint8 vb = px[2] - prev[2];
+                gint8 vg_r = vr - vg;
+                gint8 vg_b = vb - vg;
+
+                memcpy(seen[hash], px, 4);
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                    *p++ = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                    *p++ = QOI_OP_LUMA | (vg + 32);
+                    *p++ = (vg_r + 8) << 4 | (vg_b + 8);
+                } else {
+                    *p++ = QOI_OP_RGB;
+                    memcpy(p, px, 3);
+                    p += 3;
+                }
+            } else {
+                memcpy(seen[hash], px, 4);
+                *p++ = QOI_OP_RGBA;
+                memcpy(p, px, 4);
+                p += 4;
+            }
+            memcpy(prev, px, 4);
+        }
+    }
+
+    memcpy(p, padding, sizeof(padding));
+    p += sizeof(padding);
+
+    return g_bytes_new_take(g_realloc(data, p - data), p - data);
+}
+
+gboolean
+virt_viewer_screenshot_save(GdkPixbuf *pixbuf,
+                            const gchar *filename,
+                            GError **error)
+{
+    const gchar *ext = strrchr(filename, '.');
+    GdkPixbufFormat *format;
+    GBytes *bytes = NULL;
+    gboolean result;
+
+    ext = ext ? ext + 1 : "";
+    if (g_str_equal(ext, "ppm")) {
+        bytes = virt_viewer_screenshot_encode_ppm(pixbuf);
+    } else if (g_str_equal(ext, "qoi")) {
+        bytes = virt_viewer_screenshot_encode_qoi(pixbuf);
+    }
+
+    if (bytes != NULL) {
+        result = g_file_set_contents(filename, g_bytes_get_data(bytes, NULL),
+                                     g_bytes_get_size(bytes), error);
+        g_bytes_unref(bytes);
+        return result;
+    }
+
+    format = get_image_format(ext);
+    if (format == NULL) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                    _("Unable to determine image format for file '%s'"), filename);
+        result = FALSE;
+    } else {
+        char *type = gdk_pixbuf_format_get_name(format);
+        g_debug("saving to %s", type);
+        result = gdk_pixbuf_save(pixbuf, filename, type, error, NULL);
+        g_free(type);
+    }
+
+    return result;
+}
+
+static void
+save_thread(GTask *task,
+            gpointer source_object G_GNUC_UNUSED,
+            gpointer task_data G_GNUC_UNUSED,
+            GCancellable *cancellable G_GNUC_UNUSED)
+{
+    GdkPixbuf *pixbuf = g_object_get_data(G_OBJECT(task), "pixbuf");
+    const gchar *filename = g_object_get_data(G_OBJECT(task), "filename");
+    GError *error = NULL;
+
+    if (virt_viewer_screenshot_save(pixbuf, filename, &error))
+        g_task_return_boolean(task, TRUE);
+    else
+        g_task_return_error(task, error);
+}
+
+/* @pixbuf must not be modified until the save is finished */
+void
+virt_viewer_screenshot_save_async(GdkPixbuf *pixbuf,
+                                  const gchar *filename,
+                                  GCancellable *cancellable,
+                                  GAsyncReadyCallback callback,
+                                  gpointer user_data)
+{
+    GTask *task;
+
+    g_return_if_fail(GDK_IS_PIXBUF(pixbuf));
+    g_return_if_fail(filename != NULL);
+
+    task = g_task_new(NULL, cancellable, callback, user_data);
+    g_object_set_data_full(G_OBJECT(task), "pixbuf", g_object_ref(pixbuf), g_object_unref);
+    g_object_set_data_full(G_OBJECT(task), "filename", g_strdup(filename), g_free);
+    g_task_run_in_thread(task, save_thread);
+    g_object_unref(task);
+}
+
+gboolean
+virt_viewer_screenshot_save_finish(GAsyncResult *result,
+                                   GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), FALSE);
+
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
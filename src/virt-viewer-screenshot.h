@@ -0,0 +1,40 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+gboolean virt_viewer_screenshot_format_supported(const gchar *format);
+
+GBytes *virt_viewer_screenshot_encode_ppm(GdkPixbuf *pixbuf);
+GBytes *virt_viewer_screenshot_encode_qoi(GdkPixbuf *pixbuf);
+
+gboolean virt_viewer_screenshot_save(GdkPixbuf *pixbuf,
+                                     const gchar *filename,
+                                     GError **error);
+void virt_viewer_screenshot_save_async(GdkPixbuf *pixbuf,
+                                       const gchar *filename,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data);
+gboolean virt_viewer_screenshot_save_finish(GAsyncResult *result,
+                                            GError **error);
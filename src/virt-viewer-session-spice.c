@@ -24,8 +24,15 @@
 
 #include <config.h>
 
+#include <time.h>
 #include <glib/gi18n.h>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
 #include <spice-client-gtk.h>
 
 #include <usb-device-widget.h>
@@ -36,6 +43,10 @@
 #include "virt-viewer-display-spice.h"
 #include "virt-viewer-display-vte.h"
 #include "virt-viewer-auth.h"
+#include "virt-viewer-link-quality.h"
+#include "virt-viewer-calibration.h"
+#include "virt-viewer-ring-buffer.h"
+#include "virt-viewer-log-sink.h"
 
 #if SPICE_GTK_CHECK_VERSION(0,36,0)
 #define WITH_QMP_PORT 1
@@ -52,8 +63,32 @@ struct _VirtViewerSessionSpice {
     int channel_count;
     int usbredir_channel_count;
     gboolean has_sw_smartcard_reader;
+    gboolean has_hw_smartcard_reader;
+    guint disabled_channels; /* bitmask of SPICE_CHANNEL_* types */
+    SpiceUsbDeviceManager *usb_manager;
+    gboolean smartcard_manager_ready;
     guint pass_try;
     gboolean did_auto_conf;
+    gboolean opened; /* until "session-disconnected" is emitted */
+    gboolean display_ready; /* a display channel got its first frame */
+    /* channels not connected yet, with --lazy-channels */
+    GPtrArray *deferred_channels;
+    /* with --link-profile */
+    gint link_profile; /* VirtViewerLinkProfile applied, -1 for none */
+    VirtViewerLinkQuality *link_quality; /* when it is picked automatically */
+    guint link_quality_id;
+    guint64 link_read_bytes;
+    gint64 link_sample_time;
+    /* with --calibrate-video-codecs */
+    VirtViewerCalibration *calibration;
+    gint calibration_codec; /* index in video_codecs[] tried, -1 for none */
+    guint calibration_id;
+    guint64 calibration_bytes;
+    clock_t calibration_cpu;
+    guint pause_id;
+    /* GHashTable<channel id, GPtrArray<VirtViewerDisplaySpice>> of the display
+     * channels closed during a warm reconnection */
+    GHashTable *parked_displays;
     VirtViewerFileTransferDialog *file_transfer_dialog;
     GError *disconnect_error;
 #ifdef WITH_QMP_PORT
@@ -92,6 +127,12 @@ static gboolean virt_viewer_session_spice_fullscreen_auto_conf(VirtViewerSession
 static void virt_viewer_session_spice_apply_monitor_geometry(VirtViewerSession *self, GHashTable *monitors);
 static void virt_viewer_session_spice_vm_action(VirtViewerSession *self, gint action);
 static gboolean virt_viewer_session_spice_has_vm_action(VirtViewerSession *self, gint action);
+static void virt_viewer_session_spice_add_benchmark_stats(VirtViewerSession *self,
+                                                          VirtViewerBenchmark *benchmark);
+static gboolean virt_viewer_session_spice_channel_disabled(VirtViewerSessionSpice *self, int type);
+static void virt_viewer_session_spice_stop_link_quality(VirtViewerSessionSpice *self);
+static void virt_viewer_session_spice_stop_calibration(VirtViewerSessionSpice *self);
+static void virt_viewer_session_spice_display_hidden(VirtViewerSessionSpice *self);
 
 static void virt_viewer_session_spice_clear_displays(VirtViewerSessionSpice *self)
 {
@@ -106,9 +147,208 @@ static void virt_viewer_session_spice_clear_displays(VirtViewerSessionSpice *sel
         g_object_set_data(G_OBJECT(channel), "virt-viewer-displays", NULL);
     }
     g_list_free(channels);
+    g_hash_table_remove_all(self->parked_displays);
     virt_viewer_session_clear_displays(VIRT_VIEWER_SESSION(self));
 }
 
+static gboolean
+virt_viewer_session_spice_warm_reconnect(VirtViewerSessionSpice *self)
+{
+    return virt_viewer_app_get_warm_reconnect(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)));
+}
+
+/* Keeps the displays of @channel for the display channel with the same id
+ * in the next connection. Their SpiceDisplay widgets attach to it on
+ * their own. */
+static void
+virt_viewer_session_spice_park_channel_displays(VirtViewerSessionSpice *self,
+                                                SpiceChannel *channel)
+{
+    GPtrArray *displays;
+    int id;
+
+    displays = g_object_steal_data(G_OBJECT(channel), "virt-viewer-displays");
+    if (displays == NULL)
+        return;
+
+    g_object_get(channel, "channel-id", &id, NULL);
+    g_debug("Keeping the displays of channel %d", id);
+    g_hash_table_replace(self->parked_displays, GINT_TO_POINTER(id), displays);
+}
+
+/* The server lists its channels at once, so by the time a display channel
+ * of the new connection shows its monitors, a channel whose displays are
+ * still parked is not coming back: they are removed. */
+static void
+virt_viewer_session_spice_drop_parked_displays(VirtViewerSessionSpice *self)
+{
+    GHashTableIter iter;
+    gpointer key;
+    GList *channels;
+
+    if (g_hash_table_size(self->parked_displays) == 0)
+        return;
+
+    channels = spice_session_get_channels(self->session);
+    g_hash_table_iter_init(&iter, self->parked_displays);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        gboolean found = FALSE;
+        GList *l;
+
+        for (l = channels; l != NULL && !found; l = l->next) {
+            int id;
+
+            if (!SPICE_IS_DISPLAY_CHANNEL(l->data))
+                continue;
+            g_object_get(l->data, "channel-id", &id, NULL);
+            found = id == GPOINTER_TO_INT(key);
+        }
+
+        if (!found) {
+            g_debug("Dropping the displays of channel %d", GPOINTER_TO_INT(key));
+            g_hash_table_iter_remove(&iter);
+        }
+    }
+    g_list_free(channels);
+}
+
+/* Called when the connection goes away */
+static void
+virt_viewer_session_spice_release_displays(VirtViewerSessionSpice *self)
+{
+    GList *l;
+    GList *channels;
+
+    if (!virt_viewer_session_spice_warm_reconnect(self)) {
+        virt_viewer_session_spice_clear_displays(self);
+        return;
+    }
+
+    channels = spice_session_get_channels(self->session);
+    for (l = channels; l != NULL; l = l->next) {
+        if (SPICE_IS_DISPLAY_CHANNEL(l->data))
+            virt_viewer_session_spice_park_channel_displays(self, SPICE_CHANNEL(l->data));
+    }
+    g_list_free(channels);
+}
+
+/* The deferred channels which are not waiting for the user once the guest
+ * display is up */
+static gboolean
+virt_viewer_session_spice_connect_when_ready(VirtViewerSessionSpice *self, int type)
+{
+    switch (type) {
+    case SPICE_CHANNEL_RECORD:
+    case SPICE_CHANNEL_PORT: /* the consoles only get their name once connected */
+        return TRUE;
+    case SPICE_CHANNEL_USBREDIR: /* the devices plugged later are redirected at once */
+        return virt_viewer_session_get_auto_usbredir(VIRT_VIEWER_SESSION(self));
+    case SPICE_CHANNEL_SMARTCARD:
+        return self->has_hw_smartcard_reader;
+    default:
+        return FALSE;
+    }
+}
+
+static gboolean
+virt_viewer_session_spice_defer_channel(VirtViewerSessionSpice *self,
+                                        SpiceChannel *channel,
+                                        int type)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+
+    if (!virt_viewer_app_get_lazy_channels(app) ||
+        g_object_get_data(G_OBJECT(channel), "virt-viewer-undeferred") != NULL)
+        return FALSE;
+
+    /* webdav is already only connected when a folder is shared */
+    if (type != SPICE_CHANNEL_RECORD && type != SPICE_CHANNEL_PORT &&
+        type != SPICE_CHANNEL_USBREDIR && type != SPICE_CHANNEL_SMARTCARD)
+        return FALSE;
+
+    return !self->display_ready || !virt_viewer_session_spice_connect_when_ready(self, type);
+}
+
+static gboolean
+virt_viewer_session_spice_has_deferred(VirtViewerSessionSpice *self, int type)
+{
+    guint i;
+
+    for (i = 0; i < self->deferred_channels->len; i++) {
+        int channel_type;
+
+        g_object_get(g_ptr_array_index(self->deferred_channels, i),
+                     "channel-type", &channel_type, NULL);
+        if (channel_type == type)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Emits channel-new again for the deferred channels of @type, so that
+ * virt-viewer, the spice-gtk managers and widgets connect them. Since our
+ * handler runs first and stopped the first emission, this one is the only
+ * emission the other handlers see. The managers scanning the session
+ * channels when created must thus exist before a channel is deferred. */
+static void
+virt_viewer_session_spice_connect_deferred(VirtViewerSessionSpice *self, int type)
+{
+    GPtrArray *channels = g_ptr_array_new_with_free_func(g_object_unref);
+    guint i = 0;
+
+    while (i < self->deferred_channels->len) {
+        SpiceChannel *channel = g_ptr_array_index(self->deferred_channels, i);
+        int channel_type;
+
+        g_object_get(channel, "channel-type", &channel_type, NULL);
+        if (channel_type != type) {
+            i++;
+            continue;
+        }
+
+        g_ptr_array_add(channels, g_object_ref(channel));
+        g_ptr_array_remove_index(self->deferred_channels, i);
+    }
+
+    for (i = 0; i < channels->len; i++) {
+        SpiceChannel *channel = g_ptr_array_index(channels, i);
+
+        g_debug("Connecting deferred spice channel %s", spice_channel_type_to_string(type));
+        g_object_set_data(G_OBJECT(channel), "virt-viewer-undeferred", GINT_TO_POINTER(TRUE));
+        g_signal_emit_by_name(self->session, "channel-new", channel);
+    }
+    g_ptr_array_unref(channels);
+}
+
+static void
+virt_viewer_session_spice_display_mark(SpiceChannel *channel G_GNUC_UNUSED,
+                                       gint mark,
+                                       VirtViewerSessionSpice *self)
+{
+    static const int types[] = {
+        SPICE_CHANNEL_RECORD, SPICE_CHANNEL_PORT,
+        SPICE_CHANNEL_USBREDIR, SPICE_CHANNEL_SMARTCARD,
+    };
+    guint i;
+
+    if (!mark || self->display_ready)
+        return;
+
+    self->display_ready = TRUE;
+    for (i = 0; i < G_N_ELEMENTS(types); i++) {
+        if (virt_viewer_session_spice_connect_when_ready(self, types[i]))
+            virt_viewer_session_spice_connect_deferred(self, types[i]);
+    }
+}
+
+static void
+auto_usbredir_changed(VirtViewerSessionSpice *self)
+{
+    if (self->display_ready && virt_viewer_session_get_auto_usbredir(VIRT_VIEWER_SESSION(self)))
+        virt_viewer_session_spice_connect_deferred(self, SPICE_CHANNEL_USBREDIR);
+}
+
 
 static void
 virt_viewer_session_spice_get_property(GObject *object, guint property_id,
@@ -159,6 +399,14 @@ virt_viewer_session_spice_dispose(GObject *obj)
     }
 
     self->audio = NULL;
+    g_clear_pointer(&self->parked_displays, g_hash_table_unref);
+    g_clear_pointer(&self->deferred_channels, g_ptr_array_unref);
+    virt_viewer_session_spice_stop_link_quality(self);
+    virt_viewer_session_spice_stop_calibration(self);
+    if (self->pause_id > 0) {
+        g_source_remove(self->pause_id);
+        self->pause_id = 0;
+    }
 
     gtk_widget_destroy(GTK_WIDGET(self->auth));
     g_clear_object(&self->main_window);
@@ -183,7 +431,8 @@ virt_viewer_session_spice_can_share_folder(VirtViewerSession *session)
 {
     VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
 
-    return spice_session_has_channel_type(self->session, SPICE_CHANNEL_WEBDAV);
+    return !virt_viewer_session_spice_channel_disabled(self, SPICE_CHANNEL_WEBDAV) &&
+        spice_session_has_channel_type(self->session, SPICE_CHANNEL_WEBDAV);
 }
 
 static gboolean
@@ -192,6 +441,12 @@ virt_viewer_session_spice_can_retry_auth(VirtViewerSession *session G_GNUC_UNUSE
     return TRUE;
 }
 
+static gboolean
+virt_viewer_session_spice_can_reconnect(VirtViewerSession *session G_GNUC_UNUSED)
+{
+    return TRUE;
+}
+
 static void
 create_spice_session(VirtViewerSessionSpice *self);
 
@@ -203,6 +458,103 @@ property_notify_do_auto_conf(GObject *gobject G_GNUC_UNUSED,
     virt_viewer_session_spice_fullscreen_auto_conf(self);
 }
 
+/* seconds a display must stay hidden before its channel is paused, so that
+ * switching between windows does not pause it */
+#define PAUSE_DELAY 2
+
+/* Whether all the enabled displays of the display @channel are hidden */
+static gboolean
+virt_viewer_session_spice_channel_hidden(SpiceChannel *channel)
+{
+    GPtrArray *displays = g_object_get_data(G_OBJECT(channel), "virt-viewer-displays");
+    gboolean hidden = FALSE;
+    guint i;
+
+    for (i = 0; displays != NULL && i < displays->len; i++) {
+        VirtViewerDisplay *display = g_ptr_array_index(displays, i);
+
+        if (display == NULL || !virt_viewer_display_get_enabled(display))
+            continue;
+        if (!virt_viewer_display_get_hidden(display))
+            return FALSE;
+        hidden = TRUE;
+    }
+
+    return hidden;
+}
+
+/* The guest monitors are left alone: the display channel is disconnected,
+ * which stops the server from sending its updates, and connected again
+ * when a display is shown. */
+static gboolean
+virt_viewer_session_spice_pause_displays(gpointer user_data)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(user_data);
+    GList *l, *channels;
+
+    self->pause_id = 0;
+
+    channels = spice_session_get_channels(self->session);
+    for (l = channels; l != NULL; l = l->next) {
+        SpiceChannel *channel = l->data;
+        int id;
+
+        if (!SPICE_IS_DISPLAY_CHANNEL(channel) ||
+            g_object_get_data(G_OBJECT(channel), "virt-viewer-paused") != NULL ||
+            !virt_viewer_session_spice_channel_hidden(channel))
+            continue;
+
+        g_object_get(channel, "channel-id", &id, NULL);
+        virt_viewer_app_trace(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)),
+                              "Pausing the hidden display channel %d", id);
+        g_object_set_data(G_OBJECT(channel), "virt-viewer-paused", GINT_TO_POINTER(TRUE));
+        spice_channel_disconnect(channel, SPICE_CHANNEL_NONE);
+    }
+    g_list_free(channels);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+virt_viewer_session_spice_display_hidden(VirtViewerSessionSpice *self)
+{
+    gboolean hidden = FALSE;
+    GList *l, *channels;
+
+    if (self->session == NULL)
+        return;
+
+    channels = spice_session_get_channels(self->session);
+    for (l = channels; l != NULL; l = l->next) {
+        SpiceChannel *channel = l->data;
+        gboolean paused;
+        int id;
+
+        if (!SPICE_IS_DISPLAY_CHANNEL(channel))
+            continue;
+
+        paused = g_object_get_data(G_OBJECT(channel), "virt-viewer-paused") != NULL;
+        if (virt_viewer_session_spice_channel_hidden(channel)) {
+            hidden |= !paused;
+            continue;
+        }
+        if (!paused)
+            continue;
+
+        g_object_get(channel, "channel-id", &id, NULL);
+        virt_viewer_app_trace(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)),
+                              "Resuming the display channel %d", id);
+        g_object_set_data(G_OBJECT(channel), "virt-viewer-paused", NULL);
+        spice_channel_connect(channel);
+    }
+    g_list_free(channels);
+
+    if (hidden && self->pause_id == 0)
+        self->pause_id = g_timeout_add_seconds(PAUSE_DELAY,
+                                               virt_viewer_session_spice_pause_displays,
+                                               self);
+}
+
 static void
 update_share_folder(VirtViewerSessionSpice *self)
 {
@@ -211,6 +563,8 @@ update_share_folder(VirtViewerSessionSpice *self)
     GList *l, *channels;
 
     g_object_get(self, "share-folder", &share, NULL);
+    if (virt_viewer_session_spice_channel_disabled(self, SPICE_CHANNEL_WEBDAV))
+        return;
 
     channels = spice_session_get_channels(session);
     for (l = channels; l != NULL; l = l->next) {
@@ -243,6 +597,9 @@ virt_viewer_session_spice_constructed(GObject *obj)
     virt_viewer_signal_connect_object(self, "notify::share-folder",
                                       G_CALLBACK(update_share_folder), self,
                                       G_CONNECT_SWAPPED);
+    virt_viewer_signal_connect_object(self, "notify::auto-usbredir",
+                                      G_CALLBACK(auto_usbredir_changed), self,
+                                      G_CONNECT_SWAPPED);
 
     self->file_transfer_dialog =
         virt_viewer_file_transfer_dialog_new(self->main_window);
@@ -274,8 +631,10 @@ virt_viewer_session_spice_class_init(VirtViewerSessionSpiceClass *klass)
     dclass->apply_monitor_geometry = virt_viewer_session_spice_apply_monitor_geometry;
     dclass->can_share_folder = virt_viewer_session_spice_can_share_folder;
     dclass->can_retry_auth = virt_viewer_session_spice_can_retry_auth;
+    dclass->can_reconnect = virt_viewer_session_spice_can_reconnect;
     dclass->vm_action = virt_viewer_session_spice_vm_action;
     dclass->has_vm_action = virt_viewer_session_spice_has_vm_action;
+    dclass->add_benchmark_stats = virt_viewer_session_spice_add_benchmark_stats;
 
     g_object_class_install_property(oclass,
                                     PROP_SPICE_SESSION,
@@ -299,8 +658,13 @@ virt_viewer_session_spice_class_init(VirtViewerSessionSpiceClass *klass)
 }
 
 static void
-virt_viewer_session_spice_init(VirtViewerSessionSpice *self G_GNUC_UNUSED)
+virt_viewer_session_spice_init(VirtViewerSessionSpice *self)
 {
+    self->parked_displays = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                                  (GDestroyNotify)g_ptr_array_unref);
+    self->deferred_channels = g_ptr_array_new_with_free_func(g_object_unref);
+    self->link_profile = -1;
+    self->calibration_codec = -1;
 }
 
 static void
@@ -334,6 +698,9 @@ static void reader_added_cb(SpiceSmartcardManager *manager G_GNUC_UNUSED,
     session = VIRT_VIEWER_SESSION_SPICE(user_data);
     if (spice_smartcard_reader_is_software(reader)) {
         virt_viewer_session_spice_set_has_sw_reader(session, TRUE);
+    } else {
+        session->has_hw_smartcard_reader = TRUE;
+        virt_viewer_session_spice_connect_deferred(session, SPICE_CHANNEL_SMARTCARD);
     }
 }
 
@@ -370,137 +737,743 @@ uuid_changed(GObject *gobject G_GNUC_UNUSED,
             }
         }
 
-        if (!uuid_empty) {
-            gchar *uuid_str = spice_uuid_to_string(uuid);
-            g_object_set(app, "uuid", uuid_str, NULL);
-            g_free(uuid_str);
-        }
+        if (!uuid_empty) {
+            gchar *uuid_str = spice_uuid_to_string(uuid);
+            g_object_set(app, "uuid", uuid_str, NULL);
+            g_free(uuid_str);
+        }
+    }
+
+    virt_viewer_session_spice_fullscreen_auto_conf(self);
+}
+
+static void
+name_changed(GObject *gobject G_GNUC_UNUSED,
+              GParamSpec *pspec G_GNUC_UNUSED,
+              VirtViewerSessionSpice *self)
+{
+    gchar *name = NULL;
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+
+    g_object_get(self->session, "name", &name, NULL);
+
+    g_object_set(app, "guest-name", name, NULL);
+    g_free(name);
+}
+
+static void
+create_spice_session(VirtViewerSessionSpice *self)
+{
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(self->session == NULL);
+
+    g_hash_table_remove_all(self->parked_displays);
+    self->session = spice_session_new();
+    spice_set_session_option(self->session);
+
+    /* connected before the spice-gtk session and managers, so that they
+     * never see the channels whose emission is stopped below */
+    virt_viewer_signal_connect_object(self->session, "channel-new",
+                                      G_CALLBACK(virt_viewer_session_spice_channel_new), self, 0);
+
+    self->gtk_session = spice_gtk_session_get(self->session);
+
+    g_object_set(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)),
+                 "supports-share-clipboard", TRUE,
+                 NULL);
+
+    g_object_bind_property(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)), "config-share-clipboard",
+                           self->gtk_session, "auto-clipboard",
+                           G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+
+    virt_viewer_signal_connect_object(self->session, "channel-destroy",
+                                      G_CALLBACK(virt_viewer_session_spice_channel_destroyed), self, 0);
+    virt_viewer_signal_connect_object(self->session, "disconnected",
+                                      G_CALLBACK(virt_viewer_session_spice_session_disconnected), self, 0);
+
+    g_object_bind_property(self, "auto-usbredir",
+                           self->gtk_session, "auto-usbredir",
+                           G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+
+    /* notify::uuid is guaranteed to be emitted during connection startup even
+     * if the server is too old to support sending uuid */
+    virt_viewer_signal_connect_object(self->session, "notify::uuid",
+                                      G_CALLBACK(uuid_changed), self, 0);
+    virt_viewer_signal_connect_object(self->session, "notify::name",
+                                      G_CALLBACK(name_changed), self, 0);
+
+    g_object_bind_property(self->session, "shared-dir",
+                           self, "shared-folder",
+                           G_BINDING_BIDIRECTIONAL|G_BINDING_SYNC_CREATE);
+    g_object_bind_property(self->session, "share-dir-ro",
+                           self, "share-folder-ro",
+                           G_BINDING_BIDIRECTIONAL|G_BINDING_SYNC_CREATE);
+
+}
+
+static void
+virt_viewer_session_spice_close(VirtViewerSession *session)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
+    gboolean warm_reconnect;
+
+    g_return_if_fail(self != NULL);
+
+    g_object_add_weak_pointer(G_OBJECT(self), (gpointer*)&self);
+
+    warm_reconnect = virt_viewer_session_spice_warm_reconnect(self);
+    virt_viewer_session_spice_stop_link_quality(self);
+    virt_viewer_session_spice_stop_calibration(self);
+    if (self->pause_id > 0) {
+        g_source_remove(self->pause_id);
+        self->pause_id = 0;
+    }
+
+#ifdef WITH_QMP_PORT
+    g_clear_object(&self->qmp);
+#endif
+    virt_viewer_session_spice_release_displays(self);
+
+    if (self->session) {
+        gtk_dialog_response(GTK_DIALOG(self->auth),
+                            GTK_RESPONSE_CANCEL);
+        spice_session_disconnect(self->session);
+        if (!self)
+            return;
+
+        g_ptr_array_set_size(self->deferred_channels, 0);
+
+        /* The session is kept with its settings, the gtk session bindings,
+         * the USB and smartcard managers and the displays widgets. Only the
+         * channels are created again by the next connection. */
+        if (warm_reconnect) {
+            self->audio = NULL;
+            g_object_remove_weak_pointer(G_OBJECT(self), (gpointer*)&self);
+            return;
+        }
+
+        g_object_unref(self->session);
+        self->session = NULL;
+        self->gtk_session = NULL;
+        self->usb_manager = NULL;
+        self->audio = NULL;
+    }
+
+    g_object_remove_weak_pointer(G_OBJECT(self), (gpointer*)&self);
+
+    /* without warm reconnection, the next connection starts afresh */
+    create_spice_session(self);
+}
+
+/* The display settings of each link profile. The color depth and the
+ * effects are sent by spice-gtk when the guest agent connects, they only
+ * apply to the profile set before that. */
+typedef struct {
+    gint compression;
+    gint video_codecs[3];
+    gint color_depth;
+    const gchar *disable_effects;
+} VirtViewerLinkSettings;
+
+static const VirtViewerLinkSettings link_settings[] = {
+    [VIRT_VIEWER_LINK_PROFILE_LAN] = {
+        SPICE_IMAGE_COMPRESSION_AUTO_LZ,
+        { SPICE_VIDEO_CODEC_TYPE_MJPEG, SPICE_VIDEO_CODEC_TYPE_VP8, SPICE_VIDEO_CODEC_TYPE_H264 },
+        0, NULL,
+    },
+    [VIRT_VIEWER_LINK_PROFILE_WAN] = {
+        SPICE_IMAGE_COMPRESSION_AUTO_GLZ,
+        { SPICE_VIDEO_CODEC_TYPE_VP8, SPICE_VIDEO_CODEC_TYPE_H264, SPICE_VIDEO_CODEC_TYPE_MJPEG },
+        0, "animation",
+    },
+    [VIRT_VIEWER_LINK_PROFILE_CELLULAR] = {
+        SPICE_IMAGE_COMPRESSION_AUTO_GLZ,
+        { SPICE_VIDEO_CODEC_TYPE_H264, SPICE_VIDEO_CODEC_TYPE_VP8, SPICE_VIDEO_CODEC_TYPE_MJPEG },
+        16, "wallpaper,font-smooth,animation",
+    },
+};
+
+/* sample period of the link quality, in seconds */
+#define LINK_QUALITY_INTERVAL 2
+/* a channel set up takes the tcp handshake, the link and the ticket */
+#define LINK_ROUND_TRIPS 3
+
+static const struct {
+    const gchar *name;
+    gint type;
+} video_codecs[] = {
+    { "mjpeg", SPICE_VIDEO_CODEC_TYPE_MJPEG },
+    { "vp8", SPICE_VIDEO_CODEC_TYPE_VP8 },
+    { "h264", SPICE_VIDEO_CODEC_TYPE_H264 },
+    { "vp9", SPICE_VIDEO_CODEC_TYPE_VP9 },
+};
+
+static const struct {
+    const gchar *name;
+    gint type;
+} image_compressions[] = {
+    { "off", SPICE_IMAGE_COMPRESSION_OFF },
+    { "auto-glz", SPICE_IMAGE_COMPRESSION_AUTO_GLZ },
+    { "auto-lz", SPICE_IMAGE_COMPRESSION_AUTO_LZ },
+    { "quic", SPICE_IMAGE_COMPRESSION_QUIC },
+    { "glz", SPICE_IMAGE_COMPRESSION_GLZ },
+    { "lz", SPICE_IMAGE_COMPRESSION_LZ },
+    { "lz4", SPICE_IMAGE_COMPRESSION_LZ4 },
+};
+
+static gint
+video_codec_from_name(const gchar *name)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(video_codecs); i++) {
+        if (g_ascii_strcasecmp(name, video_codecs[i].name) == 0)
+            return video_codecs[i].type;
+    }
+
+    g_warning("Unknown video codec '%s'", name);
+    return -1;
+}
+
+/* The host the calibrated video codec is saved for */
+static gchar *
+virt_viewer_session_spice_get_calibration_host(VirtViewerSessionSpice *self)
+{
+    gchar *host = NULL;
+
+    g_object_get(self->session, "host", &host, NULL);
+    if (host == NULL)
+        g_object_get(self->session, "unix-path", &host, NULL);
+
+    return host;
+}
+
+/* The video codecs from the command line, the connection file, or the one
+ * found by a previous calibration followed by the others. Returns the
+ * number of codecs stored in @codecs. */
+static guint
+virt_viewer_session_spice_get_preferred_video_codecs(VirtViewerSessionSpice *self,
+                                                     gint codecs[G_N_ELEMENTS(video_codecs)])
+{
+    VirtViewerSession *session = VIRT_VIEWER_SESSION(self);
+    VirtViewerApp *app = virt_viewer_session_get_app(session);
+    VirtViewerFile *file = virt_viewer_session_get_file(session);
+    const gchar *option = virt_viewer_app_get_preferred_video_codecs(app);
+    gchar **names = NULL;
+    guint i, j, n = 0;
+
+    if (option != NULL) {
+        names = g_strsplit(option, ",", -1);
+    } else if (file != NULL && virt_viewer_file_is_set(file, "preferred-video-codecs")) {
+        names = virt_viewer_file_get_preferred_video_codecs(file, NULL);
+    } else {
+        gchar *host = virt_viewer_session_spice_get_calibration_host(self);
+        gchar *winner = NULL;
+
+        if (host != NULL)
+            winner = virt_viewer_app_get_config_video_codec(app, host);
+        if (winner != NULL) {
+            names = g_new0(gchar *, G_N_ELEMENTS(video_codecs) + 2);
+            names[0] = winner;
+            for (i = 0; i < G_N_ELEMENTS(video_codecs); i++)
+                names[i + 1] = g_strdup(video_codecs[i].name);
+        }
+        g_free(host);
+    }
+
+    for (i = 0; names != NULL && names[i] != NULL; i++) {
+        gint type = video_codec_from_name(g_strstrip(names[i]));
+        gboolean dup = FALSE;
+
+        for (j = 0; j < n; j++)
+            dup |= codecs[j] == type;
+        if (type >= 0 && !dup && n < G_N_ELEMENTS(video_codecs))
+            codecs[n++] = type;
+    }
+    g_strfreev(names);
+
+    return n;
+}
+
+static gint
+virt_viewer_session_spice_get_preferred_compression(VirtViewerSessionSpice *self)
+{
+    VirtViewerSession *session = VIRT_VIEWER_SESSION(self);
+    VirtViewerFile *file = virt_viewer_session_get_file(session);
+    gchar *name = g_strdup(virt_viewer_app_get_preferred_compression(virt_viewer_session_get_app(session)));
+    gint type = SPICE_IMAGE_COMPRESSION_INVALID;
+    guint i;
+
+    if (name == NULL && file != NULL && virt_viewer_file_is_set(file, "preferred-compression"))
+        name = virt_viewer_file_get_preferred_compression(file);
+    if (name == NULL)
+        return type;
+
+    for (i = 0; i < G_N_ELEMENTS(image_compressions); i++) {
+        if (g_ascii_strcasecmp(name, image_compressions[i].name) == 0)
+            type = image_compressions[i].type;
+    }
+    if (type == SPICE_IMAGE_COMPRESSION_INVALID)
+        g_warning("Unknown image compression '%s'", name);
+    g_free(name);
+
+    return type;
+}
+
+/* Needs the channel to be opened to know what the server supports. The
+ * codec being calibrated, then the explicit preferences, win over the link
+ * profile. Returns FALSE if the video codecs could not be changed. */
+static gboolean
+virt_viewer_session_spice_apply_display_settings(VirtViewerSessionSpice *self,
+                                                 SpiceChannel *channel)
+{
+    gint codecs[G_N_ELEMENTS(video_codecs)];
+    gint compression = SPICE_IMAGE_COMPRESSION_INVALID;
+    gint preferred_compression;
+    guint i, ncodecs = 0;
+#if SPICE_GTK_CHECK_VERSION(0,38,0)
+    GError *error = NULL;
+#endif
+
+    if (self->link_profile >= 0) {
+        const VirtViewerLinkSettings *settings = &link_settings[self->link_profile];
+
+        compression = settings->compression;
+        for (i = 0; i < G_N_ELEMENTS(settings->video_codecs); i++)
+            codecs[ncodecs++] = settings->video_codecs[i];
+    }
+
+    if (self->calibration_codec >= 0) {
+        codecs[0] = video_codecs[self->calibration_codec].type;
+        ncodecs = 1;
+    } else {
+        gint preferred[G_N_ELEMENTS(video_codecs)];
+        guint npreferred = virt_viewer_session_spice_get_preferred_video_codecs(self, preferred);
+
+        if (npreferred > 0) {
+            for (i = 0; i < npreferred; i++)
+                codecs[i] = preferred[i];
+            ncodecs = npreferred;
+        }
+    }
+
+    preferred_compression = virt_viewer_session_spice_get_preferred_compression(self);
+    if (preferred_compression != SPICE_IMAGE_COMPRESSION_INVALID)
+        compression = preferred_compression;
+
+    if (compression != SPICE_IMAGE_COMPRESSION_INVALID)
+        spice_display_channel_change_preferred_compression(channel, compression);
+    if (ncodecs == 0)
+        return TRUE;
+
+#if SPICE_GTK_CHECK_VERSION(0,38,0)
+    if (!spice_display_channel_change_preferred_video_codec_types(channel, codecs, ncodecs,
+                                                                  &error)) {
+        g_debug("Failed to set the preferred video codecs: %s", error->message);
+        g_clear_error(&error);
+        return FALSE;
+    }
+#else
+    /* only the most preferred codec can be sent */
+    spice_display_channel_change_preferred_video_codec_type(channel, codecs[0]);
+#endif
+
+    return TRUE;
+}
+
+static gboolean
+virt_viewer_session_spice_update_display_settings(VirtViewerSessionSpice *self)
+{
+    gboolean ret = TRUE;
+    GList *l, *channels;
+
+    channels = spice_session_get_channels(self->session);
+    for (l = channels; l != NULL; l = l->next) {
+        if (SPICE_IS_DISPLAY_CHANNEL(l->data))
+            ret &= virt_viewer_session_spice_apply_display_settings(self, SPICE_CHANNEL(l->data));
+    }
+    g_list_free(channels);
+
+    return ret;
+}
+
+static guint64
+virt_viewer_session_spice_get_read_bytes(VirtViewerSessionSpice *self,
+                                         gboolean with_main)
+{
+    guint64 read_bytes = 0;
+    GList *l, *channels;
+
+    channels = spice_session_get_channels(self->session);
+    for (l = channels; l != NULL; l = l->next) {
+        gulong bytes = 0;
+
+        if (!SPICE_IS_DISPLAY_CHANNEL(l->data) &&
+            !(with_main && SPICE_IS_MAIN_CHANNEL(l->data)))
+            continue;
+
+        g_object_get(l->data, "total-read-bytes", &bytes, NULL);
+        read_bytes += bytes;
+    }
+    g_list_free(channels);
+
+    return read_bytes;
+}
+
+static void
+virt_viewer_session_spice_set_link_profile(VirtViewerSessionSpice *self,
+                                           VirtViewerLinkProfile profile)
+{
+    VirtViewerFile *file = virt_viewer_session_get_file(VIRT_VIEWER_SESSION(self));
+    const VirtViewerLinkSettings *settings = &link_settings[profile];
+    gboolean agent_connected = FALSE;
+
+    self->link_profile = profile;
+
+    /* spice-gtk only sends them when the agent connects, a profile
+     * switched to afterwards leaves them alone */
+    if (self->main_channel != NULL)
+        g_object_get(self->main_channel, "agent-connected", &agent_connected, NULL);
+
+    /* the connection file settings win */
+    if (!agent_connected &&
+        (file == NULL || !virt_viewer_file_is_set(file, "color-depth")))
+        g_object_set(self->session, "color-depth", settings->color_depth, NULL);
+    if (!agent_connected &&
+        (file == NULL || !virt_viewer_file_is_set(file, "disable-effects"))) {
+        gchar **effects = NULL;
+
+        if (settings->disable_effects != NULL)
+            effects = g_strsplit(settings->disable_effects, ",", -1);
+        g_object_set(self->session, "disable-effects", effects, NULL);
+        g_strfreev(effects);
+    }
+
+    virt_viewer_session_spice_update_display_settings(self);
+    /* the resolution asked with auto-resize drops with the link */
+    virt_viewer_session_set_link_max_area(VIRT_VIEWER_SESSION(self),
+                                          virt_viewer_link_profile_get_max_area(profile));
+}
+
+/* The round trip time the kernel measured on the main channel, in
+ * microseconds, -1 if unknown */
+static gint64
+virt_viewer_session_spice_get_rtt(VirtViewerSessionSpice *self G_GNUC_UNUSED)
+{
+    gint64 rtt = -1;
+#if defined(__linux__) && defined(TCP_INFO)
+    GSocket *sock = NULL;
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+
+    if (self->main_channel == NULL ||
+        !g_object_class_find_property(G_OBJECT_GET_CLASS(self->main_channel), "socket"))
+        return -1;
+
+    g_object_get(self->main_channel, "socket", &sock, NULL);
+    if (sock == NULL)
+        return -1;
+
+    if (g_socket_get_family(sock) != G_SOCKET_FAMILY_UNIX &&
+        getsockopt(g_socket_get_fd(sock), IPPROTO_TCP, TCP_INFO, &info, &len) == 0 &&
+        info.tcpi_rtt > 0)
+        rtt = info.tcpi_rtt;
+    g_object_unref(sock);
+#endif
+
+    return rtt;
+}
+
+static gboolean
+virt_viewer_session_spice_sample_link(gpointer user_data)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(user_data);
+    VirtViewerLinkProfile profile;
+    gint64 now = g_get_monotonic_time();
+    guint64 read_bytes = virt_viewer_session_spice_get_read_bytes(self, TRUE);
+
+    /* before the transfer, so that a saturated link is seen */
+    virt_viewer_link_quality_add_latency(self->link_quality,
+                                         virt_viewer_session_spice_get_rtt(self));
+
+    /* skip the sample when a channel went away */
+    if (self->link_sample_time != 0 && read_bytes >= self->link_read_bytes)
+        virt_viewer_link_quality_add_transfer(self->link_quality,
+                                              read_bytes - self->link_read_bytes,
+                                              now - self->link_sample_time);
+    self->link_read_bytes = read_bytes;
+    self->link_sample_time = now;
+
+    if (!virt_viewer_link_quality_update(self->link_quality))
+        return G_SOURCE_CONTINUE;
+
+    profile = virt_viewer_link_quality_get_profile(self->link_quality);
+    virt_viewer_app_trace(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)),
+                          "Switching to the %s link profile (latency %.1f ms, throughput %.2f Mbit/s)",
+                          virt_viewer_link_profile_to_string(profile),
+                          virt_viewer_link_quality_get_latency(self->link_quality) / 1000.0,
+                          virt_viewer_link_quality_get_throughput(self->link_quality) * 8 / 1000000);
+    virt_viewer_session_spice_set_link_profile(self, profile);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+virt_viewer_session_spice_stop_link_quality(VirtViewerSessionSpice *self)
+{
+    if (self->link_quality_id > 0) {
+        g_source_remove(self->link_quality_id);
+        self->link_quality_id = 0;
+    }
+    g_clear_pointer(&self->link_quality, virt_viewer_link_quality_free);
+}
+
+/* Called for each connection */
+static void
+virt_viewer_session_spice_start_link_quality(VirtViewerSessionSpice *self)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    const gchar *name = virt_viewer_app_get_link_profile(app);
+    VirtViewerLinkProfile profile;
+
+    virt_viewer_session_spice_stop_link_quality(self);
+    virt_viewer_session_set_link_max_area(VIRT_VIEWER_SESSION(self), 0);
+    if (name == NULL)
+        return;
+
+    if (virt_viewer_link_profile_from_string(name, &profile)) {
+        virt_viewer_session_spice_set_link_profile(self, profile);
+        return;
+    }
+
+    /* the server defaults are left alone until the link is measured */
+    self->link_profile = -1;
+    self->link_quality = virt_viewer_link_quality_new(VIRT_VIEWER_LINK_PROFILE_LAN);
+    self->link_read_bytes = 0;
+    self->link_sample_time = 0;
+    self->link_quality_id = g_timeout_add_seconds(LINK_QUALITY_INTERVAL,
+                                                  virt_viewer_session_spice_sample_link,
+                                                  self);
+}
+
+/* time each video codec is tried for, in seconds */
+#define CALIBRATION_PERIOD 5
+
+static void
+virt_viewer_session_spice_stop_calibration(VirtViewerSessionSpice *self)
+{
+    if (self->calibration_id > 0) {
+        g_source_remove(self->calibration_id);
+        self->calibration_id = 0;
+    }
+    g_clear_pointer(&self->calibration, virt_viewer_calibration_free);
+    self->calibration_codec = -1;
+}
+
+/* Records what the codec tried during the last period cost and moves to the
+ * next one. spice-gtk does not report the decoding time, the CPU time of the
+ * process is used instead. */
+static gboolean
+virt_viewer_session_spice_calibrate(gpointer user_data)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(user_data);
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    guint64 bytes = virt_viewer_session_spice_get_read_bytes(self, FALSE);
+    clock_t cpu = clock();
+    const gchar *winner;
+    gchar *host;
+
+    if (self->calibration_codec >= 0 && bytes >= self->calibration_bytes) {
+        gint64 cpu_time = (gint64)(cpu - self->calibration_cpu) * G_USEC_PER_SEC / CLOCKS_PER_SEC;
+
+        virt_viewer_app_trace(app, "Video codec %s: %" G_GUINT64_FORMAT " bytes, %" G_GINT64_FORMAT " ms of CPU",
+                              video_codecs[self->calibration_codec].name,
+                              bytes - self->calibration_bytes, cpu_time / 1000);
+        virt_viewer_calibration_add_result(self->calibration,
+                                           video_codecs[self->calibration_codec].name,
+                                           bytes - self->calibration_bytes, cpu_time);
+    }
+
+    self->calibration_codec++;
+    self->calibration_bytes = bytes;
+    self->calibration_cpu = cpu;
+    if (self->calibration_codec < (gint)G_N_ELEMENTS(video_codecs)) {
+        if (virt_viewer_session_spice_update_display_settings(self))
+            return G_SOURCE_CONTINUE;
+
+        virt_viewer_app_trace(app, "The server cannot change the video codec, stopping the calibration");
+        winner = NULL;
+    } else {
+        winner = virt_viewer_calibration_get_winner(self->calibration);
+    }
+
+    host = virt_viewer_session_spice_get_calibration_host(self);
+    if (winner != NULL && host != NULL) {
+        virt_viewer_app_trace(app, "Using the %s video codec with %s from now on", winner, host);
+        virt_viewer_app_set_config_video_codec(app, host, winner);
+    } else if (self->calibration_codec >= (gint)G_N_ELEMENTS(video_codecs)) {
+        virt_viewer_app_trace(app, "Not enough video was streamed to pick a video codec");
     }
+    g_free(host);
 
-    virt_viewer_session_spice_fullscreen_auto_conf(self);
+    /* once per run */
+    virt_viewer_app_set_calibrate_video_codecs(app, FALSE);
+    self->calibration_id = 0;
+    virt_viewer_session_spice_stop_calibration(self);
+    virt_viewer_session_spice_update_display_settings(self);
+
+    return G_SOURCE_REMOVE;
 }
 
 static void
-name_changed(GObject *gobject G_GNUC_UNUSED,
-              GParamSpec *pspec G_GNUC_UNUSED,
-              VirtViewerSessionSpice *self)
+virt_viewer_session_spice_start_calibration(VirtViewerSessionSpice *self)
 {
-    gchar *name = NULL;
     VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
 
-    g_object_get(self->session, "name", &name, NULL);
+    if (self->calibration != NULL || !virt_viewer_app_get_calibrate_video_codecs(app))
+        return;
 
-    g_object_set(app, "guest-name", name, NULL);
-    g_free(name);
+    virt_viewer_app_trace(app, "Trying each video codec for %d seconds", CALIBRATION_PERIOD);
+    self->calibration = virt_viewer_calibration_new();
+    self->calibration_codec = -1;
+    /* the first period lets the display settle down */
+    self->calibration_id = g_timeout_add_seconds(CALIBRATION_PERIOD,
+                                                 virt_viewer_session_spice_calibrate,
+                                                 self);
+}
+
+static gboolean
+virt_viewer_session_spice_channel_disabled(VirtViewerSessionSpice *self, int type)
+{
+    return type >= 0 && type < 32 && (self->disabled_channels & (1U << type)) != 0;
 }
 
 static void
-create_spice_session(VirtViewerSessionSpice *self)
+virt_viewer_session_spice_disable_channels(VirtViewerSessionSpice *self, gchar **names)
 {
-    SpiceUsbDeviceManager *usb_manager;
-    SpiceSmartcardManager *smartcard_manager;
+    /* the session is of no use without the other channels */
+    const guint optional = (1U << SPICE_CHANNEL_PLAYBACK) |
+                           (1U << SPICE_CHANNEL_RECORD) |
+                           (1U << SPICE_CHANNEL_SMARTCARD) |
+                           (1U << SPICE_CHANNEL_USBREDIR) |
+                           (1U << SPICE_CHANNEL_PORT) |
+                           (1U << SPICE_CHANNEL_WEBDAV);
+    gint i;
+
+    for (i = 0; names != NULL && names[i] != NULL; i++) {
+        gchar *name = g_strstrip(g_strdup(names[i]));
+        gint type = spice_channel_string_to_type(name);
+
+        if (type >= 0 && type < 32 && (optional & (1U << type)) != 0)
+            self->disabled_channels |= 1U << type;
+        else if (*name != '\0')
+            g_warning("Channel '%s' cannot be disabled", name);
+        g_free(name);
+    }
+}
 
-    g_return_if_fail(self != NULL);
-    g_return_if_fail(self->session == NULL);
+static void
+virt_viewer_session_spice_setup_usb_manager(VirtViewerSessionSpice *self)
+{
+    VirtViewerFile *file = virt_viewer_session_get_file(VIRT_VIEWER_SESSION(self));
 
-    self->session = spice_session_new();
-    spice_set_session_option(self->session);
+    if (self->usb_manager != NULL)
+        return;
 
-    self->gtk_session = spice_gtk_session_get(self->session);
+    self->usb_manager = spice_usb_device_manager_get(self->session, NULL);
+    if (self->usb_manager == NULL)
+        return;
 
-    g_object_set(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)),
-                 "supports-share-clipboard", TRUE,
-                 NULL);
+    virt_viewer_signal_connect_object(self->usb_manager, "auto-connect-failed",
+                                      G_CALLBACK(usb_connect_failed), self, 0);
+    virt_viewer_signal_connect_object(self->usb_manager, "device-error",
+                                      G_CALLBACK(usb_connect_failed), self, 0);
 
-    g_object_bind_property(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self)), "config-share-clipboard",
-                           self->gtk_session, "auto-clipboard",
-                           G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+    if (file != NULL && virt_viewer_file_is_set(file, "usb-filter")) {
+        gchar *filterstr = virt_viewer_file_get_usb_filter(file);
+        g_object_set(self->usb_manager, "auto-connect-filter", filterstr, NULL);
+        g_free(filterstr);
+    }
+}
 
-    virt_viewer_signal_connect_object(self->session, "channel-new",
-                                      G_CALLBACK(virt_viewer_session_spice_channel_new), self, 0);
-    virt_viewer_signal_connect_object(self->session, "channel-destroy",
-                                      G_CALLBACK(virt_viewer_session_spice_channel_destroyed), self, 0);
-    virt_viewer_signal_connect_object(self->session, "disconnected",
-                                      G_CALLBACK(virt_viewer_session_spice_session_disconnected), self, 0);
+static void
+virt_viewer_session_spice_setup_smartcard_manager(VirtViewerSessionSpice *self)
+{
+    SpiceSmartcardManager *smartcard_manager;
+    GList *readers;
+    GList *it;
 
-    usb_manager = spice_usb_device_manager_get(self->session, NULL);
-    if (usb_manager) {
-        virt_viewer_signal_connect_object(usb_manager, "auto-connect-failed",
-                                          G_CALLBACK(usb_connect_failed), self, 0);
-        virt_viewer_signal_connect_object(usb_manager, "device-error",
-                                          G_CALLBACK(usb_connect_failed), self, 0);
-    }
-    g_object_bind_property(self, "auto-usbredir",
-                           self->gtk_session, "auto-usbredir",
-                           G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+    if (self->smartcard_manager_ready)
+        return;
 
     smartcard_manager = spice_smartcard_manager_get();
-    if (smartcard_manager) {
-        GList *readers;
-        GList *it;
-        virt_viewer_signal_connect_object(smartcard_manager, "reader-added",
-                                          G_CALLBACK(reader_added_cb), self, 0);
-        virt_viewer_signal_connect_object(smartcard_manager, "reader-removed",
-                                          G_CALLBACK(reader_removed_cb), self, 0);
-        readers = spice_smartcard_manager_get_readers(smartcard_manager);
-        for (it = readers; it != NULL; it = it->next) {
-            SpiceSmartcardReader *reader;
-            reader = (SpiceSmartcardReader *)it->data;
-            if (spice_smartcard_reader_is_software(reader)) {
-                virt_viewer_session_spice_set_has_sw_reader(self, TRUE);
-            }
-            g_boxed_free(SPICE_TYPE_SMARTCARD_READER, reader);
+    if (smartcard_manager == NULL)
+        return;
+
+    self->smartcard_manager_ready = TRUE;
+    virt_viewer_signal_connect_object(smartcard_manager, "reader-added",
+                                      G_CALLBACK(reader_added_cb), self, 0);
+    virt_viewer_signal_connect_object(smartcard_manager, "reader-removed",
+                                      G_CALLBACK(reader_removed_cb), self, 0);
+    readers = spice_smartcard_manager_get_readers(smartcard_manager);
+    for (it = readers; it != NULL; it = it->next) {
+        SpiceSmartcardReader *reader;
+        reader = (SpiceSmartcardReader *)it->data;
+        if (spice_smartcard_reader_is_software(reader)) {
+            virt_viewer_session_spice_set_has_sw_reader(self, TRUE);
+        } else {
+            self->has_hw_smartcard_reader = TRUE;
         }
-        g_list_free(readers);
+        g_boxed_free(SPICE_TYPE_SMARTCARD_READER, reader);
     }
-
-    /* notify::uuid is guaranteed to be emitted during connection startup even
-     * if the server is too old to support sending uuid */
-    virt_viewer_signal_connect_object(self->session, "notify::uuid",
-                                      G_CALLBACK(uuid_changed), self, 0);
-    virt_viewer_signal_connect_object(self->session, "notify::name",
-                                      G_CALLBACK(name_changed), self, 0);
-
-    g_object_bind_property(self->session, "shared-dir",
-                           self, "shared-folder",
-                           G_BINDING_BIDIRECTIONAL|G_BINDING_SYNC_CREATE);
-    g_object_bind_property(self->session, "share-dir-ro",
-                           self, "share-folder-ro",
-                           G_BINDING_BIDIRECTIONAL|G_BINDING_SYNC_CREATE);
-
+    g_list_free(readers);
 }
 
+/* Reads the channels disabled on the command line and in the connection
+ * file, and only sets up the managers of the channels left. spice-gtk
+ * does not create the audio, usbredir and smartcard channels when they
+ * are not enabled, the other ones are not connected in channel_new. */
 static void
-virt_viewer_session_spice_close(VirtViewerSession *session)
+virt_viewer_session_spice_setup_channels(VirtViewerSessionSpice *self)
 {
-    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
-
-    g_return_if_fail(self != NULL);
-
-    g_object_add_weak_pointer(G_OBJECT(self), (gpointer*)&self);
+    VirtViewerSession *session = VIRT_VIEWER_SESSION(self);
+    VirtViewerFile *file = virt_viewer_session_get_file(session);
 
-#ifdef WITH_QMP_PORT
-    g_clear_object(&self->qmp);
-#endif
-    virt_viewer_session_spice_clear_displays(self);
+    self->disabled_channels = 0;
+    virt_viewer_session_spice_disable_channels(self,
+        virt_viewer_app_get_disabled_channels(virt_viewer_session_get_app(session)));
+    if (file != NULL && virt_viewer_file_is_set(file, "disable-channels")) {
+        gchar **names = virt_viewer_file_get_disable_channels(file, NULL);
+        virt_viewer_session_spice_disable_channels(self, names);
+        g_strfreev(names);
+    }
 
-    if (self->session) {
-        gtk_dialog_response(GTK_DIALOG(self->auth),
-                            GTK_RESPONSE_CANCEL);
-        spice_session_disconnect(self->session);
-        if (!self)
-            return;
+    /* the record channel is only connected by the audio of the playback one */
+    if (virt_viewer_session_spice_channel_disabled(self, SPICE_CHANNEL_PLAYBACK))
+        g_object_set(self->session, "enable-audio", FALSE, NULL);
 
-        g_object_unref(self->session);
-        self->session = NULL;
-        self->gtk_session = NULL;
-        self->audio = NULL;
+    if (virt_viewer_session_spice_channel_disabled(self, SPICE_CHANNEL_USBREDIR)) {
+        g_object_set(self->session, "enable-usbredir", FALSE, NULL);
+        virt_viewer_session_set_auto_usbredir(session, FALSE);
+    } else {
+        virt_viewer_session_spice_setup_usb_manager(self);
     }
 
-    g_object_remove_weak_pointer(G_OBJECT(self), (gpointer*)&self);
+    if (virt_viewer_session_spice_channel_disabled(self, SPICE_CHANNEL_SMARTCARD))
+        g_object_set(self->session, "enable-smartcard", FALSE, NULL);
+    else
+        virt_viewer_session_spice_setup_smartcard_manager(self);
+}
 
-    /* FIXME: version 0.7 of spice-gtk allows reuse of session */
-    create_spice_session(self);
+/* Called for each new connection */
+static void
+virt_viewer_session_spice_opened(VirtViewerSessionSpice *self)
+{
+    self->opened = TRUE;
+    self->display_ready = FALSE;
+    self->pass_try = 0;
+    g_clear_error(&self->disconnect_error);
+    virt_viewer_session_spice_start_link_quality(self);
 }
 
 static gboolean
@@ -520,6 +1493,8 @@ virt_viewer_session_spice_open_host(VirtViewerSession *session,
                  "tls-port", tlsport,
                  NULL);
 
+    virt_viewer_session_spice_setup_channels(self);
+    virt_viewer_session_spice_opened(self);
     return spice_session_connect(self->session);
 }
 
@@ -622,25 +1597,11 @@ fill_session(VirtViewerFile *file, SpiceSession *session)
         g_object_set(G_OBJECT(gtk), "auto-usbredir", enabled, NULL);
     }
 
-    if (virt_viewer_file_is_set(file, "usb-filter")) {
-        gchar *filterstr = virt_viewer_file_get_usb_filter(file);
-        SpiceUsbDeviceManager *manager = spice_usb_device_manager_get(session,
-                                                                      NULL);
-        if (manager != NULL) {
-            g_object_set(manager, "auto-connect-filter", filterstr, NULL);
-        }
-        g_free(filterstr);
-    }
-
     if (virt_viewer_file_is_set(file, "secure-channels")) {
         gchar **channels = virt_viewer_file_get_secure_channels(file, NULL);
         g_object_set(G_OBJECT(session), "secure-channels", channels, NULL);
         g_strfreev(channels);
     }
-
-    if (virt_viewer_file_is_set(file, "disable-channels")) {
-        g_debug("FIXME: disable-channels is not supported atm");
-    }
 }
 
 static gboolean
@@ -662,6 +1623,8 @@ virt_viewer_session_spice_open_uri(VirtViewerSession *session,
         g_object_set(self->session, "uri", uri, NULL);
     }
 
+    virt_viewer_session_spice_setup_channels(self);
+    virt_viewer_session_spice_opened(self);
     return spice_session_connect(self->session);
 }
 
@@ -673,6 +1636,8 @@ virt_viewer_session_spice_open_fd(VirtViewerSession *session,
 
     g_return_val_if_fail(self != NULL, FALSE);
 
+    virt_viewer_session_spice_setup_channels(self);
+    virt_viewer_session_spice_opened(self);
     return spice_session_open_fd(self->session, fd);
 }
 
@@ -693,9 +1658,54 @@ virt_viewer_session_spice_channel_open_fd_request(SpiceChannel *channel,
                                                   gint tls G_GNUC_UNUSED,
                                                   VirtViewerSession *session)
 {
+    /* its set up time is no measure of the link latency */
+    g_object_set_data(G_OBJECT(channel), "virt-viewer-open-fd", GINT_TO_POINTER(TRUE));
     g_signal_emit_by_name(session, "session-channel-open", channel);
 }
 
+/* Reports how long each channel took to be set up, tunnels included */
+static void
+virt_viewer_session_spice_channel_event(SpiceChannel *channel,
+                                        SpiceChannelEvent event,
+                                        VirtViewerSession *session)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
+    gint64 *start;
+    int id, type;
+
+    if (event != SPICE_CHANNEL_OPENED)
+        return;
+
+    if (SPICE_IS_DISPLAY_CHANNEL(channel)) {
+        virt_viewer_session_spice_apply_display_settings(self, channel);
+        virt_viewer_session_spice_start_calibration(self);
+    }
+
+    start = g_object_get_data(G_OBJECT(channel), "virt-viewer-setup-start");
+    if (start == NULL)
+        return;
+
+    if (self->link_quality != NULL &&
+        g_object_get_data(G_OBJECT(channel), "virt-viewer-open-fd") == NULL)
+        virt_viewer_link_quality_add_latency(self->link_quality,
+                                             (g_get_monotonic_time() - *start) / LINK_ROUND_TRIPS);
+
+    g_object_get(channel,
+                 "channel-id", &id,
+                 "channel-type", &type,
+                 NULL);
+    virt_viewer_app_trace(virt_viewer_session_get_app(session),
+                          "Channel %s %d set up in %" G_GINT64_FORMAT " ms",
+                          spice_channel_type_to_string(type), id,
+                          (g_get_monotonic_time() - *start) / 1000);
+    virt_viewer_app_timing_mark(virt_viewer_session_get_app(session),
+                                "spice-channel-opened %s %d",
+                                spice_channel_type_to_string(type), id);
+
+    /* only the first connection is of interest */
+    g_object_set_data(G_OBJECT(channel), "virt-viewer-setup-start", NULL);
+}
+
 static void
 virt_viewer_session_spice_main_channel_event(SpiceChannel *channel,
                                              SpiceChannelEvent event,
@@ -716,7 +1726,7 @@ virt_viewer_session_spice_main_channel_event(SpiceChannel *channel,
     case SPICE_CHANNEL_CLOSED:
         g_debug("main channel: closed");
         /* Ensure the other channels get closed too */
-        virt_viewer_session_spice_clear_displays(self);
+        virt_viewer_session_spice_release_displays(self);
         if (self->session)
             spice_session_disconnect(self->session);
         break;
@@ -835,6 +1845,8 @@ virt_viewer_session_spice_usb_device_selection(VirtViewerSession *session,
     VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
     GtkWidget *dialog, *area, *usb_device_widget;
 
+    virt_viewer_session_spice_connect_deferred(self, SPICE_CHANNEL_USBREDIR);
+
     /* Create the widgets */
     dialog = gtk_dialog_new_with_buttons(_("Select USB devices for redirection"), parent,
                                          GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
@@ -925,10 +1937,21 @@ virt_viewer_session_spice_display_monitors(SpiceChannel *channel,
 
     displays = g_object_get_data(G_OBJECT(channel), "virt-viewer-displays");
     if (displays == NULL) {
-        displays = g_ptr_array_new();
-        g_ptr_array_set_free_func(displays, destroy_display);
+        int id;
+
+        g_object_get(channel, "channel-id", &id, NULL);
+        displays = g_hash_table_lookup(self->parked_displays, GINT_TO_POINTER(id));
+        if (displays != NULL) {
+            g_debug("Reusing the displays of channel %d", id);
+            g_ptr_array_ref(displays);
+            g_hash_table_remove(self->parked_displays, GINT_TO_POINTER(id));
+        } else {
+            displays = g_ptr_array_new();
+            g_ptr_array_set_free_func(displays, destroy_display);
+        }
         g_object_set_data_full(G_OBJECT(channel), "virt-viewer-displays",
                                displays, (GDestroyNotify)g_ptr_array_unref);
+        virt_viewer_session_spice_drop_parked_displays(self);
     }
 
     g_ptr_array_set_size(displays, monitors_max);
@@ -943,6 +1966,9 @@ virt_viewer_session_spice_display_monitors(SpiceChannel *channel,
             g_debug("creating spice display (#:%d)",
                     virt_viewer_display_get_nth(VIRT_VIEWER_DISPLAY(display)));
             g_ptr_array_index(displays, i) = g_object_ref_sink(display);
+            virt_viewer_signal_connect_object(display, "notify::hidden",
+                                              G_CALLBACK(virt_viewer_session_spice_display_hidden),
+                                              self, G_CONNECT_SWAPPED);
             virt_viewer_session_add_display(VIRT_VIEWER_SESSION(self),
                                             VIRT_VIEWER_DISPLAY(display));
         }
@@ -988,12 +2014,76 @@ on_new_file_transfer(SpiceMainChannel *channel G_GNUC_UNUSED,
                                               task);
 }
 
+/* The writes to a port are merged in chunks of at most this size, with a
+ * single one being written at a time */
+#define PORT_WRITE_CHUNK (64 * 1024)
+/* The data of a port is shown at most every this many milliseconds... */
+#define PORT_RENDER_INTERVAL 16
+/* ...unless that much is pending */
+#define PORT_RENDER_THRESHOLD (256 * 1024)
+/* The data received while that much is pending is not shown */
+#define PORT_INPUT_MAX (4 * 1024 * 1024)
+
+typedef struct {
+    gint refs;
+    VirtViewerRingBuffer *output;
+    gpointer chunk; /* the one being written */
+    VirtViewerRingBuffer *input;
+    guint render_id;
+    gboolean render_now;
+    gsize dropped;
+} VirtViewerPortBuffer;
+
+static VirtViewerPortBuffer *
+virt_viewer_port_buffer_new(void)
+{
+    VirtViewerPortBuffer *buffer = g_new0(VirtViewerPortBuffer, 1);
+
+    buffer->refs = 1;
+    buffer->output = virt_viewer_ring_buffer_new(4096);
+    buffer->input = virt_viewer_ring_buffer_new(4096);
+
+    return buffer;
+}
+
+static VirtViewerPortBuffer *
+virt_viewer_port_buffer_ref(VirtViewerPortBuffer *buffer)
+{
+    buffer->refs++;
+    return buffer;
+}
+
+static void
+virt_viewer_port_buffer_unref(VirtViewerPortBuffer *buffer)
+{
+    if (--buffer->refs > 0)
+        return;
+
+    virt_viewer_ring_buffer_free(buffer->output);
+    virt_viewer_ring_buffer_free(buffer->input);
+    g_free(buffer);
+}
+
+/* Called when the console is closed, a write may still hold the buffer */
+static void
+virt_viewer_port_buffer_close(VirtViewerPortBuffer *buffer)
+{
+    if (buffer->render_id > 0) {
+        g_source_remove(buffer->render_id);
+        buffer->render_id = 0;
+    }
+    virt_viewer_port_buffer_unref(buffer);
+}
+
+static void spice_port_flush(SpicePortChannel *port);
+
 static void
 spice_port_write_finished(GObject *source_object,
                           GAsyncResult *res,
-                          gpointer dup)
+                          gpointer user_data)
 {
     SpicePortChannel *port = SPICE_PORT_CHANNEL(source_object);
+    VirtViewerPortBuffer *buffer = user_data;
     GError *err = NULL;
 
     spice_port_channel_write_finish(port, res, &err);
@@ -1001,25 +2091,116 @@ spice_port_write_finished(GObject *source_object,
         g_warning("Spice port write failed: %s", err->message);
         g_error_free(err);
     }
-    g_free(dup);
+    g_clear_pointer(&buffer->chunk, g_free);
+
+    /* the console may have been closed, or closed and opened again,
+     * meanwhile: the new buffer has its own writes */
+    if (g_object_get_data(G_OBJECT(port), "virt-viewer-port-buffer") == buffer)
+        spice_port_flush(port);
+    virt_viewer_port_buffer_unref(buffer);
+}
+
+static void
+spice_port_flush(SpicePortChannel *port)
+{
+    VirtViewerPortBuffer *buffer = g_object_get_data(G_OBJECT(port), "virt-viewer-port-buffer");
+    gsize size;
+
+    if (buffer->chunk != NULL)
+        return;
+
+    size = MIN(virt_viewer_ring_buffer_get_length(buffer->output), PORT_WRITE_CHUNK);
+    if (size == 0)
+        return;
+
+    buffer->chunk = g_malloc(size);
+    virt_viewer_ring_buffer_read(buffer->output, buffer->chunk, size);
+    spice_port_channel_write_async(port, buffer->chunk, size,
+                                   NULL, spice_port_write_finished,
+                                   virt_viewer_port_buffer_ref(buffer));
 }
 
 static void
 spice_vte_commit(SpicePortChannel *port, const char *text,
                  guint size, gpointer user_data G_GNUC_UNUSED)
 {
-    void *dup = g_memdup(text, size);
+    VirtViewerPortBuffer *buffer = g_object_get_data(G_OBJECT(port), "virt-viewer-port-buffer");
+
+    if (buffer == NULL)
+        return;
+
+    /* what is typed or pasted meanwhile is sent with the next chunk */
+    virt_viewer_ring_buffer_write(buffer->output, text, size);
+    spice_port_flush(port);
+}
+
+static void
+spice_port_render(SpicePortChannel *port)
+{
+    VirtViewerPortBuffer *buffer = g_object_get_data(G_OBJECT(port), "virt-viewer-port-buffer");
+    VirtViewerDisplayVte *vte = g_object_get_data(G_OBJECT(port), "virt-viewer-vte");
+    gconstpointer data;
+    gsize size;
+
+    while ((size = virt_viewer_ring_buffer_peek(buffer->input, &data)) > 0) {
+        virt_viewer_display_vte_feed(vte, (gpointer)data, size);
+        virt_viewer_ring_buffer_consume(buffer->input, size);
+    }
+
+    if (buffer->dropped > 0) {
+        g_debug("Dropped %" G_GSIZE_FORMAT " bytes of port data", buffer->dropped);
+        buffer->dropped = 0;
+    }
+}
+
+static gboolean
+spice_port_render_timeout(gpointer user_data)
+{
+    SpicePortChannel *port = SPICE_PORT_CHANNEL(user_data);
+    VirtViewerPortBuffer *buffer = g_object_get_data(G_OBJECT(port), "virt-viewer-port-buffer");
+
+    buffer->render_id = 0;
+    buffer->render_now = FALSE;
+    spice_port_render(port);
 
-    /* note: spice-gtk queues write */
-    spice_port_channel_write_async(port, dup, size,
-                                   NULL, spice_port_write_finished, dup);
+    return G_SOURCE_REMOVE;
 }
 
+/* Feeding the terminal while the guest is flooding the port would block
+ * the reads from the port, slowing the guest down. The data is thus shown
+ * from the main loop, and what comes while too much is pending is dropped
+ * until it is shown; the serial log still gets everything. */
 static void
-spice_port_data(VirtViewerDisplayVte *vte, gpointer data, int size,
-                SpicePortChannel *port G_GNUC_UNUSED)
+spice_port_data(VirtViewerDisplayVte *vte G_GNUC_UNUSED, gpointer data, int size,
+                SpicePortChannel *port)
 {
-    virt_viewer_display_vte_feed(vte, data, size);
+    VirtViewerPortBuffer *buffer = g_object_get_data(G_OBJECT(port), "virt-viewer-port-buffer");
+    VirtViewerLogSink *sink = g_object_get_data(G_OBJECT(port), "virt-viewer-log-sink");
+
+    if (sink != NULL)
+        virt_viewer_log_sink_write(sink, data, size);
+
+    if (buffer == NULL)
+        return;
+
+    if (virt_viewer_ring_buffer_get_length(buffer->input) >= PORT_INPUT_MAX) {
+        buffer->dropped += size;
+        return;
+    }
+
+    virt_viewer_ring_buffer_write(buffer->input, data, size);
+    if (virt_viewer_ring_buffer_get_length(buffer->input) >= PORT_RENDER_THRESHOLD) {
+        if (buffer->render_now)
+            return;
+        if (buffer->render_id > 0)
+            g_source_remove(buffer->render_id);
+        buffer->render_id = g_idle_add_full(G_PRIORITY_DEFAULT,
+                                            spice_port_render_timeout, port, NULL);
+        buffer->render_now = TRUE;
+    } else if (buffer->render_id == 0) {
+        buffer->render_id = g_timeout_add(PORT_RENDER_INTERVAL,
+                                          spice_port_render_timeout, port);
+    }
 }
 
 static const char *
@@ -1066,6 +2247,30 @@ virt_viewer_session_spice_vm_action(VirtViewerSession *sess G_GNUC_UNUSED,
 #endif
 }
 
+/* channels of the same type add up, a closed channel is not counted */
+static void
+virt_viewer_session_spice_add_benchmark_stats(VirtViewerSession *session,
+                                              VirtViewerBenchmark *benchmark)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
+    GList *l, *channels;
+
+    if (self->session == NULL)
+        return;
+
+    channels = spice_session_get_channels(self->session);
+    for (l = channels; l != NULL; l = l->next) {
+        gulong bytes = 0;
+        gint type;
+
+        g_object_get(l->data, "channel-type", &type, "total-read-bytes", &bytes, NULL);
+        virt_viewer_benchmark_add_channel_bytes(benchmark,
+                                                spice_channel_type_to_string(type),
+                                                bytes);
+    }
+    g_list_free(channels);
+}
+
 static gboolean
 virt_viewer_session_spice_has_vm_action(VirtViewerSession *sess G_GNUC_UNUSED,
                                         gint action G_GNUC_UNUSED)
@@ -1141,6 +2346,26 @@ static void qmp_event_cb(VirtViewerSessionSpice *self, const gchar *event,
 }
 #endif /* WITH_QMP_PORT */
 
+/* The log is written by a thread of its own, the data it could not keep
+ * up with is dropped */
+static void
+virt_viewer_session_spice_start_serial_log(VirtViewerSessionSpice *self,
+                                           SpicePortChannel *port)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    const gchar *path = virt_viewer_app_get_serial_log(app);
+    gsize max_size = (gsize)virt_viewer_app_get_serial_log_max_size(app) * 1024 * 1024;
+
+    if (path == NULL)
+        return;
+
+    virt_viewer_app_trace(app, "Logging the serial console to %s", path);
+    g_object_set_data_full(G_OBJECT(port), "virt-viewer-log-sink",
+                           virt_viewer_log_sink_new(path, max_size,
+                                                    virt_viewer_app_get_serial_log_compress(app)),
+                           (GDestroyNotify)virt_viewer_log_sink_free);
+}
+
 static void
 spice_port_opened(SpiceChannel *channel, GParamSpec *pspec G_GNUC_UNUSED,
                   VirtViewerSessionSpice *self)
@@ -1150,6 +2375,7 @@ spice_port_opened(SpiceChannel *channel, GParamSpec *pspec G_GNUC_UNUSED,
     gchar *name = NULL;
     gboolean opened = FALSE;
     const char *vte_name;
+    gboolean serial;
     GtkWidget *vte;
 
     g_object_get(G_OBJECT(port),
@@ -1161,6 +2387,7 @@ spice_port_opened(SpiceChannel *channel, GParamSpec *pspec G_GNUC_UNUSED,
     g_return_if_fail(name != NULL);
     g_debug("port#%d %s: %s", id, name, opened ? "opened" : "closed");
     vte_name = port_name_to_vte_name(name);
+    serial = g_str_equal(name, "org.qemu.console.serial.0");
 
 #ifdef WITH_QMP_PORT
     if (g_str_equal(name, "org.qemu.monitor.qmp.0")) {
@@ -1189,6 +2416,8 @@ spice_port_opened(SpiceChannel *channel, GParamSpec *pspec G_GNUC_UNUSED,
         if (opened)
             return;
 
+        g_object_set_data(G_OBJECT(port), "virt-viewer-log-sink", NULL);
+        g_object_set_data(G_OBJECT(port), "virt-viewer-port-buffer", NULL);
         g_object_set_data(G_OBJECT(port), "virt-viewer-vte", NULL);
         virt_viewer_session_remove_display(VIRT_VIEWER_SESSION(self), VIRT_VIEWER_DISPLAY(vte));
         g_object_unref(vte);
@@ -1199,6 +2428,11 @@ spice_port_opened(SpiceChannel *channel, GParamSpec *pspec G_GNUC_UNUSED,
 
         vte = virt_viewer_display_vte_new(VIRT_VIEWER_SESSION(self), vte_name);
         g_object_set_data(G_OBJECT(port), "virt-viewer-vte", g_object_ref_sink(vte));
+        g_object_set_data_full(G_OBJECT(port), "virt-viewer-port-buffer",
+                               virt_viewer_port_buffer_new(),
+                               (GDestroyNotify)virt_viewer_port_buffer_close);
+        if (serial)
+            virt_viewer_session_spice_start_serial_log(self, port);
         virt_viewer_session_add_display(VIRT_VIEWER_SESSION(self), VIRT_VIEWER_DISPLAY(vte));
         virt_viewer_signal_connect_object(vte, "commit",
                                           G_CALLBACK(spice_vte_commit), port, G_CONNECT_SWAPPED);
@@ -1213,19 +2447,47 @@ virt_viewer_session_spice_channel_new(SpiceSession *s,
                                       VirtViewerSession *session)
 {
     VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
+    gint64 *start;
     int id, type;
 
     g_return_if_fail(self != NULL);
 
-    virt_viewer_signal_connect_object(channel, "open-fd",
-                                      G_CALLBACK(virt_viewer_session_spice_channel_open_fd_request), self, 0);
-
     g_object_get(channel,
                  "channel-id", &id,
                  "channel-type", &type,
                  NULL);
 
+    /* keep the channel from the audio and other handlers connecting it */
+    if (virt_viewer_session_spice_channel_disabled(self, type)) {
+        g_debug("Not connecting disabled spice channel %s %d",
+                spice_channel_type_to_string(type), id);
+        g_signal_stop_emission_by_name(s, "channel-new");
+        return;
+    }
+
+    if (virt_viewer_session_spice_defer_channel(self, channel, type)) {
+        g_debug("Deferring spice channel %s %d", spice_channel_type_to_string(type), id);
+        g_ptr_array_add(self->deferred_channels, g_object_ref(channel));
+        g_signal_stop_emission_by_name(s, "channel-new");
+        /* the USB dialog connects them when it is opened */
+        if (type == SPICE_CHANNEL_USBREDIR && self->usb_manager != NULL)
+            virt_viewer_session_set_has_usbredir(session, TRUE);
+        return;
+    }
+
+    start = g_new(gint64, 1);
+    *start = g_get_monotonic_time();
+    g_object_set_data_full(G_OBJECT(channel), "virt-viewer-setup-start", start, g_free);
+    virt_viewer_signal_connect_object(channel, "channel-event",
+                                      G_CALLBACK(virt_viewer_session_spice_channel_event), self, 0);
+
+    virt_viewer_signal_connect_object(channel, "open-fd",
+                                      G_CALLBACK(virt_viewer_session_spice_channel_open_fd_request), self, 0);
+
     g_debug("New spice channel %p %s %d", channel, g_type_name(G_OBJECT_TYPE(channel)), id);
+    virt_viewer_app_timing_mark(virt_viewer_session_get_app(session),
+                                "spice-channel-new %s %d",
+                                spice_channel_type_to_string(type), id);
 
     if (SPICE_IS_MAIN_CHANNEL(channel)) {
         if (self->main_channel != NULL)
@@ -1244,6 +2506,12 @@ virt_viewer_session_spice_channel_new(SpiceSession *s,
                                           G_CALLBACK(agent_connected_changed), self, 0);
         virt_viewer_signal_connect_object(channel, "new-file-transfer",
                                           G_CALLBACK(on_new_file_transfer), self, 0);
+
+        /* the audio connects the record channels it finds when created,
+         * so it must come before any of them is deferred */
+        if (self->audio == NULL &&
+            virt_viewer_app_get_lazy_channels(virt_viewer_session_get_app(session)))
+            self->audio = spice_audio_get(s, NULL);
     }
 
     if (SPICE_IS_DISPLAY_CHANNEL(channel)) {
@@ -1251,6 +2519,8 @@ virt_viewer_session_spice_channel_new(SpiceSession *s,
 
         virt_viewer_signal_connect_object(channel, "notify::monitors",
                                           G_CALLBACK(virt_viewer_session_spice_display_monitors), self, 0);
+        virt_viewer_signal_connect_object(channel, "display-mark",
+                                          G_CALLBACK(virt_viewer_session_spice_display_mark), self, 0);
 
         spice_channel_connect(channel);
     }
@@ -1268,7 +2538,7 @@ virt_viewer_session_spice_channel_new(SpiceSession *s,
     if (SPICE_IS_USBREDIR_CHANNEL(channel)) {
         g_debug("new usbredir channel");
         self->usbredir_channel_count++;
-        if (spice_usb_device_manager_get(self->session, NULL))
+        if (self->usb_manager != NULL)
             virt_viewer_session_set_has_usbredir(session, TRUE);
     }
 
@@ -1363,6 +2633,12 @@ virt_viewer_session_spice_session_disconnected(G_GNUC_UNUSED SpiceSession *s,
                                                VirtViewerSessionSpice *self)
 {
     GError *error = self->disconnect_error;
+
+    /* the session is disconnected again when it is closed */
+    if (!self->opened)
+        return;
+
+    self->opened = FALSE;
     g_signal_emit_by_name(self, "session-disconnected", error ? error->message : NULL);
 }
 
@@ -1373,12 +2649,26 @@ virt_viewer_session_spice_channel_destroyed(G_GNUC_UNUSED SpiceSession *s,
                                             VirtViewerSession *session)
 {
     VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
-    int id;
+    int id, type;
     const GError *error;
 
     g_return_if_fail(self != NULL);
 
-    g_object_get(channel, "channel-id", &id, NULL);
+    g_object_get(channel,
+                 "channel-id", &id,
+                 "channel-type", &type,
+                 NULL);
+    if (virt_viewer_session_spice_channel_disabled(self, type))
+        return;
+
+    if (g_ptr_array_remove(self->deferred_channels, channel)) {
+        g_debug("Destroy deferred SPICE channel %s %d", spice_channel_type_to_string(type), id);
+        if (type == SPICE_CHANNEL_USBREDIR && self->usbredir_channel_count == 0 &&
+            !virt_viewer_session_spice_has_deferred(self, SPICE_CHANNEL_USBREDIR))
+            virt_viewer_session_set_has_usbredir(session, FALSE);
+        return;
+    }
+
     g_debug("Destroy SPICE channel %s %d", g_type_name(G_OBJECT_TYPE(channel)), id);
 
     error = spice_channel_get_error(channel);
@@ -1391,13 +2681,18 @@ virt_viewer_session_spice_channel_destroyed(G_GNUC_UNUSED SpiceSession *s,
 
     if (SPICE_IS_DISPLAY_CHANNEL(channel)) {
         g_debug("zap display channel (#%d)", id);
-        g_object_set_data(G_OBJECT(channel), "virt-viewer-displays", NULL);
+        if (virt_viewer_session_spice_warm_reconnect(self))
+            virt_viewer_session_spice_park_channel_displays(self, channel);
+        else
+            g_object_set_data(G_OBJECT(channel), "virt-viewer-displays", NULL);
     }
 
     if (SPICE_IS_PORT_CHANNEL(channel)) {
         VirtViewerDisplayVte *vte = g_object_get_data(G_OBJECT(channel), "virt-viewer-vte");
         g_debug("zap port channel (#%d)", id);
         if (vte) {
+            g_object_set_data(G_OBJECT(channel), "virt-viewer-log-sink", NULL);
+            g_object_set_data(G_OBJECT(channel), "virt-viewer-port-buffer", NULL);
             g_object_set_data(G_OBJECT(channel), "virt-viewer-vte", NULL);
             virt_viewer_session_remove_display(VIRT_VIEWER_SESSION(self), VIRT_VIEWER_DISPLAY(vte));
             g_object_unref(vte);
@@ -1509,8 +2804,10 @@ virt_viewer_session_spice_usb_device_reset(VirtViewerSession *session)
 }
 
 static void
-virt_viewer_session_spice_smartcard_insert(VirtViewerSession *session G_GNUC_UNUSED)
+virt_viewer_session_spice_smartcard_insert(VirtViewerSession *session)
 {
+    virt_viewer_session_spice_connect_deferred(VIRT_VIEWER_SESSION_SPICE(session),
+                                               SPICE_CHANNEL_SMARTCARD);
     spice_smartcard_manager_insert_card(spice_smartcard_manager_get());
 }
 
@@ -1527,6 +2824,10 @@ virt_viewer_session_spice_apply_monitor_geometry(VirtViewerSession *session, GHa
     gpointer key = NULL, value = NULL;
     VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
 
+    /* the displays are kept while disconnected */
+    if (self->main_channel == NULL)
+        return;
+
     g_hash_table_iter_init(&iter, monitors);
     while (g_hash_table_iter_next(&iter, &key, &value)) {
         gint i = GPOINTER_TO_INT(key);
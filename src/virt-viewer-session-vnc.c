@@ -32,6 +32,7 @@
 #include "virt-viewer-auth.h"
 #include "virt-viewer-session-vnc.h"
 #include "virt-viewer-display-vnc.h"
+#include "virt-viewer-link-quality.h"
 
 #include <glib/gi18n.h>
 #include <libxml/uri.h>
@@ -41,6 +42,7 @@
 #endif
 #if VNC_CHECK_VERSION(1, 2, 0)
 # define HAVE_VNC_POWER_CONTROL
+# define HAVE_VNC_SET_ENCODINGS
 #endif
 
 struct _VirtViewerSessionVnc {
@@ -52,6 +54,8 @@ struct _VirtViewerSessionVnc {
     gboolean auth_dialog_cancelled;
     gchar *error_msg;
     gboolean power_control;
+    gint link_profile; /* VirtViewerLinkProfile guessed with "auto", -1 for none */
+    gint64 handshake_start; /* 0 when not measured */
 };
 
 G_DEFINE_TYPE(VirtViewerSessionVnc, virt_viewer_session_vnc, VIRT_VIEWER_TYPE_SESSION)
@@ -141,8 +145,238 @@ virt_viewer_session_vnc_class_init(VirtViewerSessionVncClass *klass)
 }
 
 static void
-virt_viewer_session_vnc_init(VirtViewerSessionVnc *self G_GNUC_UNUSED)
+virt_viewer_session_vnc_init(VirtViewerSessionVnc *self)
 {
+    self->link_profile = -1;
+}
+
+static const struct {
+    const gchar *name;
+    VncDisplayDepthColor depth;
+} vnc_depths[] = {
+    { "default", VNC_DISPLAY_DEPTH_COLOR_DEFAULT },
+    { "full", VNC_DISPLAY_DEPTH_COLOR_FULL },
+    { "medium", VNC_DISPLAY_DEPTH_COLOR_MEDIUM },
+    { "low", VNC_DISPLAY_DEPTH_COLOR_LOW },
+    { "ultra-low", VNC_DISPLAY_DEPTH_COLOR_ULTRA_LOW },
+};
+
+/* Whether each link profile enables the lossy encoding, unless it is set
+ * explicitly. The servers only send JPEG in full color, so the depth is
+ * left alone. */
+static const gboolean link_lossy[] = {
+    [VIRT_VIEWER_LINK_PROFILE_LAN] = FALSE,
+    [VIRT_VIEWER_LINK_PROFILE_WAN] = TRUE,
+    [VIRT_VIEWER_LINK_PROFILE_CELLULAR] = TRUE,
+};
+
+/* the JPEG quality VncDisplay asks for with lossy encoding */
+#define DEFAULT_JPEG_QUALITY 5
+/* the handshake takes the version, the security type, the authentication
+ * and the init messages */
+#define HANDSHAKE_ROUND_TRIPS 4
+
+#ifdef HAVE_VNC_SET_ENCODINGS
+static const struct {
+    const gchar *name;
+    gint32 encoding;
+} vnc_encodings[] = {
+    { "tight", VNC_CONNECTION_ENCODING_TIGHT },
+    { "zrle", VNC_CONNECTION_ENCODING_ZRLE },
+    { "hextile", VNC_CONNECTION_ENCODING_HEXTILE },
+    { "rre", VNC_CONNECTION_ENCODING_RRE },
+    { "copyrect", VNC_CONNECTION_ENCODING_COPY_RECT },
+    { "raw", VNC_CONNECTION_ENCODING_RAW },
+};
+
+/* the pseudo encodings VncDisplay needs for the resizes, the cursor and
+ * the keyboard */
+static const gint32 vnc_pseudo_encodings[] = {
+    VNC_CONNECTION_ENCODING_EXTENDED_DESKTOP_RESIZE,
+    VNC_CONNECTION_ENCODING_DESKTOP_RESIZE,
+    VNC_CONNECTION_ENCODING_LED_STATE,
+    VNC_CONNECTION_ENCODING_WMVi,
+    VNC_CONNECTION_ENCODING_RICH_CURSOR,
+    VNC_CONNECTION_ENCODING_XCURSOR,
+    VNC_CONNECTION_ENCODING_POINTER_CHANGE,
+    VNC_CONNECTION_ENCODING_EXT_KEY_EVENT,
+};
+#endif
+
+/* The profile set with --link-profile, or the one guessed with "auto",
+ * -1 for none */
+static gint
+virt_viewer_session_vnc_get_link_profile(VirtViewerSessionVnc *self)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    const gchar *name = virt_viewer_app_get_link_profile(app);
+    VirtViewerLinkProfile profile;
+
+    if (name == NULL)
+        return -1;
+    if (virt_viewer_link_profile_from_string(name, &profile))
+        return profile;
+
+    return self->link_profile;
+}
+
+static VncDisplayDepthColor
+virt_viewer_session_vnc_get_depth(VirtViewerSessionVnc *self)
+{
+    VirtViewerSession *session = VIRT_VIEWER_SESSION(self);
+    VirtViewerFile *file = virt_viewer_session_get_file(session);
+    gchar *name = g_strdup(virt_viewer_app_get_vnc_depth(virt_viewer_session_get_app(session)));
+    VncDisplayDepthColor depth = VNC_DISPLAY_DEPTH_COLOR_DEFAULT;
+    gboolean found = FALSE;
+    guint i;
+
+    if (name == NULL && file != NULL && virt_viewer_file_is_set(file, "vnc-depth"))
+        name = virt_viewer_file_get_vnc_depth(file);
+    if (name == NULL)
+        return depth;
+
+    for (i = 0; i < G_N_ELEMENTS(vnc_depths); i++) {
+        if (g_ascii_strcasecmp(name, vnc_depths[i].name) == 0) {
+            depth = vnc_depths[i].depth;
+            found = TRUE;
+        }
+    }
+    if (!found)
+        g_warning("Unknown VNC color depth '%s'", name);
+    g_free(name);
+
+    return depth;
+}
+
+/* The command line, the connection file, then the link profile decide */
+static gboolean
+virt_viewer_session_vnc_get_lossy(VirtViewerSessionVnc *self)
+{
+    VirtViewerSession *session = VIRT_VIEWER_SESSION(self);
+    VirtViewerFile *file = virt_viewer_session_get_file(session);
+    gint profile = virt_viewer_session_vnc_get_link_profile(self);
+    gint lossy = virt_viewer_app_get_vnc_lossy_encoding(virt_viewer_session_get_app(session));
+
+    if (lossy >= 0)
+        return lossy;
+    if (file != NULL && virt_viewer_file_is_set(file, "vnc-lossy-encoding"))
+        return virt_viewer_file_get_vnc_lossy_encoding(file);
+
+    return profile >= 0 && link_lossy[profile];
+}
+
+#ifdef HAVE_VNC_SET_ENCODINGS
+static gint32
+vnc_encoding_from_name(const gchar *name)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(vnc_encodings); i++) {
+        if (g_ascii_strcasecmp(name, vnc_encodings[i].name) == 0)
+            return vnc_encodings[i].encoding;
+    }
+
+    g_warning("Unknown VNC encoding '%s'", name);
+    return -1;
+}
+
+/* The encodings from the command line or the connection file. Returns the
+ * number of encodings stored in @encodings. */
+static guint
+virt_viewer_session_vnc_get_encodings(VirtViewerSessionVnc *self,
+                                      gint32 encodings[G_N_ELEMENTS(vnc_encodings)])
+{
+    VirtViewerSession *session = VIRT_VIEWER_SESSION(self);
+    VirtViewerFile *file = virt_viewer_session_get_file(session);
+    const gchar *option = virt_viewer_app_get_vnc_encodings(virt_viewer_session_get_app(session));
+    gchar **names = NULL;
+    guint i, j, n = 0;
+
+    if (option != NULL)
+        names = g_strsplit(option, ",", -1);
+    else if (file != NULL && virt_viewer_file_is_set(file, "vnc-encodings"))
+        names = virt_viewer_file_get_vnc_encodings(file, NULL);
+
+    for (i = 0; names != NULL && names[i] != NULL; i++) {
+        gint32 encoding = vnc_encoding_from_name(g_strstrip(names[i]));
+        gboolean dup = FALSE;
+
+        for (j = 0; j < n; j++)
+            dup |= encodings[j] == encoding;
+        if (encoding >= 0 && !dup && n < G_N_ELEMENTS(vnc_encodings))
+            encodings[n++] = encoding;
+    }
+    g_strfreev(names);
+
+    return n;
+}
+#endif
+
+/* VncDisplay always asks for its own encodings once connected, they are
+ * only replaced when a list is given */
+static void
+virt_viewer_session_vnc_send_encodings(VirtViewerSessionVnc *self)
+{
+#ifdef HAVE_VNC_SET_ENCODINGS
+    gint32 encodings[G_N_ELEMENTS(vnc_encodings) + 1 + G_N_ELEMENTS(vnc_pseudo_encodings)];
+    guint i, n = virt_viewer_session_vnc_get_encodings(self, encodings);
+
+    if (n == 0)
+        return;
+
+    if (vnc_display_get_lossy_encoding(self->vnc))
+        encodings[n++] = VNC_CONNECTION_ENCODING_TIGHT_JPEG0 + DEFAULT_JPEG_QUALITY;
+    for (i = 0; i < G_N_ELEMENTS(vnc_pseudo_encodings); i++)
+        encodings[n++] = vnc_pseudo_encodings[i];
+
+    g_debug("Setting %u VNC encodings", n);
+    vnc_connection_set_encodings(vnc_display_get_connection(self->vnc), n, encodings);
+#else
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    VirtViewerFile *file = virt_viewer_session_get_file(VIRT_VIEWER_SESSION(self));
+
+    if (virt_viewer_app_get_vnc_encodings(app) != NULL ||
+        (file != NULL && virt_viewer_file_is_set(file, "vnc-encodings")))
+        g_warning("The VNC encodings can't be set with this version of gtk-vnc");
+#endif
+}
+
+/* Called for each VncDisplay, before it connects */
+static void
+virt_viewer_session_vnc_apply_settings(VirtViewerSessionVnc *self)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+
+    vnc_display_set_shared_flag(self->vnc,
+                                virt_viewer_app_get_shared(app));
+    vnc_display_set_pointer_local(self->vnc,
+                                  virt_viewer_app_get_cursor(app) == VIRT_VIEWER_CURSOR_LOCAL);
+    vnc_display_set_depth(self->vnc, virt_viewer_session_vnc_get_depth(self));
+    vnc_display_set_lossy_encoding(self->vnc,
+                                   virt_viewer_session_vnc_get_lossy(self));
+}
+
+/* With --link-profile=auto, the profile is guessed from the duration of
+ * the handshake. It can't be sampled like with SPICE as gtk-vnc doesn't
+ * count the bytes received, and the depth of a new profile only applies
+ * from the next connection. */
+static void
+virt_viewer_session_vnc_guess_link_profile(VirtViewerSessionVnc *self, gint64 duration)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    gint64 latency = duration / HANDSHAKE_ROUND_TRIPS;
+    VirtViewerLinkProfile profile;
+
+    if (g_strcmp0(virt_viewer_app_get_link_profile(app), "auto") != 0)
+        return;
+
+    profile = virt_viewer_link_profile_from_latency(latency);
+    if (self->link_profile == profile)
+        return;
+
+    virt_viewer_app_trace(app, "Switching to the %s link profile (latency %.1f ms)",
+                          virt_viewer_link_profile_to_string(profile), latency / 1000.0);
+    self->link_profile = profile;
 }
 
 #ifdef HAVE_VNC_POWER_CONTROL
@@ -165,6 +399,8 @@ virt_viewer_session_vnc_connected(VncDisplay *vnc G_GNUC_UNUSED,
     VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
 
     self->auth_dialog_cancelled = FALSE;
+    self->handshake_start = g_get_monotonic_time();
+    virt_viewer_app_timing_mark(app, "vnc-connected");
 
     virt_viewer_window_set_display(virt_viewer_app_get_main_window(app),
                                    VIRT_VIEWER_DISPLAY(display));
@@ -207,6 +443,15 @@ static void
 virt_viewer_session_vnc_initialized(VncDisplay *vnc G_GNUC_UNUSED,
                                     VirtViewerSessionVnc *session)
 {
+    if (session->handshake_start > 0) {
+        virt_viewer_session_vnc_guess_link_profile(session,
+                                                   g_get_monotonic_time() - session->handshake_start);
+        session->handshake_start = 0;
+    }
+    virt_viewer_session_vnc_send_encodings(session);
+
+    virt_viewer_app_timing_mark(virt_viewer_session_get_app(VIRT_VIEWER_SESSION(session)),
+                                "vnc-initialized");
     g_signal_emit_by_name(session, "session-initialized");
 }
 
@@ -307,6 +552,7 @@ virt_viewer_session_vnc_open_uri(VirtViewerSession* session,
 
         if (!virt_viewer_file_fill_app(file, app, error))
             return FALSE;
+        virt_viewer_session_vnc_apply_settings(self);
     } else {
         xmlURIPtr uri = NULL;
         if (!(uri = xmlParseURI(uristr)))
@@ -385,11 +631,16 @@ virt_viewer_session_vnc_auth_credential(GtkWidget *src G_GNUC_UNUSED,
     }
 
     if (wantUsername || wantPassword) {
+        gint64 start = g_get_monotonic_time();
         gboolean ret = virt_viewer_auth_collect_credentials(self->auth,
                                                             "VNC", NULL,
                                                             wantUsername ? &username : NULL,
                                                             wantPassword ? &password : NULL);
 
+        /* the time taken by the user tells nothing about the link */
+        if (self->handshake_start > 0)
+            self->handshake_start += g_get_monotonic_time() - start;
+
         if (!ret) {
             vnc_display_close(self->vnc);
             self->auth_dialog_cancelled = TRUE;
@@ -458,6 +709,7 @@ virt_viewer_session_vnc_close(VirtViewerSession* session)
 
     self->vnc = VNC_DISPLAY(vnc_display_new());
     g_object_ref_sink(self->vnc);
+    virt_viewer_session_vnc_apply_settings(self);
 
     g_signal_connect_object(self->vnc, "vnc-connected",
                             G_CALLBACK(virt_viewer_session_vnc_connected), session, 0);
@@ -498,10 +750,7 @@ virt_viewer_session_vnc_new(VirtViewerApp *app, GtkWindow *main_window)
     self->main_window = g_object_ref(main_window);
     self->auth = virt_viewer_auth_new(self->main_window);
 
-    vnc_display_set_shared_flag(self->vnc,
-                                virt_viewer_app_get_shared(app));
-    vnc_display_set_pointer_local(self->vnc,
-                                  virt_viewer_app_get_cursor(app) == VIRT_VIEWER_CURSOR_LOCAL);
+    virt_viewer_session_vnc_apply_settings(self);
 
     g_signal_connect_object(self->vnc, "vnc-connected",
                             G_CALLBACK(virt_viewer_session_vnc_connected), self, 0);
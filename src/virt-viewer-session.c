@@ -43,8 +43,17 @@ struct _VirtViewerSessionPrivate
     gboolean share_folder;
     gchar *shared_folder;
     gboolean share_folder_ro;
+
+    guint monitor_geometry_id;
+    guint suppressed_geometry_updates;
+    gint64 link_max_area; /* lowered when the link is slow, 0 for none */
 };
 
+/* how long the displays sizes must be left unchanged before they are sent
+ * to the guest, so that resizing a window doesn't make it change its
+ * resolution continuously */
+#define MONITOR_GEOMETRY_SETTLE_DELAY 150 /* ms */
+
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE(VirtViewerSession, virt_viewer_session, G_TYPE_OBJECT)
 
 enum {
@@ -73,6 +82,9 @@ virt_viewer_session_finalize(GObject *obj)
     }
     g_list_free(priv->displays);
 
+    if (priv->monitor_geometry_id > 0)
+        g_source_remove(priv->monitor_geometry_id);
+
     g_free(priv->uri);
     g_clear_object(&priv->file);
     g_free(priv->shared_folder);
@@ -398,8 +410,7 @@ virt_viewer_session_init(VirtViewerSession *session G_GNUC_UNUSED)
 }
 
 static void
-virt_viewer_session_on_monitor_geometry_changed(VirtViewerSession* self,
-                                                VirtViewerDisplay* display G_GNUC_UNUSED)
+virt_viewer_session_apply_monitor_geometry(VirtViewerSession* self)
 {
     VirtViewerSessionPrivate *priv = virt_viewer_session_get_instance_private(self);
     VirtViewerSessionClass *klass;
@@ -439,6 +450,36 @@ virt_viewer_session_on_monitor_geometry_changed(VirtViewerSession* self,
         goto cleanup;
     }
 
+    if (priv->app != NULL) {
+        gint max_width, max_height;
+        gint64 max_area = virt_viewer_app_get_max_area(priv->app);
+
+        virt_viewer_app_get_max_resolution(priv->app, &max_width, &max_height);
+        if (priv->link_max_area > 0)
+            max_area = max_area > 0 ? MIN(max_area, priv->link_max_area) : priv->link_max_area;
+
+        /* the capped monitors would overlap otherwise */
+        if (virt_viewer_cap_monitors(monitors, max_width, max_height, max_area))
+            all_fullscreen = FALSE;
+    }
+
+    /* their windows keep the requested size when the guest takes the
+     * capped one */
+    for (l = priv->displays; l; l = l->next) {
+        VirtViewerDisplay *d = VIRT_VIEWER_DISPLAY(l->data);
+        GdkRectangle requested, *capped;
+        guint nth = 0;
+
+        if (VIRT_VIEWER_IS_DISPLAY_VTE(d))
+            continue;
+
+        g_object_get(d, "nth-display", &nth, NULL);
+        capped = g_hash_table_lookup(monitors, GINT_TO_POINTER(nth));
+        virt_viewer_display_get_preferred_monitor_geometry(d, &requested);
+        virt_viewer_display_set_capped_size(d, requested.width, requested.height,
+                                            capped->width, capped->height);
+    }
+
     if (!all_fullscreen)
         virt_viewer_align_monitors_linear(monitors);
 
@@ -450,6 +491,75 @@ cleanup:
     g_hash_table_unref(monitors);
 }
 
+static gboolean
+virt_viewer_session_monitor_geometry_settled(gpointer data)
+{
+    VirtViewerSession *self = data;
+    VirtViewerSessionPrivate *priv = virt_viewer_session_get_instance_private(self);
+
+    priv->monitor_geometry_id = 0;
+    g_debug("Displays geometry settled, %u updates suppressed so far",
+            priv->suppressed_geometry_updates);
+    virt_viewer_session_apply_monitor_geometry(self);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Only the layout the displays end up with is sent, once they stopped
+ * changing for MONITOR_GEOMETRY_SETTLE_DELAY */
+static void
+virt_viewer_session_on_monitor_geometry_changed(VirtViewerSession* self,
+                                                VirtViewerDisplay* display G_GNUC_UNUSED)
+{
+    VirtViewerSessionPrivate *priv = virt_viewer_session_get_instance_private(self);
+
+    if (priv->monitor_geometry_id > 0) {
+        g_source_remove(priv->monitor_geometry_id);
+        priv->suppressed_geometry_updates++;
+    }
+
+    priv->monitor_geometry_id = g_timeout_add(MONITOR_GEOMETRY_SETTLE_DELAY,
+                                              virt_viewer_session_monitor_geometry_settled,
+                                              self);
+}
+
+/* Number of displays geometry updates which were superseded by a later
+ * one before being sent to the guest */
+guint virt_viewer_session_get_suppressed_geometry_updates(VirtViewerSession *self)
+{
+    VirtViewerSessionPrivate *priv;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION(self), 0);
+    priv = virt_viewer_session_get_instance_private(self);
+
+    return priv->suppressed_geometry_updates;
+}
+
+/* Caps the total area of the guest displays below the one of the app, for a
+ * slow link, 0 for no cap */
+void virt_viewer_session_set_link_max_area(VirtViewerSession *self, gint64 area)
+{
+    VirtViewerSessionPrivate *priv;
+    GList *l;
+
+    g_return_if_fail(VIRT_VIEWER_IS_SESSION(self));
+    priv = virt_viewer_session_get_instance_private(self);
+
+    if (priv->link_max_area == area)
+        return;
+
+    g_debug("Capping the displays to %" G_GINT64_FORMAT " pixels for the link", area);
+    priv->link_max_area = area;
+
+    /* the guest resolution is left alone without auto-resize */
+    for (l = priv->displays; l; l = l->next) {
+        if (virt_viewer_display_get_auto_resize(VIRT_VIEWER_DISPLAY(l->data))) {
+            virt_viewer_session_update_displays_geometry(self);
+            break;
+        }
+    }
+}
+
 void virt_viewer_session_add_display(VirtViewerSession *session,
                                      VirtViewerDisplay *display)
 {
@@ -499,7 +609,16 @@ void virt_viewer_session_clear_displays(VirtViewerSession *session)
 
 void virt_viewer_session_update_displays_geometry(VirtViewerSession *session)
 {
-    virt_viewer_session_on_monitor_geometry_changed(session, NULL);
+    VirtViewerSessionPrivate *priv = virt_viewer_session_get_instance_private(session);
+
+    /* sent right away, including any pending change */
+    if (priv->monitor_geometry_id > 0) {
+        g_source_remove(priv->monitor_geometry_id);
+        priv->monitor_geometry_id = 0;
+        priv->suppressed_geometry_updates++;
+    }
+
+    virt_viewer_session_apply_monitor_geometry(session);
 }
 
 
@@ -720,6 +839,19 @@ gboolean virt_viewer_session_can_retry_auth(VirtViewerSession *self)
     return klass->can_retry_auth ? klass->can_retry_auth(self) : FALSE;
 }
 
+/* Whether the session can be opened again once closed, keeping its
+ * displays */
+gboolean virt_viewer_session_can_reconnect(VirtViewerSession *self)
+{
+    VirtViewerSessionClass *klass;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION(self), FALSE);
+
+    klass = VIRT_VIEWER_SESSION_GET_CLASS(self);
+
+    return klass->can_reconnect ? klass->can_reconnect(self) : FALSE;
+}
+
 void virt_viewer_session_vm_action(VirtViewerSession *self, gint action)
 {
     VirtViewerSessionClass *klass;
@@ -744,3 +876,17 @@ gboolean virt_viewer_session_has_vm_action(VirtViewerSession *self, gint action)
         return klass->has_vm_action(self, action);
     return FALSE;
 }
+
+/* Adds what the session measures, such as the bytes received per channel */
+void virt_viewer_session_add_benchmark_stats(VirtViewerSession *self, VirtViewerBenchmark *benchmark)
+{
+    VirtViewerSessionClass *klass;
+
+    g_return_if_fail(VIRT_VIEWER_IS_SESSION(self));
+    g_return_if_fail(benchmark != NULL);
+
+    klass = VIRT_VIEWER_SESSION_GET_CLASS(self);
+
+    if (klass->add_benchmark_stats)
+        klass->add_benchmark_stats(self, benchmark);
+}
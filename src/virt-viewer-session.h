@@ -28,6 +28,7 @@
 
 #include "virt-viewer-app.h"
 #include "virt-viewer-file.h"
+#include "virt-viewer-benchmark.h"
 #include "virt-viewer-display.h"
 
 #define VIRT_VIEWER_TYPE_SESSION virt_viewer_session_get_type()
@@ -67,8 +68,10 @@ struct _VirtViewerSessionClass {
     void (*apply_monitor_geometry)(VirtViewerSession *session, GHashTable* monitors);
     gboolean (*can_share_folder)(VirtViewerSession *session);
     gboolean (*can_retry_auth)(VirtViewerSession *session);
+    gboolean (*can_reconnect)(VirtViewerSession *session);
     void (*vm_action)(VirtViewerSession *session, gint action);
     gboolean (*has_vm_action)(VirtViewerSession *session, gint action);
+    void (*add_benchmark_stats)(VirtViewerSession *session, VirtViewerBenchmark *benchmark);
 };
 
 GType virt_viewer_session_get_type(void);
@@ -81,6 +84,8 @@ void virt_viewer_session_remove_display(VirtViewerSession *session,
                                         VirtViewerDisplay *display);
 void virt_viewer_session_clear_displays(VirtViewerSession *session);
 void virt_viewer_session_update_displays_geometry(VirtViewerSession *session);
+guint virt_viewer_session_get_suppressed_geometry_updates(VirtViewerSession *self);
+void virt_viewer_session_set_link_max_area(VirtViewerSession *self, gint64 area);
 
 void virt_viewer_session_close(VirtViewerSession* session);
 gboolean virt_viewer_session_open_fd(VirtViewerSession* session, int fd);
@@ -106,6 +111,8 @@ void virt_viewer_session_set_file(VirtViewerSession *self, VirtViewerFile *file)
 VirtViewerFile* virt_viewer_session_get_file(VirtViewerSession *self);
 gboolean virt_viewer_session_can_share_folder(VirtViewerSession *self);
 gboolean virt_viewer_session_can_retry_auth(VirtViewerSession *self);
+gboolean virt_viewer_session_can_reconnect(VirtViewerSession *self);
 
 void virt_viewer_session_vm_action(VirtViewerSession *self, gint action);
 gboolean virt_viewer_session_has_vm_action(VirtViewerSession *self, gint action);
+void virt_viewer_session_add_benchmark_stats(VirtViewerSession *self, VirtViewerBenchmark *benchmark);
@@ -0,0 +1,240 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <glib/gstdio.h>
+
+#include "virt-viewer-timing.h"
+
+/*
+ * Records when each phase of a connection attempt happened. An attempt
+ * begins with virt_viewer_timing_start(), phases outside of an attempt are
+ * ignored, and it ends with virt_viewer_timing_finish(), which returns it
+ * as a single line JSON object, such as:
+ *
+ * {"program":"remote-viewer","attempt":1,"start":1650000000123456,
+ *  "result":"ready","duration":812.340,
+ *  "phases":[{"phase":"initial-connect","time":0.000},...]}
+ *
+ * "start" is the wall clock time in microseconds since the epoch, the
+ * other times are milliseconds since the start of the attempt.
+ */
+
+typedef struct {
+    gchar *name;
+    gint64 time; /* monotonic */
+} VirtViewerTimingPhase;
+
+struct _VirtViewerTiming {
+    gchar *program;
+    guint attempt;
+    gint64 start; /* wall clock */
+    GArray *phases;
+};
+
+static void
+virt_viewer_timing_phase_clear(gpointer data)
+{
+    VirtViewerTimingPhase *phase = data;
+
+    g_free(phase->name);
+}
+
+VirtViewerTiming *
+virt_viewer_timing_new(const gchar *program)
+{
+    VirtViewerTiming *timing = g_new0(VirtViewerTiming, 1);
+
+    timing->program = g_strdup(program);
+    timing->phases = g_array_new(FALSE, FALSE, sizeof(VirtViewerTimingPhase));
+    g_array_set_clear_func(timing->phases, virt_viewer_timing_phase_clear);
+
+    return timing;
+}
+
+void
+virt_viewer_timing_free(VirtViewerTiming *timing)
+{
+    if (timing == NULL)
+        return;
+
+    g_array_unref(timing->phases);
+    g_free(timing->program);
+    g_free(timing);
+}
+
+gboolean
+virt_viewer_timing_is_started(VirtViewerTiming *timing)
+{
+    g_return_val_if_fail(timing != NULL, FALSE);
+
+    return timing->phases->len > 0;
+}
+
+/* @time is a g_get_monotonic_time() value */
+void
+virt_viewer_timing_mark_at(VirtViewerTiming *timing, const gchar *phase, gint64 time)
+{
+    VirtViewerTimingPhase p;
+
+    g_return_if_fail(timing != NULL);
+    g_return_if_fail(phase != NULL);
+
+    if (timing->phases->len == 0)
+        return;
+
+    p.name = g_strdup(phase);
+    p.time = time;
+    g_array_append_val(timing->phases, p);
+}
+
+void
+virt_viewer_timing_mark(VirtViewerTiming *timing, const gchar *phase)
+{
+    virt_viewer_timing_mark_at(timing, phase, g_get_monotonic_time());
+}
+
+/* Begins a new attempt with @phase, or marks @phase if one is going on */
+void
+virt_viewer_timing_start(VirtViewerTiming *timing, const gchar *phase)
+{
+    VirtViewerTimingPhase p;
+
+    g_return_if_fail(timing != NULL);
+    g_return_if_fail(phase != NULL);
+
+    if (timing->phases->len > 0) {
+        virt_viewer_timing_mark(timing, phase);
+        return;
+    }
+
+    timing->attempt++;
+    timing->start = g_get_real_time();
+    p.name = g_strdup(phase);
+    p.time = g_get_monotonic_time();
+    g_array_append_val(timing->phases, p);
+}
+
+void
+virt_viewer_timing_append_json_string(GString *json, const gchar *str)
+{
+    const gchar *p;
+
+    g_string_append_c(json, '"');
+    for (p = str; *p != '\0'; p++) {
+        switch (*p) {
+        case '"':
+            g_string_append(json, "\\\"");
+            break;
+        case '\\':
+            g_string_append(json, "\\\\");
+            break;
+        default:
+            if ((guchar)*p < 0x20)
+                g_string_append_printf(json, "\\u%04x", (guchar)*p);
+            else
+                g_string_append_c(json, *p);
+        }
+    }
+    g_string_append_c(json, '"');
+}
+
+/* milliseconds, with a '.' whatever the locale is */
+void
+virt_viewer_timing_append_json_ms(GString *json, gint64 usecs)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append(json, g_ascii_formatd(buf, sizeof(buf), "%.3f", usecs / 1000.0));
+}
+
+/*
+ * Ends the current attempt, @time being the monotonic time it ended at.
+ * Returns the JSON record of the attempt, or NULL if none was started.
+ */
+gchar *
+virt_viewer_timing_finish(VirtViewerTiming *timing, const gchar *result, gint64 time)
+{
+    VirtViewerTimingPhase *first;
+    GString *json;
+    guint i;
+
+    g_return_val_if_fail(timing != NULL, NULL);
+    g_return_val_if_fail(result != NULL, NULL);
+
+    if (timing->phases->len == 0)
+        return NULL;
+
+    first = &g_array_index(timing->phases, VirtViewerTimingPhase, 0);
+
+    json = g_string_new("{\"program\":");
+    virt_viewer_timing_append_json_string(json, timing->program ? timing->program : "");
+    g_string_append_printf(json, ",\"attempt\":%u,\"start\":%" G_GINT64_FORMAT
+                           ",\"result\":", timing->attempt, timing->start);
+    virt_viewer_timing_append_json_string(json, result);
+    g_string_append(json, ",\"duration\":");
+    virt_viewer_timing_append_json_ms(json, time - first->time);
+    g_string_append(json, ",\"phases\":[");
+    for (i = 0; i < timing->phases->len; i++) {
+        VirtViewerTimingPhase *phase = &g_array_index(timing->phases, VirtViewerTimingPhase, i);
+
+        if (i > 0)
+            g_string_append_c(json, ',');
+        g_string_append(json, "{\"phase\":");
+        virt_viewer_timing_append_json_string(json, phase->name);
+        g_string_append(json, ",\"time\":");
+        virt_viewer_timing_append_json_ms(json, phase->time - first->time);
+        g_string_append_c(json, '}');
+    }
+    g_string_append(json, "]}");
+
+    g_array_set_size(timing->phases, 0);
+
+    return g_string_free(json, FALSE);
+}
+
+/* Appends @record as a line of @filename, so that it holds one JSON object
+ * per connection attempt */
+gboolean
+virt_viewer_timing_append_to_file(const gchar *filename, const gchar *record, GError **error)
+{
+    FILE *file = g_fopen(filename, "a");
+    int err = 0;
+
+    if (file == NULL) {
+        err = errno;
+        goto error;
+    }
+
+    if (fprintf(file, "%s\n", record) < 0)
+        err = errno;
+    if (fclose(file) != 0 && err == 0)
+        err = errno;
+    if (err == 0)
+        return TRUE;
+
+error:
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err),
+                "Cannot write timing to %s: %s", filename, g_strerror(err));
+    return FALSE;
+}
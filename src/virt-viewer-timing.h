@@ -0,0 +1,38 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _VirtViewerTiming VirtViewerTiming;
+
+VirtViewerTiming *virt_viewer_timing_new(const gchar *program);
+void virt_viewer_timing_free(VirtViewerTiming *timing);
+
+gboolean virt_viewer_timing_is_started(VirtViewerTiming *timing);
+void virt_viewer_timing_start(VirtViewerTiming *timing, const gchar *phase);
+void virt_viewer_timing_mark_at(VirtViewerTiming *timing, const gchar *phase, gint64 time);
+void virt_viewer_timing_mark(VirtViewerTiming *timing, const gchar *phase);
+gchar *virt_viewer_timing_finish(VirtViewerTiming *timing, const gchar *result, gint64 time);
+gboolean virt_viewer_timing_append_to_file(const gchar *filename, const gchar *record, GError **error);
+
+void virt_viewer_timing_append_json_string(GString *json, const gchar *str);
+void virt_viewer_timing_append_json_ms(GString *json, gint64 usecs);
@@ -26,6 +26,7 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <locale.h>
+#include <math.h>
 
 #ifdef G_OS_WIN32
 #include <windows.h>
@@ -124,6 +125,160 @@ virt_viewer_util_extract_host(const char *uristr,
     return 0;
 }
 
+/* libvirt reports "-1" for ports which have not been allocated yet */
+static gchar *
+graphics_info_take_value(xmlChar *value)
+{
+    gchar *ret = NULL;
+
+    if (value && value[0] && !xmlStrEqual(value, BAD_CAST "-1"))
+        ret = g_strdup((const gchar *)value);
+
+    xmlFree(value);
+    return ret;
+}
+
+static void
+graphics_info_get_prop(xmlNodePtr node, const char *name, xmlChar **value)
+{
+    /* the first element carrying the attribute wins, like XPath string() */
+    if (*value == NULL)
+        *value = xmlGetProp(node, BAD_CAST name);
+}
+
+/**
+ * virt_viewer_util_extract_graphics_info:
+ * @xmldesc: a libvirt domain XML description
+ *
+ * Extracts the graphics connection details from @xmldesc with a single
+ * parse of the document. The graphics type is taken from the first
+ * <graphics> element, the other fields from the first <graphics> element
+ * of that type defining them. Both the <listen> child element and the
+ * older listen/socket attributes on <graphics> are handled, the former
+ * taking precedence.
+ *
+ * Returns: (transfer full) a #VirtViewerGraphicsInfo, or %NULL if @xmldesc
+ *  could not be parsed or has no graphics type. Free it with
+ *  virt_viewer_graphics_info_free().
+ */
+VirtViewerGraphicsInfo *
+virt_viewer_util_extract_graphics_info(const gchar *xmldesc)
+{
+    xmlDocPtr xml = NULL;
+    xmlParserCtxtPtr pctxt = NULL;
+    xmlNodePtr root, devices = NULL, node, child;
+    xmlChar *type = NULL;
+    xmlChar *port = NULL, *tls_port = NULL;
+    xmlChar *listen_address = NULL, *listen_attr = NULL;
+    xmlChar *listen_socket = NULL, *socket_attr = NULL;
+    VirtViewerGraphicsInfo *info = NULL;
+
+    g_return_val_if_fail(xmldesc != NULL, NULL);
+
+    pctxt = xmlNewParserCtxt();
+    if (!pctxt || !pctxt->sax)
+        goto cleanup;
+
+    xml = xmlCtxtReadDoc(pctxt, (const xmlChar *)xmldesc, "domain.xml", NULL,
+                         XML_PARSE_NOENT | XML_PARSE_NONET |
+                         XML_PARSE_NOWARNING);
+    if (!xml)
+        goto cleanup;
+
+    root = xmlDocGetRootElement(xml);
+    if (!root || !xmlStrEqual(root->name, BAD_CAST "domain"))
+        goto cleanup;
+
+    for (node = root->children; node; node = node->next) {
+        if (node->type == XML_ELEMENT_NODE &&
+            xmlStrEqual(node->name, BAD_CAST "devices")) {
+            devices = node;
+            break;
+        }
+    }
+    if (!devices)
+        goto cleanup;
+
+    for (node = devices->children; node; node = node->next) {
+        if (node->type != XML_ELEMENT_NODE ||
+            !xmlStrEqual(node->name, BAD_CAST "graphics"))
+            continue;
+
+        if (type == NULL) {
+            type = xmlGetProp(node, BAD_CAST "type");
+            if (type == NULL)
+                continue;
+        } else {
+            xmlChar *node_type = xmlGetProp(node, BAD_CAST "type");
+            gboolean same_type = xmlStrEqual(node_type, type);
+            xmlFree(node_type);
+            if (!same_type)
+                continue;
+        }
+
+        graphics_info_get_prop(node, "port", &port);
+        graphics_info_get_prop(node, "tlsPort", &tls_port);
+        graphics_info_get_prop(node, "listen", &listen_attr);
+        graphics_info_get_prop(node, "socket", &socket_attr);
+
+        for (child = node->children; child; child = child->next) {
+            if (child->type != XML_ELEMENT_NODE ||
+                !xmlStrEqual(child->name, BAD_CAST "listen"))
+                continue;
+            graphics_info_get_prop(child, "address", &listen_address);
+            graphics_info_get_prop(child, "socket", &listen_socket);
+        }
+    }
+
+    info = g_new0(VirtViewerGraphicsInfo, 1);
+    info->type = graphics_info_take_value(type);
+    type = NULL;
+    if (info->type == NULL) {
+        g_clear_pointer(&info, virt_viewer_graphics_info_free);
+        goto cleanup;
+    }
+
+    info->port = graphics_info_take_value(port);
+    info->tls_port = graphics_info_take_value(tls_port);
+    info->listen = graphics_info_take_value(listen_address);
+    if (info->listen == NULL)
+        info->listen = graphics_info_take_value(listen_attr);
+    else
+        xmlFree(listen_attr);
+    info->socket = graphics_info_take_value(listen_socket);
+    if (info->socket == NULL)
+        info->socket = graphics_info_take_value(socket_attr);
+    else
+        xmlFree(socket_attr);
+    port = tls_port = listen_address = listen_attr = listen_socket = socket_attr = NULL;
+
+ cleanup:
+    xmlFree(type);
+    xmlFree(port);
+    xmlFree(tls_port);
+    xmlFree(listen_address);
+    xmlFree(listen_attr);
+    xmlFree(listen_socket);
+    xmlFree(socket_attr);
+    xmlFreeDoc(xml);
+    xmlFreeParserCtxt(pctxt);
+    return info;
+}
+
+void
+virt_viewer_graphics_info_free(VirtViewerGraphicsInfo *info)
+{
+    if (info == NULL)
+        return;
+
+    g_free(info->type);
+    g_free(info->port);
+    g_free(info->tls_port);
+    g_free(info->listen);
+    g_free(info->socket);
+    g_free(info);
+}
+
 typedef struct {
     GObject *instance;
     GObject *observer;
@@ -769,6 +924,163 @@ virt_viewer_shift_monitors_to_origin(GHashTable *displays)
     }
 }
 
+static void
+scale_monitor(GdkRectangle *rect, gdouble scale)
+{
+    /* the widths are kept a multiple of 8, as most guest drivers want */
+    rect->width = MAX((gint)(rect->width * scale) & ~7, 8);
+    rect->height = MAX((gint)(rect->height * scale), 1);
+}
+
+/* Scales down the displays so that none is larger than @max_width x
+ * @max_height, and so that their total area is at most @max_area pixels,
+ * keeping their aspect ratio. The guest then renders, encodes and sends
+ * fewer pixels, and the client scales them up to its monitors. A limit of 0
+ * means none. Returns TRUE if any display was changed, their positions have
+ * to be aligned again then. */
+gboolean
+virt_viewer_cap_monitors(GHashTable *displays, gint max_width, gint max_height, gint64 max_area)
+{
+    GHashTableIter iter;
+    gpointer value;
+    gint64 area = 0;
+    gboolean capped = FALSE;
+
+    g_return_val_if_fail(displays != NULL, FALSE);
+
+    g_hash_table_iter_init(&iter, displays);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        GdkRectangle *rect = value;
+        gdouble scale = 1.0;
+
+        g_return_val_if_fail(rect != NULL, capped);
+        if (rect->width <= 0 || rect->height <= 0)
+            continue;
+
+        if (max_width > 0 && rect->width > max_width)
+            scale = (gdouble)max_width / rect->width;
+        if (max_height > 0 && rect->height > max_height)
+            scale = MIN(scale, (gdouble)max_height / rect->height);
+        if (scale < 1.0) {
+            g_debug("%s: Capping %dx%d by %.3f", G_STRFUNC, rect->width, rect->height, scale);
+            scale_monitor(rect, scale);
+            capped = TRUE;
+        }
+        area += (gint64)rect->width * rect->height;
+    }
+
+    if (max_area <= 0 || area <= max_area)
+        return capped;
+
+    g_debug("%s: Capping a total area of %" G_GINT64_FORMAT " pixels", G_STRFUNC, area);
+    g_hash_table_iter_init(&iter, displays);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        GdkRectangle *rect = value;
+
+        if (rect->width > 0 && rect->height > 0)
+            scale_monitor(rect, sqrt((gdouble)max_area / area));
+    }
+
+    return TRUE;
+}
+
+/* Whether the guest took the @capped_width x @capped_height size that
+ * virt_viewer_cap_monitors() made of the @requested_width x
+ * @requested_height one of a display. Its window then keeps the requested
+ * size and scales the desktop, shrinking to it would only ask for a
+ * smaller one next. */
+gboolean
+virt_viewer_desktop_is_capped(gint requested_width, gint requested_height,
+                              gint capped_width, gint capped_height,
+                              gint desktop_width, gint desktop_height)
+{
+    if (capped_width == requested_width && capped_height == requested_height)
+        return FALSE;
+
+    return desktop_width == capped_width && desktop_height == capped_height;
+}
+
+/* Parses a "WIDTHxHEIGHT" resolution, both positive */
+gboolean
+virt_viewer_parse_resolution(const gchar *str, gint *width, gint *height)
+{
+    gchar *end = NULL;
+    gint64 w, h;
+
+    g_return_val_if_fail(str != NULL, FALSE);
+
+    w = g_ascii_strtoll(str, &end, 10);
+    if (end == str || *end != 'x' || w <= 0 || w > G_MAXINT)
+        return FALSE;
+
+    str = end + 1;
+    h = g_ascii_strtoll(str, &end, 10);
+    if (end == str || *end != '\0' || h <= 0 || h > G_MAXINT)
+        return FALSE;
+
+    if (width)
+        *width = w;
+    if (height)
+        *height = h;
+    return TRUE;
+}
+
+/* The size of a @desktop_width x @desktop_height desktop shown unscaled in
+ * a @width x @height area, cut if the area is smaller */
+void
+virt_viewer_scale_desktop_off(gint desktop_width, gint desktop_height,
+                              gint width, gint height,
+                              gint *scaled_width, gint *scaled_height)
+{
+    *scaled_width = MIN(width, desktop_width);
+    *scaled_height = MIN(height, desktop_height);
+}
+
+/* The size of a @desktop_width x @desktop_height desktop zoomed in or out
+ * by the largest integer factor that fits a @width x @height area */
+void
+virt_viewer_scale_desktop_integer(gint desktop_width, gint desktop_height,
+                                  gint width, gint height,
+                                  gint *scaled_width, gint *scaled_height)
+{
+    gint factor;
+
+    g_return_if_fail(desktop_width > 0 && desktop_height > 0);
+    g_return_if_fail(width > 0 && height > 0);
+
+    factor = MIN(width / desktop_width, height / desktop_height);
+    if (factor >= 1) {
+        *scaled_width = desktop_width * factor;
+        *scaled_height = desktop_height * factor;
+        return;
+    }
+
+    /* the smallest divisor that makes it fit */
+    factor = MAX((desktop_width + width - 1) / width,
+                 (desktop_height + height - 1) / height);
+    *scaled_width = MAX(desktop_width / factor, 1);
+    *scaled_height = MAX(desktop_height / factor, 1);
+}
+
+/* Whether @scaled_width x @scaled_height is the desktop zoomed in or out
+ * by the same integer factor in both directions */
+gboolean
+virt_viewer_is_integer_scale(gint desktop_width, gint desktop_height,
+                             gint scaled_width, gint scaled_height)
+{
+    g_return_val_if_fail(desktop_width > 0 && desktop_height > 0, FALSE);
+    g_return_val_if_fail(scaled_width > 0 && scaled_height > 0, FALSE);
+
+    if (scaled_width >= desktop_width && scaled_height >= desktop_height)
+        return scaled_width % desktop_width == 0 &&
+            scaled_height % desktop_height == 0 &&
+            scaled_width / desktop_width == scaled_height / desktop_height;
+
+    return desktop_width % scaled_width == 0 &&
+        desktop_height % scaled_height == 0 &&
+        desktop_width / scaled_width == desktop_height / scaled_height;
+}
+
 /**
  * virt_viewer_parse_monitor_mappings:
  * @mappings: (array zero-terminated=1) values for the "monitor-mapping" key
@@ -47,6 +47,17 @@ int virt_viewer_util_extract_host(const char *uristr,
                                   char **user,
                                   int *port);
 
+typedef struct {
+    gchar *type;
+    gchar *port;
+    gchar *tls_port;
+    gchar *listen;
+    gchar *socket;
+} VirtViewerGraphicsInfo;
+
+VirtViewerGraphicsInfo *virt_viewer_util_extract_graphics_info(const gchar *xmldesc);
+void virt_viewer_graphics_info_free(VirtViewerGraphicsInfo *info);
+
 gulong virt_viewer_signal_connect_object(gpointer instance,
                                          const gchar *detailed_signal,
                                          GCallback c_handler,
@@ -60,6 +71,22 @@ gint virt_viewer_compare_buildid(const gchar *s1, const gchar *s2);
 /* monitor alignment */
 void virt_viewer_align_monitors_linear(GHashTable *displays);
 void virt_viewer_shift_monitors_to_origin(GHashTable *displays);
+gboolean virt_viewer_cap_monitors(GHashTable *displays, gint max_width, gint max_height,
+                                  gint64 max_area);
+gboolean virt_viewer_desktop_is_capped(gint requested_width, gint requested_height,
+                                       gint capped_width, gint capped_height,
+                                       gint desktop_width, gint desktop_height);
+gboolean virt_viewer_parse_resolution(const gchar *str, gint *width, gint *height);
+
+/* desktop scaling */
+void virt_viewer_scale_desktop_off(gint desktop_width, gint desktop_height,
+                                   gint width, gint height,
+                                   gint *scaled_width, gint *scaled_height);
+void virt_viewer_scale_desktop_integer(gint desktop_width, gint desktop_height,
+                                       gint width, gint height,
+                                       gint *scaled_width, gint *scaled_height);
+gboolean virt_viewer_is_integer_scale(gint desktop_width, gint desktop_height,
+                                      gint scaled_width, gint scaled_height);
 
 /* monitor mapping */
 GHashTable* virt_viewer_parse_monitor_mappings(gchar **mappings,
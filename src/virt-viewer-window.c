@@ -43,6 +43,8 @@
 #include "virt-viewer-util.h"
 #include "virt-viewer-timed-revealer.h"
 #include "virt-viewer-display-vte.h"
+#include "virt-viewer-screenshot.h"
+#include "virt-viewer-keymap.h"
 
 #include "remote-viewer-iso-list-dialog.h"
 
@@ -50,6 +52,8 @@
 
 /* Signal handlers for main window (move in a VirtViewerMainWindow?) */
 gboolean virt_viewer_window_delete(GtkWidget *src, void *dummy, VirtViewerWindow *self);
+gboolean virt_viewer_window_state_event(GtkWidget *src, GdkEventWindowState *event, VirtViewerWindow *self);
+gboolean virt_viewer_window_visibility_notify(GtkWidget *src, GdkEventVisibility *event, VirtViewerWindow *self);
 void virt_viewer_window_guest_details_response(GtkDialog *dialog, gint response_id, gpointer user_data);
 
 /* Internal methods */
@@ -90,12 +94,14 @@ struct _VirtViewerWindow {
     gint fullscreen_monitor;
     gboolean desktop_resize_pending;
     gboolean kiosk;
+    gboolean iconified;
+    gboolean obscured; /* only reported by X11 */
 
     gint zoomlevel;
     gboolean fullscreen;
     gchar *subtitle;
     gboolean initial_zoom_set;
-    VirtViewerKeyMapping *keyMappings;
+    VirtViewerKeymap *keymap;
 };
 
 G_DEFINE_TYPE(VirtViewerWindow, virt_viewer_window, G_TYPE_OBJECT)
@@ -147,8 +153,13 @@ virt_viewer_window_set_property (GObject *object, guint property_id,
         break;
 
     case PROP_KEYMAP:
-        g_free(self->keyMappings);
-        self->keyMappings = (VirtViewerKeyMapping *)g_value_get_pointer(value);
+        virt_viewer_keymap_unref(self->keymap);
+        self->keymap = g_value_get_pointer(value);
+        if (self->keymap) {
+            virt_viewer_keymap_ref(self->keymap);
+            virt_viewer_keymap_update_modifiers(self->keymap,
+                                                gdk_keymap_get_for_display(gtk_widget_get_display(self->window)));
+        }
         break;
 
     default:
@@ -188,12 +199,21 @@ virt_viewer_window_dispose (GObject *object)
 
     g_free(self->subtitle);
     self->subtitle = NULL;
+    g_clear_pointer(&self->keymap, virt_viewer_keymap_unref);
 
     g_value_unset(&self->accel_setting);
 
     G_OBJECT_CLASS (virt_viewer_window_parent_class)->dispose (object);
 }
 
+/* The keymap is shared by the windows, they all update it */
+static void
+virt_viewer_window_keys_changed(VirtViewerWindow *self, GdkKeymap *keymap)
+{
+    if (self->keymap)
+        virt_viewer_keymap_update_modifiers(self->keymap, keymap);
+}
+
 static void
 rebuild_combo_menu(GObject    *gobject G_GNUC_UNUSED,
                    GParamSpec *pspec G_GNUC_UNUSED,
@@ -406,6 +426,16 @@ virt_viewer_window_action_screenshot(GSimpleAction *act G_GNUC_UNUSED,
     virt_viewer_window_screenshot(VIRT_VIEWER_WINDOW(opaque));
 }
 
+static void
+virt_viewer_window_action_screenshot_all(GSimpleAction *act G_GNUC_UNUSED,
+                                         GVariant *param G_GNUC_UNUSED,
+                                         gpointer opaque)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_WINDOW(opaque));
+
+    virt_viewer_window_screenshot_all(VIRT_VIEWER_WINDOW(opaque));
+}
+
 static void
 virt_viewer_window_action_usb_device_select(GSimpleAction *act G_GNUC_UNUSED,
                                             GVariant *param G_GNUC_UNUSED,
@@ -504,6 +534,8 @@ static GActionEntry actions[] = {
       .activate = virt_viewer_window_action_send_key },
     { .name = "screenshot",
       .activate = virt_viewer_window_action_screenshot },
+    { .name = "screenshot-all",
+      .activate = virt_viewer_window_action_screenshot_all },
     { .name = "usb-device-select",
       .activate = virt_viewer_window_action_usb_device_select },
     { .name = "usb-device-reset",
@@ -554,6 +586,11 @@ virt_viewer_window_init (VirtViewerWindow *self)
 
     gtk_window_add_accel_group(GTK_WINDOW(self->window), self->accel_group);
 
+    virt_viewer_signal_connect_object(gdk_keymap_get_for_display(gtk_widget_get_display(self->window)),
+                                      "keys-changed",
+                                      G_CALLBACK(virt_viewer_window_keys_changed),
+                                      self, G_CONNECT_SWAPPED);
+
     menuBuilder =
         gtk_builder_new_from_resource(VIRT_VIEWER_RESOURCE_PREFIX "/ui/virt-viewer-menus.ui");
 
@@ -598,6 +635,10 @@ virt_viewer_window_desktop_resize(VirtViewerDisplay *display G_GNUC_UNUSED,
         self->desktop_resize_pending = TRUE;
         return;
     }
+    /* the window keeps the size the desktop was capped from, it would
+     * snap back to the capped one when enlarged otherwise */
+    if (self->display != NULL && virt_viewer_display_get_desktop_capped(self->display))
+        return;
     virt_viewer_window_queue_resize(self);
 }
 
@@ -993,6 +1034,40 @@ virt_viewer_window_delete(GtkWidget *src G_GNUC_UNUSED,
     return TRUE;
 }
 
+static void
+virt_viewer_window_update_hidden(VirtViewerWindow *self)
+{
+    if (self->display == NULL)
+        return;
+
+    virt_viewer_display_set_hidden(self->display, self->iconified || self->obscured);
+}
+
+G_MODULE_EXPORT gboolean
+virt_viewer_window_state_event(GtkWidget *src G_GNUC_UNUSED,
+                               GdkEventWindowState *event,
+                               VirtViewerWindow *self)
+{
+    if (event->changed_mask & GDK_WINDOW_STATE_ICONIFIED) {
+        self->iconified = !!(event->new_window_state & GDK_WINDOW_STATE_ICONIFIED);
+        g_debug("Window %s", self->iconified ? "minimized" : "restored");
+        virt_viewer_window_update_hidden(self);
+    }
+
+    return FALSE;
+}
+
+G_MODULE_EXPORT gboolean
+virt_viewer_window_visibility_notify(GtkWidget *src G_GNUC_UNUSED,
+                                     GdkEventVisibility *event,
+                                     VirtViewerWindow *self)
+{
+    self->obscured = event->state == GDK_VISIBILITY_FULLY_OBSCURED;
+    virt_viewer_window_update_hidden(self);
+
+    return FALSE;
+}
+
 
 static void
 virt_viewer_window_set_fullscreen(VirtViewerWindow *self,
@@ -1011,69 +1086,40 @@ virt_viewer_window_set_fullscreen(VirtViewerWindow *self,
 }
 
 
-static void add_if_writable (GdkPixbufFormat *data, GHashTable *formats)
-{
-    if (gdk_pixbuf_format_is_writable(data)) {
-        gchar **extensions;
-        gchar **it;
-        extensions = gdk_pixbuf_format_get_extensions(data);
-        for (it = extensions; *it != NULL; it++) {
-            g_hash_table_insert(formats, g_strdup(*it), data);
-        }
-        g_strfreev(extensions);
-    }
-}
-
-static GHashTable *init_image_formats(G_GNUC_UNUSED gpointer user_data)
-{
-    GHashTable *format_map;
-    GSList *formats = gdk_pixbuf_get_formats();
-
-    format_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-    g_slist_foreach(formats, (GFunc)add_if_writable, format_map);
-    g_slist_free (formats);
-
-    return format_map;
-}
-
-static GdkPixbufFormat *get_image_format(const char *filename)
+static void
+virt_viewer_window_screenshot_saved(GObject *source G_GNUC_UNUSED,
+                                    GAsyncResult *result,
+                                    gpointer opaque)
 {
-    static GOnce image_formats_once = G_ONCE_INIT;
-    const char *ext;
-
-    g_once(&image_formats_once, (GThreadFunc)init_image_formats, NULL);
+    VirtViewerWindow *self = opaque;
+    GError *error = NULL;
 
-    ext = strrchr(filename, '.');
-    if (ext == NULL)
-        return NULL;
-
-    ext++; /* skip '.' */
-
-    return g_hash_table_lookup(image_formats_once.retval, ext);
+    if (!virt_viewer_screenshot_save_finish(result, &error)) {
+        virt_viewer_app_simple_message_dialog(self->app,
+                                              "%s", error->message);
+        g_error_free(error);
+    }
+    g_object_unref(self);
 }
 
-static gboolean
+/* The frame is taken right away, the encoding is done in a thread */
+static void
 virt_viewer_window_save_screenshot(VirtViewerWindow *self,
-                                   const char *file,
-                                   GError **error)
+                                   const char *file)
 {
     GdkPixbuf *pix = virt_viewer_display_get_pixbuf(VIRT_VIEWER_DISPLAY(self->display));
-    GdkPixbufFormat *format = get_image_format(file);
-    gboolean result;
 
-    if (format == NULL) {
-        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                    _("Unable to determine image format for file '%s'"), file);
-        result = FALSE;
-    } else {
-        char *type = gdk_pixbuf_format_get_name(format);
-        g_debug("saving to %s", type);
-        result = gdk_pixbuf_save(pix, file, type, error, NULL);
-        g_free(type);
+    /* the display may have no frame yet */
+    if (pix == NULL) {
+        virt_viewer_app_simple_message_dialog(self->app,
+                                              _("Unable to take a screenshot of the display"));
+        return;
     }
 
+    virt_viewer_screenshot_save_async(pix, file, NULL,
+                                      virt_viewer_window_screenshot_saved,
+                                      g_object_ref(self));
     g_object_unref(pix);
-    return result;
 }
 
 void
@@ -1103,7 +1149,6 @@ virt_viewer_window_screenshot(VirtViewerWindow *self)
 retry_dialog:
     if (gtk_dialog_run(GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT) {
         char *filename;
-        GError *error = NULL;
 
         filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER (dialog));
         if (g_strrstr(filename, ".") == NULL) {
@@ -1118,17 +1163,97 @@ retry_dialog:
             goto retry_dialog;
         }
 
-        if (!virt_viewer_window_save_screenshot(self, filename, &error)) {
-            virt_viewer_app_simple_message_dialog(self->app,
-                                                  "%s", error->message);
-            g_error_free(error);
-        }
+        virt_viewer_window_save_screenshot(self, filename);
         g_free(filename);
     }
 
     gtk_widget_destroy(dialog);
 }
 
+void
+virt_viewer_window_screenshot_all(VirtViewerWindow *self)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_WINDOW(self));
+
+    GtkWidget *dialog;
+    const char *image_dir;
+
+    image_dir = virt_viewer_app_get_screenshot_dir(self->app);
+    if (image_dir != NULL) {
+        virt_viewer_app_save_screenshots(self->app, image_dir);
+        return;
+    }
+
+    dialog = gtk_file_chooser_dialog_new(_("Save screenshots of all displays"),
+                                         NULL,
+                                         GTK_FILE_CHOOSER_ACTION_SELECT_FOLDER,
+                                         _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                         _("_Save"), GTK_RESPONSE_ACCEPT,
+                                         NULL);
+    gtk_window_set_transient_for(GTK_WINDOW(dialog),
+                                 GTK_WINDOW(self->window));
+    image_dir = g_get_user_special_dir(G_USER_DIRECTORY_PICTURES);
+    if (image_dir != NULL)
+        gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER (dialog), image_dir);
+
+    if (gtk_dialog_run(GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT) {
+        char *dirname = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER (dialog));
+
+        virt_viewer_app_save_screenshots(self->app, dirname);
+        g_free(dirname);
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+
+typedef struct {
+    VirtViewerWindow *window;
+    GtkLabel *label;
+} VirtViewerWindowLatencyLabel;
+
+static void
+virt_viewer_window_latency_label_free(gpointer data)
+{
+    VirtViewerWindowLatencyLabel *latency_label = data;
+
+    g_object_unref(latency_label->window);
+    g_object_unref(latency_label->label);
+    g_free(latency_label);
+}
+
+/* the percentiles of the last inputs to the display of the window */
+static gboolean
+virt_viewer_window_update_latency_label(gpointer data)
+{
+    VirtViewerWindowLatencyLabel *latency_label = data;
+    VirtViewerDisplay *display = latency_label->window->display;
+    VirtViewerLatency *latency = display ? virt_viewer_display_get_input_latency(display) : NULL;
+    gint64 p50, p95, p99;
+    gchar *text;
+
+    if (latency && virt_viewer_latency_get_percentiles(latency, &p50, &p95, &p99)) {
+        text = g_strdup_printf(_("%.1f ms median, %.1f ms p95, %.1f ms p99 (last %u inputs)"),
+                               p50 / 1000.0, p95 / 1000.0, p99 / 1000.0,
+                               virt_viewer_latency_get_count(latency));
+    } else {
+        text = g_strdup(_("No input measured yet"));
+    }
+    gtk_label_set_text(latency_label->label, text);
+    g_free(text);
+
+    return G_SOURCE_CONTINUE;
+}
+
+/* When the dialog is closed, or destroyed by the window manager */
+static void
+virt_viewer_window_stop_latency_label(GtkWidget *dialog)
+{
+    guint id = GPOINTER_TO_UINT(g_object_steal_data(G_OBJECT(dialog), "virt-viewer-latency-source"));
+
+    if (id != 0)
+        g_source_remove(id);
+}
 
 void
 virt_viewer_window_show_guest_details(VirtViewerWindow *self)
@@ -1144,8 +1269,11 @@ virt_viewer_window_show_guest_details(VirtViewerWindow *self)
     GtkWidget *dialog = GTK_WIDGET(gtk_builder_get_object(ui, "guestdetailsdialog"));
     GtkWidget *namelabel = GTK_WIDGET(gtk_builder_get_object(ui, "namevaluelabel"));
     GtkWidget *guidlabel = GTK_WIDGET(gtk_builder_get_object(ui, "guidvaluelabel"));
+    GtkWidget *latencylabel = GTK_WIDGET(gtk_builder_get_object(ui, "latencyvaluelabel"));
+    VirtViewerWindowLatencyLabel *latency_label;
+    guint id;
 
-    g_return_if_fail(dialog && namelabel && guidlabel);
+    g_return_if_fail(dialog && namelabel && guidlabel && latencylabel);
 
     g_object_get(self->app, "guest-name", &name, "uuid", &uuid, NULL);
 
@@ -1165,6 +1293,18 @@ virt_viewer_window_show_guest_details(VirtViewerWindow *self)
 
     gtk_widget_show_all(dialog);
 
+    /* updated as long as the dialog is shown */
+    latency_label = g_new0(VirtViewerWindowLatencyLabel, 1);
+    latency_label->window = g_object_ref(self);
+    latency_label->label = GTK_LABEL(g_object_ref(latencylabel));
+    virt_viewer_window_update_latency_label(latency_label);
+    id = g_timeout_add_seconds_full(G_PRIORITY_DEFAULT, 1,
+                                    virt_viewer_window_update_latency_label,
+                                    latency_label, virt_viewer_window_latency_label_free);
+    g_object_set_data(G_OBJECT(dialog), "virt-viewer-latency-source", GUINT_TO_POINTER(id));
+    g_signal_connect(dialog, "hide", G_CALLBACK(virt_viewer_window_stop_latency_label), NULL);
+    g_signal_connect(dialog, "destroy", G_CALLBACK(virt_viewer_window_stop_latency_label), NULL);
+
     g_object_unref(G_OBJECT(ui));
 }
 
@@ -1458,7 +1598,7 @@ display_show_hint(VirtViewerDisplay *display,
 
 
 static gboolean
-window_key_pressed (GtkWidget *widget G_GNUC_UNUSED,
+window_key_pressed (GtkWidget *widget,
                     GdkEvent  *ev,
                    VirtViewerWindow *self)
 {
@@ -1468,34 +1608,24 @@ window_key_pressed (GtkWidget *widget G_GNUC_UNUSED,
     event = (GdkEventKey *)ev;
 
     gtk_widget_grab_focus(GTK_WIDGET(display));
+    virt_viewer_display_notify_input(display);
 
     // Look through keymaps - if set for mappings and intercept
-    if (self->keyMappings) {
-        VirtViewerKeyMapping *ptr, *matched;
-        ptr = self->keyMappings;
-        matched = NULL;
-        do {
-                if (event->keyval == ptr->sourceKey) {
-                        matched = ptr;
-                }
-                if (ptr->isLast) {
-                        break;
-                }
-                ptr++;
-        } while (matched == NULL);
-
-        if (matched) {
-                if (matched->mappedKeys == NULL) {
-                        // Key to be ignored and not pass through to VM
-                        g_debug("Blocking keypress '%s'", gdk_keyval_name(matched->sourceKey));
-                } else {
-                        g_debug("Sending through mapped keys");
-                        virt_viewer_display_send_keys(display,
-                                matched->mappedKeys, matched->numMappedKeys);
-                }
-                return TRUE;
+    if (self->keymap) {
+        const guint *keyvals;
+        guint nkeyvals;
+
+        if (virt_viewer_keymap_lookup(self->keymap, event->keyval, event->state,
+                                      &keyvals, &nkeyvals)) {
+            if (keyvals == NULL) {
+                // Key to be ignored and not pass through to VM
+                g_debug("Blocking keypress '%s'", gdk_keyval_name(event->keyval));
+            } else {
+                g_debug("Sending through mapped keys");
+                virt_viewer_display_send_keys(display, keyvals, nkeyvals);
+            }
+            return TRUE;
         }
-
     }
     g_debug("Key pressed was keycode='0x%x', gdk_keyname='%s'", event->keyval, gdk_keyval_name(event->keyval));
     return gtk_widget_event(GTK_WIDGET(display), ev);
@@ -1510,6 +1640,7 @@ virt_viewer_window_set_display(VirtViewerWindow *self, VirtViewerDisplay *displa
 
     if (self->display) {
         gtk_notebook_remove_page(GTK_NOTEBOOK(self->notebook), 1);
+        virt_viewer_display_set_hidden(self->display, FALSE);
         g_object_unref(self->display);
         self->display = NULL;
     }
@@ -1519,6 +1650,7 @@ virt_viewer_window_set_display(VirtViewerWindow *self, VirtViewerDisplay *displa
 
         virt_viewer_display_set_monitor(VIRT_VIEWER_DISPLAY(self->display), self->fullscreen_monitor);
         virt_viewer_display_set_fullscreen(VIRT_VIEWER_DISPLAY(self->display), self->fullscreen);
+        virt_viewer_window_update_hidden(self);
 
         gtk_widget_show_all(GTK_WIDGET(display));
         gtk_notebook_append_page(GTK_NOTEBOOK(self->notebook), GTK_WIDGET(display), NULL);
@@ -1575,6 +1707,11 @@ virt_viewer_window_show(VirtViewerWindow *self)
         self->desktop_resize_pending = FALSE;
     }
 
+    /* benchmarks run with the windows unmapped, which doesn't pause
+     * the displays as hiding them does */
+    if (virt_viewer_app_get_benchmark(self->app) > 0)
+        return;
+
     gtk_widget_show(self->window);
 
     if (self->fullscreen)
@@ -65,4 +65,5 @@ void virt_viewer_window_set_kiosk(VirtViewerWindow *self, gboolean enabled);
 void virt_viewer_window_show_about(VirtViewerWindow *self);
 void virt_viewer_window_show_guest_details(VirtViewerWindow *self);
 void virt_viewer_window_screenshot(VirtViewerWindow *self);
+void virt_viewer_window_screenshot_all(VirtViewerWindow *self);
 void virt_viewer_window_change_cd(VirtViewerWindow *self);
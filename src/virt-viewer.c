@@ -39,7 +39,6 @@
 #include <libvirt/libvirt.h>
 #include <libvirt/virterror.h>
 #include <libvirt-glib/libvirt-glib.h>
-#include <libxml/xpath.h>
 #include <libxml/uri.h>
 
 #ifndef G_OS_WIN32
@@ -56,27 +55,71 @@
 #include "virt-viewer-session-spice.h"
 #endif
 
+/*
+ * A connection attempt is a chain of libvirt calls, each made from a worker
+ * thread and followed up from the main loop when it returns, so that no
+ * main loop source runs in the middle of a step.
+ */
+typedef struct {
+    gboolean starting; /* from virt_viewer_start(), failing to open libvirt is fatal */
+    gboolean opened; /* the libvirt connection was opened by the attempt */
+    gboolean polled; /* made by the reconnection poll */
+    gboolean domain_started; /* the display of @dom is activated from its event */
+    int oflags;
+    gchar *error_message;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    gboolean has_uuid;
+    virDomainPtr dom;
+    char uuid_string[VIR_UUID_STRING_BUFLEN];
+    gboolean has_uuid_string;
+    char *title;
+    virDomainInfo info;
+    gboolean has_info;
+} VirtViewerConnectAttempt;
+
 struct _VirtViewer {
     VirtViewerApp parent;
     char *uri;
     virConnectPtr conn;
     virDomainPtr dom;
     char *domkey;
+    unsigned char uuid[VIR_UUID_BUFLEN]; /* domkey resolved, valid if has_uuid */
+    gboolean has_uuid;
     gboolean waitvm;
     gboolean reconnect;
     gboolean auth_cancelled;
+    VirtViewerConnectAttempt *attempt; /* in progress, or NULL */
+    gboolean connect_again; /* the guest started during the attempt */
     gint domain_event;
     guint reconnect_poll; /* source id */
+    gboolean reconnect_polling; /* the attempt of the last poll is running */
+    guint reconnect_delay; /* ms until the next poll */
+    guint reconnect_attempts;
+    gint64 reconnect_since; /* monotonic time the display went away, 0 if not waiting */
+    gint64 reconnect_time; /* duration of the last reconnection, in ms */
 };
 
 G_DEFINE_TYPE(VirtViewer, virt_viewer, VIRT_VIEWER_TYPE_APP)
 
+enum {
+    PROP_0,
+    PROP_RECONNECT_ATTEMPTS,
+    PROP_RECONNECT_TIME,
+};
+
+/* Polling intervals used when no libvirt event tells us the guest or the
+ * daemon is back. The interval doubles after each failed attempt, so that
+ * many viewers waiting on a restarting libvirtd don't flood it. */
+#define RECONNECT_DELAY_MIN 500 /* ms */
+#define RECONNECT_DELAY_MAX 30000 /* ms */
+
 static gboolean virt_viewer_initial_connect(VirtViewerApp *self, GError **error);
 static gboolean virt_viewer_open_connection(VirtViewerApp *self, int *fd);
 static void virt_viewer_deactivated(VirtViewerApp *self, gboolean connect_error);
 static gboolean virt_viewer_start(VirtViewerApp *self, GError **error);
 static void virt_viewer_dispose (GObject *object);
-static int virt_viewer_connect(VirtViewerApp *app, GError **error);
+static void virt_viewer_domain_started(VirtViewer *self, virDomainPtr dom);
+static void virt_viewer_conn_event(virConnectPtr conn, int reason, void *opaque);
 
 static gchar **opt_args = NULL;
 static gchar *opt_uri = NULL;
@@ -198,6 +241,7 @@ virt_viewer_local_command_line (GApplication   *gapp,
     virt_viewer_app_set_attach(app, opt_attach);
     virt_viewer_app_set_shared(app, opt_shared);
     self->reconnect = opt_reconnect;
+    virt_viewer_app_set_warm_reconnect(app, opt_reconnect);
     self->uri = g_strdup(opt_uri);
 
 end:
@@ -209,6 +253,26 @@ end:
     return ret;
 }
 
+static void
+virt_viewer_get_property(GObject *object, guint property_id,
+                         GValue *value, GParamSpec *pspec)
+{
+    VirtViewer *self = VIRT_VIEWER(object);
+
+    switch (property_id) {
+    case PROP_RECONNECT_ATTEMPTS:
+        g_value_set_uint(value, self->reconnect_attempts);
+        break;
+
+    case PROP_RECONNECT_TIME:
+        g_value_set_int64(value, self->reconnect_time);
+        break;
+
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+    }
+}
+
 static void
 virt_viewer_class_init (VirtViewerClass *klass)
 {
@@ -217,6 +281,7 @@ virt_viewer_class_init (VirtViewerClass *klass)
     GApplicationClass *g_app_class = G_APPLICATION_CLASS(klass);
 
     object_class->dispose = virt_viewer_dispose;
+    object_class->get_property = virt_viewer_get_property;
 
     app_class->initial_connect = virt_viewer_initial_connect;
     app_class->deactivated = virt_viewer_deactivated;
@@ -225,12 +290,81 @@ virt_viewer_class_init (VirtViewerClass *klass)
     app_class->add_option_entries = virt_viewer_add_option_entries;
 
     g_app_class->local_command_line = virt_viewer_local_command_line;
+
+    g_object_class_install_property(object_class,
+                                    PROP_RECONNECT_ATTEMPTS,
+                                    g_param_spec_uint("reconnect-attempts",
+                                                      "Reconnect attempts",
+                                                      "Attempts made by the last reconnection",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE |
+                                                      G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(object_class,
+                                    PROP_RECONNECT_TIME,
+                                    g_param_spec_int64("reconnect-time",
+                                                       "Reconnect time",
+                                                       "Duration of the last reconnection, in ms",
+                                                       -1, G_MAXINT64, -1,
+                                                       G_PARAM_READABLE |
+                                                       G_PARAM_STATIC_STRINGS));
 }
 
 static void
 virt_viewer_init(VirtViewer *self)
 {
     self->domain_event = -1;
+    self->reconnect_delay = RECONNECT_DELAY_MIN;
+    self->reconnect_time = -1;
+}
+
+/* Called whenever the guest display went away and we start waiting for it */
+static void
+virt_viewer_reconnect_begin(VirtViewer *self)
+{
+    if (self->reconnect_since != 0)
+        return;
+
+    self->reconnect_since = g_get_monotonic_time();
+    self->reconnect_attempts = 0;
+    self->reconnect_delay = RECONNECT_DELAY_MIN;
+}
+
+/* Called after each connection attempt, successful or not */
+static void
+virt_viewer_reconnect_update(VirtViewer *self)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+
+    if (self->reconnect_since == 0)
+        return;
+
+    self->reconnect_attempts++;
+    g_object_notify(G_OBJECT(self), "reconnect-attempts");
+
+    if (!virt_viewer_app_is_active(app))
+        return;
+
+    self->reconnect_time = (g_get_monotonic_time() - self->reconnect_since) / 1000;
+    self->reconnect_since = 0;
+    self->reconnect_delay = RECONNECT_DELAY_MIN;
+    g_object_notify(G_OBJECT(self), "reconnect-time");
+
+    virt_viewer_app_trace(app, "Guest %s reconnected after %u attempt(s) in %" G_GINT64_FORMAT " ms",
+                          self->domkey, self->reconnect_attempts, self->reconnect_time);
+}
+
+/* Returns the next polling interval, with up to 25% of random jitter so
+ * that viewers disconnected at the same time don't poll in lockstep */
+static guint
+virt_viewer_next_reconnect_delay(VirtViewer *self)
+{
+    guint delay = self->reconnect_delay;
+    gint jitter = delay / 4;
+
+    self->reconnect_delay = MIN(delay * 2, RECONNECT_DELAY_MAX);
+
+    return delay + g_random_int_range(-jitter, jitter + 1);
 }
 
 static gboolean
@@ -240,17 +374,54 @@ virt_viewer_connect_timer(void *opaque)
     VirtViewerApp *app = VIRT_VIEWER_APP(self);
 
     g_debug("Connect timer fired");
+    self->reconnect_poll = 0;
 
-    if (!virt_viewer_app_is_active(app) &&
-        !virt_viewer_app_initial_connect(app, NULL))
-        g_application_quit(G_APPLICATION(app));
+    /* Only keep the libvirt connection from the previous attempt if it is
+     * still usable, otherwise open a new one */
+    if (self->conn && virConnectIsAlive(self->conn) == 0) {
+        g_debug("libvirt connection is dead, reopening it");
+        virConnectUnregisterCloseCallback(self->conn, virt_viewer_conn_event);
+        virConnectClose(self->conn);
+        self->conn = NULL;
+        self->domain_event = -1;
+    }
 
     if (virt_viewer_app_is_active(app)) {
-        self->reconnect_poll = 0;
-        return FALSE;
+        virt_viewer_reconnect_update(self);
+        return G_SOURCE_REMOVE;
     }
 
-    return TRUE;
+    /* the next poll is scheduled once the attempt is over */
+    self->reconnect_polling = TRUE;
+    if (!virt_viewer_app_initial_connect(app, NULL))
+        g_application_quit(G_APPLICATION(app));
+    else if (self->attempt != NULL)
+        self->attempt->polled = TRUE;
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Called once the attempt made by a poll is over */
+static void
+virt_viewer_reconnect_poll_done(VirtViewer *self)
+{
+    guint delay;
+
+    virt_viewer_reconnect_update(self);
+
+    /* virt_viewer_stop_reconnect_poll() was called meanwhile, usually
+     * because domain events are now available to wait for the guest */
+    if (!self->reconnect_polling)
+        return;
+
+    self->reconnect_polling = FALSE;
+    if (virt_viewer_app_is_active(VIRT_VIEWER_APP(self)))
+        return;
+
+    delay = virt_viewer_next_reconnect_delay(self);
+    g_debug("Connection attempt %u failed, retrying in %u ms",
+            self->reconnect_attempts, delay);
+    self->reconnect_poll = g_timeout_add(delay, virt_viewer_connect_timer, self);
 }
 
 static void
@@ -258,10 +429,12 @@ virt_viewer_start_reconnect_poll(VirtViewer *self)
 {
     g_debug("reconnect_poll: %u", self->reconnect_poll);
 
-    if (self->reconnect_poll != 0)
+    if (self->reconnect_poll != 0 || self->reconnect_polling)
         return;
 
-    self->reconnect_poll = g_timeout_add(500, virt_viewer_connect_timer, self);
+    virt_viewer_reconnect_begin(self);
+    self->reconnect_poll = g_timeout_add(virt_viewer_next_reconnect_delay(self),
+                                         virt_viewer_connect_timer, self);
 }
 
 static void
@@ -269,6 +442,7 @@ virt_viewer_stop_reconnect_poll(VirtViewer *self)
 {
     g_debug("reconnect_poll: %u", self->reconnect_poll);
 
+    self->reconnect_polling = FALSE;
     if (self->reconnect_poll == 0)
         return;
 
@@ -287,6 +461,7 @@ virt_viewer_deactivated(VirtViewerApp *app, gboolean connect_error)
     }
 
     if (self->reconnect && !virt_viewer_app_get_session_cancelled(app)) {
+        virt_viewer_reconnect_begin(self);
         if (self->domain_event < 0) {
             g_debug("No domain events, falling back to polling");
             virt_viewer_start_reconnect_poll(self);
@@ -342,8 +517,9 @@ virt_viewer_parse_uuid(const char *name,
 }
 
 
+/* @uuid is the UUID domkey was resolved to, NULL if none */
 static virDomainPtr
-virt_viewer_lookup_domain(VirtViewer *self)
+virt_viewer_lookup_domain(VirtViewer *self, const unsigned char *uuid)
 {
     char *end;
     virDomainPtr dom = NULL;
@@ -352,6 +528,14 @@ virt_viewer_lookup_domain(VirtViewer *self)
         return NULL;
     }
 
+    /* the guest may have been recreated with a new UUID, in which case
+     * domkey is resolved again */
+    if (uuid != NULL) {
+        dom = virDomainLookupByUUID(self->conn, uuid);
+        if (dom != NULL)
+            return dom;
+    }
+
     if (domain_selection_type & DOMAIN_SELECTION_ID) {
         long int id = strtol(self->domkey, &end, 10);
         if (id >= 0 && end && !*end) {
@@ -360,9 +544,9 @@ virt_viewer_lookup_domain(VirtViewer *self)
     }
 
     if (domain_selection_type & DOMAIN_SELECTION_UUID) {
-        unsigned char uuid[16];
-        if (dom == NULL && virt_viewer_parse_uuid(self->domkey, uuid) == 0) {
-            dom = virDomainLookupByUUID(self->conn, uuid);
+        unsigned char wantuuid[16];
+        if (dom == NULL && virt_viewer_parse_uuid(self->domkey, wantuuid) == 0) {
+            dom = virDomainLookupByUUID(self->conn, wantuuid);
         }
     }
 
@@ -375,76 +559,51 @@ virt_viewer_lookup_domain(VirtViewer *self)
     return dom;
 }
 
+/* Remembers the UUID @dom has, so that domkey is only resolved once */
+static void
+virt_viewer_set_domain_uuid(VirtViewer *self,
+                            virDomainPtr dom)
+{
+    self->has_uuid = virDomainGetUUID(dom, self->uuid) == 0;
+}
+
 static int
 virt_viewer_matches_domain(VirtViewer *self,
                            virDomainPtr dom)
 {
     char *end;
     const char *name;
-    int id = strtol(self->domkey, &end, 10);
+    int id;
     unsigned char wantuuid[16];
     unsigned char domuuid[16];
 
+    if (self->has_uuid) {
+        return virDomainGetUUID(dom, domuuid) == 0 &&
+            memcmp(self->uuid, domuuid, VIR_UUID_BUFLEN) == 0;
+    }
+
+    id = strtol(self->domkey, &end, 10);
     if (id >= 0 && end && !*end) {
         if (virDomainGetID(dom) == id)
-            return 1;
+            goto matched;
     }
     if (virt_viewer_parse_uuid(self->domkey, wantuuid) == 0) {
         virDomainGetUUID(dom, domuuid);
         if (memcmp(wantuuid, domuuid, VIR_UUID_BUFLEN) == 0)
-            return 1;
+            goto matched;
     }
 
     name = virDomainGetName(dom);
     if (strcmp(name, self->domkey) == 0)
-        return 1;
+        goto matched;
 
     return 0;
-}
 
-static char *
-virt_viewer_extract_xpath_string(const gchar *xmldesc,
-                                 const gchar *xpath)
-{
-    xmlDocPtr xml = NULL;
-    xmlParserCtxtPtr pctxt = NULL;
-    xmlXPathContextPtr ctxt = NULL;
-    xmlXPathObjectPtr obj = NULL;
-    char *port = NULL;
-
-    pctxt = xmlNewParserCtxt();
-    if (!pctxt || !pctxt->sax)
-        goto error;
-
-    xml = xmlCtxtReadDoc(pctxt, (const xmlChar *)xmldesc, "domain.xml", NULL,
-                         XML_PARSE_NOENT | XML_PARSE_NONET |
-                         XML_PARSE_NOWARNING);
-    if (!xml)
-        goto error;
-
-    ctxt = xmlXPathNewContext(xml);
-    if (!ctxt)
-        goto error;
-
-    obj = xmlXPathEval((const xmlChar *)xpath, ctxt);
-    if (!obj || obj->type != XPATH_STRING || !obj->stringval || !obj->stringval[0])
-        goto error;
-    if (!strcmp((const char*)obj->stringval, "-1"))
-        goto error;
-
-    port = g_strdup((const char*)obj->stringval);
-    xmlXPathFreeObject(obj);
-    obj = NULL;
-
- error:
-    xmlXPathFreeObject(obj);
-    xmlXPathFreeContext(ctxt);
-    xmlFreeDoc(xml);
-    xmlFreeParserCtxt(pctxt);
-    return port;
+matched:
+    virt_viewer_set_domain_uuid(self, dom);
+    return 1;
 }
 
-
 static gboolean
 virt_viewer_replace_host(const gchar *host)
 {
@@ -516,15 +675,70 @@ virt_viewer_is_reachable(const gchar *host,
 }
 
 
+typedef gpointer (*VirtViewerThreadFunc)(VirtViewer *self, gpointer data);
+typedef void (*VirtViewerThreadDone)(VirtViewer *self, gpointer result, gpointer data);
+
+typedef struct {
+    VirtViewerThreadFunc func;
+    VirtViewerThreadDone done;
+    gpointer data;
+} VirtViewerThreadCall;
+
+static void
+virt_viewer_thread_call_run(GTask *task,
+                            gpointer source_object,
+                            gpointer task_data,
+                            GCancellable *cancellable G_GNUC_UNUSED)
+{
+    VirtViewerThreadCall *call = task_data;
+
+    g_task_return_pointer(task, call->func(VIRT_VIEWER(source_object), call->data), NULL);
+}
+
+static void
+virt_viewer_thread_call_done(GObject *source_object,
+                             GAsyncResult *res,
+                             gpointer user_data)
+{
+    VirtViewerThreadCall *call = user_data;
+    gpointer result = g_task_propagate_pointer(G_TASK(res), NULL);
+
+    call->done(VIRT_VIEWER(source_object), result, call->data);
+    g_free(call);
+}
+
+/*
+ * Runs @func in a worker thread, then @done with what it returned, from
+ * the main loop. libvirt calls can block for a long time on a remote or
+ * restarting daemon; this keeps the windows redrawn and lets credential
+ * prompts be answered in the meantime.
+ *
+ * libvirt errors are thread local, so @func must fetch them itself.
+ */
+static void
+virt_viewer_run_in_thread(VirtViewer *self,
+                          VirtViewerThreadFunc func,
+                          VirtViewerThreadDone done,
+                          gpointer data)
+{
+    VirtViewerThreadCall *call = g_new0(VirtViewerThreadCall, 1);
+    GTask *task = g_task_new(self, NULL, virt_viewer_thread_call_done, call);
+
+    call->func = func;
+    call->done = done;
+    call->data = data;
+    g_task_set_task_data(task, call, NULL);
+    g_task_run_in_thread(task, virt_viewer_thread_call_run);
+    g_object_unref(task);
+}
+
 static gboolean
 virt_viewer_extract_connect_info(VirtViewer *self,
-                                 virDomainPtr dom,
+                                 const char *xmldesc,
                                  GError **error)
 {
-    char *type = NULL;
-    char *xpath = NULL;
+    VirtViewerGraphicsInfo *graphics = NULL;
     gboolean retval = FALSE;
-    char *xmldesc = virDomainGetXMLDesc(dom, 0);
     VirtViewerApp *app = VIRT_VIEWER_APP(self);
     gchar *gport = NULL;
     gchar *gtlsport = NULL;
@@ -539,7 +753,8 @@ virt_viewer_extract_connect_info(VirtViewer *self,
 
     virt_viewer_app_free_connect_info(app);
 
-    if ((type = virt_viewer_extract_xpath_string(xmldesc, "string(/domain/devices/graphics/@type)")) == NULL) {
+    if (xmldesc == NULL ||
+        (graphics = virt_viewer_util_extract_graphics_info(xmldesc)) == NULL) {
         g_set_error(error,
                     VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
                     _("Cannot determine the graphic type for the guest %s"), self->domkey);
@@ -547,35 +762,17 @@ virt_viewer_extract_connect_info(VirtViewer *self,
         goto cleanup;
     }
 
-    if (!virt_viewer_app_create_session(app, type, error))
+    if (!virt_viewer_app_create_session(app, graphics->type, error))
         goto cleanup;
 
-    xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/@port)", type);
-    gport = virt_viewer_extract_xpath_string(xmldesc, xpath);
-    g_free(xpath);
-    if (g_str_equal(type, "spice")) {
-        xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/@tlsPort)", type);
-        gtlsport = virt_viewer_extract_xpath_string(xmldesc, xpath);
-        g_free(xpath);
-    }
+    gport = g_steal_pointer(&graphics->port);
+    if (g_str_equal(graphics->type, "spice"))
+        gtlsport = g_steal_pointer(&graphics->tls_port);
 
-    if (gport || gtlsport) {
-        xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/listen/@address)", type);
-        ghost = virt_viewer_extract_xpath_string(xmldesc, xpath);
-        if (ghost == NULL) { /* try old xml format - listen attribute in the graphics node */
-            g_free(xpath);
-            xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/@listen)", type);
-            ghost = virt_viewer_extract_xpath_string(xmldesc, xpath);
-        }
-    } else {
-        xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/listen/@socket)", type);
-        unixsock = virt_viewer_extract_xpath_string(xmldesc, xpath);
-        if (unixsock == NULL) { /* try old xml format - socket attribute in the graphics node */
-            g_free(xpath);
-            xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/@socket)", type);
-            unixsock = virt_viewer_extract_xpath_string(xmldesc, xpath);
-        }
-    }
+    if (gport || gtlsport)
+        ghost = g_steal_pointer(&graphics->listen);
+    else
+        unixsock = g_steal_pointer(&graphics->socket);
 
     if (ghost && gport) {
         g_debug("Guest graphics address is %s:%s", ghost, gport);
@@ -639,32 +836,11 @@ virt_viewer_extract_connect_info(VirtViewer *self,
     g_free(host);
     g_free(transport);
     g_free(user);
-    g_free(type);
-    g_free(xpath);
-    g_free(xmldesc);
+    virt_viewer_graphics_info_free(graphics);
     g_free(uri);
     return retval;
 }
 
-static gboolean
-virt_viewer_update_display(VirtViewer *self, virDomainPtr dom, GError **error)
-{
-    VirtViewerApp *app = VIRT_VIEWER_APP(self);
-
-    if (self->dom)
-        virDomainFree(self->dom);
-    self->dom = dom;
-    virDomainRef(self->dom);
-
-    virt_viewer_app_trace(app, "Guest %s is running, determining display",
-                          self->domkey);
-
-    if (virt_viewer_app_has_session(app))
-        return TRUE;
-
-    return virt_viewer_extract_connect_info(self, dom, error);
-}
-
 static gboolean
 virt_viewer_open_connection(VirtViewerApp *viewer, int *fd)
 {
@@ -716,7 +892,6 @@ virt_viewer_domain_event(virConnectPtr conn G_GNUC_UNUSED,
     VirtViewer *self = opaque;
     VirtViewerApp *app = VIRT_VIEWER_APP(self);
     VirtViewerSession *session;
-    GError *error = NULL;
 
     g_debug("Got domain event %d %d", event, detail);
 
@@ -724,7 +899,15 @@ virt_viewer_domain_event(virConnectPtr conn G_GNUC_UNUSED,
         return 0;
 
     switch (event) {
+    case VIR_DOMAIN_EVENT_UNDEFINED:
+        /* a guest defined later with the same name is a different one */
+        self->has_uuid = FALSE;
+        break;
+
     case VIR_DOMAIN_EVENT_STOPPED:
+        if (virDomainIsPersistent(dom) == 0)
+            self->has_uuid = FALSE;
+
         session = virt_viewer_app_get_session(app);
 #ifdef HAVE_SPICE_GTK
         /* do not disconnect due to migration */
@@ -738,19 +921,7 @@ virt_viewer_domain_event(virConnectPtr conn G_GNUC_UNUSED,
         break;
 
     case VIR_DOMAIN_EVENT_STARTED:
-        virt_viewer_update_display(self, dom, &error);
-        if (error) {
-            virt_viewer_app_simple_message_dialog(app, "%s", error->message);
-            g_clear_error(&error);
-        }
-
-        virt_viewer_app_activate(app, &error);
-        if (error) {
-            /* we may want to consolidate error reporting in
-               app_activate() instead */
-            g_warning("%s", error->message);
-            g_clear_error(&error);
-        }
+        virt_viewer_domain_started(self, dom);
         break;
     }
 
@@ -768,6 +939,8 @@ virt_viewer_conn_event(virConnectPtr conn G_GNUC_UNUSED,
 
     virConnectClose(self->conn);
     self->conn = NULL;
+    /* the event callbacks went away with the connection */
+    self->domain_event = -1;
 
     virt_viewer_start_reconnect_poll(self);
 }
@@ -799,14 +972,121 @@ virt_viewer_dispose (GObject *object)
     G_OBJECT_CLASS(virt_viewer_parent_class)->dispose (object);
 }
 
+/*
+ * libvirt has no call returning the metadata of several domains, so the
+ * chooser is shown as soon as the domains are listed and their titles, then
+ * their descriptions, are fetched from a worker thread and filled in as they
+ * arrive.
+ */
+typedef struct {
+    gint refs;
+    GCancellable *cancellable;
+    GtkListStore *model; /* not referenced, only used while not cancelled */
+    GtkTreeIter *iters;
+    virDomainPtr *domains;
+    guint ndomains;
+} VirtViewerDomainList;
+
+typedef struct {
+    VirtViewerDomainList *list;
+    guint index;
+    gint column;
+    char *value;
+} VirtViewerDomainListUpdate;
+
+static VirtViewerDomainList *
+virt_viewer_domain_list_ref(VirtViewerDomainList *list)
+{
+    g_atomic_int_inc(&list->refs);
+    return list;
+}
+
+static void
+virt_viewer_domain_list_unref(gpointer data)
+{
+    VirtViewerDomainList *list = data;
+    guint i;
+
+    if (!g_atomic_int_dec_and_test(&list->refs))
+        return;
+
+    for (i = 0; i < list->ndomains; i++)
+        virDomainFree(list->domains[i]);
+    g_free(list->domains);
+    g_free(list->iters);
+    g_object_unref(list->cancellable);
+    g_free(list);
+}
+
+static gboolean
+virt_viewer_domain_list_update(gpointer data)
+{
+    VirtViewerDomainListUpdate *update = data;
+    VirtViewerDomainList *list = update->list;
+
+    if (!g_cancellable_is_cancelled(list->cancellable))
+        gtk_list_store_set(list->model, &list->iters[update->index],
+                           update->column, update->value, -1);
+
+    virt_viewer_domain_list_unref(list);
+    free(update->value);
+    g_free(update);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+virt_viewer_domain_list_fetch_metadata(GTask *task,
+                                       gpointer source_object G_GNUC_UNUSED,
+                                       gpointer task_data,
+                                       GCancellable *cancellable)
+{
+    static const struct {
+        int type;
+        gint column;
+    } metadata[] = {
+        /* visible names first, tooltips afterwards */
+        { VIR_DOMAIN_METADATA_TITLE, 0 },
+        { VIR_DOMAIN_METADATA_DESCRIPTION, 2 },
+    };
+    VirtViewerDomainList *list = task_data;
+    guint i, j;
+
+    for (j = 0; j < G_N_ELEMENTS(metadata); j++) {
+        for (i = 0; i < list->ndomains; i++) {
+            VirtViewerDomainListUpdate *update;
+            char *value;
+
+            if (g_cancellable_is_cancelled(cancellable))
+                goto done;
+
+            value = virDomainGetMetadata(list->domains[i], metadata[j].type, NULL, 0);
+            if (value == NULL)
+                continue;
+
+            update = g_new0(VirtViewerDomainListUpdate, 1);
+            update->list = virt_viewer_domain_list_ref(list);
+            update->index = i;
+            update->column = metadata[j].column;
+            update->value = value;
+            g_main_context_invoke(NULL, virt_viewer_domain_list_update, update);
+        }
+    }
+
+done:
+    g_task_return_boolean(task, TRUE);
+}
+
 static virDomainPtr
 choose_vm(GtkWindow *main_window,
           char **vm_name,
           virConnectPtr conn,
+          const gchar *filter,
           GError **error)
 {
     GtkListStore *model;
-    GtkTreeIter iter;
+    VirtViewerDomainList *list;
+    GTask *task;
     virDomainPtr *domains, dom = NULL;
     int i, vms_running;
     unsigned int flags = VIR_CONNECT_LIST_DOMAINS_RUNNING;
@@ -817,24 +1097,42 @@ choose_vm(GtkWindow *main_window,
                                /* UI name      , key          , tooltip */
     model = gtk_list_store_new(3, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
 
+    list = g_new0(VirtViewerDomainList, 1);
+    list->refs = 1;
+    list->cancellable = g_cancellable_new();
+    list->model = model;
+
     vms_running = virConnectListAllDomains(conn, &domains, flags);
+    if (vms_running > 0) {
+        list->domains = g_new0(virDomainPtr, vms_running);
+        list->iters = g_new0(GtkTreeIter, vms_running);
+    }
     for (i = 0; i < vms_running; i++) {
         const char *name = virDomainGetName(domains[i]);
-        char *title = virDomainGetMetadata(domains[i], VIR_DOMAIN_METADATA_TITLE, NULL, 0);
-        char *description = virDomainGetMetadata(domains[i], VIR_DOMAIN_METADATA_DESCRIPTION, NULL, 0);
-        gtk_list_store_append(model, &iter);
-        gtk_list_store_set(model, &iter, 0, title ? title : name, 1, name, -1);
-        if (description)
-            gtk_list_store_set(model, &iter, 2, description, -1);
-        virDomainFree(domains[i]);
-        free(title);
-        free(description);
+
+        if (filter && !g_pattern_match_simple(filter, name)) {
+            virDomainFree(domains[i]);
+            continue;
+        }
+
+        gtk_list_store_append(model, &list->iters[list->ndomains]);
+        gtk_list_store_set(model, &list->iters[list->ndomains], 0, name, 1, name, -1);
+        list->domains[list->ndomains++] = domains[i];
     }
     free(domains);
 
+    g_debug("Fetching metadata of %u domain(s)", list->ndomains);
+    task = g_task_new(NULL, list->cancellable, NULL, NULL);
+    g_task_set_task_data(task, virt_viewer_domain_list_ref(list),
+                         virt_viewer_domain_list_unref);
+    g_task_run_in_thread(task, virt_viewer_domain_list_fetch_metadata);
+    g_object_unref(task);
+
     *vm_name = virt_viewer_vm_connection_choose_name_dialog(main_window,
                                                             GTK_TREE_MODEL(model),
                                                             error);
+    g_cancellable_cancel(list->cancellable);
+    virt_viewer_domain_list_unref(list);
     g_object_unref(G_OBJECT(model));
     if (*vm_name == NULL)
         return NULL;
@@ -856,95 +1154,6 @@ choose_vm(GtkWindow *main_window,
     return dom;
 }
 
-static gboolean
-virt_viewer_initial_connect(VirtViewerApp *app, GError **error)
-{
-    virDomainPtr dom = NULL;
-    virDomainInfo info;
-    gboolean ret = FALSE;
-    VirtViewer *self = VIRT_VIEWER(app);
-    char uuid_string[VIR_UUID_STRING_BUFLEN];
-    const char *guest_name;
-    char *title;
-    GError *err = NULL;
-
-    g_debug("initial connect");
-
-    if (!self->conn &&
-        virt_viewer_connect(app, &err) < 0) {
-        virt_viewer_app_show_status(app, _("Waiting for libvirt to start"));
-        goto wait;
-    }
-
-    virt_viewer_app_show_status(app, _("Finding guest domain"));
-    dom = virt_viewer_lookup_domain(self);
-    if (!dom) {
-        if (self->waitvm) {
-            virt_viewer_app_show_status(app, _("Waiting for guest domain to be created"));
-            goto wait;
-        } else {
-            VirtViewerWindow *main_window = virt_viewer_app_get_main_window(app);
-            if (self->domkey != NULL)
-                g_debug("Cannot find guest %s", self->domkey);
-            dom = choose_vm(virt_viewer_window_get_window(main_window),
-                            &self->domkey,
-                            self->conn,
-                            &err);
-            if (dom == NULL) {
-                goto cleanup;
-            }
-        }
-    }
-
-    if (virDomainGetUUIDString(dom, uuid_string) < 0) {
-        g_debug("Couldn't get uuid from libvirt");
-    } else {
-        g_object_set(app, "uuid", uuid_string, NULL);
-    }
-    guest_name = virDomainGetName(dom);
-    if (guest_name != NULL) {
-        g_object_set(app, "guest-name", guest_name, NULL);
-    }
-
-    title = virDomainGetMetadata(dom, VIR_DOMAIN_METADATA_TITLE, NULL, 0);
-    if (title != NULL) {
-        g_object_set(app, "title", title, NULL);
-        free(title);
-    }
-
-    virt_viewer_app_show_status(app, _("Checking guest domain status"));
-    if (virDomainGetInfo(dom, &info) < 0) {
-        g_set_error_literal(&err, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                            _("Cannot get guest state"));
-        g_debug("%s", err->message);
-        goto cleanup;
-    }
-
-    if (info.state == VIR_DOMAIN_SHUTOFF) {
-        virt_viewer_app_show_status(app, _("Waiting for guest domain to start"));
-        goto wait;
-    }
-
-    if (!virt_viewer_update_display(self, dom, &err))
-        goto cleanup;
-
-    ret = VIRT_VIEWER_APP_CLASS(virt_viewer_parent_class)->initial_connect(app, &err);
-    if (ret || err)
-        goto cleanup;
-
-wait:
-    virt_viewer_app_trace(app, "Guest %s has not activated its display yet, waiting "
-                          "for it to start", self->domkey);
-    ret = TRUE;
-
-cleanup:
-    if (err != NULL)
-        g_propagate_error(error, err);
-    if (dom)
-        virDomainFree(dom);
-    return ret;
-}
-
 static void
 virt_viewer_error_func (void *data G_GNUC_UNUSED,
                         virErrorPtr error G_GNUC_UNUSED)
@@ -955,12 +1164,11 @@ virt_viewer_error_func (void *data G_GNUC_UNUSED,
 
 
 static int
-virt_viewer_auth_libvirt_credentials(virConnectCredentialPtr cred,
-                                     unsigned int ncred,
-                                     void *cbdata)
+virt_viewer_auth_libvirt_prompt(virConnectCredentialPtr cred,
+                                unsigned int ncred,
+                                VirtViewer *self)
 {
     char **username = NULL, **password = NULL;
-    VirtViewer *self = cbdata;
     int i;
     int ret = 0;
 
@@ -1029,6 +1237,65 @@ virt_viewer_auth_libvirt_credentials(virConnectCredentialPtr cred,
     return ret;
 }
 
+typedef struct {
+    VirtViewer *self;
+    virConnectCredentialPtr cred;
+    unsigned int ncred;
+    int ret;
+    gboolean done;
+    GMutex lock;
+    GCond cond;
+} VirtViewerAuthRequest;
+
+static gboolean
+virt_viewer_auth_libvirt_prompt_idle(gpointer opaque)
+{
+    VirtViewerAuthRequest *req = opaque;
+    int ret = virt_viewer_auth_libvirt_prompt(req->cred, req->ncred, req->self);
+
+    g_mutex_lock(&req->lock);
+    req->ret = ret;
+    req->done = TRUE;
+    g_cond_signal(&req->cond);
+    g_mutex_unlock(&req->lock);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* The connection is opened from a worker thread, the dialog has to be run
+ * from the main one */
+static int
+virt_viewer_auth_libvirt_credentials(virConnectCredentialPtr cred,
+                                     unsigned int ncred,
+                                     void *cbdata)
+{
+    VirtViewerAuthRequest req = {
+        .self = cbdata,
+        .cred = cred,
+        .ncred = ncred,
+        .ret = -1,
+        .done = FALSE,
+    };
+
+    if (g_main_context_is_owner(g_main_context_default()))
+        return virt_viewer_auth_libvirt_prompt(cred, ncred, cbdata);
+
+    g_mutex_init(&req.lock);
+    g_cond_init(&req.cond);
+
+    g_main_context_invoke(NULL, virt_viewer_auth_libvirt_prompt_idle, &req);
+
+    g_mutex_lock(&req.lock);
+    while (!req.done)
+        g_cond_wait(&req.cond, &req.lock);
+    g_mutex_unlock(&req.lock);
+
+    g_cond_clear(&req.cond);
+    g_mutex_clear(&req.lock);
+
+    return req.ret;
+}
+
 static gchar *
 virt_viewer_get_error_message_from_vir_error(VirtViewer *self,
                                              virErrorPtr error)
@@ -1058,53 +1325,45 @@ virt_viewer_get_error_message_from_vir_error(VirtViewer *self,
     return error_message;
 }
 
-static int
-virt_viewer_connect(VirtViewerApp *app, GError **err)
+static void
+virt_viewer_connect_attempt_free(VirtViewerConnectAttempt *attempt)
 {
-    VirtViewer *self = VIRT_VIEWER(app);
+    if (attempt->dom)
+        virDomainFree(attempt->dom);
+    free(attempt->title);
+    g_free(attempt->error_message);
+    g_free(attempt);
+}
+
+static gpointer
+virt_viewer_open_thread(VirtViewer *self, gpointer data)
+{
+    VirtViewerConnectAttempt *attempt = data;
     int cred_types[] =
         { VIR_CRED_AUTHNAME, VIR_CRED_PASSPHRASE };
     virConnectAuth auth_libvirt = {
         .credtype = cred_types,
         .ncredtype = G_N_ELEMENTS(cred_types),
         .cb = virt_viewer_auth_libvirt_credentials,
-        .cbdata = app,
+        .cbdata = self,
     };
-    int oflags = 0;
-    GError *error = NULL;
-
-    if (!virt_viewer_app_get_attach(app))
-        oflags |= VIR_CONNECT_RO;
-
-    g_debug("connecting ...");
+    virConnectPtr conn;
 
-    virt_viewer_app_trace(app, "Opening connection to libvirt with URI %s",
-                          self->uri ? self->uri : "<null>");
-    self->conn = virConnectOpenAuth(self->uri,
-                                    //virConnectAuthPtrDefault,
-                                    &auth_libvirt,
-                                    oflags);
-    if (!self->conn) {
-        if (!self->auth_cancelled) {
-            gchar *error_message = virt_viewer_get_error_message_from_vir_error(self, virGetLastError());
-            g_set_error_literal(&error,
-                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                                error_message);
+    conn = virConnectOpenAuth(self->uri,
+                              //virConnectAuthPtrDefault,
+                              &auth_libvirt,
+                              attempt->oflags);
+    if (!conn && !self->auth_cancelled)
+        attempt->error_message = virt_viewer_get_error_message_from_vir_error(self, virGetLastError());
 
-            g_free(error_message);
-        } else {
-            g_set_error_literal(&error,
-                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED,
-                                _("Authentication was cancelled"));
-        }
-        g_propagate_error(err, error);
-        return -1;
-    }
+    return conn;
+}
 
-    if (!virt_viewer_app_initial_connect(app, &error)) {
-        g_propagate_prefixed_error(err, error, _("Failed to connect: "));
-        return -1;
-    }
+/* Watches the libvirt connection opened by the attempt */
+static void
+virt_viewer_connect_setup(VirtViewer *self)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
 
     self->domain_event = virConnectDomainEventRegisterAny(self->conn,
                                                           self->dom,
@@ -1132,8 +1391,382 @@ virt_viewer_connect(VirtViewerApp *app, GError **err)
     if (virConnectSetKeepAlive(self->conn, 5, 3) < 0) {
         g_debug("Unable to set keep alive");
     }
+}
 
-    return 0;
+/* Goes on with what waited for the attempt, which is over */
+static void
+virt_viewer_connect_attempt_end(VirtViewer *self)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    VirtViewerConnectAttempt *attempt = self->attempt;
+    gboolean polled = attempt->polled;
+
+    self->attempt = NULL;
+    virt_viewer_connect_attempt_free(attempt);
+
+    if (polled)
+        virt_viewer_reconnect_poll_done(self);
+
+    if (self->connect_again) {
+        self->connect_again = FALSE;
+        if (!virt_viewer_app_is_active(app))
+            virt_viewer_app_initial_connect(app, NULL);
+    }
+}
+
+/* Ends the attempt, a failure quits as it did when it was synchronous */
+static void
+virt_viewer_connect_attempt_finish(VirtViewer *self, gboolean ret, GError *error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+
+    if (ret) {
+        if (self->attempt->opened)
+            virt_viewer_connect_setup(self);
+        g_clear_error(&error);
+        virt_viewer_connect_attempt_end(self);
+        return;
+    }
+
+    virt_viewer_app_timing_finish(app, "failed");
+    if (error != NULL && self->attempt->opened)
+        g_prefix_error(&error, _("Failed to connect: "));
+    if (error != NULL && !g_error_matches(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED))
+        virt_viewer_app_simple_message_dialog(app, "%s", error->message);
+    g_clear_error(&error);
+
+    virt_viewer_connect_attempt_free(self->attempt);
+    self->attempt = NULL;
+    self->connect_again = FALSE;
+    g_application_quit(G_APPLICATION(app));
+}
+
+/* The guest display is not there yet, the next poll or domain event makes
+ * another attempt */
+static void
+virt_viewer_connect_attempt_wait(VirtViewer *self)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+
+    virt_viewer_app_timing_finish(app, "waiting");
+    virt_viewer_app_trace(app, "Guest %s has not activated its display yet, waiting "
+                          "for it to start", self->domkey);
+    virt_viewer_connect_attempt_finish(self, TRUE, NULL);
+}
+
+static void
+virt_viewer_domain_started_done(VirtViewer *self, GError *error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+
+    if (error) {
+        virt_viewer_app_simple_message_dialog(app, "%s", error->message);
+        g_clear_error(&error);
+    }
+
+    virt_viewer_app_activate(app, &error);
+    if (error) {
+        /* we may want to consolidate error reporting in
+           app_activate() instead */
+        g_warning("%s", error->message);
+        g_clear_error(&error);
+    }
+    virt_viewer_reconnect_update(self);
+    virt_viewer_connect_attempt_end(self);
+}
+
+/* The display of the guest is known, unless @error tells why */
+static void
+virt_viewer_connect_display_ready(VirtViewer *self, GError *error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    gboolean ret;
+
+    if (self->attempt->domain_started) {
+        virt_viewer_domain_started_done(self, error);
+        return;
+    }
+
+    if (error != NULL) {
+        virt_viewer_connect_attempt_finish(self, FALSE, error);
+        return;
+    }
+    virt_viewer_app_timing_mark(app, "graphics-info");
+
+    ret = VIRT_VIEWER_APP_CLASS(virt_viewer_parent_class)->initial_connect(app, &error);
+    if (ret || error) {
+        virt_viewer_connect_attempt_finish(self, ret, error);
+        return;
+    }
+
+    virt_viewer_connect_attempt_wait(self);
+}
+
+static gpointer
+virt_viewer_get_xml_desc_thread(VirtViewer *self G_GNUC_UNUSED, gpointer data)
+{
+    VirtViewerConnectAttempt *attempt = data;
+
+    return virDomainGetXMLDesc(attempt->dom, 0);
+}
+
+static void
+virt_viewer_get_xml_desc_done(VirtViewer *self, gpointer result, gpointer data G_GNUC_UNUSED)
+{
+    char *xmldesc = result;
+    GError *error = NULL;
+
+    virt_viewer_extract_connect_info(self, xmldesc, &error);
+    g_free(xmldesc);
+    virt_viewer_connect_display_ready(self, error);
+}
+
+/* The guest of the attempt is running, its display is looked up */
+static void
+virt_viewer_update_display(VirtViewer *self)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    VirtViewerConnectAttempt *attempt = self->attempt;
+
+    if (self->dom)
+        virDomainFree(self->dom);
+    self->dom = attempt->dom;
+    virDomainRef(self->dom);
+
+    virt_viewer_app_trace(app, "Guest %s is running, determining display",
+                          self->domkey);
+
+    if (virt_viewer_app_has_session(app)) {
+        virt_viewer_connect_display_ready(self, NULL);
+        return;
+    }
+
+    virt_viewer_run_in_thread(self, virt_viewer_get_xml_desc_thread,
+                              virt_viewer_get_xml_desc_done, attempt);
+}
+
+static gpointer
+virt_viewer_get_domain_details_thread(VirtViewer *self G_GNUC_UNUSED, gpointer data)
+{
+    VirtViewerConnectAttempt *attempt = data;
+
+    attempt->has_uuid_string = virDomainGetUUIDString(attempt->dom, attempt->uuid_string) == 0;
+    attempt->title = virDomainGetMetadata(attempt->dom, VIR_DOMAIN_METADATA_TITLE, NULL, 0);
+    attempt->has_info = virDomainGetInfo(attempt->dom, &attempt->info) == 0;
+
+    return NULL;
+}
+
+static void
+virt_viewer_get_domain_details_done(VirtViewer *self,
+                                    gpointer result G_GNUC_UNUSED,
+                                    gpointer data)
+{
+    VirtViewerConnectAttempt *attempt = data;
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    const char *guest_name;
+    GError *error = NULL;
+
+    virt_viewer_app_timing_mark(app, "domain-details");
+
+    if (!attempt->has_uuid_string) {
+        g_debug("Couldn't get uuid from libvirt");
+    } else {
+        g_object_set(app, "uuid", attempt->uuid_string, NULL);
+    }
+    guest_name = virDomainGetName(attempt->dom);
+    if (guest_name != NULL) {
+        g_object_set(app, "guest-name", guest_name, NULL);
+    }
+
+    if (attempt->title != NULL) {
+        g_object_set(app, "title", attempt->title, NULL);
+    }
+
+    if (!attempt->has_info) {
+        g_set_error_literal(&error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("Cannot get guest state"));
+        g_debug("%s", error->message);
+        virt_viewer_connect_attempt_finish(self, FALSE, error);
+        return;
+    }
+
+    if (attempt->info.state == VIR_DOMAIN_SHUTOFF) {
+        virt_viewer_app_show_status(app, _("Waiting for guest domain to start"));
+        virt_viewer_connect_attempt_wait(self);
+        return;
+    }
+
+    virt_viewer_update_display(self);
+}
+
+static gpointer
+virt_viewer_lookup_domain_thread(VirtViewer *self, gpointer data)
+{
+    VirtViewerConnectAttempt *attempt = data;
+
+    return virt_viewer_lookup_domain(self, attempt->has_uuid ? attempt->uuid : NULL);
+}
+
+static void
+virt_viewer_lookup_domain_done(VirtViewer *self, gpointer result, gpointer data)
+{
+    VirtViewerConnectAttempt *attempt = data;
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    GError *error = NULL;
+
+    attempt->dom = result;
+    if (!attempt->dom) {
+        if (self->waitvm) {
+            virt_viewer_app_show_status(app, _("Waiting for guest domain to be created"));
+            virt_viewer_connect_attempt_wait(self);
+            return;
+        } else {
+            VirtViewerWindow *main_window = virt_viewer_app_get_main_window(app);
+            gchar *filter = NULL;
+
+            if (self->domkey != NULL)
+                g_debug("Cannot find guest %s", self->domkey);
+            /* a name with wildcards restricts the guests to choose from */
+            if (self->domkey != NULL && strpbrk(self->domkey, "*?") != NULL)
+                filter = g_strdup(self->domkey);
+            attempt->dom = choose_vm(virt_viewer_window_get_window(main_window),
+                                     &self->domkey,
+                                     self->conn,
+                                     filter,
+                                     &error);
+            g_free(filter);
+            if (attempt->dom == NULL) {
+                virt_viewer_connect_attempt_finish(self, FALSE, error);
+                return;
+            }
+        }
+    }
+    virt_viewer_set_domain_uuid(self, attempt->dom);
+    virt_viewer_app_timing_mark(app, "domain-found");
+
+    virt_viewer_app_show_status(app, _("Checking guest domain status"));
+    virt_viewer_run_in_thread(self, virt_viewer_get_domain_details_thread,
+                              virt_viewer_get_domain_details_done, attempt);
+}
+
+static void
+virt_viewer_find_domain(VirtViewer *self)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    VirtViewerConnectAttempt *attempt = self->attempt;
+
+    virt_viewer_app_show_status(app, _("Finding guest domain"));
+    virt_viewer_app_timing_mark(app, "domain-lookup");
+    /* the domain events clear the UUID on the main thread meanwhile */
+    attempt->has_uuid = self->has_uuid;
+    memcpy(attempt->uuid, self->uuid, VIR_UUID_BUFLEN);
+    virt_viewer_run_in_thread(self, virt_viewer_lookup_domain_thread,
+                              virt_viewer_lookup_domain_done, attempt);
+}
+
+static void
+virt_viewer_open_done(VirtViewer *self, gpointer result, gpointer data)
+{
+    VirtViewerConnectAttempt *attempt = data;
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    GError *error = NULL;
+
+    self->conn = result;
+    if (!self->conn) {
+        if (!self->auth_cancelled) {
+            g_set_error_literal(&error,
+                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                attempt->error_message);
+        } else {
+            g_set_error_literal(&error,
+                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED,
+                                _("Authentication was cancelled"));
+        }
+
+        if (attempt->starting) {
+            virt_viewer_connect_attempt_finish(self, FALSE, error);
+            return;
+        }
+        g_debug("%s", error->message);
+        g_clear_error(&error);
+        virt_viewer_app_show_status(app, _("Waiting for libvirt to start"));
+        virt_viewer_connect_attempt_wait(self);
+        return;
+    }
+    virt_viewer_app_timing_mark(app, "libvirt-opened");
+    attempt->opened = TRUE;
+
+    virt_viewer_find_domain(self);
+}
+
+static void
+virt_viewer_open(VirtViewer *self)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    VirtViewerConnectAttempt *attempt = self->attempt;
+
+    if (!virt_viewer_app_get_attach(app))
+        attempt->oflags |= VIR_CONNECT_RO;
+
+    g_debug("connecting ...");
+
+    virt_viewer_app_trace(app, "Opening connection to libvirt with URI %s",
+                          self->uri ? self->uri : "<null>");
+    self->auth_cancelled = FALSE;
+    virt_viewer_app_timing_start(app, "libvirt-open");
+    virt_viewer_run_in_thread(self, virt_viewer_open_thread,
+                              virt_viewer_open_done, attempt);
+}
+
+static void
+virt_viewer_connect_attempt_start(VirtViewer *self, gboolean starting)
+{
+    g_return_if_fail(self->attempt == NULL);
+
+    self->attempt = g_new0(VirtViewerConnectAttempt, 1);
+    self->attempt->starting = starting;
+
+    if (!self->conn)
+        virt_viewer_open(self);
+    else
+        virt_viewer_find_domain(self);
+}
+
+/* Activates the display of the guest, from its start event */
+static void
+virt_viewer_domain_started(VirtViewer *self, virDomainPtr dom)
+{
+    /* the attempt may have found the guest still off */
+    if (self->attempt != NULL) {
+        g_debug("Guest started during a connection attempt");
+        self->connect_again = TRUE;
+        return;
+    }
+
+    self->attempt = g_new0(VirtViewerConnectAttempt, 1);
+    self->attempt->domain_started = TRUE;
+    self->attempt->dom = dom;
+    virDomainRef(dom);
+    virt_viewer_update_display(self);
+}
+
+/* The attempt goes on from the main loop, it reports its own errors */
+static gboolean
+virt_viewer_initial_connect(VirtViewerApp *app, GError **error G_GNUC_UNUSED)
+{
+    VirtViewer *self = VIRT_VIEWER(app);
+
+    g_debug("initial connect");
+
+    /* a poll or a retry may get us here again */
+    if (self->attempt != NULL) {
+        g_debug("connection already in progress");
+        return TRUE;
+    }
+
+    virt_viewer_connect_attempt_start(self, FALSE);
+    return TRUE;
 }
 
 static gboolean
@@ -1143,8 +1776,7 @@ virt_viewer_start(VirtViewerApp *app, GError **error)
 
     virSetErrorFunc(NULL, virt_viewer_error_func);
 
-    if (virt_viewer_connect(app, error) < 0)
-        return FALSE;
+    virt_viewer_connect_attempt_start(VIRT_VIEWER(app), TRUE);
 
     return VIRT_VIEWER_APP_CLASS(virt_viewer_parent_class)->start(app, error);
 }
@@ -0,0 +1,103 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <string.h>
+#include <virt-viewer-benchmark.h>
+
+gboolean doDebug = FALSE;
+
+static void
+test_summary(void)
+{
+    VirtViewerBenchmark *benchmark = virt_viewer_benchmark_new("remote-viewer", 1000000);
+    VirtViewerLatency *latency = virt_viewer_latency_new(8);
+    gchar *json;
+    guint i;
+
+    virt_viewer_latency_add(latency, 20000);
+
+    virt_viewer_benchmark_set_connected(benchmark, 1250000);
+    virt_viewer_benchmark_set_connected(benchmark, 5000000);
+    virt_viewer_benchmark_set_cpu_time(benchmark, 500000);
+    virt_viewer_benchmark_set_string(benchmark, "session", "vnc");
+    virt_viewer_benchmark_set_string(benchmark, "session", "spice");
+    virt_viewer_benchmark_set_display(benchmark, 1, 10, 5);
+    virt_viewer_benchmark_set_display(benchmark, 0, 1, 1);
+    virt_viewer_benchmark_set_display(benchmark, 0, 200, 100);
+    virt_viewer_benchmark_set_display_latency(benchmark, 0, latency);
+    virt_viewer_benchmark_add_channel_bytes(benchmark, "main", 1000);
+    virt_viewer_benchmark_add_channel_bytes(benchmark, "display", 3000);
+    virt_viewer_benchmark_add_channel_bytes(benchmark, "main", 1000);
+    for (i = 1; i <= 100; i++)
+        virt_viewer_benchmark_add_latency(benchmark, i * 1000);
+    virt_viewer_benchmark_add_latency(benchmark, -5);
+
+    /* 2 s after the connection */
+    json = virt_viewer_benchmark_finish(benchmark, "completed", 3250000);
+    g_assert_cmpstr(json, ==,
+                    "{\"program\":\"remote-viewer\",\"result\":\"completed\","
+                    "\"duration\":2250.000,\"connect\":250.000,"
+                    "\"cpu_time\":500.000,\"cpu_usage\":25.00,\"session\":\"spice\","
+                    "\"displays\":["
+                    "{\"display\":1,\"updates\":200,\"frames\":100,"
+                    "\"updates_per_second\":100.00,\"frames_per_second\":50.00,"
+                    "\"input_latency\":{\"samples\":1,\"p50\":20.000,\"p95\":20.000,\"p99\":20.000}},"
+                    "{\"display\":2,\"updates\":10,\"frames\":5,"
+                    "\"updates_per_second\":5.00,\"frames_per_second\":2.50}],"
+                    "\"channels\":["
+                    "{\"channel\":\"main\",\"bytes\":2000,\"bytes_per_second\":1000.00},"
+                    "{\"channel\":\"display\",\"bytes\":3000,\"bytes_per_second\":1500.00}],"
+                    "\"main_loop_latency\":{\"samples\":101,\"mean\":50.000,"
+                    "\"p50\":50.000,\"p95\":95.000,\"p99\":99.000,\"max\":100.000}}");
+    g_free(json);
+
+    virt_viewer_latency_free(latency);
+    virt_viewer_benchmark_free(benchmark);
+}
+
+static void
+test_not_connected(void)
+{
+    VirtViewerBenchmark *benchmark = virt_viewer_benchmark_new("remote-viewer", 0);
+    gchar *json;
+
+    json = virt_viewer_benchmark_finish(benchmark, "failed", 500000);
+    g_assert_cmpstr(json, ==,
+                    "{\"program\":\"remote-viewer\",\"result\":\"failed\","
+                    "\"duration\":500.000,\"connect\":null,"
+                    "\"displays\":[],\"channels\":[],"
+                    "\"main_loop_latency\":{\"samples\":0}}");
+    g_free(json);
+
+    virt_viewer_benchmark_free(benchmark);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/benchmark/summary", test_summary);
+    g_test_add_func("/benchmark/not-connected", test_not_connected);
+
+    return g_test_run();
+}
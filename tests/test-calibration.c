@@ -0,0 +1,85 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <virt-viewer-calibration.h>
+
+gboolean doDebug = FALSE;
+
+#define MB (1000 * 1000)
+#define MS 1000
+
+static void
+test_least_bytes(void)
+{
+    VirtViewerCalibration *calibration = virt_viewer_calibration_new();
+
+    g_assert_null(virt_viewer_calibration_get_winner(calibration));
+
+    virt_viewer_calibration_add_result(calibration, "mjpeg", 40 * MB, 300 * MS);
+    virt_viewer_calibration_add_result(calibration, "vp8", 6 * MB, 380 * MS);
+    virt_viewer_calibration_add_result(calibration, "h264", 4 * MB, 350 * MS);
+    g_assert_cmpstr(virt_viewer_calibration_get_winner(calibration), ==, "h264");
+
+    virt_viewer_calibration_free(calibration);
+}
+
+static void
+test_cpu_limit(void)
+{
+    VirtViewerCalibration *calibration = virt_viewer_calibration_new();
+
+    /* vp9 saves bandwidth but costs too much CPU */
+    virt_viewer_calibration_add_result(calibration, "mjpeg", 40 * MB, 300 * MS);
+    virt_viewer_calibration_add_result(calibration, "vp9", 2 * MB, 1200 * MS);
+    virt_viewer_calibration_add_result(calibration, "vp8", 6 * MB, 420 * MS);
+    g_assert_cmpstr(virt_viewer_calibration_get_winner(calibration), ==, "vp8");
+
+    virt_viewer_calibration_free(calibration);
+}
+
+static void
+test_idle(void)
+{
+    VirtViewerCalibration *calibration = virt_viewer_calibration_new();
+
+    /* nothing was streamed */
+    virt_viewer_calibration_add_result(calibration, "mjpeg", 1000, 1 * MS);
+    virt_viewer_calibration_add_result(calibration, "vp8", 0, 0);
+    g_assert_null(virt_viewer_calibration_get_winner(calibration));
+
+    virt_viewer_calibration_add_result(calibration, "h264", 3 * MB, 200 * MS);
+    g_assert_cmpstr(virt_viewer_calibration_get_winner(calibration), ==, "h264");
+
+    virt_viewer_calibration_free(calibration);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/calibration/least-bytes", test_least_bytes);
+    g_test_add_func("/calibration/cpu-limit", test_cpu_limit);
+    g_test_add_func("/calibration/idle", test_idle);
+
+    return g_test_run();
+}
@@ -0,0 +1,269 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <string.h>
+#include <libxml/xpath.h>
+#include <virt-viewer-util.h>
+
+gboolean doDebug = FALSE;
+
+static VirtViewerGraphicsInfo *
+extract(const gchar *devices)
+{
+    gchar *xml = g_strdup_printf("<domain type='kvm'><name>test</name>"
+                                 "<devices>%s</devices></domain>", devices);
+    VirtViewerGraphicsInfo *info = virt_viewer_util_extract_graphics_info(xml);
+
+    g_free(xml);
+    return info;
+}
+
+static void
+test_new_listen_syntax(void)
+{
+    VirtViewerGraphicsInfo *info;
+
+    info = extract("<graphics type='spice' port='5900' tlsPort='5901' listen='0.0.0.0'>"
+                   "<listen type='address' address='192.168.1.2'/>"
+                   "</graphics>");
+    g_assert_nonnull(info);
+    g_assert_cmpstr(info->type, ==, "spice");
+    g_assert_cmpstr(info->port, ==, "5900");
+    g_assert_cmpstr(info->tls_port, ==, "5901");
+    g_assert_cmpstr(info->listen, ==, "192.168.1.2");
+    g_assert_null(info->socket);
+    virt_viewer_graphics_info_free(info);
+
+    info = extract("<graphics type='vnc' socket='/old.sock'>"
+                   "<listen type='socket' socket='/run/vnc.sock'/>"
+                   "</graphics>");
+    g_assert_nonnull(info);
+    g_assert_cmpstr(info->type, ==, "vnc");
+    g_assert_null(info->port);
+    g_assert_cmpstr(info->socket, ==, "/run/vnc.sock");
+    virt_viewer_graphics_info_free(info);
+}
+
+static void
+test_old_listen_syntax(void)
+{
+    VirtViewerGraphicsInfo *info;
+
+    info = extract("<graphics type='vnc' port='5902' listen='::1'/>");
+    g_assert_nonnull(info);
+    g_assert_cmpstr(info->type, ==, "vnc");
+    g_assert_cmpstr(info->port, ==, "5902");
+    g_assert_null(info->tls_port);
+    g_assert_cmpstr(info->listen, ==, "::1");
+    virt_viewer_graphics_info_free(info);
+
+    info = extract("<graphics type='spice' socket='/run/spice.sock'/>");
+    g_assert_nonnull(info);
+    g_assert_cmpstr(info->socket, ==, "/run/spice.sock");
+    virt_viewer_graphics_info_free(info);
+}
+
+static void
+test_multiple_graphics(void)
+{
+    VirtViewerGraphicsInfo *info;
+
+    /* the first element decides the type, other types are ignored */
+    info = extract("<graphics type='vnc' port='-1' autoport='yes'/>"
+                   "<graphics type='spice' port='5900' listen='10.0.0.1'/>"
+                   "<graphics type='vnc' port='5903' listen='10.0.0.2'/>");
+    g_assert_nonnull(info);
+    g_assert_cmpstr(info->type, ==, "vnc");
+    g_assert_null(info->port);
+    g_assert_cmpstr(info->listen, ==, "10.0.0.2");
+    virt_viewer_graphics_info_free(info);
+
+    /* graphics outside of <devices> are not considered */
+    info = extract("<graphics type='spice' port='5905'/>"
+                   "<video><graphics type='vnc' port='5906'/></video>");
+    g_assert_nonnull(info);
+    g_assert_cmpstr(info->type, ==, "spice");
+    g_assert_cmpstr(info->port, ==, "5905");
+    virt_viewer_graphics_info_free(info);
+}
+
+static void
+test_invalid(void)
+{
+    g_assert_null(extract(""));
+    g_assert_null(extract("<graphics port='5900'/>"));
+    g_assert_null(virt_viewer_util_extract_graphics_info("<domain>"));
+    g_assert_null(virt_viewer_util_extract_graphics_info("<network><devices>"
+                                                         "<graphics type='vnc'/>"
+                                                         "</devices></network>"));
+}
+
+/* Builds a domain description similar to what libvirt returns for a large
+ * guest, with the graphics devices at the end of <devices> */
+static gchar *
+build_large_domain_xml(guint ndisks, guint nnics)
+{
+    GString *xml = g_string_new("<domain type='kvm' id='42'>\n"
+                                "  <name>bench</name>\n"
+                                "  <uuid>c7a5fdbd-cdaf-9455-926a-d65c16db1809</uuid>\n"
+                                "  <memory unit='KiB'>8388608</memory>\n"
+                                "  <vcpu placement='static'>8</vcpu>\n"
+                                "  <os><type arch='x86_64' machine='q35'>hvm</type></os>\n"
+                                "  <devices>\n"
+                                "    <emulator>/usr/bin/qemu-system-x86_64</emulator>\n");
+    guint i;
+
+    for (i = 0; i < ndisks; i++) {
+        g_string_append_printf(xml,
+                               "    <disk type='file' device='disk'>\n"
+                               "      <driver name='qemu' type='qcow2' cache='none'/>\n"
+                               "      <source file='/var/lib/libvirt/images/bench-%u.qcow2'/>\n"
+                               "      <backingStore/>\n"
+                               "      <target dev='vd%c%c' bus='virtio'/>\n"
+                               "      <alias name='virtio-disk%u'/>\n"
+                               "      <address type='pci' domain='0x0000' bus='0x%02x' slot='0x00' function='0x0'/>\n"
+                               "    </disk>\n",
+                               i, 'a' + (i / 26) % 26, 'a' + i % 26, i, (i + 1) % 256);
+    }
+    for (i = 0; i < nnics; i++) {
+        g_string_append_printf(xml,
+                               "    <interface type='network'>\n"
+                               "      <mac address='52:54:00:00:%02x:%02x'/>\n"
+                               "      <source network='net%u' bridge='virbr%u'/>\n"
+                               "      <target dev='vnet%u'/>\n"
+                               "      <model type='virtio'/>\n"
+                               "      <alias name='net%u'/>\n"
+                               "      <address type='pci' domain='0x0000' bus='0x%02x' slot='0x01' function='0x0'/>\n"
+                               "    </interface>\n",
+                               i / 256, i % 256, i, i, i, i, (i + 1) % 256);
+    }
+    g_string_append(xml,
+                    "    <graphics type='spice' port='5900' tlsPort='5901' autoport='yes' listen='0.0.0.0'>\n"
+                    "      <listen type='address' address='0.0.0.0'/>\n"
+                    "    </graphics>\n"
+                    "    <graphics type='vnc' port='5902' autoport='yes'>\n"
+                    "      <listen type='address' address='127.0.0.1'/>\n"
+                    "    </graphics>\n"
+                    "  </devices>\n"
+                    "</domain>\n");
+
+    return g_string_free(xml, FALSE);
+}
+
+/* The previous implementation: one parse per XPath query */
+static gchar *
+extract_xpath_string(const gchar *xmldesc, const gchar *xpath)
+{
+    xmlDocPtr xml;
+    xmlXPathContextPtr ctxt;
+    xmlXPathObjectPtr obj;
+    gchar *value = NULL;
+
+    xml = xmlReadDoc((const xmlChar *)xmldesc, "domain.xml", NULL,
+                     XML_PARSE_NOENT | XML_PARSE_NONET | XML_PARSE_NOWARNING);
+    g_assert_nonnull(xml);
+    ctxt = xmlXPathNewContext(xml);
+    obj = xmlXPathEval((const xmlChar *)xpath, ctxt);
+    if (obj && obj->type == XPATH_STRING && obj->stringval && obj->stringval[0])
+        value = g_strdup((const gchar *)obj->stringval);
+
+    xmlXPathFreeObject(obj);
+    xmlXPathFreeContext(ctxt);
+    xmlFreeDoc(xml);
+    return value;
+}
+
+static void
+extract_xpath_all(const gchar *xmldesc)
+{
+    static const gchar * const queries[] = {
+        "string(/domain/devices/graphics/@type)",
+        "string(/domain/devices/graphics[@type='spice']/@port)",
+        "string(/domain/devices/graphics[@type='spice']/@tlsPort)",
+        "string(/domain/devices/graphics[@type='spice']/listen/@address)",
+    };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(queries); i++)
+        g_free(extract_xpath_string(xmldesc, queries[i]));
+}
+
+static void
+bench_large_domain(gconstpointer data)
+{
+    const guint nelements = GPOINTER_TO_UINT(data);
+    const guint iterations = 200;
+    gchar *xml = build_large_domain_xml(nelements, nelements);
+    VirtViewerGraphicsInfo *info;
+    gdouble single, xpath;
+    guint i;
+
+    info = virt_viewer_util_extract_graphics_info(xml);
+    g_assert_nonnull(info);
+    g_assert_cmpstr(info->type, ==, "spice");
+    g_assert_cmpstr(info->port, ==, "5900");
+    g_assert_cmpstr(info->tls_port, ==, "5901");
+    g_assert_cmpstr(info->listen, ==, "0.0.0.0");
+    virt_viewer_graphics_info_free(info);
+
+    g_test_timer_start();
+    for (i = 0; i < iterations; i++)
+        virt_viewer_graphics_info_free(virt_viewer_util_extract_graphics_info(xml));
+    single = g_test_timer_elapsed();
+
+    g_test_timer_start();
+    for (i = 0; i < iterations; i++)
+        extract_xpath_all(xml);
+    xpath = g_test_timer_elapsed();
+
+    g_test_minimized_result(single * 1000000 / iterations,
+                            "%u disks/nics (%zu bytes): single pass %.1f us per domain",
+                            nelements, strlen(xml), single * 1000000 / iterations);
+    g_test_message("%u disks/nics: one parse per XPath query %.1f us per domain (%.1fx)",
+                   nelements, xpath * 1000000 / iterations, xpath / single);
+
+    g_free(xml);
+}
+
+int main(int argc, char* argv[])
+{
+    static const guint sizes[] = { 8, 64, 256 };
+    guint i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/graphics-info/new-listen-syntax", test_new_listen_syntax);
+    g_test_add_func("/graphics-info/old-listen-syntax", test_old_listen_syntax);
+    g_test_add_func("/graphics-info/multiple-graphics", test_multiple_graphics);
+    g_test_add_func("/graphics-info/invalid", test_invalid);
+
+    if (g_test_perf()) {
+        for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+            gchar *path = g_strdup_printf("/graphics-info/bench/%u", sizes[i]);
+            g_test_add_data_func(path, GUINT_TO_POINTER(sizes[i]), bench_large_domain);
+            g_free(path);
+        }
+    }
+
+    return g_test_run();
+}
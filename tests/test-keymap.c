@@ -0,0 +1,277 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <gdk/gdkkeysyms.h>
+
+#include "virt-viewer-keymap.h"
+
+gboolean doDebug = FALSE;
+
+static void
+test_simple(void)
+{
+    VirtViewerKeymap *keymap = virt_viewer_keymap_new();
+    const gchar * const mappings[] = {
+        "Control_R=Control_L+Alt_L+Delete",
+        "F12=",
+        NULL
+    };
+    const guint *keyvals;
+    guint nkeyvals;
+
+    g_assert_cmpuint(virt_viewer_keymap_add_list(keymap, mappings), ==, 2);
+    g_assert_cmpuint(virt_viewer_keymap_get_size(keymap), ==, 2);
+
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_Control_R, 0,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(nkeyvals, ==, 3);
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_Control_L);
+    g_assert_cmpuint(keyvals[1], ==, GDK_KEY_Alt_L);
+    g_assert_cmpuint(keyvals[2], ==, GDK_KEY_Delete);
+
+    /* without modifiers, the mapping ignores them */
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_Control_R,
+                                            GDK_SHIFT_MASK | GDK_LOCK_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(nkeyvals, ==, 3);
+
+    /* blocked */
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F12, 0,
+                                            &keyvals, &nkeyvals));
+    g_assert_null(keyvals);
+    g_assert_cmpuint(nkeyvals, ==, 0);
+
+    g_assert_false(virt_viewer_keymap_lookup(keymap, GDK_KEY_F11, 0, NULL, NULL));
+
+    virt_viewer_keymap_unref(keymap);
+}
+
+static void
+test_modifiers(void)
+{
+    VirtViewerKeymap *keymap = virt_viewer_keymap_new();
+    const guint *keyvals;
+    guint nkeyvals;
+
+    g_assert_true(virt_viewer_keymap_add(keymap, "F1=F2", NULL));
+    g_assert_true(virt_viewer_keymap_add(keymap, "<Ctrl><Alt>F1=F3", NULL));
+    g_assert_true(virt_viewer_keymap_add(keymap, "<shift>a=b", NULL));
+    g_assert_cmpuint(virt_viewer_keymap_get_size(keymap), ==, 3);
+
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F1,
+                                            GDK_CONTROL_MASK | GDK_MOD1_MASK | GDK_MOD2_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(nkeyvals, ==, 1);
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F3);
+
+    /* other modifiers fall back to the mapping without modifiers */
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F1, GDK_CONTROL_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F2);
+
+    /* GDK reports the shifted keyval */
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_A, GDK_SHIFT_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_b);
+    g_assert_false(virt_viewer_keymap_lookup(keymap, GDK_KEY_a, 0, NULL, NULL));
+
+    /* a later mapping replaces an earlier one */
+    g_assert_true(virt_viewer_keymap_add(keymap, "<Control><Mod1>F1=F4", NULL));
+    g_assert_cmpuint(virt_viewer_keymap_get_size(keymap), ==, 3);
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F1,
+                                            GDK_CONTROL_MASK | GDK_MOD1_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F4);
+
+    virt_viewer_keymap_unref(keymap);
+}
+
+static void
+test_virtual_modifiers(void)
+{
+    VirtViewerKeymap *keymap = virt_viewer_keymap_new();
+    const guint *keyvals;
+    guint nkeyvals;
+
+    g_assert_true(virt_viewer_keymap_add(keymap, "F1=F2", NULL));
+    g_assert_true(virt_viewer_keymap_add(keymap, "<Alt>F1=F3", NULL));
+    g_assert_true(virt_viewer_keymap_add(keymap, "<Super>F5=F6", NULL));
+
+    /* Meta is on Mod1 with Alt, and Super and Hyper on Mod4: GDK reports
+     * Alt as Mod1|Meta and Super as Mod4|Super|Hyper */
+    virt_viewer_keymap_set_virtual_modifier(keymap, GDK_META_MASK, GDK_MOD1_MASK | GDK_META_MASK);
+    virt_viewer_keymap_set_virtual_modifier(keymap, GDK_SUPER_MASK, GDK_MOD4_MASK);
+    virt_viewer_keymap_set_virtual_modifier(keymap, GDK_HYPER_MASK, GDK_MOD4_MASK);
+    g_assert_cmpuint(virt_viewer_keymap_get_size(keymap), ==, 3);
+
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F1,
+                                            GDK_MOD1_MASK | GDK_META_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F3);
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F5,
+                                            GDK_MOD4_MASK | GDK_SUPER_MASK | GDK_HYPER_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F6);
+
+    /* or only the real modifiers */
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F5, GDK_MOD4_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F6);
+
+    /* a mapping added later is normalized too */
+    g_assert_true(virt_viewer_keymap_add(keymap, "<Meta>F7=F8", NULL));
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F7,
+                                            GDK_MOD1_MASK | GDK_META_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F8);
+
+    /* Meta on its own modifier is not Alt */
+    virt_viewer_keymap_set_virtual_modifier(keymap, GDK_META_MASK, GDK_MOD3_MASK);
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F1,
+                                            GDK_MOD3_MASK | GDK_META_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F2);
+    g_assert_true(virt_viewer_keymap_lookup(keymap, GDK_KEY_F7,
+                                            GDK_MOD3_MASK | GDK_META_MASK,
+                                            &keyvals, &nkeyvals));
+    g_assert_cmpuint(keyvals[0], ==, GDK_KEY_F8);
+
+    virt_viewer_keymap_unref(keymap);
+}
+
+static void
+test_invalid(void)
+{
+    VirtViewerKeymap *keymap = virt_viewer_keymap_new();
+    const gchar * const invalid[] = {
+        "F1",
+        "NoSuchKey=F2",
+        "F1=F2+NoSuchKey",
+        "<Foo>F1=F2",
+        "<Ctrl F1=F2",
+        "=F2",
+    };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(invalid); i++) {
+        GError *error = NULL;
+
+        g_assert_false(virt_viewer_keymap_add(keymap, invalid[i], &error));
+        g_assert_nonnull(error);
+        g_clear_error(&error);
+    }
+
+    /* nothing is left behind by the invalid mappings */
+    g_assert_cmpuint(virt_viewer_keymap_get_size(keymap), ==, 0);
+    g_assert_false(virt_viewer_keymap_lookup(keymap, GDK_KEY_F1, 0, NULL, NULL));
+
+    virt_viewer_keymap_unref(keymap);
+}
+
+/* The previous implementation: an array walked until its last entry */
+typedef struct {
+    guint sourceKey;
+    guint numMappedKeys;
+    guint *mappedKeys;
+    gboolean isLast;
+} LinearMapping;
+
+static const LinearMapping *
+linear_lookup(const LinearMapping *ptr, guint keyval)
+{
+    do {
+        if (keyval == ptr->sourceKey)
+            return ptr;
+    } while (!(ptr++)->isLast);
+
+    return NULL;
+}
+
+static void
+bench_dispatch(gconstpointer data)
+{
+    const guint nmappings = GPOINTER_TO_UINT(data);
+    const guint iterations = 1000000;
+    VirtViewerKeymap *keymap = virt_viewer_keymap_new();
+    LinearMapping *linear = g_new0(LinearMapping, nmappings);
+    guint mapped = GDK_KEY_Escape;
+    gdouble hashed, walked;
+    guint i, found = 0;
+
+    /* map F1.. and their Ctrl variants, and type keys that are not mapped,
+     * which is the common case and the worst one for the walk */
+    for (i = 0; i < nmappings; i++) {
+        gchar *mapping = g_strdup_printf("%s%s=Escape", i % 2 ? "<Ctrl>" : "",
+                                         gdk_keyval_name(GDK_KEY_F1 + i / 2));
+
+        g_assert_true(virt_viewer_keymap_add(keymap, mapping, NULL));
+        g_free(mapping);
+        linear[i].sourceKey = GDK_KEY_F1 + i;
+        linear[i].numMappedKeys = 1;
+        linear[i].mappedKeys = &mapped;
+    }
+    linear[nmappings - 1].isLast = TRUE;
+
+    g_test_timer_start();
+    for (i = 0; i < iterations; i++)
+        found += virt_viewer_keymap_lookup(keymap, GDK_KEY_a + i % 26, GDK_MOD2_MASK, NULL, NULL);
+    hashed = g_test_timer_elapsed();
+
+    g_test_timer_start();
+    for (i = 0; i < iterations; i++)
+        found += linear_lookup(linear, GDK_KEY_a + i % 26) != NULL;
+    walked = g_test_timer_elapsed();
+    g_assert_cmpuint(found, ==, 0);
+
+    g_test_minimized_result(hashed * 1000000000 / iterations,
+                            "%u mappings: table lookup %.1f ns per key",
+                            nmappings, hashed * 1000000000 / iterations);
+    g_test_message("%u mappings: linear walk %.1f ns per key",
+                   nmappings, walked * 1000000000 / iterations);
+
+    g_free(linear);
+    virt_viewer_keymap_unref(keymap);
+}
+
+int main(int argc, char* argv[])
+{
+    static const guint sizes[] = { 4, 16, 64 };
+    guint i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/keymap/simple", test_simple);
+    g_test_add_func("/keymap/modifiers", test_modifiers);
+    g_test_add_func("/keymap/virtual-modifiers", test_virtual_modifiers);
+    g_test_add_func("/keymap/invalid", test_invalid);
+
+    if (g_test_perf()) {
+        for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+            gchar *path = g_strdup_printf("/keymap/bench/%u", sizes[i]);
+            g_test_add_data_func(path, GUINT_TO_POINTER(sizes[i]), bench_dispatch);
+            g_free(path);
+        }
+    }
+
+    return g_test_run();
+}
@@ -0,0 +1,89 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <virt-viewer-latency.h>
+
+gboolean doDebug = FALSE;
+
+static void
+test_percentiles(void)
+{
+    VirtViewerLatency *latency = virt_viewer_latency_new(100);
+    gint64 p50, p95, p99;
+    GString *json = g_string_new(NULL);
+    guint i;
+
+    g_assert_false(virt_viewer_latency_get_percentiles(latency, &p50, &p95, &p99));
+    virt_viewer_latency_append_json(latency, json);
+    g_assert_cmpstr(json->str, ==, "{\"samples\":0}");
+
+    /* in any order */
+    for (i = 0; i < 100; i++)
+        virt_viewer_latency_add(latency, ((i * 37) % 100 + 1) * 1000);
+    g_assert_cmpuint(virt_viewer_latency_get_count(latency), ==, 100);
+    g_assert_true(virt_viewer_latency_get_percentiles(latency, &p50, &p95, &p99));
+    g_assert_cmpint(p50, ==, 50000);
+    g_assert_cmpint(p95, ==, 95000);
+    g_assert_cmpint(p99, ==, 99000);
+
+    g_string_truncate(json, 0);
+    virt_viewer_latency_append_json(latency, json);
+    g_assert_cmpstr(json->str, ==, "{\"samples\":100,\"p50\":50.000,\"p95\":95.000,\"p99\":99.000}");
+
+    g_string_free(json, TRUE);
+    virt_viewer_latency_free(latency);
+}
+
+static void
+test_window(void)
+{
+    VirtViewerLatency *latency = virt_viewer_latency_new(10);
+    gint64 p50, p99;
+    guint i;
+
+    virt_viewer_latency_add(latency, -1);
+    g_assert_true(virt_viewer_latency_get_percentiles(latency, &p50, NULL, &p99));
+    g_assert_cmpint(p50, ==, 0);
+
+    /* the slow start is forgotten */
+    for (i = 0; i < 10; i++)
+        virt_viewer_latency_add(latency, 500000);
+    for (i = 0; i < 10; i++)
+        virt_viewer_latency_add(latency, 2000 + i);
+    g_assert_cmpuint(virt_viewer_latency_get_count(latency), ==, 10);
+    g_assert_true(virt_viewer_latency_get_percentiles(latency, &p50, NULL, &p99));
+    g_assert_cmpint(p50, ==, 2004);
+    g_assert_cmpint(p99, ==, 2009);
+
+    virt_viewer_latency_free(latency);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/latency/percentiles", test_percentiles);
+    g_test_add_func("/latency/window", test_window);
+
+    return g_test_run();
+}
@@ -0,0 +1,229 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <virt-viewer-link-quality.h>
+#include <virt-viewer-util.h>
+
+gboolean doDebug = FALSE;
+
+static void
+feed(VirtViewerLinkQuality *quality, gint64 latency, guint updates)
+{
+    guint i;
+
+    for (i = 0; i < updates; i++) {
+        virt_viewer_link_quality_add_latency(quality, latency);
+        virt_viewer_link_quality_update(quality);
+    }
+}
+
+static void
+test_profile_names(void)
+{
+    VirtViewerLinkProfile profile = VIRT_VIEWER_LINK_PROFILE_LAN;
+
+    g_assert_true(virt_viewer_link_profile_from_string("WAN", &profile));
+    g_assert_cmpint(profile, ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+    g_assert_true(virt_viewer_link_profile_from_string("cellular", &profile));
+    g_assert_cmpint(profile, ==, VIRT_VIEWER_LINK_PROFILE_CELLULAR);
+    g_assert_false(virt_viewer_link_profile_from_string("auto", &profile));
+    g_assert_cmpstr(virt_viewer_link_profile_to_string(VIRT_VIEWER_LINK_PROFILE_LAN), ==, "lan");
+}
+
+static void
+test_profile_from_latency(void)
+{
+    g_assert_cmpint(virt_viewer_link_profile_from_latency(0), ==, VIRT_VIEWER_LINK_PROFILE_LAN);
+    g_assert_cmpint(virt_viewer_link_profile_from_latency(2000), ==, VIRT_VIEWER_LINK_PROFILE_LAN);
+    g_assert_cmpint(virt_viewer_link_profile_from_latency(40 * 1000), ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+    g_assert_cmpint(virt_viewer_link_profile_from_latency(300 * 1000), ==, VIRT_VIEWER_LINK_PROFILE_CELLULAR);
+}
+
+static void
+test_classify(void)
+{
+    VirtViewerLinkQuality *quality = virt_viewer_link_quality_new(VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    /* nothing measured yet */
+    g_assert_false(virt_viewer_link_quality_update(quality));
+    g_assert_cmpint(virt_viewer_link_quality_get_latency(quality), ==, -1);
+
+    feed(quality, 40 * 1000, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+
+    feed(quality, 300 * 1000, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_CELLULAR);
+
+    feed(quality, 1000, 20);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    virt_viewer_link_quality_free(quality);
+}
+
+static void
+test_hysteresis(void)
+{
+    VirtViewerLinkQuality *quality = virt_viewer_link_quality_new(VIRT_VIEWER_LINK_PROFILE_LAN);
+    guint changes = 0;
+    guint i;
+
+    /* a single spike is smoothed out */
+    virt_viewer_link_quality_add_latency(quality, 2000);
+    g_assert_false(virt_viewer_link_quality_update(quality));
+    virt_viewer_link_quality_add_latency(quality, 30 * 1000);
+    g_assert_false(virt_viewer_link_quality_update(quality));
+    feed(quality, 2000, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    /* nor does a latency going back and forth around a threshold */
+    feed(quality, 12 * 1000, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+    for (i = 0; i < 100; i++) {
+        virt_viewer_link_quality_add_latency(quality, i % 2 ? 9 * 1000 : 11 * 1000);
+        if (virt_viewer_link_quality_update(quality))
+            changes++;
+    }
+    g_assert_cmpint(changes, ==, 0);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+
+    virt_viewer_link_quality_free(quality);
+}
+
+static void
+test_throughput(void)
+{
+    VirtViewerLinkQuality *quality = virt_viewer_link_quality_new(VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    /* 4 MB in one second over a high latency link */
+    virt_viewer_link_quality_add_transfer(quality, 4 * 1000 * 1000, G_USEC_PER_SEC);
+    g_assert_cmpfloat(virt_viewer_link_quality_get_throughput(quality), ==, 4 * 1000 * 1000);
+    feed(quality, 300 * 1000, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+
+    /* an idle period does not tell anything about the link */
+    virt_viewer_link_quality_add_transfer(quality, 0, G_USEC_PER_SEC);
+    g_assert_cmpfloat(virt_viewer_link_quality_get_throughput(quality), >, 3 * 1000 * 1000);
+
+    virt_viewer_link_quality_free(quality);
+}
+
+/* A transfer of @rate bytes per second, with the latency it was sampled
+ * with, @updates times */
+static void
+feed_transfer(VirtViewerLinkQuality *quality, gint64 latency, guint64 rate, guint updates)
+{
+    guint i;
+
+    for (i = 0; i < updates; i++) {
+        virt_viewer_link_quality_add_latency(quality, latency);
+        virt_viewer_link_quality_add_transfer(quality, rate * 2, 2 * G_USEC_PER_SEC);
+        virt_viewer_link_quality_update(quality);
+    }
+}
+
+static void
+test_saturation(void)
+{
+    VirtViewerLinkQuality *quality = virt_viewer_link_quality_new(VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    /* a little data without queuing tells nothing about the capacity */
+    feed_transfer(quality, 1000, 20 * 1000, 10);
+    g_assert_cmpfloat(virt_viewer_link_quality_get_capacity(quality), <, 0);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    /* the bandwidth drops to 3 Mbit/s, the latency grows while it is used */
+    feed_transfer(quality, 8000, 3 * 1000 * 1000 / 8, 10);
+    g_assert_cmpfloat(virt_viewer_link_quality_get_capacity(quality), ==, 3 * 1000 * 1000 / 8);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+
+    /* then to 1 Mbit/s */
+    feed_transfer(quality, 9000, 1000 * 1000 / 8, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_CELLULAR);
+
+    /* the link is fast again */
+    feed_transfer(quality, 1000, 50 * 1000 * 1000 / 8, 20);
+    g_assert_cmpfloat(virt_viewer_link_quality_get_capacity(quality), <, 0);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    virt_viewer_link_quality_free(quality);
+}
+
+/* The area requested from the guest for a 4k monitor, with the cap of the
+ * current profile */
+static gint64
+capped_area(VirtViewerLinkQuality *quality)
+{
+    GHashTable *monitors = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    GdkRectangle *rect = g_new0(GdkRectangle, 1);
+    VirtViewerLinkProfile profile = virt_viewer_link_quality_get_profile(quality);
+    gint64 area;
+
+    rect->width = 3840;
+    rect->height = 2160;
+    g_hash_table_insert(monitors, GINT_TO_POINTER(0), rect);
+    virt_viewer_cap_monitors(monitors, 0, 0, virt_viewer_link_profile_get_max_area(profile));
+    area = (gint64)rect->width * rect->height;
+    g_hash_table_unref(monitors);
+
+    return area;
+}
+
+static void
+test_cap_lowered(void)
+{
+    VirtViewerLinkQuality *quality = virt_viewer_link_quality_new(VIRT_VIEWER_LINK_PROFILE_LAN);
+
+    g_assert_cmpint(virt_viewer_link_profile_get_max_area(VIRT_VIEWER_LINK_PROFILE_LAN), ==, 0);
+    feed_transfer(quality, 1000, 20 * 1000 * 1000 / 8, 10);
+    g_assert_cmpint(capped_area(quality), ==, 3840 * 2160);
+
+    /* the bandwidth drops in the middle of the session */
+    feed_transfer(quality, 8000, 3 * 1000 * 1000 / 8, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_WAN);
+    g_assert_cmpint(capped_area(quality), <=, 2560 * 1440);
+
+    feed_transfer(quality, 9000, 1000 * 1000 / 8, 10);
+    g_assert_cmpint(virt_viewer_link_quality_get_profile(quality), ==, VIRT_VIEWER_LINK_PROFILE_CELLULAR);
+    g_assert_cmpint(capped_area(quality), ==, 1920 * 1080);
+
+    /* and the full resolution is back with it */
+    feed_transfer(quality, 1000, 50 * 1000 * 1000 / 8, 20);
+    g_assert_cmpint(capped_area(quality), ==, 3840 * 2160);
+
+    virt_viewer_link_quality_free(quality);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/link-quality/profile-names", test_profile_names);
+    g_test_add_func("/link-quality/profile-from-latency", test_profile_from_latency);
+    g_test_add_func("/link-quality/classify", test_classify);
+    g_test_add_func("/link-quality/hysteresis", test_hysteresis);
+    g_test_add_func("/link-quality/throughput", test_throughput);
+    g_test_add_func("/link-quality/saturation", test_saturation);
+    g_test_add_func("/link-quality/cap-lowered", test_cap_lowered);
+
+    return g_test_run();
+}
@@ -0,0 +1,203 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+#include <virt-viewer-log-sink.h>
+
+gboolean doDebug = FALSE;
+
+static gchar *
+read_file(const gchar *path, gboolean compressed)
+{
+    GError *error = NULL;
+    gchar *contents;
+    gsize length;
+
+    g_assert_true(g_file_get_contents(path, &contents, &length, &error));
+    g_assert_no_error(error);
+
+    if (compressed) {
+        GConverter *decompressor = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+        GInputStream *mem = g_memory_input_stream_new_from_data(contents, length, g_free);
+        GInputStream *stream = g_converter_input_stream_new(mem, decompressor);
+        gchar buf[4096];
+        gssize n;
+        GString *str = g_string_new(NULL);
+
+        while ((n = g_input_stream_read(stream, buf, sizeof(buf), NULL, &error)) > 0)
+            g_string_append_len(str, buf, n);
+        g_assert_no_error(error);
+
+        g_object_unref(stream);
+        g_object_unref(mem);
+        g_object_unref(decompressor);
+        contents = g_string_free(str, FALSE);
+    }
+
+    return contents;
+}
+
+static void
+write_lines(VirtViewerLogSink *sink, guint first, guint n)
+{
+    guint i;
+
+    for (i = first; i < first + n; i++) {
+        /* 10 bytes per line */
+        gchar *line = g_strdup_printf("line %04u\n", i);
+        virt_viewer_log_sink_write(sink, line, strlen(line));
+        g_free(line);
+    }
+}
+
+static void
+test_rotation(gconstpointer data)
+{
+    gboolean compress = GPOINTER_TO_INT(data);
+    gchar *dir = g_dir_make_tmp("virt-viewer-log-XXXXXX", NULL);
+    gchar *path = g_build_filename(dir, "serial.log", NULL);
+    gchar *rotated, *contents;
+    VirtViewerLogSink *sink;
+    guint i;
+
+    g_assert_nonnull(dir);
+
+    /* 10 lines per file, 7 files worth */
+    sink = virt_viewer_log_sink_new(path, 100, compress);
+    write_lines(sink, 0, 70);
+    virt_viewer_log_sink_flush(sink);
+
+    contents = read_file(path, FALSE);
+    g_assert_cmpstr(contents, ==,
+                    "line 0060\nline 0061\nline 0062\nline 0063\nline 0064\n"
+                    "line 0065\nline 0066\nline 0067\nline 0068\nline 0069\n");
+    g_free(contents);
+
+    for (i = 1; i <= 5; i++) {
+        gchar *first = g_strdup_printf("line %04u\n", 60 - i * 10);
+
+        rotated = g_strdup_printf("%s.%u%s", path, i, compress ? ".gz" : "");
+        contents = read_file(rotated, compress);
+        g_assert_cmpuint(strlen(contents), ==, 100);
+        g_assert_true(g_str_has_prefix(contents, first));
+        g_free(contents);
+        g_unlink(rotated);
+        g_free(rotated);
+        g_free(first);
+    }
+
+    /* the oldest one was removed */
+    rotated = g_strdup_printf("%s.6%s", path, compress ? ".gz" : "");
+    g_assert_false(g_file_test(rotated, G_FILE_TEST_EXISTS));
+    g_free(rotated);
+
+    virt_viewer_log_sink_free(sink);
+    g_unlink(path);
+    g_rmdir(dir);
+    g_free(path);
+    g_free(dir);
+}
+
+static void
+test_append(void)
+{
+    gchar *dir = g_dir_make_tmp("virt-viewer-log-XXXXXX", NULL);
+    gchar *path = g_build_filename(dir, "serial.log", NULL);
+    VirtViewerLogSink *sink;
+    gchar *contents;
+
+    g_assert_nonnull(dir);
+
+    sink = virt_viewer_log_sink_new(path, 0, FALSE);
+    write_lines(sink, 0, 1);
+    virt_viewer_log_sink_flush(sink);
+    virt_viewer_log_sink_free(sink);
+
+    /* a new connection keeps what was logged */
+    sink = virt_viewer_log_sink_new(path, 0, FALSE);
+    write_lines(sink, 1, 1);
+    virt_viewer_log_sink_flush(sink);
+
+    contents = read_file(path, FALSE);
+    g_assert_cmpstr(contents, ==, "line 0000\nline 0001\n");
+    g_free(contents);
+
+    virt_viewer_log_sink_free(sink);
+    g_unlink(path);
+    g_rmdir(dir);
+    g_free(path);
+    g_free(dir);
+}
+
+static void
+test_free(void)
+{
+    gchar *dir = g_dir_make_tmp("virt-viewer-log-XXXXXX", NULL);
+    gchar *path = g_build_filename(dir, "serial.log", NULL);
+    VirtViewerLogSink *sink;
+    gchar *contents;
+
+    g_assert_nonnull(dir);
+
+    /* a console reopened right away writes after what was queued */
+    sink = virt_viewer_log_sink_new(path, 0, FALSE);
+    write_lines(sink, 0, 1000);
+    virt_viewer_log_sink_free(sink);
+    sink = virt_viewer_log_sink_new(path, 0, FALSE);
+    write_lines(sink, 1000, 1);
+    virt_viewer_log_sink_flush(sink);
+
+    contents = read_file(path, FALSE);
+    g_assert_cmpuint(strlen(contents), ==, 10010);
+    g_assert_true(g_str_has_suffix(contents, "line 0999\nline 1000\n"));
+    g_free(contents);
+
+    /* and what is still queued when quitting is written */
+    write_lines(sink, 1001, 1000);
+    virt_viewer_log_sink_free(sink);
+    virt_viewer_log_sink_wait_all();
+
+    contents = read_file(path, FALSE);
+    g_assert_cmpuint(strlen(contents), ==, 20010);
+    g_assert_true(g_str_has_suffix(contents, "line 2000\n"));
+    g_free(contents);
+
+    g_unlink(path);
+    g_rmdir(dir);
+    g_free(path);
+    g_free(dir);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/log-sink/append", test_append);
+    g_test_add_func("/log-sink/free", test_free);
+    g_test_add_data_func("/log-sink/rotation", GINT_TO_POINTER(FALSE), test_rotation);
+    g_test_add_data_func("/log-sink/rotation-compressed", GINT_TO_POINTER(TRUE), test_rotation);
+
+    return g_test_run();
+}
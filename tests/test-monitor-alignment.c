@@ -201,6 +201,118 @@ test_monitor_align_linear(void)
     test_monitor_align(virt_viewer_align_monitors_linear, test_cases, G_N_ELEMENTS(test_cases));
 }
 
+static void
+test_monitor_cap(void)
+{
+    const struct {
+        gint max_width;
+        gint max_height;
+        gint64 max_area;
+        gboolean capped;
+        GdkRectangle in[2];
+        GdkRectangle out[2];
+    } test_cases[] = {
+        { 0, 0, 0, FALSE,
+          {{0, 0, 3840, 2160}, {3840, 0, 1920, 1080}},
+          {{0, 0, 3840, 2160}, {3840, 0, 1920, 1080}} },
+        { 1920, 1200, 0, TRUE,
+          {{0, 0, 3840, 2160}, {3840, 0, 1920, 1080}},
+          {{0, 0, 1920, 1080}, {3840, 0, 1920, 1080}} },
+        /* the width is rounded down to a multiple of 8 */
+        { 0, 600, 0, TRUE,
+          {{0, 0, 1280, 1024}, {0, 0, 0, 0}},
+          {{0, 0, 744, 600}, {0, 0, 0, 0}} },
+        { 0, 0, 2 * 1920 * 1080, TRUE,
+          {{0, 0, 2560, 1440}, {2560, 0, 2560, 1440}},
+          {{0, 0, 1920, 1080}, {2560, 0, 1920, 1080}} },
+        { 0, 0, 2 * 1920 * 1080, FALSE,
+          {{0, 0, 1920, 1080}, {1920, 0, 1920, 1080}},
+          {{0, 0, 1920, 1080}, {1920, 0, 1920, 1080}} },
+    };
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS(test_cases); i++) {
+        GHashTable *displays = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+        for (j = 0; j < G_N_ELEMENTS(test_cases[i].in); j++) {
+            GdkRectangle *monitor = g_new(GdkRectangle, 1);
+            *monitor = test_cases[i].in[j];
+            g_hash_table_insert(displays, GUINT_TO_POINTER(j), monitor);
+        }
+
+        g_assert_cmpint(virt_viewer_cap_monitors(displays,
+                                                 test_cases[i].max_width,
+                                                 test_cases[i].max_height,
+                                                 test_cases[i].max_area),
+                        ==, test_cases[i].capped);
+
+        for (j = 0; j < G_N_ELEMENTS(test_cases[i].out); j++) {
+            GdkRectangle *monitor = g_hash_table_lookup(displays, GUINT_TO_POINTER(j));
+            g_assert_cmpint(monitor->x, ==, test_cases[i].out[j].x);
+            g_assert_cmpint(monitor->y, ==, test_cases[i].out[j].y);
+            g_assert_cmpint(monitor->width, ==, test_cases[i].out[j].width);
+            g_assert_cmpint(monitor->height, ==, test_cases[i].out[j].height);
+        }
+        g_hash_table_unref(displays);
+    }
+}
+
+/* A window enlarged past the cap keeps its size when the guest takes the
+ * capped one, and asks for the same capped size again */
+static void
+test_monitor_cap_window(void)
+{
+    GHashTable *displays = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    GdkRectangle *monitor = g_new0(GdkRectangle, 1);
+    gint capped_width, capped_height;
+
+    monitor->width = 2560;
+    monitor->height = 1600;
+    g_hash_table_insert(displays, GUINT_TO_POINTER(0), monitor);
+
+    g_assert_true(virt_viewer_cap_monitors(displays, 0, 0, 1920 * 1080));
+    capped_width = monitor->width;
+    capped_height = monitor->height;
+    g_assert_cmpint(capped_width, <, 2560);
+    g_assert_cmpint(capped_height, <, 1600);
+
+    /* the guest took the capped size, the window keeps its own */
+    g_assert_true(virt_viewer_desktop_is_capped(2560, 1600, capped_width, capped_height,
+                                                capped_width, capped_height));
+    /* so the next request is capped the same */
+    monitor->width = 2560;
+    monitor->height = 1600;
+    g_assert_true(virt_viewer_cap_monitors(displays, 0, 0, 1920 * 1080));
+    g_assert_cmpint(monitor->width, ==, capped_width);
+    g_assert_cmpint(monitor->height, ==, capped_height);
+
+    /* the guest picked another size, the window follows it */
+    g_assert_false(virt_viewer_desktop_is_capped(2560, 1600, capped_width, capped_height,
+                                                 1024, 768));
+    /* nothing was capped, the window follows the guest */
+    g_assert_false(virt_viewer_desktop_is_capped(1280, 720, 1280, 720, 1280, 720));
+
+    g_hash_table_unref(displays);
+}
+
+static void
+test_parse_resolution(void)
+{
+    gint width = 0, height = 0;
+
+    g_assert_true(virt_viewer_parse_resolution("1920x1080", &width, &height));
+    g_assert_cmpint(width, ==, 1920);
+    g_assert_cmpint(height, ==, 1080);
+
+    g_assert_false(virt_viewer_parse_resolution("", NULL, NULL));
+    g_assert_false(virt_viewer_parse_resolution("1920", NULL, NULL));
+    g_assert_false(virt_viewer_parse_resolution("1920x", NULL, NULL));
+    g_assert_false(virt_viewer_parse_resolution("x1080", NULL, NULL));
+    g_assert_false(virt_viewer_parse_resolution("0x1080", NULL, NULL));
+    g_assert_false(virt_viewer_parse_resolution("1920x-1", NULL, NULL));
+    g_assert_false(virt_viewer_parse_resolution("1920x1080+0+0", NULL, NULL));
+}
+
 int main(int argc, char* argv[])
 {
     gtk_init_check(&argc, &argv);
@@ -208,6 +320,9 @@ int main(int argc, char* argv[])
 
     g_test_add_func("/virt-viewer-util/monitor-shift", test_monitor_shift);
     g_test_add_func("/virt-viewer-util/monitor-align-linear", test_monitor_align_linear);
+    g_test_add_func("/virt-viewer-util/monitor-cap", test_monitor_cap);
+    g_test_add_func("/virt-viewer-util/monitor-cap-window", test_monitor_cap_window);
+    g_test_add_func("/virt-viewer-util/parse-resolution", test_parse_resolution);
 
     return g_test_run();
 }
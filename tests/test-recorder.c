@@ -0,0 +1,213 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can brightistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <virt-viewer-recorder.h>
+
+gboolean doDebug = FALSE;
+
+static GdkPixbuf *
+create_frame(int width, int height, guint8 value)
+{
+    GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+
+    gdk_pixbuf_fill(pixbuf, (guint32)value << 24 | (guint32)value << 8 | 0xff);
+
+    return pixbuf;
+}
+
+static gchar *
+read_file(const gchar *dir, const gchar *name)
+{
+    gchar *path = g_build_filename(dir, name, NULL);
+    gchar *contents = NULL;
+    GError *error = NULL;
+
+    g_assert_true(g_file_get_contents(path, &contents, NULL, &error));
+    g_assert_no_error(error);
+    g_free(path);
+
+    return contents;
+}
+
+static void
+remove_dir(const gchar *dir)
+{
+    GDir *d = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+
+    while ((name = g_dir_read_name(d)) != NULL) {
+        gchar *path = g_build_filename(dir, name, NULL);
+        g_unlink(path);
+        g_free(path);
+    }
+    g_dir_close(d);
+    g_rmdir(dir);
+}
+
+static void
+test_unchanged(void)
+{
+    gchar *dir = g_dir_make_tmp("virt-viewer-record-XXXXXX", NULL);
+    VirtViewerRecorder *recorder = virt_viewer_recorder_new(dir, 100, NULL);
+    GdkPixbuf *bright = create_frame(64, 48, 0xff);
+    GdkPixbuf *black = create_frame(64, 48, 0);
+    VirtViewerRecorderStats stats;
+    gchar *manifest, *summary;
+    gchar **lines;
+
+    g_assert_nonnull(recorder);
+    g_assert_true(virt_viewer_recorder_push(recorder, 0, bright, 10));
+    g_assert_true(virt_viewer_recorder_push(recorder, 0, bright, 10));
+    g_assert_true(virt_viewer_recorder_push(recorder, 1, bright, 10));
+    g_assert_true(virt_viewer_recorder_push(recorder, 0, black, 10));
+    g_assert_true(virt_viewer_recorder_push(recorder, 1, bright, 10));
+    virt_viewer_recorder_stop(recorder);
+    g_assert_false(virt_viewer_recorder_push(recorder, 0, bright, 10));
+
+    virt_viewer_recorder_get_stats(recorder, &stats);
+    g_assert_cmpuint(stats.frames, ==, 5);
+    g_assert_cmpuint(stats.written, ==, 3);
+    g_assert_cmpuint(stats.unchanged, ==, 2);
+    g_assert_cmpuint(stats.dropped, ==, 0);
+    g_assert_cmpint(stats.grab_time, ==, 50);
+    g_assert_cmpuint(stats.bytes, >, 0);
+    virt_viewer_recorder_free(recorder);
+
+    manifest = read_file(dir, "manifest.csv");
+    lines = g_strsplit(manifest, "\n", -1);
+    g_assert_cmpuint(g_strv_length(lines), ==, 5);
+    g_assert_cmpstr(lines[0], ==, "display,time_us,file");
+    g_assert_true(g_str_has_prefix(lines[1], "1,"));
+    g_assert_true(g_str_has_suffix(lines[1], ",display1-000000.qoi"));
+    g_assert_true(g_str_has_suffix(lines[2], ",display2-000001.qoi"));
+    g_assert_true(g_str_has_suffix(lines[3], ",display1-000002.qoi"));
+    g_assert_cmpstr(lines[4], ==, "");
+    g_free(read_file(dir, "display1-000002.qoi"));
+
+    summary = read_file(dir, "summary.txt");
+    g_assert_nonnull(strstr(summary, "written=3\n"));
+    g_assert_nonnull(strstr(summary, "unchanged=2\n"));
+
+    g_free(summary);
+    g_strfreev(lines);
+    g_free(manifest);
+    g_object_unref(black);
+    g_object_unref(bright);
+    remove_dir(dir);
+    g_free(dir);
+}
+
+static void
+test_dropped(void)
+{
+    gchar *dir = g_dir_make_tmp("virt-viewer-record-XXXXXX", NULL);
+    VirtViewerRecorder *recorder = virt_viewer_recorder_new(dir, 2, NULL);
+    GdkPixbuf *frame = create_frame(1920, 1080, 0x80);
+    VirtViewerRecorderStats stats;
+    guint i, queued = 0;
+
+    /* pushed much faster than they can be hashed */
+    for (i = 0; i < 50; i++) {
+        if (virt_viewer_recorder_push(recorder, 0, frame, 0))
+            queued++;
+    }
+    g_object_unref(frame);
+    virt_viewer_recorder_stop(recorder);
+
+    virt_viewer_recorder_get_stats(recorder, &stats);
+    g_assert_cmpuint(stats.frames, ==, 50);
+    g_assert_cmpuint(stats.dropped, ==, 50 - queued);
+    g_assert_cmpuint(stats.dropped, >, 0);
+    g_assert_cmpuint(stats.written, ==, 1);
+    g_assert_cmpuint(stats.unchanged, ==, queued - 1);
+    virt_viewer_recorder_free(recorder);
+
+    remove_dir(dir);
+    g_free(dir);
+}
+
+static void
+test_invalid_dir(void)
+{
+    GError *error = NULL;
+
+    g_assert_null(virt_viewer_recorder_new("/dev/null/record", 1, &error));
+    g_assert_error(error, G_FILE_ERROR, G_FILE_ERROR_NOTDIR);
+    g_clear_error(&error);
+}
+
+/* The cost of a 1080p frame on the caller's side and in the thread */
+static void
+bench_record(void)
+{
+    gchar *dir = g_dir_make_tmp("virt-viewer-record-XXXXXX", NULL);
+    VirtViewerRecorder *recorder = virt_viewer_recorder_new(dir, 4, NULL);
+    GdkPixbuf *frame = create_frame(1920, 1080, 0x80);
+    VirtViewerRecorderStats stats;
+    const guint iterations = 100;
+    gint64 push = 0;
+    guint i;
+
+    for (i = 0; i < iterations; i++) {
+        gint64 start = g_get_monotonic_time();
+        GdkPixbuf *copy = gdk_pixbuf_copy(frame);
+        gint64 grabbed = g_get_monotonic_time();
+
+        /* a changing pixel, so that every frame gets encoded */
+        gdk_pixbuf_get_pixels(copy)[0] = i;
+        virt_viewer_recorder_push(recorder, 0, copy, grabbed - start);
+        push += g_get_monotonic_time() - start;
+        g_object_unref(copy);
+        g_usleep(G_USEC_PER_SEC / 50);
+    }
+    virt_viewer_recorder_stop(recorder);
+    virt_viewer_recorder_get_stats(recorder, &stats);
+
+    g_test_minimized_result(push / 1000.0 / iterations,
+                            "1920x1080: %.2f ms per frame on the caller's side",
+                            push / 1000.0 / iterations);
+    g_test_message("encoder: %.2f ms per frame, %u written, %u dropped",
+                   stats.encode_time / 1000.0 / MAX(stats.written, 1),
+                   stats.written, stats.dropped);
+
+    virt_viewer_recorder_free(recorder);
+    g_object_unref(frame);
+    remove_dir(dir);
+    g_free(dir);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/recorder/unchanged", test_unchanged);
+    g_test_add_func("/recorder/dropped", test_dropped);
+    g_test_add_func("/recorder/invalid-dir", test_invalid_dir);
+
+    if (g_test_perf())
+        g_test_add_func("/recorder/bench/record", bench_record);
+
+    return g_test_run();
+}
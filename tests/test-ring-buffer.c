@@ -0,0 +1,145 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <string.h>
+#include <virt-viewer-ring-buffer.h>
+
+gboolean doDebug = FALSE;
+
+#define CHUNK (64 * 1024)
+
+static void
+test_wrap(void)
+{
+    VirtViewerRingBuffer *buffer = virt_viewer_ring_buffer_new(8);
+    gconstpointer peek;
+    gchar data[8];
+
+    virt_viewer_ring_buffer_write(buffer, "abcdef", 6);
+    g_assert_cmpuint(virt_viewer_ring_buffer_read(buffer, data, 4), ==, 4);
+    g_assert_cmpmem(data, 4, "abcd", 4);
+
+    /* "ghij" wraps around the end of the 8 bytes */
+    virt_viewer_ring_buffer_write(buffer, "ghij", 4);
+    g_assert_cmpuint(virt_viewer_ring_buffer_get_length(buffer), ==, 6);
+    g_assert_cmpuint(virt_viewer_ring_buffer_peek(buffer, &peek), ==, 4);
+    g_assert_cmpmem(peek, 4, "efgh", 4);
+    virt_viewer_ring_buffer_consume(buffer, 4);
+    g_assert_cmpuint(virt_viewer_ring_buffer_peek(buffer, &peek), ==, 2);
+    g_assert_cmpmem(peek, 2, "ij", 2);
+    virt_viewer_ring_buffer_consume(buffer, 2);
+
+    g_assert_cmpuint(virt_viewer_ring_buffer_get_length(buffer), ==, 0);
+    g_assert_cmpuint(virt_viewer_ring_buffer_read(buffer, data, sizeof(data)), ==, 0);
+
+    virt_viewer_ring_buffer_free(buffer);
+}
+
+static void
+test_grow(void)
+{
+    VirtViewerRingBuffer *buffer = virt_viewer_ring_buffer_new(4);
+    gchar data[16];
+
+    virt_viewer_ring_buffer_write(buffer, "abc", 3);
+    g_assert_cmpuint(virt_viewer_ring_buffer_read(buffer, data, 2), ==, 2);
+    virt_viewer_ring_buffer_write(buffer, "de", 2);
+    /* grows while the queued bytes wrap around */
+    virt_viewer_ring_buffer_write(buffer, "fghijklm", 8);
+    g_assert_cmpuint(virt_viewer_ring_buffer_get_length(buffer), ==, 11);
+    g_assert_cmpuint(virt_viewer_ring_buffer_read(buffer, data, sizeof(data)), ==, 11);
+    g_assert_cmpmem(data, 11, "cdefghijklm", 11);
+
+    virt_viewer_ring_buffer_free(buffer);
+}
+
+/* Writes @total bytes in chunks of 1 to 128 bytes, as typed or pasted in a
+ * terminal, while reading them back in large chunks as a port would, and
+ * checks nothing is lost or reordered */
+static gdouble
+drive_port(gsize total)
+{
+    VirtViewerRingBuffer *buffer = virt_viewer_ring_buffer_new(4096);
+    GRand *rand = g_rand_new_with_seed(42);
+    guint8 *input = g_malloc(total);
+    guint8 *output = g_malloc(total);
+    gsize written = 0, read = 0;
+    gdouble elapsed;
+    gsize i;
+
+    for (i = 0; i < total; i++)
+        input[i] = g_rand_int(rand);
+
+    g_test_timer_start();
+    while (read < total) {
+        gsize size = MIN(total - written, (gsize)g_rand_int_range(rand, 1, 129));
+
+        virt_viewer_ring_buffer_write(buffer, input + written, size);
+        written += size;
+
+        /* one write in flight at a time, the others are merged */
+        if (virt_viewer_ring_buffer_get_length(buffer) >= CHUNK || written == total)
+            read += virt_viewer_ring_buffer_read(buffer, output + read, CHUNK);
+    }
+    elapsed = g_test_timer_elapsed();
+
+    g_assert_cmpmem(input, total, output, total);
+
+    g_free(input);
+    g_free(output);
+    g_rand_free(rand);
+    virt_viewer_ring_buffer_free(buffer);
+
+    return elapsed;
+}
+
+static void
+test_port(void)
+{
+    drive_port(4 * 1024 * 1024);
+}
+
+static void
+bench_port(void)
+{
+    const gsize total = 64 * 1024 * 1024;
+    gdouble elapsed = drive_port(total);
+
+    g_test_minimized_result(elapsed, "%zu MiB through the port buffer in %.1f ms, %.0f MiB/s",
+                            total / (1024 * 1024), elapsed * 1000,
+                            total / (1024 * 1024) / elapsed);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/ring-buffer/wrap", test_wrap);
+    g_test_add_func("/ring-buffer/grow", test_grow);
+    g_test_add_func("/ring-buffer/port", test_port);
+
+    if (g_test_perf())
+        g_test_add_func("/ring-buffer/bench/port", bench_port);
+
+    return g_test_run();
+}
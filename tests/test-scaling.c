@@ -0,0 +1,112 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <virt-viewer-util.h>
+
+gboolean doDebug = FALSE;
+
+typedef struct {
+    gint desktop_width, desktop_height;
+    gint width, height;
+    gint scaled_width, scaled_height;
+} ScaleCase;
+
+static void
+test_off(void)
+{
+    static const ScaleCase cases[] = {
+        { 1024, 768, 1920, 1080, 1024, 768 },
+        { 1024, 768, 800, 1080, 800, 768 },
+        { 1024, 768, 800, 600, 800, 600 },
+    };
+    gsize i;
+
+    for (i = 0; i < G_N_ELEMENTS(cases); i++) {
+        gint width = 0, height = 0;
+
+        virt_viewer_scale_desktop_off(cases[i].desktop_width, cases[i].desktop_height,
+                                      cases[i].width, cases[i].height,
+                                      &width, &height);
+        g_assert_cmpint(width, ==, cases[i].scaled_width);
+        g_assert_cmpint(height, ==, cases[i].scaled_height);
+    }
+}
+
+static void
+test_integer(void)
+{
+    static const ScaleCase cases[] = {
+        /* fits as is */
+        { 1024, 768, 1024, 768, 1024, 768 },
+        { 1024, 768, 1920, 1080, 1024, 768 },
+        /* zoomed in, limited by the height */
+        { 800, 600, 2560, 1440, 1600, 1200 },
+        { 640, 480, 1920, 1440, 1920, 1440 },
+        /* zoomed out, limited by the width */
+        { 3840, 2160, 1920, 1440, 1920, 1080 },
+        { 3840, 2160, 1919, 1440, 1280, 720 },
+        /* zoomed out, limited by the height */
+        { 1920, 1200, 1920, 1080, 960, 600 },
+        /* never smaller than a pixel */
+        { 1920, 3, 100, 100, 96, 1 },
+    };
+    gsize i;
+
+    for (i = 0; i < G_N_ELEMENTS(cases); i++) {
+        gint width = 0, height = 0;
+
+        virt_viewer_scale_desktop_integer(cases[i].desktop_width, cases[i].desktop_height,
+                                          cases[i].width, cases[i].height,
+                                          &width, &height);
+        g_assert_cmpint(width, ==, cases[i].scaled_width);
+        g_assert_cmpint(height, ==, cases[i].scaled_height);
+    }
+}
+
+static void
+test_is_integer(void)
+{
+    g_assert_true(virt_viewer_is_integer_scale(1024, 768, 1024, 768));
+    g_assert_true(virt_viewer_is_integer_scale(1024, 768, 2048, 1536));
+    g_assert_true(virt_viewer_is_integer_scale(3840, 2160, 1920, 1080));
+    g_assert_true(virt_viewer_is_integer_scale(3840, 2160, 1280, 720));
+
+    /* not the same factor in both directions */
+    g_assert_false(virt_viewer_is_integer_scale(1024, 768, 2048, 768));
+    g_assert_false(virt_viewer_is_integer_scale(3840, 2160, 1920, 2160));
+    g_assert_false(virt_viewer_is_integer_scale(3840, 2160, 1280, 1080));
+    /* not an integer factor */
+    g_assert_false(virt_viewer_is_integer_scale(1024, 768, 1536, 1152));
+    g_assert_false(virt_viewer_is_integer_scale(1920, 1080, 1280, 720));
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/scaling/off", test_off);
+    g_test_add_func("/scaling/integer", test_integer);
+    g_test_add_func("/scaling/is-integer", test_is_integer);
+
+    return g_test_run();
+}
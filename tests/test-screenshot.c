@@ -0,0 +1,265 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <virt-viewer-screenshot.h>
+
+gboolean doDebug = FALSE;
+
+/* Some flat areas, gradients and noise, as on a desktop */
+static GdkPixbuf *
+create_pixbuf(int width, int height, gboolean alpha)
+{
+    GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, alpha, 8, width, height);
+    int channels = gdk_pixbuf_get_n_channels(pixbuf);
+    int stride = gdk_pixbuf_get_rowstride(pixbuf);
+    guint8 *pixels = gdk_pixbuf_get_pixels(pixbuf);
+    GRand *rand = g_rand_new_with_seed(42);
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            guint8 *px = pixels + y * stride + x * channels;
+
+            if (y < height / 3) {
+                px[0] = 0x20; px[1] = 0x40; px[2] = 0x80;
+            } else if (y < 2 * height / 3) {
+                px[0] = x; px[1] = y; px[2] = x + y;
+            } else {
+                px[0] = g_rand_int(rand); px[1] = g_rand_int(rand); px[2] = g_rand_int(rand);
+            }
+            if (alpha)
+                px[3] = x % 7 == 0 ? 0x80 : 0xff;
+        }
+    }
+    g_rand_free(rand);
+
+    return pixbuf;
+}
+
+static guint32
+read_32(const guint8 *p)
+{
+    return (guint32)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+/* A plain QOI decoder, to check the encoder against */
+static guint8 *
+decode_qoi(GBytes *bytes, int *width, int *height, int *channels)
+{
+    gsize size;
+    const guint8 *p = g_bytes_get_data(bytes, &size);
+    const guint8 *end = p + size - 8;
+    guint8 index[64][4] = { { 0 } };
+    guint8 px[4] = { 0, 0, 0, 255 };
+    guint8 *pixels, *out;
+    int npixels, run = 0;
+
+    g_assert_cmpmem(p, 4, "qoif", 4);
+    *width = read_32(p + 4);
+    *height = read_32(p + 8);
+    *channels = p[12];
+    p += 14;
+
+    npixels = *width * *height;
+    pixels = out = g_malloc(npixels * 4);
+    while (npixels-- > 0) {
+        if (run > 0) {
+            run--;
+        } else {
+            guint8 b = *p++;
+
+            g_assert_true(p <= end);
+            if (b == 0xfe) {
+                memcpy(px, p, 3);
+                p += 3;
+            } else if (b == 0xff) {
+                memcpy(px, p, 4);
+                p += 4;
+            } else if ((b & 0xc0) == 0x00) {
+                memcpy(px, index[b], 4);
+            } else if ((b & 0xc0) == 0x40) {
+                px[0] += ((b >> 4) & 3) - 2;
+                px[1] += ((b >> 2) & 3) - 2;
+                px[2] += (b & 3) - 2;
+            } else if ((b & 0xc0) == 0x80) {
+                guint8 b2 = *p++;
+                int vg = (b & 0x3f) - 32;
+
+                px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+                px[1] += vg;
+                px[2] += vg - 8 + (b2 & 0x0f);
+            } else {
+                run = b & 0x3f;
+            }
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        }
+        memcpy(out, px, 4);
+        out += 4;
+    }
+    g_assert_true(p == end);
+    g_assert_cmpmem(end, 8, "\0\0\0\0\0\0\0\1", 8);
+
+    return pixels;
+}
+
+static void
+test_qoi(gconstpointer data)
+{
+    gboolean alpha = GPOINTER_TO_INT(data);
+    GdkPixbuf *pixbuf = create_pixbuf(300, 200, alpha);
+    int stride = gdk_pixbuf_get_rowstride(pixbuf);
+    int n = gdk_pixbuf_get_n_channels(pixbuf);
+    const guint8 *pixels = gdk_pixbuf_read_pixels(pixbuf);
+    GBytes *bytes = virt_viewer_screenshot_encode_qoi(pixbuf);
+    int width, height, channels, x, y;
+    guint8 *decoded = decode_qoi(bytes, &width, &height, &channels);
+
+    g_assert_cmpint(width, ==, 300);
+    g_assert_cmpint(height, ==, 200);
+    g_assert_cmpint(channels, ==, n);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            const guint8 *px = decoded + (y * width + x) * 4;
+
+            g_assert_cmpmem(px, 3, pixels + y * stride + x * n, 3);
+            g_assert_cmpint(px[3], ==, alpha ? pixels[y * stride + x * n + 3] : 255);
+        }
+    }
+
+    g_free(decoded);
+    g_bytes_unref(bytes);
+    g_object_unref(pixbuf);
+}
+
+static void
+test_ppm(void)
+{
+    GdkPixbuf *pixbuf = create_pixbuf(40, 30, TRUE);
+    GBytes *bytes = virt_viewer_screenshot_encode_ppm(pixbuf);
+    const guint8 *pixels = gdk_pixbuf_read_pixels(pixbuf);
+    int stride = gdk_pixbuf_get_rowstride(pixbuf);
+    const gchar header[] = "P6\n40 30\n255\n";
+    gsize size;
+    const guint8 *data = g_bytes_get_data(bytes, &size);
+
+    g_assert_cmpuint(size, ==, strlen(header) + 40 * 30 * 3);
+    g_assert_cmpmem(data, strlen(header), header, strlen(header));
+    data += strlen(header);
+    g_assert_cmpmem(data + (29 * 40 + 39) * 3, 3, pixels + 29 * stride + 39 * 4, 3);
+
+    g_bytes_unref(bytes);
+    g_object_unref(pixbuf);
+}
+
+static void
+saved(GObject *source G_GNUC_UNUSED, GAsyncResult *result, gpointer user_data)
+{
+    GError *error = NULL;
+
+    g_assert_true(virt_viewer_screenshot_save_finish(result, &error));
+    g_assert_no_error(error);
+    g_main_loop_quit(user_data);
+}
+
+static void
+test_save_async(void)
+{
+    gchar *dir = g_dir_make_tmp("virt-viewer-screenshot-XXXXXX", NULL);
+    gchar *path = g_build_filename(dir, "screenshot.qoi", NULL);
+    GdkPixbuf *pixbuf = create_pixbuf(64, 48, FALSE);
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+    GBytes *bytes = virt_viewer_screenshot_encode_qoi(pixbuf);
+    GError *error = NULL;
+    gchar *contents;
+    gsize length;
+
+    virt_viewer_screenshot_save_async(pixbuf, path, NULL, saved, loop);
+    g_main_loop_run(loop);
+
+    g_assert_true(g_file_get_contents(path, &contents, &length, &error));
+    g_assert_no_error(error);
+    g_assert_cmpmem(contents, length,
+                    g_bytes_get_data(bytes, NULL), g_bytes_get_size(bytes));
+
+    g_assert_false(virt_viewer_screenshot_save(pixbuf, "screenshot.unknown", &error));
+    g_assert_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED);
+    g_clear_error(&error);
+
+    g_free(contents);
+    g_bytes_unref(bytes);
+    g_main_loop_unref(loop);
+    g_object_unref(pixbuf);
+    g_unlink(path);
+    g_rmdir(dir);
+    g_free(path);
+    g_free(dir);
+}
+
+static void
+bench_encode(void)
+{
+    GdkPixbuf *pixbuf = create_pixbuf(3840, 2160, FALSE);
+    gchar *buffer;
+    gsize size;
+    gdouble png, qoi, ppm;
+    GBytes *bytes;
+
+    g_test_timer_start();
+    g_assert_true(gdk_pixbuf_save_to_buffer(pixbuf, &buffer, &size, "png", NULL, NULL));
+    png = g_test_timer_elapsed();
+    g_test_message("png: %.1f ms, %zu bytes", png * 1000, size);
+    g_free(buffer);
+
+    g_test_timer_start();
+    bytes = virt_viewer_screenshot_encode_qoi(pixbuf);
+    qoi = g_test_timer_elapsed();
+    g_test_message("qoi: %.1f ms, %zu bytes", qoi * 1000, g_bytes_get_size(bytes));
+    g_bytes_unref(bytes);
+
+    g_test_timer_start();
+    bytes = virt_viewer_screenshot_encode_ppm(pixbuf);
+    ppm = g_test_timer_elapsed();
+    g_test_message("ppm: %.1f ms, %zu bytes", ppm * 1000, g_bytes_get_size(bytes));
+    g_bytes_unref(bytes);
+
+    g_test_minimized_result(qoi, "3840x2160 qoi encoding %.1f ms (png %.1fx slower)",
+                            qoi * 1000, png / qoi);
+    g_object_unref(pixbuf);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_data_func("/screenshot/qoi-rgb", GINT_TO_POINTER(FALSE), test_qoi);
+    g_test_add_data_func("/screenshot/qoi-rgba", GINT_TO_POINTER(TRUE), test_qoi);
+    g_test_add_func("/screenshot/ppm", test_ppm);
+    g_test_add_func("/screenshot/save-async", test_save_async);
+
+    if (g_test_perf())
+        g_test_add_func("/screenshot/bench/encode", bench_encode);
+
+    return g_test_run();
+}
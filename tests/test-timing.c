@@ -0,0 +1,125 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 The virt-viewer contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <virt-viewer-timing.h>
+
+gboolean doDebug = FALSE;
+
+static void
+test_phases(void)
+{
+    VirtViewerTiming *timing = virt_viewer_timing_new("remote-viewer");
+    gchar *record;
+    gint64 start;
+
+    /* nothing is recorded outside of an attempt */
+    virt_viewer_timing_mark(timing, "ignored");
+    g_assert_false(virt_viewer_timing_is_started(timing));
+    g_assert_null(virt_viewer_timing_finish(timing, "ready", g_get_monotonic_time()));
+
+    virt_viewer_timing_start(timing, "initial-connect");
+    g_assert_true(virt_viewer_timing_is_started(timing));
+    start = g_get_monotonic_time();
+    virt_viewer_timing_start(timing, "initial-connect");
+    virt_viewer_timing_mark_at(timing, "activate", start + 1500);
+    virt_viewer_timing_mark_at(timing, "display-ready 0", start + 250000);
+    record = virt_viewer_timing_finish(timing, "ready", start + 250250);
+    g_assert_false(virt_viewer_timing_is_started(timing));
+
+    g_assert_true(g_str_has_prefix(record, "{\"program\":\"remote-viewer\",\"attempt\":1,\"start\":"));
+    g_assert_nonnull(strstr(record, ",\"result\":\"ready\",\"duration\":"));
+    g_assert_nonnull(strstr(record, "\"phases\":[{\"phase\":\"initial-connect\",\"time\":0.000},"
+                                    "{\"phase\":\"initial-connect\",\"time\":"));
+    g_assert_nonnull(strstr(record, "{\"phase\":\"display-ready 0\",\"time\":"));
+    g_assert_null(strstr(record, "ignored"));
+    g_assert_true(g_str_has_suffix(record, "}]}"));
+    g_free(record);
+
+    virt_viewer_timing_start(timing, "initial-connect");
+    record = virt_viewer_timing_finish(timing, "failed", g_get_monotonic_time());
+    g_assert_nonnull(strstr(record, "\"attempt\":2,"));
+    g_assert_nonnull(strstr(record, "\"result\":\"failed\""));
+    g_free(record);
+
+    virt_viewer_timing_free(timing);
+}
+
+static void
+test_escaping(void)
+{
+    VirtViewerTiming *timing = virt_viewer_timing_new("a\"b\\c");
+    gchar *record;
+
+    virt_viewer_timing_start(timing, "tab\there\nnewline");
+    record = virt_viewer_timing_finish(timing, "ok", g_get_monotonic_time());
+    g_assert_true(g_str_has_prefix(record, "{\"program\":\"a\\\"b\\\\c\","));
+    g_assert_nonnull(strstr(record, "\"tab\\u0009here\\u000anewline\""));
+    g_assert_null(strchr(record, '\n'));
+    g_free(record);
+
+    virt_viewer_timing_free(timing);
+}
+
+static void
+test_append(void)
+{
+    GError *error = NULL;
+    gchar *dir = g_dir_make_tmp("virt-viewer-timing-XXXXXX", &error);
+    gchar *filename, *contents = NULL;
+
+    g_assert_no_error(error);
+    filename = g_build_filename(dir, "timing.json", NULL);
+
+    g_assert_true(virt_viewer_timing_append_to_file(filename, "{\"attempt\":1}", &error));
+    g_assert_no_error(error);
+    g_assert_true(virt_viewer_timing_append_to_file(filename, "{\"attempt\":2}", &error));
+    g_assert_no_error(error);
+    g_assert_true(g_file_get_contents(filename, &contents, NULL, &error));
+    g_assert_cmpstr(contents, ==, "{\"attempt\":1}\n{\"attempt\":2}\n");
+    g_free(contents);
+
+    g_assert_cmpint(g_unlink(filename), ==, 0);
+    g_free(filename);
+
+    filename = g_build_filename(dir, "missing", "timing.json", NULL);
+    g_assert_false(virt_viewer_timing_append_to_file(filename, "{}", &error));
+    g_assert_error(error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+    g_clear_error(&error);
+    g_free(filename);
+
+    g_assert_cmpint(g_rmdir(dir), ==, 0);
+    g_free(dir);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/timing/phases", test_phases);
+    g_test_add_func("/timing/escaping", test_escaping);
+    g_test_add_func("/timing/append", test_append);
+
+    return g_test_run();
+}